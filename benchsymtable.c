@@ -0,0 +1,1600 @@
+/*--------------------------------------------------------------------*/
+/* benchsymtable.c                                                    */
+/* Author: Tinney Mak                                                 */
+/*--------------------------------------------------------------------*/
+
+/* For clock_gettime(), the POSIX threads of the concurrent
+   benchmark and the processes of the shared one. */
+#define _POSIX_C_SOURCE 200112L
+
+#include "symtable.h"
+#include "symfrozen.h"
+#include "symdurable.h"
+#include "symhash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+
+/*--------------------------------------------------------------------*/
+
+/* Return the CPU time consumed between iInitialClock and
+   iFinalClock, in seconds. */
+
+static double cpuSeconds(clock_t iInitialClock, clock_t iFinalClock)
+{
+   return ((double)(iFinalClock - iInitialClock)) / CLOCKS_PER_SEC;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the current value of a monotonic wall clock, in
+   nanoseconds. */
+
+static long long wallNanoseconds(void)
+{
+   struct timespec sTime;
+   int iSuccessful;
+
+   iSuccessful = clock_gettime(CLOCK_MONOTONIC, &sTime);
+   assert(iSuccessful == 0);
+   return (long long)sTime.tv_sec * 1000000000LL + sTime.tv_nsec;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Compare the latencies that pvFirst and pvSecond point to, for
+   qsort(). */
+
+static int compareLatencies(const void *pvFirst, const void *pvSecond)
+{
+   long long llFirst = *(const long long*)pvFirst;
+   long long llSecond = *(const long long*)pvSecond;
+
+   return (llFirst > llSecond) - (llFirst < llSecond);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write iKeyNum as ten zero-padded decimal digits at the end of
+   pcKey, a key of uKeyLength characters whose other characters were
+   already set by the caller.  Distinct keys thus share a long
+   prefix.  uKeyLength must be at least 10. */
+
+static void setKeySuffix(char *pcKey, size_t uKeyLength, int iKeyNum)
+{
+   char acDigits[11];
+
+   assert(pcKey != NULL);
+   assert(uKeyLength >= 10);
+
+   sprintf(acDigits, "%010d", iKeyNum);
+   memcpy(pcKey + uKeyLength - 10, acDigits, 10);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure the time to put iBindingCount bindings whose keys are
+   uKeyLength characters long into a SymTable object, and then the
+   time to get each of them iRounds times.  Write the times consumed
+   to stdout. */
+
+static void benchLongKeys(int iBindingCount, size_t uKeyLength,
+   int iRounds)
+{
+   SymTable_T oSymTable;
+   char *pcKey;
+   int i;
+   int iRound;
+   int iSuccessful;
+   void *pvValue;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   pcKey = (char*)malloc(uKeyLength + 1);
+   assert(pcKey != NULL);
+   memset(pcKey, 'k', uKeyLength);
+   pcKey[uKeyLength] = '\0';
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+
+   iInitialClock = clock();
+   for (i = 0; i < iBindingCount; i++)
+   {
+      setKeySuffix(pcKey, uKeyLength, i);
+      iSuccessful = SymTable_put(oSymTable, pcKey, pcKey);
+      assert(iSuccessful);
+   }
+   iFinalClock = clock();
+   printf("put  %d keys of length %lu:  %f seconds\n", iBindingCount,
+      (unsigned long)uKeyLength, cpuSeconds(iInitialClock, iFinalClock));
+
+   iInitialClock = clock();
+   for (iRound = 0; iRound < iRounds; iRound++)
+      for (i = 0; i < iBindingCount; i++)
+      {
+         setKeySuffix(pcKey, uKeyLength, i);
+         pvValue = SymTable_get(oSymTable, pcKey);
+         assert(pvValue != NULL);
+      }
+   iFinalClock = clock();
+   printf("get  %d keys of length %lu x %d:  %f seconds\n",
+      iBindingCount, (unsigned long)uKeyLength, iRounds,
+      cpuSeconds(iInitialClock, iFinalClock));
+   fflush(stdout);
+
+   SymTable_free(oSymTable);
+   free(pcKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure the time to put iBindingCount bindings whose keys are the
+   decimal numerals 0 through iBindingCount-1, as testsymtable.c
+   does, and then the time to get each of them iRounds times and to
+   look up as many absent keys.  Write the times consumed to
+   stdout. */
+
+static void benchLookups(int iBindingCount, int iRounds)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   int i;
+   int iRound;
+   int iSuccessful;
+   int iFound;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+
+   iInitialClock = clock();
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, NULL);
+      assert(iSuccessful);
+   }
+   iFinalClock = clock();
+   printf("put  %d numeral keys:  %f seconds\n", iBindingCount,
+      cpuSeconds(iInitialClock, iFinalClock));
+
+   iInitialClock = clock();
+   for (iRound = 0; iRound < iRounds; iRound++)
+      for (i = 0; i < iBindingCount; i++)
+      {
+         sprintf(acKey, "%d", i);
+         iFound = SymTable_contains(oSymTable, acKey);
+         assert(iFound);
+      }
+   iFinalClock = clock();
+   printf("hit  %d numeral keys x %d:  %f seconds\n", iBindingCount,
+      iRounds, cpuSeconds(iInitialClock, iFinalClock));
+
+   iInitialClock = clock();
+   for (iRound = 0; iRound < iRounds; iRound++)
+      for (i = 0; i < iBindingCount; i++)
+      {
+         sprintf(acKey, "%d", -1 - i);
+         iFound = SymTable_contains(oSymTable, acKey);
+         assert(! iFound);
+      }
+   iFinalClock = clock();
+   printf("miss %d numeral keys x %d:  %f seconds\n", iBindingCount,
+      iRounds, cpuSeconds(iInitialClock, iFinalClock));
+   fflush(stdout);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure the time to get each of iBindingCount bindings whose keys
+   are decimal numerals iRounds times, in a shuffled order, first
+   with one call of SymTable_get per key and then with calls of
+   SymTable_getBatch on BATCH_SIZE keys at a time.  With enough
+   bindings the table does not fit in the cache, so most lookups miss
+   it.  Write the times consumed to stdout. */
+
+static void benchBatchLookups(int iBindingCount, int iRounds)
+{
+   enum {MAX_KEY_LENGTH = 12, BATCH_SIZE = 1024};
+
+   SymTable_T oSymTable;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   const char **ppcKeys;
+   const char *pcSwap;
+   void *apvValues[BATCH_SIZE];
+   void *pvValue;
+   int i;
+   int j;
+   int iRound;
+   int iSuccessful;
+   int iBatch;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   pacKeys = (char(*)[MAX_KEY_LENGTH])
+      malloc((size_t)iBindingCount * MAX_KEY_LENGTH);
+   ppcKeys = (const char**)malloc((size_t)iBindingCount * sizeof(char*));
+   assert(pacKeys != NULL && ppcKeys != NULL);
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(pacKeys[i], "%d", i);
+      ppcKeys[i] = pacKeys[i];
+      iSuccessful = SymTable_put(oSymTable, pacKeys[i], pacKeys[i]);
+      assert(iSuccessful);
+   }
+
+   /* Shuffle the lookups so that consecutive keys are in unrelated
+      parts of the table */
+   srand(1);
+   for (i = iBindingCount - 1; i > 0; i--)
+   {
+      j = rand() % (i + 1);
+      pcSwap = ppcKeys[i];
+      ppcKeys[i] = ppcKeys[j];
+      ppcKeys[j] = pcSwap;
+   }
+
+   iInitialClock = clock();
+   for (iRound = 0; iRound < iRounds; iRound++)
+      for (i = 0; i < iBindingCount; i++)
+      {
+         pvValue = SymTable_get(oSymTable, ppcKeys[i]);
+         assert(pvValue == ppcKeys[i]);
+      }
+   iFinalClock = clock();
+   printf("get       %d shuffled keys x %d:  %f seconds\n",
+      iBindingCount, iRounds, cpuSeconds(iInitialClock, iFinalClock));
+
+   iInitialClock = clock();
+   for (iRound = 0; iRound < iRounds; iRound++)
+      for (i = 0; i < iBindingCount; i += BATCH_SIZE)
+      {
+         iBatch = iBindingCount - i < BATCH_SIZE ?
+            iBindingCount - i : BATCH_SIZE;
+         SymTable_getBatch(oSymTable, &ppcKeys[i], (size_t)iBatch,
+            apvValues);
+         for (j = 0; j < iBatch; j++)
+            assert(apvValues[j] == ppcKeys[i + j]);
+      }
+   iFinalClock = clock();
+   printf("getBatch  %d shuffled keys x %d:  %f seconds\n",
+      iBindingCount, iRounds, cpuSeconds(iInitialClock, iFinalClock));
+   fflush(stdout);
+
+   SymTable_free(oSymTable);
+   free(ppcKeys);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure the time to build a SymTable object holding iBindingCount
+   bindings whose keys are decimal numerals, first with one call of
+   SymTable_put per binding and then with one call of
+   SymTable_bulkLoad.  Write the times consumed to stdout. */
+
+static void benchBulkLoad(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   char (*pacKeys)[MAX_KEY_LENGTH];
+   const char **ppcKeys;
+   void **ppvValues;
+   int i;
+   int iSuccessful;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   pacKeys = (char(*)[MAX_KEY_LENGTH])
+      malloc((size_t)iBindingCount * MAX_KEY_LENGTH);
+   ppcKeys = (const char**)malloc((size_t)iBindingCount * sizeof(char*));
+   ppvValues = (void**)malloc((size_t)iBindingCount * sizeof(void*));
+   assert(pacKeys != NULL && ppcKeys != NULL && ppvValues != NULL);
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(pacKeys[i], "%d", i);
+      ppcKeys[i] = pacKeys[i];
+      ppvValues[i] = pacKeys[i];
+   }
+
+   iInitialClock = clock();
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      iSuccessful = SymTable_put(oSymTable, ppcKeys[i], ppvValues[i]);
+      assert(iSuccessful);
+   }
+   iFinalClock = clock();
+   printf("put       %d numeral keys:  %f seconds\n", iBindingCount,
+      cpuSeconds(iInitialClock, iFinalClock));
+   SymTable_free(oSymTable);
+
+   iInitialClock = clock();
+   oSymTable = SymTable_bulkLoad(ppcKeys, ppvValues,
+      (size_t)iBindingCount, NULL);
+   assert(oSymTable != NULL);
+   iFinalClock = clock();
+   printf("bulkLoad  %d numeral keys:  %f seconds\n", iBindingCount,
+      cpuSeconds(iInitialClock, iFinalClock));
+   fflush(stdout);
+   SymTable_free(oSymTable);
+
+   free(ppvValues);
+   free(ppcKeys);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure the time to make iTableCount SymTable objects holding
+   iBindingCount bindings each, as a compiler makes one per scope,
+   to get each binding of each of them, and to free them.  Write the
+   times consumed to stdout. */
+
+static void benchSmallTables(int iTableCount, int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   SymTable_T *poSymTables;
+   char acKey[MAX_KEY_LENGTH];
+   int i;
+   int j;
+   int iSuccessful;
+   void *pvValue;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   poSymTables =
+      (SymTable_T*)malloc((size_t)iTableCount * sizeof(SymTable_T));
+   assert(poSymTables != NULL);
+
+   iInitialClock = clock();
+   for (i = 0; i < iTableCount; i++)
+   {
+      poSymTables[i] = SymTable_new();
+      assert(poSymTables[i] != NULL);
+      for (j = 0; j < iBindingCount; j++)
+      {
+         sprintf(acKey, "v%d", j);
+         iSuccessful = SymTable_put(poSymTables[i], acKey, poSymTables);
+         assert(iSuccessful);
+      }
+   }
+   iFinalClock = clock();
+   printf("make %d tables of %d bindings:  %f seconds\n", iTableCount,
+      iBindingCount, cpuSeconds(iInitialClock, iFinalClock));
+
+   iInitialClock = clock();
+   for (i = 0; i < iTableCount; i++)
+      for (j = 0; j < iBindingCount; j++)
+      {
+         sprintf(acKey, "v%d", j);
+         pvValue = SymTable_get(poSymTables[i], acKey);
+         assert(pvValue == poSymTables);
+      }
+   iFinalClock = clock();
+   printf("get  %d tables of %d bindings:  %f seconds\n", iTableCount,
+      iBindingCount, cpuSeconds(iInitialClock, iFinalClock));
+
+   iInitialClock = clock();
+   for (i = 0; i < iTableCount; i++)
+      SymTable_free(poSymTables[i]);
+   iFinalClock = clock();
+   printf("free %d tables of %d bindings:  %f seconds\n", iTableCount,
+      iBindingCount, cpuSeconds(iInitialClock, iFinalClock));
+   fflush(stdout);
+
+   free(poSymTables);
+}
+
+/*--------------------------------------------------------------------*/
+
+enum {CONCURRENT_KEY_LENGTH = 12};
+
+/* A ConcurrentWorker is the work of one thread of benchConcurrent. */
+
+struct ConcurrentWorker
+{
+   /* The table that every thread uses */
+   SymTable_T oSymTable;
+
+   /* The keys bound in the table, and their number */
+   char (*pacKeys)[CONCURRENT_KEY_LENGTH];
+   int iKeyCount;
+
+   /* The number of operations to perform, and the percentage of
+      them that are lookups */
+   int iOpCount;
+   int iReadPercent;
+
+   /* The seed of the thread's random numbers */
+   unsigned long long ullSeed;
+};
+
+/* Perform the operations of the ConcurrentWorker at pvWorker on
+   random keys of its table: lookups, or removals of a binding that
+   put it back at once, so that the table keeps its size. Return
+   NULL. */
+
+static void *concurrentWork(void *pvWorker)
+{
+   struct ConcurrentWorker *psWorker = (struct ConcurrentWorker*)pvWorker;
+   unsigned long long ullRandom = psWorker->ullSeed;
+   const char *pcKey;
+   void *pvValue;
+   int iSuccessful;
+   int i;
+
+   for (i = 0; i < psWorker->iOpCount; i++)
+   {
+      /* xorshift64 */
+      ullRandom ^= ullRandom << 13;
+      ullRandom ^= ullRandom >> 7;
+      ullRandom ^= ullRandom << 17;
+
+      pcKey = psWorker->pacKeys[(ullRandom >> 8)
+         % (unsigned long long)psWorker->iKeyCount];
+      if ((int)(ullRandom % 100) < psWorker->iReadPercent)
+      {
+         /* Misses while another thread puts the binding back
+            are expected */
+         pvValue = SymTable_get(psWorker->oSymTable, pcKey);
+         (void)pvValue;
+      }
+      else
+      {
+         /* Another thread may have removed the binding already */
+         pvValue = SymTable_remove(psWorker->oSymTable, pcKey);
+         if (pvValue != NULL)
+         {
+            iSuccessful = SymTable_put(psWorker->oSymTable, pcKey,
+               pvValue);
+            assert(iSuccessful);
+         }
+      }
+   }
+   return NULL;
+}
+
+/* Measure the wall-clock time for 1, 2, 4, ... 64 threads to share
+   iOpCount operations, iReadPercent percent of them lookups and the
+   rest removals that put the binding back, on a table made by
+   SymTable_newConcurrent holding iBindingCount bindings.  Write the
+   throughputs to stdout, or a note if the implementation does not
+   support concurrent use. */
+
+static void benchConcurrent(int iBindingCount, int iReadPercent,
+   int iOpCount)
+{
+   enum {MAX_THREAD_COUNT = 64};
+
+   SymTable_T oSymTable;
+   char (*pacKeys)[CONCURRENT_KEY_LENGTH];
+   struct ConcurrentWorker asWorkers[MAX_THREAD_COUNT];
+   pthread_t aiThreads[MAX_THREAD_COUNT];
+   int iThreadCount;
+   int iSuccessful;
+   int i;
+   long long llStart;
+   long long llEnd;
+
+   oSymTable = SymTable_newConcurrent();
+   if (oSymTable == NULL)
+   {
+      printf("no concurrent tables in this implementation\n");
+      fflush(stdout);
+      return;
+   }
+
+   pacKeys = (char(*)[CONCURRENT_KEY_LENGTH])
+      malloc((size_t)iBindingCount * CONCURRENT_KEY_LENGTH);
+   assert(pacKeys != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(pacKeys[i], "%d", i);
+      iSuccessful = SymTable_put(oSymTable, pacKeys[i], pacKeys[i]);
+      assert(iSuccessful);
+   }
+
+   for (iThreadCount = 1; iThreadCount <= MAX_THREAD_COUNT;
+      iThreadCount *= 2)
+   {
+      llStart = wallNanoseconds();
+      for (i = 0; i < iThreadCount; i++)
+      {
+         asWorkers[i].oSymTable = oSymTable;
+         asWorkers[i].pacKeys = pacKeys;
+         asWorkers[i].iKeyCount = iBindingCount;
+         asWorkers[i].iOpCount = iOpCount / iThreadCount;
+         asWorkers[i].iReadPercent = iReadPercent;
+         asWorkers[i].ullSeed = 0x9E3779B97F4A7C15ULL * (unsigned)(i + 1);
+         iSuccessful = pthread_create(&aiThreads[i], NULL,
+            concurrentWork, &asWorkers[i]);
+         assert(iSuccessful == 0);
+      }
+      for (i = 0; i < iThreadCount; i++)
+      {
+         iSuccessful = pthread_join(aiThreads[i], NULL);
+         assert(iSuccessful == 0);
+      }
+      llEnd = wallNanoseconds();
+
+      printf("%2d threads, %2d%% reads:  %f million ops per second\n",
+         iThreadCount, iReadPercent,
+         (double)(iOpCount / iThreadCount * iThreadCount) * 1000.0
+            / (double)(llEnd - llStart));
+      fflush(stdout);
+   }
+
+   SymTable_free(oSymTable);
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* An InsertWorker is the work of one thread of benchConcurrentInserts. */
+
+struct InsertWorker
+{
+   /* The table that every thread uses */
+   SymTable_T oSymTable;
+
+   /* The keys to put, and their number */
+   char (*pacKeys)[CONCURRENT_KEY_LENGTH];
+   int iKeyCount;
+
+   /* The longest time one put took, in nanoseconds */
+   long long llMaxLatency;
+};
+
+/* Put the keys of the InsertWorker at pvWorker into its table,
+   recording the longest time a put took. Return NULL. */
+
+static void *insertWork(void *pvWorker)
+{
+   struct InsertWorker *psWorker = (struct InsertWorker*)pvWorker;
+   long long llStart;
+   long long llLatency;
+   int iSuccessful;
+   int i;
+
+   psWorker->llMaxLatency = 0;
+   for (i = 0; i < psWorker->iKeyCount; i++)
+   {
+      llStart = wallNanoseconds();
+      iSuccessful = SymTable_put(psWorker->oSymTable,
+         psWorker->pacKeys[i], psWorker->pacKeys[i]);
+      llLatency = wallNanoseconds() - llStart;
+      assert(iSuccessful);
+      if (llLatency > psWorker->llMaxLatency)
+         psWorker->llMaxLatency = llLatency;
+   }
+   return NULL;
+}
+
+/* Measure the wall-clock time for 1, 2, 4, ... 64 threads to put
+   iBindingCount bindings, split evenly between them, into an empty
+   table made by SymTable_newConcurrent, which grows many times as
+   they do.  Write the throughputs and the longest time any one put
+   took to stdout, or a note if the implementation does not support
+   concurrent use. */
+
+static void benchConcurrentInserts(int iBindingCount)
+{
+   enum {MAX_THREAD_COUNT = 64};
+
+   SymTable_T oSymTable;
+   char (*pacKeys)[CONCURRENT_KEY_LENGTH];
+   struct InsertWorker asWorkers[MAX_THREAD_COUNT];
+   pthread_t aiThreads[MAX_THREAD_COUNT];
+   int iThreadCount;
+   int iSuccessful;
+   int i;
+   long long llStart;
+   long long llEnd;
+   long long llMaxLatency;
+
+   pacKeys = (char(*)[CONCURRENT_KEY_LENGTH])
+      malloc((size_t)iBindingCount * CONCURRENT_KEY_LENGTH);
+   assert(pacKeys != NULL);
+   for (i = 0; i < iBindingCount; i++)
+      sprintf(pacKeys[i], "%d", i);
+
+   for (iThreadCount = 1; iThreadCount <= MAX_THREAD_COUNT;
+      iThreadCount *= 2)
+   {
+      oSymTable = SymTable_newConcurrent();
+      if (oSymTable == NULL)
+      {
+         printf("no concurrent tables in this implementation\n");
+         fflush(stdout);
+         break;
+      }
+
+      llStart = wallNanoseconds();
+      for (i = 0; i < iThreadCount; i++)
+      {
+         asWorkers[i].oSymTable = oSymTable;
+         asWorkers[i].pacKeys =
+            pacKeys + (size_t)iBindingCount / iThreadCount * i;
+         asWorkers[i].iKeyCount = iBindingCount / iThreadCount;
+         iSuccessful = pthread_create(&aiThreads[i], NULL,
+            insertWork, &asWorkers[i]);
+         assert(iSuccessful == 0);
+      }
+      llMaxLatency = 0;
+      for (i = 0; i < iThreadCount; i++)
+      {
+         iSuccessful = pthread_join(aiThreads[i], NULL);
+         assert(iSuccessful == 0);
+         if (asWorkers[i].llMaxLatency > llMaxLatency)
+            llMaxLatency = asWorkers[i].llMaxLatency;
+      }
+      llEnd = wallNanoseconds();
+
+      printf("%2d threads:  %f million puts per second, "
+         "longest put %lld microseconds\n", iThreadCount,
+         (double)(iBindingCount / iThreadCount * iThreadCount) * 1000.0
+            / (double)(llEnd - llStart), llMaxLatency / 1000);
+      fflush(stdout);
+      SymTable_free(oSymTable);
+   }
+
+   free(pacKeys);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Add the length of the key pcKey to the size_t at pvExtra. */
+
+static void sumKeyLength(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   (void)pvValue;
+   *(size_t*)pvExtra += strlen(pcKey);
+}
+
+/* Measure the time to visit each of iBindingCount bindings iRounds
+   times with SymTable_map, with an iterator, and with a scan that
+   asks for SCAN_COUNT bindings per call, summing the lengths of
+   their keys.  Write the times consumed to stdout. */
+
+static void benchWalks(int iBindingCount, int iRounds)
+{
+   enum {MAX_KEY_LENGTH = 12};
+   enum {SCAN_COUNT = 1000};
+
+   SymTable_T oSymTable;
+   SymTable_Iter sIter;
+   char acKey[MAX_KEY_LENGTH];
+   const char *pcKey;
+   size_t uLength;
+   size_t uSum;
+   size_t uExpectedSum = 0;
+   size_t uCursor;
+   int iSuccessful;
+   int iRound;
+   int i;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      uExpectedSum += strlen(acKey);
+      iSuccessful = SymTable_put(oSymTable, acKey, NULL);
+      assert(iSuccessful);
+   }
+
+   iInitialClock = clock();
+   for (iRound = 0; iRound < iRounds; iRound++)
+   {
+      uSum = 0;
+      SymTable_map(oSymTable, sumKeyLength, &uSum);
+      assert(uSum == uExpectedSum);
+   }
+   iFinalClock = clock();
+   printf("map  %d bindings x %d:  %f seconds\n", iBindingCount,
+      iRounds, cpuSeconds(iInitialClock, iFinalClock));
+
+   iInitialClock = clock();
+   for (iRound = 0; iRound < iRounds; iRound++)
+   {
+      uSum = 0;
+      SymTable_iterBegin(oSymTable, &sIter);
+      while (SymTable_iterNext(&sIter, &pcKey, &uLength, NULL))
+         uSum += uLength;
+      SymTable_iterEnd(&sIter);
+      assert(uSum == uExpectedSum);
+   }
+   iFinalClock = clock();
+   printf("iter %d bindings x %d:  %f seconds\n", iBindingCount,
+      iRounds, cpuSeconds(iInitialClock, iFinalClock));
+
+   iInitialClock = clock();
+   for (iRound = 0; iRound < iRounds; iRound++)
+   {
+      uSum = 0;
+      uCursor = 0;
+      do
+         uCursor = SymTable_scan(oSymTable, uCursor, SCAN_COUNT,
+            sumKeyLength, &uSum);
+      while (uCursor != 0);
+      assert(uSum == uExpectedSum);
+   }
+   iFinalClock = clock();
+   printf("scan %d bindings x %d:  %f seconds\n", iBindingCount,
+      iRounds, cpuSeconds(iInitialClock, iFinalClock));
+   fflush(stdout);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure the time to freeze a table of iBindingCount bindings whose
+   keys are decimal numerals, and then to look up each key iRounds
+   times in the frozen table, where every key is found, and to look
+   up as many absent keys.  Write the times consumed to stdout. */
+
+static void benchFrozen(int iBindingCount, int iRounds)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   SymFrozen_T oSymFrozen;
+   char acKey[MAX_KEY_LENGTH];
+   int i;
+   int iRound;
+   int iSuccessful;
+   int iFound;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, NULL);
+      assert(iSuccessful);
+   }
+
+   iInitialClock = clock();
+   oSymFrozen = SymTable_freeze(oSymTable);
+   iFinalClock = clock();
+   assert(oSymFrozen != NULL);
+   printf("freeze %d numeral keys:  %f seconds\n", iBindingCount,
+      cpuSeconds(iInitialClock, iFinalClock));
+   SymTable_free(oSymTable);
+
+   iInitialClock = clock();
+   for (iRound = 0; iRound < iRounds; iRound++)
+      for (i = 0; i < iBindingCount; i++)
+      {
+         sprintf(acKey, "%d", i);
+         iFound = SymFrozen_contains(oSymFrozen, acKey);
+         assert(iFound);
+      }
+   iFinalClock = clock();
+   printf("hit  %d numeral keys x %d:  %f seconds\n", iBindingCount,
+      iRounds, cpuSeconds(iInitialClock, iFinalClock));
+
+   iInitialClock = clock();
+   for (iRound = 0; iRound < iRounds; iRound++)
+      for (i = 0; i < iBindingCount; i++)
+      {
+         sprintf(acKey, "%d", -1 - i);
+         iFound = SymFrozen_contains(oSymFrozen, acKey);
+         assert(! iFound);
+      }
+   iFinalClock = clock();
+   printf("miss %d numeral keys x %d:  %f seconds\n", iBindingCount,
+      iRounds, cpuSeconds(iInitialClock, iFinalClock));
+   fflush(stdout);
+
+   SymFrozen_free(oSymFrozen);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure the time to save a table of iBindingCount bindings whose
+   keys are decimal numerals, to map the saved file back, as a
+   process would instead of putting every binding again, and to look
+   up each key once in the mapped table.  Write the times consumed to
+   stdout. */
+
+static void benchSaveAndOpen(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   static const char *pcPath = "benchsymtable.sym";
+
+   SymTable_T oSymTable;
+   SymFrozen_T oSymFrozen;
+   char acKey[MAX_KEY_LENGTH];
+   int i;
+   int iSuccessful;
+   int iFound;
+   long long iInitialTime;
+   long long iFinalTime;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   iInitialClock = clock();
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, NULL);
+      assert(iSuccessful);
+   }
+   iFinalClock = clock();
+   printf("put  %d numeral keys:  %f seconds\n", iBindingCount,
+      cpuSeconds(iInitialClock, iFinalClock));
+
+   iInitialTime = wallNanoseconds();
+   iSuccessful = SymTable_save(oSymTable, pcPath);
+   iFinalTime = wallNanoseconds();
+   assert(iSuccessful);
+   printf("save %d numeral keys:  %f seconds\n", iBindingCount,
+      (double)(iFinalTime - iInitialTime) / 1e9);
+   SymTable_free(oSymTable);
+
+   iInitialTime = wallNanoseconds();
+   oSymFrozen = SymTable_openMapped(pcPath);
+   iFinalTime = wallNanoseconds();
+   assert(oSymFrozen != NULL);
+   printf("open %d numeral keys:  %f seconds\n", iBindingCount,
+      (double)(iFinalTime - iInitialTime) / 1e9);
+
+   iInitialClock = clock();
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iFound = SymFrozen_contains(oSymFrozen, acKey);
+      assert(iFound);
+   }
+   iFinalClock = clock();
+   printf("hit  %d numeral keys:  %f seconds\n", iBindingCount,
+      cpuSeconds(iInitialClock, iFinalClock));
+   fflush(stdout);
+
+   SymFrozen_free(oSymFrozen);
+   remove(pcPath);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* A DurableWorker is the work of one thread of benchDurable. */
+
+struct DurableWorker
+{
+   /* The table that every thread uses */
+   SymDurable_T oSymDurable;
+
+   /* The number of the thread, which its keys contain, and the
+      number of keys it puts */
+   int iThread;
+   int iKeyCount;
+};
+
+/* Put the keys of the DurableWorker at pvWorker into its table.
+   Return NULL. */
+
+static void *durableWork(void *pvWorker)
+{
+   struct DurableWorker *psWorker = (struct DurableWorker*)pvWorker;
+   char acKey[32];
+   int iSuccessful;
+   int i;
+
+   for (i = 0; i < psWorker->iKeyCount; i++)
+   {
+      sprintf(acKey, "%d:%d", psWorker->iThread, i);
+      iSuccessful = SymDurable_put(psWorker->oSymDurable, acKey, NULL);
+      assert(iSuccessful);
+   }
+   return NULL;
+}
+
+/* Measure the wall-clock time for 1, 4, 16 and 64 threads to put
+   iBindingCount bindings, split evenly between them, into a new
+   SymDurable table, where each put returns only once it is on disk,
+   and then the time to open the table again from its log.  Write the
+   throughputs and times to stdout. */
+
+static void benchDurable(int iBindingCount)
+{
+   enum {MAX_THREAD_COUNT = 64};
+
+   static const char *pcPath = "benchsymtable.dur";
+   static const char *pcLogPath = "benchsymtable.dur.log";
+
+   SymDurable_T oSymDurable;
+   struct DurableWorker asWorkers[MAX_THREAD_COUNT];
+   pthread_t aiThreads[MAX_THREAD_COUNT];
+   int iThreadCount;
+   int iSuccessful;
+   int i;
+   long long llStart;
+   long long llEnd;
+
+   for (iThreadCount = 1; iThreadCount <= MAX_THREAD_COUNT;
+      iThreadCount *= 4)
+   {
+      remove(pcPath);
+      remove(pcLogPath);
+      oSymDurable = SymDurable_open(pcPath);
+      assert(oSymDurable != NULL);
+
+      llStart = wallNanoseconds();
+      for (i = 0; i < iThreadCount; i++)
+      {
+         asWorkers[i].oSymDurable = oSymDurable;
+         asWorkers[i].iThread = i;
+         asWorkers[i].iKeyCount = iBindingCount / iThreadCount;
+         iSuccessful = pthread_create(&aiThreads[i], NULL,
+            durableWork, &asWorkers[i]);
+         assert(iSuccessful == 0);
+      }
+      for (i = 0; i < iThreadCount; i++)
+      {
+         iSuccessful = pthread_join(aiThreads[i], NULL);
+         assert(iSuccessful == 0);
+      }
+      llEnd = wallNanoseconds();
+      printf("%2d threads:  %f thousand durable puts per second\n",
+         iThreadCount,
+         (double)(iBindingCount / iThreadCount * iThreadCount) * 1e6
+            / (double)(llEnd - llStart));
+      fflush(stdout);
+      SymDurable_close(oSymDurable);
+   }
+
+   llStart = wallNanoseconds();
+   oSymDurable = SymDurable_open(pcPath);
+   llEnd = wallNanoseconds();
+   assert(oSymDurable != NULL);
+   printf("open %d bindings:  %f seconds\n",
+      (int)SymDurable_getLength(oSymDurable),
+      (double)(llEnd - llStart) / 1e9);
+   fflush(stdout);
+   SymDurable_close(oSymDurable);
+   remove(pcPath);
+   remove(pcLogPath);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* A ProcessResult is what one worker process of benchProcesses
+   reports to the parent. */
+
+struct ProcessResult
+{
+   /* The wall-clock times at which the worker started and finished
+      its lookups, in nanoseconds */
+   long long llStart;
+   long long llEnd;
+
+   /* The number of lookups */
+   long lLookups;
+
+   /* The memory of the worker once it is done, in kilobytes: its
+      resident set, and its proportional share of it, in which each
+      page shared by n processes counts 1/n; -1 if unknown */
+   long lRssKb;
+   long lPssKb;
+
+   /* 1 if the worker saw a binding that the parent added after it
+      started, and 0 otherwise */
+   int iSawWrite;
+};
+
+/* Store in *plRssKb and *plPssKb the resident set size of this
+   process and its proportional set size, in kilobytes, or -1 if the
+   system does not report them. */
+
+static void readMemory(long *plRssKb, long *plPssKb)
+{
+   FILE *psFile;
+   char acLine[128];
+   long lValue;
+
+   *plRssKb = -1;
+   *plPssKb = -1;
+   psFile = fopen("/proc/self/smaps_rollup", "r");
+   if (psFile == NULL)
+      return;
+   while (fgets(acLine, (int)sizeof(acLine), psFile) != NULL)
+   {
+      if (sscanf(acLine, "Rss: %ld kB", &lValue) == 1)
+         *plRssKb = lValue;
+      else if (sscanf(acLine, "Pss: %ld kB", &lValue) == 1)
+         *plPssKb = lValue;
+   }
+   fclose(psFile);
+}
+
+/* Be one worker process of benchProcesses: if oSymTable is NULL,
+   put iBindingCount bindings into a table of its own, as a worker
+   that loads its own copy would, and otherwise use oSymTable, made
+   by the parent before the fork.  Look each key up iRounds times,
+   write a ProcessResult to file descriptor iResultFd, and wait for
+   file descriptor iReleaseFd to be closed before exiting, so that
+   the workers measure their memory while all of them are alive. */
+
+static void processWork(SymTable_T oSymTable, int iBindingCount,
+   int iRounds, int iResultFd, int iReleaseFd)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   struct ProcessResult sResult;
+   char acKey[MAX_KEY_LENGTH];
+   char cByte;
+   int iRound;
+   int i;
+   int iSuccessful;
+   void *pvValue;
+
+   if (oSymTable == NULL)
+   {
+      oSymTable = SymTable_new();
+      assert(oSymTable != NULL);
+      for (i = 0; i < iBindingCount; i++)
+      {
+         sprintf(acKey, "%d", i);
+         iSuccessful = SymTable_put(oSymTable, acKey, &acKey[0]);
+         assert(iSuccessful);
+      }
+   }
+
+   sResult.llStart = wallNanoseconds();
+   for (iRound = 0; iRound < iRounds; iRound++)
+      for (i = 0; i < iBindingCount; i++)
+      {
+         sprintf(acKey, "%d", i);
+         pvValue = SymTable_get(oSymTable, acKey);
+         assert(pvValue != NULL);
+      }
+   sResult.llEnd = wallNanoseconds();
+   sResult.lLookups = (long)iBindingCount * iRounds;
+   sResult.iSawWrite = SymTable_contains(oSymTable, "after the fork");
+   readMemory(&sResult.lRssKb, &sResult.lPssKb);
+
+   iSuccessful = write(iResultFd, &sResult, sizeof(sResult))
+      == (ssize_t)sizeof(sResult);
+   assert(iSuccessful);
+   while (read(iReleaseFd, &cByte, 1) > 0)
+      ;
+   _exit(0);
+}
+
+/* Measure the lookup throughput and memory of 1, 4 and 16 worker
+   processes that look up each of the iBindingCount bindings of a
+   table iRounds times while the parent process replaces values in
+   its own table, first with each worker putting the bindings into a
+   table of its own, then with every worker using the parent's table,
+   made before the workers were forked.  A table that lives in shared
+   memory is shared by every worker and shows them the parent's
+   changes; any other is copied page by page as the parent changes
+   it.  Write the throughputs, the mean resident and proportional set
+   sizes of the workers, and whether they saw a binding added after
+   they started, to stdout. */
+
+static void benchProcesses(int iBindingCount, int iRounds)
+{
+   enum {MAX_KEY_LENGTH = 12};
+   enum {MAX_PROCESS_COUNT = 16};
+   enum {REPLACE_STEP = 1024};
+
+   static const char *apcModes[2] = {"copies", "shared"};
+
+   SymTable_T oSymTable;
+   struct ProcessResult sResult;
+   pid_t aiPids[MAX_PROCESS_COUNT];
+   struct pollfd sPollFd;
+   char acKey[MAX_KEY_LENGTH];
+   int aiResultFds[2];
+   int aiReleaseFds[2];
+   int iMode;
+   int iProcessCount;
+   int iResultCount;
+   int iSawWriteCount;
+   int i;
+   int iSuccessful;
+   long long llStart;
+   long long llEnd;
+   long lLookups;
+   long lRssKb;
+   long lPssKb;
+   long lReplaced = 0;
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &acKey[0]);
+      assert(iSuccessful);
+   }
+
+   for (iMode = 0; iMode < 2; iMode++)
+      for (iProcessCount = 1; iProcessCount <= MAX_PROCESS_COUNT;
+         iProcessCount *= 4)
+      {
+         iSuccessful = pipe(aiResultFds) == 0
+            && pipe(aiReleaseFds) == 0;
+         assert(iSuccessful);
+         fflush(stdout);
+         for (i = 0; i < iProcessCount; i++)
+         {
+            aiPids[i] = fork();
+            assert(aiPids[i] >= 0);
+            if (aiPids[i] == 0)
+            {
+               close(aiResultFds[0]);
+               close(aiReleaseFds[1]);
+               processWork(iMode == 0 ? NULL : oSymTable,
+                  iBindingCount, iRounds, aiResultFds[1],
+                  aiReleaseFds[0]);
+            }
+         }
+         close(aiResultFds[1]);
+         close(aiReleaseFds[0]);
+
+         /* The parent changes its table until every worker is done */
+         iSuccessful = SymTable_put(oSymTable, "after the fork", NULL);
+         assert(iSuccessful);
+         sPollFd.fd = aiResultFds[0];
+         sPollFd.events = POLLIN;
+         llStart = 0;
+         llEnd = 0;
+         lLookups = 0;
+         lRssKb = 0;
+         lPssKb = 0;
+         iSawWriteCount = 0;
+         for (iResultCount = 0; iResultCount < iProcessCount; )
+         {
+            for (i = 0; i < REPLACE_STEP; i++)
+            {
+               sprintf(acKey, "%ld", lReplaced++ % iBindingCount);
+               (void)SymTable_replace(oSymTable, acKey,
+                  &acKey[lReplaced % 2]);
+            }
+            if (poll(&sPollFd, 1, 0) <= 0)
+               continue;
+            iSuccessful = read(aiResultFds[0], &sResult, sizeof(sResult))
+               == (ssize_t)sizeof(sResult);
+            assert(iSuccessful);
+            if (iResultCount == 0 || sResult.llStart < llStart)
+               llStart = sResult.llStart;
+            if (sResult.llEnd > llEnd)
+               llEnd = sResult.llEnd;
+            lLookups += sResult.lLookups;
+            lRssKb += sResult.lRssKb;
+            lPssKb += sResult.lPssKb;
+            iSawWriteCount += sResult.iSawWrite;
+            iResultCount++;
+         }
+         close(aiReleaseFds[1]);
+         close(aiResultFds[0]);
+         for (i = 0; i < iProcessCount; i++)
+         {
+            iSuccessful = waitpid(aiPids[i], NULL, 0) == aiPids[i];
+            assert(iSuccessful);
+         }
+         (void)SymTable_remove(oSymTable, "after the fork");
+
+         printf("%s, %2d processes:  %f million lookups per second, "
+            "%ld kB RSS and %ld kB PSS per process, "
+            "%d of them saw writes\n", apcModes[iMode], iProcessCount,
+            (double)lLookups * 1e3 / (double)(llEnd - llStart),
+            lRssKb / iProcessCount, lPssKb / iProcessCount,
+            iSawWriteCount);
+         fflush(stdout);
+      }
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Hash the key pcKey many times, as an expensive callback would work
+   on each binding, and add the result to the size_t at pvExtra. */
+
+static void hashBindingRepeatedly(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   enum {REPEAT_COUNT = 32};
+
+   size_t uLength = strlen(pcKey);
+   size_t uHash = 0;
+   int i;
+
+   (void)pvValue;
+   for (i = 0; i < REPEAT_COUNT; i++)
+      uHash = SymHash_hash(pcKey, uLength, uHash);
+   *(size_t*)pvExtra += uHash;
+}
+
+/* Measure the wall-clock time for SymTable_mapParallel with 1, 2,
+   4, ... 16 workers to apply an expensive function to each binding
+   of a table holding iBindingCount bindings.  Write the times
+   consumed to stdout. */
+
+static void benchMapParallel(int iBindingCount)
+{
+   enum {MAX_WORKER_COUNT = 16};
+   enum {MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   size_t auSums[MAX_WORKER_COUNT];
+   void *apvExtras[MAX_WORKER_COUNT];
+   size_t uWorkerCount;
+   size_t w;
+   int iSuccessful;
+   int i;
+   long long llStart;
+   long long llEnd;
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, oSymTable);
+      assert(iSuccessful);
+   }
+   for (w = 0; w < MAX_WORKER_COUNT; w++)
+      apvExtras[w] = &auSums[w];
+
+   for (uWorkerCount = 1; uWorkerCount <= MAX_WORKER_COUNT;
+      uWorkerCount *= 2)
+   {
+      memset(auSums, 0, sizeof(auSums));
+      llStart = wallNanoseconds();
+      SymTable_mapParallel(oSymTable, hashBindingRepeatedly, apvExtras,
+         uWorkerCount);
+      llEnd = wallNanoseconds();
+      printf("mapParallel with %2lu workers:  %f seconds\n",
+         (unsigned long)uWorkerCount, (double)(llEnd - llStart) / 1e9);
+      fflush(stdout);
+   }
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put bindings whose keys are the decimal numerals 0, 1, 2, ... into
+   a new SymTable object until it holds at least iBindingCount / 2
+   bindings and the ratio of bindings to buckets (slots, for an
+   open-addressing table) has just risen to dLoadFactor.  Then
+   measure the time to look up each key iRounds times, and as many
+   absent keys.  Write the load factor reached and the times
+   consumed, per lookup, to stdout. */
+
+static void benchLoadFactor(int iBindingCount, double dLoadFactor,
+   int iRounds)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   int i;
+   int iRound;
+   int iSuccessful;
+   int iFound;
+   int iKeyCount = 0;
+   double dLoad = 0.0;
+   double dPreviousLoad;
+   size_t uBucketCount = 0;
+   size_t uPreviousBucketCount;
+   double dLookups;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+
+   /* A table that grows drops to or below dLoadFactor again, so keep
+      going until the load reaches it from below or the table grows
+      onto it.  A table with a single bucket never does either, and a
+      table that grows before it gets that full may not; stop those
+      at 4 * iBindingCount keys. */
+   do
+   {
+      sprintf(acKey, "%d", iKeyCount);
+      iSuccessful = SymTable_put(oSymTable, acKey, NULL);
+      assert(iSuccessful);
+      iKeyCount++;
+      dPreviousLoad = dLoad;
+      uPreviousBucketCount = uBucketCount;
+      uBucketCount = SymTable_getBucketCount(oSymTable);
+      dLoad = (double)SymTable_getLength(oSymTable) /
+         (double)uBucketCount;
+   } while (iKeyCount < iBindingCount / 2 ||
+      (uBucketCount > 1 && iKeyCount < 4 * iBindingCount &&
+         ! (dLoad >= dLoadFactor &&
+            (dPreviousLoad < dLoadFactor ||
+               uBucketCount != uPreviousBucketCount))));
+   dLookups = (double)iKeyCount * iRounds;
+   printf("load %.3f with %d keys:\n", dLoad, iKeyCount);
+
+   iInitialClock = clock();
+   for (iRound = 0; iRound < iRounds; iRound++)
+      for (i = 0; i < iKeyCount; i++)
+      {
+         sprintf(acKey, "%d", i);
+         iFound = SymTable_contains(oSymTable, acKey);
+         assert(iFound);
+      }
+   iFinalClock = clock();
+   printf("   hit   %f ns per lookup\n",
+      cpuSeconds(iInitialClock, iFinalClock) * 1e9 / dLookups);
+
+   iInitialClock = clock();
+   for (iRound = 0; iRound < iRounds; iRound++)
+      for (i = 0; i < iKeyCount; i++)
+      {
+         sprintf(acKey, "%d", -1 - i);
+         iFound = SymTable_contains(oSymTable, acKey);
+         assert(! iFound);
+      }
+   iFinalClock = clock();
+   printf("   miss  %f ns per lookup\n",
+      cpuSeconds(iInitialClock, iFinalClock) * 1e9 / dLookups);
+   fflush(stdout);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Put iBindingCount bindings whose keys are the decimal numerals 0
+   through iBindingCount-1 into a new SymTable object, timing each
+   put separately with a wall clock.  Write the median, 99th
+   percentile, 99.9th percentile and maximum latency of a put to
+   stdout.  The tail shows the cost of growing the table. */
+
+static void benchPutLatency(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 12};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   long long *pllLatencies;
+   long long llStart;
+   int i;
+   int iSuccessful;
+
+   pllLatencies =
+      (long long*)malloc((size_t)iBindingCount * sizeof(long long));
+   assert(pllLatencies != NULL);
+
+   oSymTable = SymTable_new();
+   assert(oSymTable != NULL);
+
+   for (i = 0; i < iBindingCount; i++)
+   {
+      sprintf(acKey, "%d", i);
+      llStart = wallNanoseconds();
+      iSuccessful = SymTable_put(oSymTable, acKey, NULL);
+      pllLatencies[i] = wallNanoseconds() - llStart;
+      assert(iSuccessful);
+   }
+
+   qsort(pllLatencies, (size_t)iBindingCount, sizeof(long long),
+      compareLatencies);
+   printf("put  %d numeral keys, ns per put:\n", iBindingCount);
+   printf("   p50 %lld  p99 %lld  p99.9 %lld  max %lld\n",
+      pllLatencies[iBindingCount / 2],
+      pllLatencies[(int)((double)iBindingCount * 0.99)],
+      pllLatencies[(int)((double)iBindingCount * 0.999)],
+      pllLatencies[iBindingCount - 1]);
+   fflush(stdout);
+
+   SymTable_free(oSymTable);
+   free(pllLatencies);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash of the uLength bytes at pvKey given by the hash
+   function from the assignment specification, which symtablehash.c
+   used before it took a SymTable_HashFunction.  uSeed is unused. */
+
+static size_t assignmentHash(const void *pvKey, size_t uLength,
+   size_t uSeed)
+{
+   const size_t HASH_MULTIPLIER = 65599;
+   const char *pcKey = (const char*)pvKey;
+   size_t u;
+   size_t uHash = 0;
+
+   (void)uSeed;
+   for (u = 0; u < uLength; u++)
+      uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+   return uHash;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Measure the throughput of hash function *pfHash, named pcName, on
+   keys of each length from 1 to 1000 bytes, hashing about
+   uByteCount bytes per length.  Write the times consumed, in
+   nanoseconds per hash, to stdout. */
+
+static void benchHashFunction(const char *pcName,
+   SymTable_HashFunction pfHash, size_t uByteCount)
+{
+   enum {MAX_KEY_LENGTH = 1000};
+   static const size_t auKeyLengths[] =
+      {1, 4, 8, 12, 16, 24, 32, 64, 128, 256, 1000};
+
+   char acKey[MAX_KEY_LENGTH];
+   size_t uLengthIndex;
+   size_t uKeyLength;
+   size_t uHashCount;
+   size_t u;
+   size_t uCombined = 0;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+
+   memset(acKey, 'k', sizeof(acKey));
+   printf("%s, ns per hash:\n", pcName);
+
+   for (uLengthIndex = 0;
+      uLengthIndex < sizeof(auKeyLengths) / sizeof(auKeyLengths[0]);
+      uLengthIndex++)
+   {
+      uKeyLength = auKeyLengths[uLengthIndex];
+      uHashCount = uByteCount / uKeyLength;
+
+      /* Feed each hash into the next key, so that the hashes can
+         neither be skipped nor overlapped. */
+      iInitialClock = clock();
+      for (u = 0; u < uHashCount; u++)
+      {
+         acKey[0] = (char)uCombined;
+         uCombined += (*pfHash)(acKey, uKeyLength, 0);
+      }
+      iFinalClock = clock();
+      printf("   length %4lu:  %f\n", (unsigned long)uKeyLength,
+         cpuSeconds(iInitialClock, iFinalClock) * 1e9 /
+            (double)uHashCount);
+   }
+
+   /* Use the hashes so that the compiler keeps the loop. */
+   printf("   (checksum %lu)\n", (unsigned long)uCombined);
+   fflush(stdout);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Run the SymTable benchmarks and write their timings to stdout.
+   As always, argc is the command-line argument count, argv contains
+   the command-line arguments, and argv[0] is the name of the
+   executable binary file. argv[1] is the number of bindings to put
+   into each benchmarked SymTable object.  Exit with EXIT_FAILURE
+   if argv[1] is missing or not a positive number.  Otherwise
+   return 0. */
+
+int main(int argc, char *argv[])
+{
+   int iBindingCount;
+
+   if (argc != 2)
+   {
+      fprintf(stderr, "Usage: %s bindingcount\n", argv[0]);
+      exit(EXIT_FAILURE);
+   }
+
+   if (sscanf(argv[1], "%d", &iBindingCount) != 1)
+   {
+      fprintf(stderr, "bindingcount must be numeric\n");
+      exit(EXIT_FAILURE);
+   }
+   if (iBindingCount <= 0)
+   {
+      fprintf(stderr, "bindingcount must be positive\n");
+      exit(EXIT_FAILURE);
+   }
+
+   printf("------------------------------------------------------\n");
+   printf("Lookups.\n");
+   benchLookups(iBindingCount, 10);
+
+   printf("------------------------------------------------------\n");
+   printf("Batch lookups.\n");
+   benchBatchLookups(iBindingCount, 10);
+
+   printf("------------------------------------------------------\n");
+   printf("Bulk loading.\n");
+   benchBulkLoad(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("Small tables.\n");
+   benchSmallTables(iBindingCount / 4, 4);
+
+   printf("------------------------------------------------------\n");
+   printf("Concurrent operations.\n");
+   benchConcurrent(iBindingCount, 50, 2 * iBindingCount);
+   benchConcurrent(iBindingCount, 90, 2 * iBindingCount);
+   benchConcurrent(iBindingCount, 99, 2 * iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("Concurrent puts across growth.\n");
+   benchConcurrentInserts(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("Parallel map.\n");
+   benchMapParallel(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("Walks.\n");
+   benchWalks(iBindingCount, 10);
+
+   printf("------------------------------------------------------\n");
+   printf("Frozen tables.\n");
+   benchFrozen(iBindingCount, 10);
+
+   printf("------------------------------------------------------\n");
+   printf("Saved tables.\n");
+   benchSaveAndOpen(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("Durable tables.\n");
+   benchDurable(iBindingCount < 100000 ? iBindingCount : 100000);
+
+   printf("------------------------------------------------------\n");
+   printf("Processes sharing a table.\n");
+   benchProcesses(iBindingCount, 2);
+
+   printf("------------------------------------------------------\n");
+   printf("Load factors.\n");
+   benchLoadFactor(iBindingCount, 0.5, 10);
+   benchLoadFactor(iBindingCount, 0.75, 10);
+   benchLoadFactor(iBindingCount, 0.875, 10);
+
+   printf("------------------------------------------------------\n");
+   printf("Put latency.\n");
+   benchPutLatency(iBindingCount);
+
+   printf("------------------------------------------------------\n");
+   printf("Hash functions.\n");
+   benchHashFunction("default", SymHash_hash, 200000000);
+   benchHashFunction("assignment", assignmentHash, 200000000);
+
+   printf("------------------------------------------------------\n");
+   printf("Long keys.\n");
+   benchLongKeys(iBindingCount, 16, 10);
+   benchLongKeys(iBindingCount, 1000, 10);
+
+   printf("------------------------------------------------------\n");
+   printf("End of %s.\n", argv[0]);
+   return 0;
+}
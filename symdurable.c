@@ -0,0 +1,939 @@
+/* symdurable.c
+Author: Tinney Mak */
+
+/* For open, fsync and pread */
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "symtable.h"
+#include "symfrozen.h"
+#include "symdurable.h"
+#include "symhash.h"
+
+/* A durable table keeps its bindings in an ordinary SymTable, a snapshot of them in a file
+saved by SymFrozen_save, and the changes since in a log. The log records each change as the
+value a key was set to or the removal of a key, never as the call that made it, so replaying
+records that the snapshot already reflects leaves the bindings as they were. A snapshot may thus
+be taken while writers go on logging, and the log is cut back to the records after it only once
+the snapshot is safely on disk. */
+
+/* The log is folded into a snapshot once it holds more than COMPACT_MIN_BYTES and more than
+COMPACT_RATIO times the size of the snapshot, or, after a compaction fails, once it has grown
+COMPACT_RATIO times larger. */
+enum {COMPACT_MIN_BYTES = 1 << 20};
+enum {COMPACT_RATIO = 2};
+
+/* A log begins with a LogHeader, whose LOG_MAGIC reads differently on a machine of the other
+byte order, and which records the width of size_t, on which the checksums depend. */
+#define LOG_MAGIC 0x31474F4C4D595353ULL
+enum {LOG_VERSION = 1};
+
+/* The seed of the checksums of records */
+enum {LOG_SEED = 0x5EED};
+
+/* The types of records */
+enum {RECORD_SET = 1, RECORD_REMOVE = 2};
+
+/* A LogHeader begins a log. */
+struct LogHeader {
+    /* LOG_MAGIC and LOG_VERSION */
+    uint64_t uMagic;
+    uint32_t uVersion;
+
+    /* The number of bits of a size_t */
+    uint32_t uSizeBits;
+};
+
+/* A LogRecord begins each record of a log, and the bytes of its key follow it. */
+struct LogRecord {
+    /* The checksum of the rest of the record and its key */
+    uint64_t uChecksum;
+
+    /* RECORD_SET or RECORD_REMOVE */
+    uint64_t uType;
+
+    /* The length of the key, and the value a RECORD_SET binds it to */
+    uint64_t uKeyLength;
+    uint64_t uValue;
+};
+
+/* A SymDurable is a table, its files, and the state that its writers and background thread
+share, all guarded by sLock. */
+struct SymDurable {
+    /* The bindings */
+    SymTable_T oSymTable;
+
+    /* The paths of the snapshot and the log, and of the log that replaces it when it is cut
+    back */
+    char* pcSnapshotPath;
+    char* pcLogPath;
+    char* pcNewLogPath;
+
+    /* The file descriptor of the log, and the number of bytes written to it */
+    int iLogFd;
+    uint64_t uLogBytes;
+
+    /* The size the log may grow to before a compaction is asked for */
+    uint64_t uCompactAt;
+
+    /* The lock, and the condition signalled whenever a flush ends */
+    pthread_mutex_t sLock;
+    pthread_cond_t sFlushed;
+
+    /* The records appended but not yet written, in a buffer of uBufferCapacity bytes, and a
+    spare buffer that the next writer fills while the one being written is written */
+    char* pcBuffer;
+    size_t uBufferLength;
+    size_t uBufferCapacity;
+    char* pcSpare;
+    size_t uSpareCapacity;
+
+    /* The numbers of bytes of records ever appended and ever made durable */
+    uint64_t uAppended;
+    uint64_t uSynced;
+
+    /* Whether a writer is writing a buffer, and whether a write has failed */
+    int iFlushing;
+    int iFailed;
+
+    /* The background thread, the condition it waits for, whether a compaction is wanted, and
+    whether the thread should stop */
+    pthread_t sCompactor;
+    pthread_cond_t sCompactWanted;
+    int iCompactWanted;
+    int iStopping;
+
+    /* Held by a compaction from start to end, so that only one runs at a time */
+    pthread_mutex_t sCompactLock;
+};
+
+/* A SnapshotLoad is the state of loading a snapshot into a table. */
+struct SnapshotLoad {
+    /* The table */
+    SymTable_T oSymTable;
+
+    /* 1 until a binding could not be added */
+    int iSuccessful;
+};
+
+/* A BindingCopy is the bindings of a table copied for a snapshot. */
+struct BindingCopy {
+    /* The keys, each followed by a '\0', one after the other */
+    char* pcKeys;
+
+    /* The values, in the order of the keys, and the number of bindings */
+    void** ppvValues;
+    size_t uCount;
+};
+
+/* Helper function that returns a copy of pcPath with pcSuffix appended, or NULL if there is
+insufficient memory.*/
+static char* SymDurable_pathWith(const char *pcPath, const char *pcSuffix);
+
+/* Helper function that forces the directory holding the file at pcPath to disk, so that a
+file created or renamed there stays so after a crash. Returns 1 if successful and 0 otherwise.*/
+static int SymDurable_syncDirectory(const char *pcPath);
+
+/* Helper function that writes the uSize bytes at pvBytes to file descriptor iFd. Returns 1 if
+successful and 0 otherwise.*/
+static int SymDurable_writeAll(int iFd, const void *pvBytes, size_t uSize);
+
+/* Helper function that adds the binding of pcKey to pvValue to the table of the SnapshotLoad at
+pvExtra.*/
+static void SymDurable_loadBinding(const char *pcKey, void *pvValue, void *pvExtra);
+
+/* Helper function that loads the snapshot of oSymDurable, if there is one, into its table.
+Returns 1 if successful and 0 otherwise.*/
+static int SymDurable_loadSnapshot(SymDurable_T oSymDurable);
+
+/* Helper function that opens the log of oSymDurable, creating it if there is none, applies its
+records to the table, and truncates it after the last whole one. Returns 1 if successful and 0
+otherwise.*/
+static int SymDurable_openLog(SymDurable_T oSymDurable);
+
+/* Helper function that returns the checksum of the uSize bytes of the record at pcRecord,
+leaving out the checksum itself.*/
+static uint64_t SymDurable_checksum(const char *pcRecord, size_t uSize);
+
+/* Helper function that appends to the buffer of oSymDurable a record of type uType of the
+uLength-byte key at pcKey and pvValue. Returns 1 if successful and 0 if there is insufficient
+memory. oSymDurable->sLock must be held.*/
+static int SymDurable_append(SymDurable_T oSymDurable, uint64_t uType, const char *pcKey,
+    size_t uLength, const void *pvValue);
+
+/* Helper function that returns once the first uTarget bytes of records ever appended to
+oSymDurable are in the log on disk. The first writer to wait writes and forces everything
+appended so far, and those that come while it does wait for it and then for one of them to
+write what they appended, so that one fsync serves many changes. Returns 1 if successful and 0
+if a write has failed. oSymDurable->sLock must be held; it is released while writing.*/
+static int SymDurable_sync(SymDurable_T oSymDurable, uint64_t uTarget);
+
+/* Helper function that copies the bindings of oSymDurable into *psCopy, the keys into one block,
+each followed by a '\0', and the values into an array, so that they can be frozen without the
+table. Returns 1 if successful and 0 if there is insufficient memory. oSymDurable->sLock must be
+held.*/
+static int SymDurable_copyBindings(SymDurable_T oSymDurable, struct BindingCopy *psCopy);
+
+/* Helper function that returns a new table holding the bindings of *psCopy, or NULL if there is
+insufficient memory.*/
+static SymTable_T SymDurable_tableOf(const struct BindingCopy *psCopy);
+
+/* Helper function that sets the size the log of oSymDurable may grow to before a compaction is
+asked for to COMPACT_RATIO times uBytes, and at least COMPACT_MIN_BYTES.*/
+static void SymDurable_setCompactAt(SymDurable_T oSymDurable, uint64_t uBytes);
+
+/* Helper function that asks the background thread of oSymDurable to compact if the log has
+outgrown the snapshot. oSymDurable->sLock must be held.*/
+static void SymDurable_checkSize(SymDurable_T oSymDurable);
+
+/* Helper function that replaces the log of oSymDurable with one holding its bytes from
+uKeepFrom on. Returns 1 if successful and 0 otherwise, leaving the log as it was.
+oSymDurable->sLock must be held and no write may be in progress.*/
+static int SymDurable_cutLog(SymDurable_T oSymDurable, uint64_t uKeepFrom);
+
+/* Helper function that compacts the SymDurable at pvSymDurable whenever asked to, until it is
+told to stop. Returns NULL.*/
+static void* SymDurable_compactWork(void *pvSymDurable);
+
+SymDurable_T SymDurable_open(const char *pcPath) {
+    SymDurable_T oSymDurable;
+
+    assert(pcPath != NULL);
+
+    oSymDurable = (SymDurable_T)calloc(1, sizeof(struct SymDurable));
+    if (oSymDurable == NULL) {
+        return NULL;
+    }
+    oSymDurable->iLogFd = -1;
+    SymDurable_setCompactAt(oSymDurable, 0);
+    oSymDurable->oSymTable = SymTable_new();
+    oSymDurable->pcSnapshotPath = SymDurable_pathWith(pcPath, "");
+    oSymDurable->pcLogPath = SymDurable_pathWith(pcPath, ".log");
+    oSymDurable->pcNewLogPath = SymDurable_pathWith(pcPath, ".log.new");
+    if (oSymDurable->oSymTable == NULL || oSymDurable->pcSnapshotPath == NULL ||
+            oSymDurable->pcLogPath == NULL || oSymDurable->pcNewLogPath == NULL ||
+            !SymDurable_loadSnapshot(oSymDurable) || !SymDurable_openLog(oSymDurable)) {
+        if (oSymDurable->iLogFd >= 0) {
+            close(oSymDurable->iLogFd);
+        }
+        if (oSymDurable->oSymTable != NULL) {
+            SymTable_free(oSymDurable->oSymTable);
+        }
+        free(oSymDurable->pcSnapshotPath);
+        free(oSymDurable->pcLogPath);
+        free(oSymDurable->pcNewLogPath);
+        free(oSymDurable);
+        return NULL;
+    }
+
+    pthread_mutex_init(&oSymDurable->sLock, NULL);
+    pthread_mutex_init(&oSymDurable->sCompactLock, NULL);
+    pthread_cond_init(&oSymDurable->sFlushed, NULL);
+    pthread_cond_init(&oSymDurable->sCompactWanted, NULL);
+    if (pthread_create(&oSymDurable->sCompactor, NULL, SymDurable_compactWork,
+            oSymDurable) != 0) {
+        oSymDurable->iStopping = 1;
+        SymDurable_close(oSymDurable);
+        return NULL;
+    }
+    return oSymDurable;
+}
+
+void SymDurable_close(SymDurable_T oSymDurable) {
+    assert(oSymDurable != NULL);
+
+    /* SymDurable_open marks a table whose thread never started as stopping already */
+    pthread_mutex_lock(&oSymDurable->sLock);
+    if (!oSymDurable->iStopping) {
+        oSymDurable->iStopping = 1;
+        pthread_cond_signal(&oSymDurable->sCompactWanted);
+        pthread_mutex_unlock(&oSymDurable->sLock);
+        pthread_join(oSymDurable->sCompactor, NULL);
+    }
+    else {
+        pthread_mutex_unlock(&oSymDurable->sLock);
+    }
+
+    close(oSymDurable->iLogFd);
+    SymTable_free(oSymDurable->oSymTable);
+    pthread_mutex_destroy(&oSymDurable->sLock);
+    pthread_mutex_destroy(&oSymDurable->sCompactLock);
+    pthread_cond_destroy(&oSymDurable->sFlushed);
+    pthread_cond_destroy(&oSymDurable->sCompactWanted);
+    free(oSymDurable->pcBuffer);
+    free(oSymDurable->pcSpare);
+    free(oSymDurable->pcSnapshotPath);
+    free(oSymDurable->pcLogPath);
+    free(oSymDurable->pcNewLogPath);
+    free(oSymDurable);
+}
+
+size_t SymDurable_getLength(SymDurable_T oSymDurable) {
+    size_t uLength;
+
+    assert(oSymDurable != NULL);
+
+    pthread_mutex_lock(&oSymDurable->sLock);
+    uLength = SymTable_getLength(oSymDurable->oSymTable);
+    pthread_mutex_unlock(&oSymDurable->sLock);
+    return uLength;
+}
+
+int SymDurable_put(SymDurable_T oSymDurable, const char *pcKey, const void *pvValue) {
+    size_t uLength;
+    int iSuccessful;
+
+    assert(oSymDurable != NULL);
+    assert(pcKey != NULL);
+
+    uLength = strlen(pcKey);
+    pthread_mutex_lock(&oSymDurable->sLock);
+    if (oSymDurable->iFailed || !SymTable_put(oSymDurable->oSymTable, pcKey, pvValue)) {
+        pthread_mutex_unlock(&oSymDurable->sLock);
+        return 0;
+    }
+    if (!SymDurable_append(oSymDurable, RECORD_SET, pcKey, uLength, pvValue)) {
+        SymTable_remove(oSymDurable->oSymTable, pcKey);
+        pthread_mutex_unlock(&oSymDurable->sLock);
+        return 0;
+    }
+    iSuccessful = SymDurable_sync(oSymDurable, oSymDurable->uAppended);
+    pthread_mutex_unlock(&oSymDurable->sLock);
+    return iSuccessful;
+}
+
+void *SymDurable_replace(SymDurable_T oSymDurable, const char *pcKey, const void *pvValue) {
+    void* pvOldValue;
+
+    assert(oSymDurable != NULL);
+    assert(pcKey != NULL);
+
+    pthread_mutex_lock(&oSymDurable->sLock);
+    if (oSymDurable->iFailed || !SymTable_contains(oSymDurable->oSymTable, pcKey) ||
+            !SymDurable_append(oSymDurable, RECORD_SET, pcKey, strlen(pcKey), pvValue)) {
+        pthread_mutex_unlock(&oSymDurable->sLock);
+        return NULL;
+    }
+    pvOldValue = SymTable_replace(oSymDurable->oSymTable, pcKey, pvValue);
+    if (!SymDurable_sync(oSymDurable, oSymDurable->uAppended)) {
+        pvOldValue = NULL;
+    }
+    pthread_mutex_unlock(&oSymDurable->sLock);
+    return pvOldValue;
+}
+
+void *SymDurable_remove(SymDurable_T oSymDurable, const char *pcKey) {
+    void* pvOldValue;
+
+    assert(oSymDurable != NULL);
+    assert(pcKey != NULL);
+
+    pthread_mutex_lock(&oSymDurable->sLock);
+    if (oSymDurable->iFailed || !SymTable_contains(oSymDurable->oSymTable, pcKey) ||
+            !SymDurable_append(oSymDurable, RECORD_REMOVE, pcKey, strlen(pcKey), NULL)) {
+        pthread_mutex_unlock(&oSymDurable->sLock);
+        return NULL;
+    }
+    pvOldValue = SymTable_remove(oSymDurable->oSymTable, pcKey);
+    if (!SymDurable_sync(oSymDurable, oSymDurable->uAppended)) {
+        pvOldValue = NULL;
+    }
+    pthread_mutex_unlock(&oSymDurable->sLock);
+    return pvOldValue;
+}
+
+int SymDurable_contains(SymDurable_T oSymDurable, const char *pcKey) {
+    int iFound;
+
+    assert(oSymDurable != NULL);
+    assert(pcKey != NULL);
+
+    pthread_mutex_lock(&oSymDurable->sLock);
+    iFound = SymTable_contains(oSymDurable->oSymTable, pcKey);
+    pthread_mutex_unlock(&oSymDurable->sLock);
+    return iFound;
+}
+
+void *SymDurable_get(SymDurable_T oSymDurable, const char *pcKey) {
+    void* pvValue;
+
+    assert(oSymDurable != NULL);
+    assert(pcKey != NULL);
+
+    pthread_mutex_lock(&oSymDurable->sLock);
+    pvValue = SymTable_get(oSymDurable->oSymTable, pcKey);
+    pthread_mutex_unlock(&oSymDurable->sLock);
+    return pvValue;
+}
+
+void SymDurable_map(SymDurable_T oSymDurable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    assert(oSymDurable != NULL);
+    assert(pfApply != NULL);
+
+    pthread_mutex_lock(&oSymDurable->sLock);
+    SymTable_map(oSymDurable->oSymTable, pfApply, pvExtra);
+    pthread_mutex_unlock(&oSymDurable->sLock);
+}
+
+int SymDurable_compact(SymDurable_T oSymDurable) {
+    struct BindingCopy sCopy = {NULL, NULL, 0};
+    SymTable_T oCopy = NULL;
+    SymFrozen_T oSymFrozen = NULL;
+    struct stat sStat;
+    uint64_t uKeepFrom;
+    int iSuccessful;
+
+    assert(oSymDurable != NULL);
+
+    pthread_mutex_lock(&oSymDurable->sCompactLock);
+
+    /* Copy the bindings once every record up to uKeepFrom is in the log, so that the snapshot
+    reflects at least those records. The records are written as any writer's are, sharing its
+    fsync, and only the copy is made under the lock. */
+    pthread_mutex_lock(&oSymDurable->sLock);
+    iSuccessful = SymDurable_sync(oSymDurable, oSymDurable->uAppended);
+    uKeepFrom = oSymDurable->uLogBytes;
+    if (iSuccessful) {
+        iSuccessful = SymDurable_copyBindings(oSymDurable, &sCopy);
+    }
+    pthread_mutex_unlock(&oSymDurable->sLock);
+
+    /* Freeze and save the copy while writers go on. SymFrozen_save replaces the old snapshot
+    only once the new one is complete. */
+    if (iSuccessful) {
+        oCopy = SymDurable_tableOf(&sCopy);
+        if (oCopy != NULL) {
+            oSymFrozen = SymTable_freeze(oCopy);
+            SymTable_free(oCopy);
+        }
+        iSuccessful = oSymFrozen != NULL &&
+            SymFrozen_save(oSymFrozen, oSymDurable->pcSnapshotPath) &&
+            SymDurable_syncDirectory(oSymDurable->pcSnapshotPath) &&
+            stat(oSymDurable->pcSnapshotPath, &sStat) == 0;
+    }
+    if (oSymFrozen != NULL) {
+        SymFrozen_free(oSymFrozen);
+    }
+    free(sCopy.pcKeys);
+    free(sCopy.ppvValues);
+
+    /* Drop the records that the snapshot reflects. Records appended since stay in the buffer and
+    go to the new log. */
+    pthread_mutex_lock(&oSymDurable->sLock);
+    if (iSuccessful) {
+        while (oSymDurable->iFlushing) {
+            pthread_cond_wait(&oSymDurable->sFlushed, &oSymDurable->sLock);
+        }
+        iSuccessful = !oSymDurable->iFailed && SymDurable_cutLog(oSymDurable, uKeepFrom);
+    }
+    SymDurable_setCompactAt(oSymDurable,
+        iSuccessful ? (uint64_t)sStat.st_size : oSymDurable->uLogBytes);
+    oSymDurable->iCompactWanted = 0;
+    pthread_mutex_unlock(&oSymDurable->sLock);
+
+    pthread_mutex_unlock(&oSymDurable->sCompactLock);
+    return iSuccessful;
+}
+
+int SymDurable_hasFailed(SymDurable_T oSymDurable) {
+    int iFailed;
+
+    assert(oSymDurable != NULL);
+
+    pthread_mutex_lock(&oSymDurable->sLock);
+    iFailed = oSymDurable->iFailed;
+    pthread_mutex_unlock(&oSymDurable->sLock);
+    return iFailed;
+}
+
+/* Helper path with function */
+char* SymDurable_pathWith(const char *pcPath, const char *pcSuffix) {
+    char* pcResult;
+
+    assert(pcPath != NULL);
+    assert(pcSuffix != NULL);
+
+    pcResult = (char*)malloc(strlen(pcPath) + strlen(pcSuffix) + 1);
+    if (pcResult == NULL) {
+        return NULL;
+    }
+    strcpy(pcResult, pcPath);
+    strcat(pcResult, pcSuffix);
+    return pcResult;
+}
+
+/* Helper sync directory function */
+int SymDurable_syncDirectory(const char *pcPath) {
+    const char* pcSlash;
+    char* pcDirectory;
+    int iFd;
+    int iSuccessful;
+
+    assert(pcPath != NULL);
+
+    pcSlash = strrchr(pcPath, '/');
+    if (pcSlash == NULL) {
+        pcDirectory = SymDurable_pathWith(".", "");
+    }
+    else if (pcSlash == pcPath) {
+        pcDirectory = SymDurable_pathWith("/", "");
+    }
+    else {
+        pcDirectory = (char*)malloc((size_t)(pcSlash - pcPath) + 1);
+        if (pcDirectory != NULL) {
+            memcpy(pcDirectory, pcPath, (size_t)(pcSlash - pcPath));
+            pcDirectory[pcSlash - pcPath] = '\0';
+        }
+    }
+    if (pcDirectory == NULL) {
+        return 0;
+    }
+
+    iFd = open(pcDirectory, O_RDONLY);
+    free(pcDirectory);
+    if (iFd < 0) {
+        return 0;
+    }
+    iSuccessful = fsync(iFd) == 0;
+    close(iFd);
+    return iSuccessful;
+}
+
+/* Helper write all function */
+int SymDurable_writeAll(int iFd, const void *pvBytes, size_t uSize) {
+    const char* pcBytes = (const char*)pvBytes;
+    ssize_t iWritten;
+
+    while (uSize > 0) {
+        iWritten = write(iFd, pcBytes, uSize);
+        if (iWritten < 0 && errno == EINTR) {
+            continue;
+        }
+        if (iWritten <= 0) {
+            return 0;
+        }
+        pcBytes += iWritten;
+        uSize -= (size_t)iWritten;
+    }
+    return 1;
+}
+
+/* Helper load binding function */
+void SymDurable_loadBinding(const char *pcKey, void *pvValue, void *pvExtra) {
+    struct SnapshotLoad* psLoad = (struct SnapshotLoad*)pvExtra;
+
+    assert(pcKey != NULL);
+    assert(psLoad != NULL);
+
+    if (!SymTable_put(psLoad->oSymTable, pcKey, pvValue)) {
+        psLoad->iSuccessful = 0;
+    }
+}
+
+/* Helper load snapshot function */
+int SymDurable_loadSnapshot(SymDurable_T oSymDurable) {
+    SymFrozen_T oSymFrozen;
+    struct SnapshotLoad sLoad;
+    struct stat sStat;
+
+    assert(oSymDurable != NULL);
+
+    /* A missing snapshot is an empty one, but one that cannot be opened is an error, lest its
+    bindings be lost */
+    if (stat(oSymDurable->pcSnapshotPath, &sStat) != 0) {
+        return errno == ENOENT;
+    }
+    oSymFrozen = SymTable_openMapped(oSymDurable->pcSnapshotPath);
+    if (oSymFrozen == NULL) {
+        return 0;
+    }
+
+    /* Loading reads every binding anyway, so the whole snapshot is checked first */
+    if (!SymFrozen_verify(oSymFrozen)) {
+        SymFrozen_free(oSymFrozen);
+        return 0;
+    }
+    SymDurable_setCompactAt(oSymDurable, (uint64_t)sStat.st_size);
+
+    sLoad.oSymTable = oSymDurable->oSymTable;
+    sLoad.iSuccessful = SymTable_reserve(oSymDurable->oSymTable,
+        SymFrozen_getLength(oSymFrozen));
+    SymFrozen_map(oSymFrozen, SymDurable_loadBinding, &sLoad);
+    SymFrozen_free(oSymFrozen);
+    return sLoad.iSuccessful;
+}
+
+/* Helper open log function */
+int SymDurable_openLog(SymDurable_T oSymDurable) {
+    struct LogHeader sHeader;
+    struct LogRecord sRecord;
+    struct stat sStat;
+    SymTable_T oSymTable;
+    char* pcLog;
+    const char* pcKey;
+    size_t uSize;
+    size_t uRecordSize;
+    size_t uOffset;
+    ssize_t iRead;
+    int iSuccessful = 1;
+
+    assert(oSymDurable != NULL);
+
+    oSymDurable->iLogFd = open(oSymDurable->pcLogPath, O_RDWR | O_CREAT, 0666);
+    if (oSymDurable->iLogFd < 0 || fstat(oSymDurable->iLogFd, &sStat) != 0) {
+        return 0;
+    }
+
+    /* A new log gets its header */
+    memset(&sHeader, 0, sizeof(sHeader));
+    sHeader.uMagic = LOG_MAGIC;
+    sHeader.uVersion = LOG_VERSION;
+    sHeader.uSizeBits = (uint32_t)(sizeof(size_t) * 8);
+    if (sStat.st_size == 0) {
+        oSymDurable->uLogBytes = sizeof(sHeader);
+        return SymDurable_writeAll(oSymDurable->iLogFd, &sHeader, sizeof(sHeader)) &&
+            fsync(oSymDurable->iLogFd) == 0 &&
+            SymDurable_syncDirectory(oSymDurable->pcLogPath);
+    }
+
+    /* Read the whole log */
+    if ((uint64_t)sStat.st_size > (uint64_t)SIZE_MAX) {
+        return 0;
+    }
+    uSize = (size_t)sStat.st_size;
+    pcLog = (char*)malloc(uSize);
+    if (pcLog == NULL) {
+        return 0;
+    }
+    for (uOffset = 0; uOffset < uSize; uOffset += (size_t)iRead) {
+        iRead = pread(oSymDurable->iLogFd, pcLog + uOffset, uSize - uOffset, (off_t)uOffset);
+        if (iRead <= 0) {
+            free(pcLog);
+            return 0;
+        }
+    }
+    if (uSize < sizeof(sHeader) || memcmp(pcLog, &sHeader, sizeof(sHeader)) != 0) {
+        free(pcLog);
+        return 0;
+    }
+
+    /* Apply the records, stopping at the first that was cut short or is corrupt */
+    oSymTable = oSymDurable->oSymTable;
+    uOffset = sizeof(sHeader);
+    while (iSuccessful && uSize - uOffset >= sizeof(sRecord)) {
+        memcpy(&sRecord, pcLog + uOffset, sizeof(sRecord));
+        if (sRecord.uKeyLength > uSize - uOffset - sizeof(sRecord)) {
+            break;
+        }
+        uRecordSize = sizeof(sRecord) + (size_t)sRecord.uKeyLength;
+        if (SymDurable_checksum(pcLog + uOffset, uRecordSize) != sRecord.uChecksum) {
+            break;
+        }
+        pcKey = pcLog + uOffset + sizeof(sRecord);
+        if (sRecord.uType == RECORD_SET) {
+            if (SymTable_containsN(oSymTable, pcKey, (size_t)sRecord.uKeyLength)) {
+                SymTable_replaceN(oSymTable, pcKey, (size_t)sRecord.uKeyLength,
+                    (void*)(uintptr_t)sRecord.uValue);
+            }
+            else {
+                iSuccessful = SymTable_putN(oSymTable, pcKey, (size_t)sRecord.uKeyLength,
+                    (void*)(uintptr_t)sRecord.uValue);
+            }
+        }
+        else if (sRecord.uType == RECORD_REMOVE) {
+            SymTable_removeN(oSymTable, pcKey, (size_t)sRecord.uKeyLength);
+        }
+        else {
+            break;
+        }
+        uOffset += uRecordSize;
+    }
+    free(pcLog);
+    if (!iSuccessful) {
+        return 0;
+    }
+
+    /* Appends go after the last whole record */
+    oSymDurable->uLogBytes = uOffset;
+    if (uOffset < uSize && (ftruncate(oSymDurable->iLogFd, (off_t)uOffset) != 0 ||
+            fsync(oSymDurable->iLogFd) != 0)) {
+        return 0;
+    }
+    return lseek(oSymDurable->iLogFd, (off_t)uOffset, SEEK_SET) == (off_t)uOffset;
+}
+
+/* Helper checksum function */
+uint64_t SymDurable_checksum(const char *pcRecord, size_t uSize) {
+    assert(pcRecord != NULL);
+    assert(uSize >= sizeof(uint64_t));
+
+    return (uint64_t)SymHash_hash(pcRecord + sizeof(uint64_t), uSize - sizeof(uint64_t),
+        LOG_SEED);
+}
+
+/* Helper append function */
+int SymDurable_append(SymDurable_T oSymDurable, uint64_t uType, const char *pcKey,
+    size_t uLength, const void *pvValue) {
+    struct LogRecord sRecord;
+    size_t uRecordSize;
+    size_t uNewCapacity;
+    char* pcNewBuffer;
+    char* pcRecord;
+
+    assert(oSymDurable != NULL);
+    assert(pcKey != NULL);
+
+    uRecordSize = sizeof(sRecord) + uLength;
+    if (oSymDurable->uBufferCapacity - oSymDurable->uBufferLength < uRecordSize) {
+        uNewCapacity = oSymDurable->uBufferCapacity * 2;
+        if (uNewCapacity < oSymDurable->uBufferLength + uRecordSize) {
+            uNewCapacity = oSymDurable->uBufferLength + uRecordSize;
+        }
+        pcNewBuffer = (char*)realloc(oSymDurable->pcBuffer, uNewCapacity);
+        if (pcNewBuffer == NULL) {
+            return 0;
+        }
+        oSymDurable->pcBuffer = pcNewBuffer;
+        oSymDurable->uBufferCapacity = uNewCapacity;
+    }
+
+    pcRecord = oSymDurable->pcBuffer + oSymDurable->uBufferLength;
+    sRecord.uChecksum = 0;
+    sRecord.uType = uType;
+    sRecord.uKeyLength = uLength;
+    sRecord.uValue = (uint64_t)(uintptr_t)pvValue;
+    memcpy(pcRecord, &sRecord, sizeof(sRecord));
+    memcpy(pcRecord + sizeof(sRecord), pcKey, uLength);
+    sRecord.uChecksum = SymDurable_checksum(pcRecord, uRecordSize);
+    memcpy(pcRecord, &sRecord.uChecksum, sizeof(sRecord.uChecksum));
+
+    oSymDurable->uBufferLength += uRecordSize;
+    oSymDurable->uAppended += uRecordSize;
+    SymDurable_checkSize(oSymDurable);
+    return 1;
+}
+
+/* Helper sync function */
+int SymDurable_sync(SymDurable_T oSymDurable, uint64_t uTarget) {
+    char* pcWriting;
+    int iFd;
+    size_t uWritingLength;
+    size_t uWritingCapacity;
+    uint64_t uWritingEnd;
+    int iSuccessful;
+
+    assert(oSymDurable != NULL);
+
+    while (oSymDurable->uSynced < uTarget && !oSymDurable->iFailed) {
+        if (oSymDurable->iFlushing) {
+            pthread_cond_wait(&oSymDurable->sFlushed, &oSymDurable->sLock);
+            continue;
+        }
+
+        /* Take the buffer, leaving the spare one for writers to append to meanwhile */
+        pcWriting = oSymDurable->pcBuffer;
+        uWritingLength = oSymDurable->uBufferLength;
+        uWritingCapacity = oSymDurable->uBufferCapacity;
+        uWritingEnd = oSymDurable->uAppended;
+        oSymDurable->pcBuffer = oSymDurable->pcSpare;
+        oSymDurable->uBufferCapacity = oSymDurable->uSpareCapacity;
+        oSymDurable->uBufferLength = 0;
+        oSymDurable->pcSpare = NULL;
+        oSymDurable->uSpareCapacity = 0;
+        oSymDurable->iFlushing = 1;
+        iFd = oSymDurable->iLogFd;
+        pthread_mutex_unlock(&oSymDurable->sLock);
+
+        iSuccessful = SymDurable_writeAll(iFd, pcWriting, uWritingLength) && fsync(iFd) == 0;
+
+        pthread_mutex_lock(&oSymDurable->sLock);
+        oSymDurable->pcSpare = pcWriting;
+        oSymDurable->uSpareCapacity = uWritingCapacity;
+        oSymDurable->iFlushing = 0;
+        if (iSuccessful) {
+            oSymDurable->uSynced = uWritingEnd;
+            oSymDurable->uLogBytes += uWritingLength;
+        }
+        else {
+            oSymDurable->iFailed = 1;
+        }
+        pthread_cond_broadcast(&oSymDurable->sFlushed);
+    }
+    return !oSymDurable->iFailed;
+}
+
+/* Helper copy bindings function */
+int SymDurable_copyBindings(SymDurable_T oSymDurable, struct BindingCopy *psCopy) {
+    SymTable_Iter sIter;
+    const char* pcKey;
+    size_t uLength;
+    void* pvValue;
+    size_t uKeyBytes = 0;
+    size_t uOffset = 0;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymDurable != NULL);
+    assert(psCopy != NULL);
+
+    /* Add up the room the keys need, then copy them */
+    psCopy->uCount = SymTable_getLength(oSymDurable->oSymTable);
+    SymTable_iterBegin(oSymDurable->oSymTable, &sIter);
+    while (SymTable_iterNext(&sIter, &pcKey, &uLength, &pvValue)) {
+        uKeyBytes += uLength + 1;
+    }
+    SymTable_iterEnd(&sIter);
+
+    psCopy->pcKeys = (char*)malloc(uKeyBytes + 1);
+    psCopy->ppvValues = (void**)calloc(psCopy->uCount + 1, sizeof(void*));
+    if (psCopy->pcKeys == NULL || psCopy->ppvValues == NULL) {
+        return 0;
+    }
+    SymTable_iterBegin(oSymDurable->oSymTable, &sIter);
+    while (i < psCopy->uCount && SymTable_iterNext(&sIter, &pcKey, &uLength, &pvValue)) {
+        memcpy(psCopy->pcKeys + uOffset, pcKey, uLength);
+        psCopy->pcKeys[uOffset + uLength] = '\0';
+        psCopy->ppvValues[i] = pvValue;
+        uOffset += uLength + 1;
+        i++;
+    }
+    SymTable_iterEnd(&sIter);
+    assert(i == psCopy->uCount);
+    return 1;
+}
+
+/* Helper table of function */
+SymTable_T SymDurable_tableOf(const struct BindingCopy *psCopy) {
+    SymTable_T oSymTable;
+    const char* pcKey;
+    size_t i = 0;  /* loop counter */
+
+    assert(psCopy != NULL);
+
+    oSymTable = SymTable_newWithCapacity(psCopy->uCount);
+    if (oSymTable == NULL) {
+        return NULL;
+    }
+    pcKey = psCopy->pcKeys;
+    for (i = 0; i < psCopy->uCount; i++) {
+        if (!SymTable_put(oSymTable, pcKey, psCopy->ppvValues[i])) {
+            SymTable_free(oSymTable);
+            return NULL;
+        }
+        pcKey += strlen(pcKey) + 1;
+    }
+    return oSymTable;
+}
+
+/* Helper set compact at function */
+void SymDurable_setCompactAt(SymDurable_T oSymDurable, uint64_t uBytes) {
+    assert(oSymDurable != NULL);
+
+    oSymDurable->uCompactAt = uBytes * COMPACT_RATIO;
+    if (oSymDurable->uCompactAt < COMPACT_MIN_BYTES) {
+        oSymDurable->uCompactAt = COMPACT_MIN_BYTES;
+    }
+}
+
+/* Helper check size function */
+void SymDurable_checkSize(SymDurable_T oSymDurable) {
+    assert(oSymDurable != NULL);
+
+    if (!oSymDurable->iCompactWanted &&
+            oSymDurable->uLogBytes + oSymDurable->uBufferLength > oSymDurable->uCompactAt) {
+        oSymDurable->iCompactWanted = 1;
+        pthread_cond_signal(&oSymDurable->sCompactWanted);
+    }
+}
+
+/* Helper cut log function */
+int SymDurable_cutLog(SymDurable_T oSymDurable, uint64_t uKeepFrom) {
+    struct LogHeader sHeader;
+    char* pcTail;
+    size_t uTailSize;
+    size_t uOffset;
+    ssize_t iRead;
+    int iNewFd;
+    int iSuccessful;
+
+    assert(oSymDurable != NULL);
+    assert(!oSymDurable->iFlushing);
+    assert(uKeepFrom <= oSymDurable->uLogBytes);
+
+    /* Copy the records after uKeepFrom, which came while the snapshot was saved */
+    uTailSize = (size_t)(oSymDurable->uLogBytes - uKeepFrom);
+    pcTail = (char*)malloc(uTailSize + 1);
+    if (pcTail == NULL) {
+        return 0;
+    }
+    for (uOffset = 0; uOffset < uTailSize; uOffset += (size_t)iRead) {
+        iRead = pread(oSymDurable->iLogFd, pcTail + uOffset, uTailSize - uOffset,
+            (off_t)(uKeepFrom + uOffset));
+        if (iRead <= 0) {
+            free(pcTail);
+            return 0;
+        }
+    }
+
+    /* Write them into a new log, and rename it over the old one */
+    memset(&sHeader, 0, sizeof(sHeader));
+    sHeader.uMagic = LOG_MAGIC;
+    sHeader.uVersion = LOG_VERSION;
+    sHeader.uSizeBits = (uint32_t)(sizeof(size_t) * 8);
+    iNewFd = open(oSymDurable->pcNewLogPath, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (iNewFd < 0) {
+        free(pcTail);
+        return 0;
+    }
+    iSuccessful = SymDurable_writeAll(iNewFd, &sHeader, sizeof(sHeader)) &&
+        SymDurable_writeAll(iNewFd, pcTail, uTailSize) && fsync(iNewFd) == 0 &&
+        rename(oSymDurable->pcNewLogPath, oSymDurable->pcLogPath) == 0;
+    free(pcTail);
+    if (!iSuccessful) {
+        close(iNewFd);
+        unlink(oSymDurable->pcNewLogPath);
+        return 0;
+    }
+
+    /* The new log is in place, and its records must stay so before more are added */
+    close(oSymDurable->iLogFd);
+    oSymDurable->iLogFd = iNewFd;
+    oSymDurable->uLogBytes = sizeof(sHeader) + uTailSize;
+    if (!SymDurable_syncDirectory(oSymDurable->pcLogPath)) {
+        oSymDurable->iFailed = 1;
+        return 0;
+    }
+    return 1;
+}
+
+/* Helper compact work function */
+void* SymDurable_compactWork(void *pvSymDurable) {
+    SymDurable_T oSymDurable = (SymDurable_T)pvSymDurable;
+
+    assert(oSymDurable != NULL);
+
+    pthread_mutex_lock(&oSymDurable->sLock);
+    for (;;) {
+        while (!oSymDurable->iCompactWanted && !oSymDurable->iStopping) {
+            pthread_cond_wait(&oSymDurable->sCompactWanted, &oSymDurable->sLock);
+        }
+        if (oSymDurable->iStopping) {
+            pthread_mutex_unlock(&oSymDurable->sLock);
+            return NULL;
+        }
+        pthread_mutex_unlock(&oSymDurable->sLock);
+        SymDurable_compact(oSymDurable);
+        pthread_mutex_lock(&oSymDurable->sLock);
+    }
+}
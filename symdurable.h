@@ -0,0 +1,68 @@
+/* symdurable.h
+Author: Tinney Mak */
+
+#include <stddef.h>
+#include "symtable.h"
+#ifndef SYMDURABLE_INCLUDED
+#define SYMDURABLE_INCLUDED
+
+/* A SymDurable_T object is a SymTable_T object whose changes survive a crash. Each change is
+appended to a log file before the call that makes it returns, and a background thread now and
+then folds the log into a snapshot saved with SymFrozen_save. Values are logged as the numbers
+their addresses convert to, so only values that are not addresses, such as small integers cast
+to void*, keep their meaning once the table is opened again. Several threads may use one
+SymDurable object at once; their changes share fsync calls. It works with any implementation of
+symtable.h and needs symfrozen.c */
+typedef struct SymDurable* SymDurable_T;
+
+/* Returns a new SymDurable object whose bindings are those of the snapshot at pcPath, if there
+is one, changed as the log at pcPath with ".log" appended records. The files are created if
+they do not exist. Returns NULL if a file cannot be read or written, the snapshot is corrupt, or
+insufficient memory is available. A log that ends in a change cut short by a crash is truncated
+before it. Only one SymDurable object may use pcPath at a time */
+SymDurable_T SymDurable_open(const char *pcPath);
+
+/* Stops the background thread and frees all memory occupied by oSymDurable. Every change is
+already in the log, so nothing is written */
+void SymDurable_close(SymDurable_T oSymDurable);
+
+/* Returns the number of bindings in oSymDurable */
+size_t SymDurable_getLength(SymDurable_T oSymDurable);
+
+/* Like SymTable_put, and returns only after the new binding is in the log on disk. Returns 0 if
+the binding exists, there is insufficient memory, or the log cannot be written; only in the last
+case is the binding added, in memory alone */
+int SymDurable_put(SymDurable_T oSymDurable, const char *pcKey, const void *pvValue);
+
+/* Like SymTable_replace, and returns only after the new value is in the log on disk. Returns
+NULL if the binding does not exist or the log cannot be written; only in the last case is the
+value replaced, in memory alone. A binding whose old value is NULL cannot be told apart from a
+failure but by SymDurable_hasFailed */
+void *SymDurable_replace(SymDurable_T oSymDurable, const char *pcKey, const void *pvValue);
+
+/* Like SymTable_remove, and returns only after the removal is in the log on disk. Returns NULL
+if the binding does not exist or the log cannot be written; only in the last case is the binding
+removed, in memory alone. A binding whose value is NULL cannot be told apart from a failure but
+by SymDurable_hasFailed */
+void *SymDurable_remove(SymDurable_T oSymDurable, const char *pcKey);
+
+/* Like SymTable_contains */
+int SymDurable_contains(SymDurable_T oSymDurable, const char *pcKey);
+
+/* Like SymTable_get */
+void *SymDurable_get(SymDurable_T oSymDurable, const char *pcKey);
+
+/* Like SymTable_map. *pfApply must not call the functions of oSymDurable */
+void SymDurable_map(SymDurable_T oSymDurable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra);
+
+/* Folds the log of oSymDurable into a new snapshot now, as the background thread does once the
+log outgrows the snapshot. Returns 1 if successful and 0 otherwise */
+int SymDurable_compact(SymDurable_T oSymDurable);
+
+/* Returns 1 if writing the log of oSymDurable has failed, after which changes are refused, and
+0 otherwise. The change whose record could not be written stays in memory */
+int SymDurable_hasFailed(SymDurable_T oSymDurable);
+
+#endif
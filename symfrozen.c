@@ -0,0 +1,811 @@
+/* symfrozen.c
+Author: Tinney Mak */
+
+/* For open, mmap and fsync */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "symtable.h"
+#include "symfrozen.h"
+#include "symhash.h"
+
+/* A frozen table finds its keys with a minimal perfect hash in the style of PTHash: each key
+hashes to one of about length / KEYS_PER_BUCKET buckets, and each bucket has a pilot, a number
+chosen when the table is built so that the keys of every bucket, hashed again with its pilot,
+land in distinct slots. There are exactly as many slots as bindings, so a lookup reads one pilot
+and one slot, and compares one key. */
+
+/* The average number of keys per bucket. More keys per bucket make the pilots take less memory
+and the table slower to build. */
+enum {KEYS_PER_BUCKET = 4};
+
+/* A build gives up on a seed once a bucket has tried more than PILOT_LIMIT_FACTOR pilots per
+binding, plus PILOT_LIMIT_BASE, and starts again with another seed, up to MAX_ATTEMPTS seeds. */
+enum {PILOT_LIMIT_FACTOR = 16, PILOT_LIMIT_BASE = 1024};
+enum {MAX_ATTEMPTS = 8};
+
+/* A saved table is a FileHeader followed by the slots, the pilots, zero bytes up to a multiple
+of 8, and the block of keys, each exactly as a SymFrozen keeps them in memory, so that a mapped
+file is used in place. FILE_MAGIC reads differently on a machine of the other byte order, and
+uSizeBits records the width of size_t, on which the hash of the keys depends. The header and the
+pilots have one checksum, which is verified when the file is opened, and the slots and keys
+another, which is verified only on request, so that opening a file reads few of its pages. */
+#define FILE_MAGIC 0x314E5A4F52464D53ULL
+enum {FILE_VERSION = 2};
+
+/* Each Slot holds a binding. The key is kept as an offset into the block of keys, so that the
+slots do not depend on where the block is, and every field has the same width on any machine. */
+struct Slot {
+    /* The offset of the key within the block of keys, and its length */
+    uint64_t uKeyOffset;
+    uint64_t uKeyLength;
+
+    /* The value, as an unsigned integer */
+    uint64_t uValue;
+};
+
+/* A FileHeader begins a saved table. */
+struct FileHeader {
+    /* FILE_MAGIC, FILE_VERSION, and the size of the header in bytes */
+    uint64_t uMagic;
+    uint32_t uVersion;
+    uint32_t uHeaderSize;
+
+    /* The number of bits of a size_t, and zero */
+    uint32_t uSizeBits;
+    uint32_t uReserved;
+
+    /* The fields of the SymFrozen */
+    uint64_t uLength;
+    uint64_t uBucketCount;
+    uint64_t uSeed;
+    uint64_t uKeyBytes;
+
+    /* The checksum of the slots and the keys */
+    uint64_t uBodyChecksum;
+
+    /* The checksum of the header, computed with this field zero, and the pilots */
+    uint64_t uChecksum;
+};
+
+/* A SymFrozen is an array of slots, a block of keys and the pilots of the minimal perfect
+hash. */
+struct SymFrozen {
+    /* The address of the array of slots, one per binding */
+    struct Slot* psSlots;
+
+    /* The number of the bindings in the frozen table */
+    size_t length;
+
+    /* The address of the block of keys, each followed by a '\0', and its size in bytes */
+    char* pcKeys;
+    size_t uKeyBytes;
+
+    /* The address of the array of pilots, one per bucket, and the number of buckets */
+    uint32_t* puPilots;
+    size_t uBucketCount;
+
+    /* The seed of the hash of the keys */
+    size_t uSeed;
+
+    /* The address and size of the mapped file that holds the arrays and the block, or NULL and
+    0 if they were allocated */
+    void* pvMapping;
+    size_t uMappingSize;
+
+    /* The checksum of the slots and keys saved in the mapped file */
+    uint64_t uBodyChecksum;
+};
+
+/* Helper function that copies the bindings of oSymTable into the slots of oSymFrozen, in the
+order SymTable_iterNext returns them, and their keys into its block of keys. Returns 1 if
+successful and 0 if there is insufficient memory.*/
+static int SymFrozen_pack(SymFrozen_T oSymFrozen, SymTable_T oSymTable);
+
+/* Helper function that returns the 64-bit hash of the uLength bytes at pcKey under uSeed.*/
+static uint64_t SymFrozen_hash(const char *pcKey, size_t uLength, size_t uSeed);
+
+/* Helper function that maps uHash to a number from 0 to uRange - 1, in proportion.*/
+static size_t SymFrozen_reduce(uint64_t uHash, size_t uRange);
+
+/* Helper function that returns the slot of a key whose hash is uHash, hashed again with
+uPilot, among uSlotCount slots.*/
+static size_t SymFrozen_position(uint64_t uHash, uint32_t uPilot, size_t uSlotCount);
+
+/* Helper function that chooses the pilots of oSymFrozen for the uCount keys whose hashes under
+oSymFrozen->uSeed are puHashes, and stores in puPositions[i] the slot of key i. Returns 1 if
+successful and 0 if some bucket found no pilot or there is insufficient memory.*/
+static int SymFrozen_build(SymFrozen_T oSymFrozen, const uint64_t *puHashes, size_t uCount,
+    size_t *puPositions);
+
+/* Helper function that computes where the sections of a saved table with uLength bindings,
+uBucketCount buckets and uKeyBytes bytes of keys begin, storing the offset of the pilots in
+*puPilotsOffset and of the keys in *puKeysOffset, and returns the size of the file. Returns 0 if
+the sizes are inconsistent or the file would be too large to map.*/
+static uint64_t SymFrozen_layout(uint64_t uLength, uint64_t uBucketCount, uint64_t uKeyBytes,
+    uint64_t *puPilotsOffset, uint64_t *puKeysOffset);
+
+/* Helper function that returns a checksum of the uSize bytes at pvBytes, varied by uSeed. It is
+not a hash of quality, only quick to compute and sure to change when the bytes do.*/
+static uint64_t SymFrozen_checksum(const void *pvBytes, size_t uSize, uint64_t uSeed);
+
+/* Helper function that returns the checksum of the header and pilots of a saved table whose
+header, with a zero uChecksum, is *psHeader, and whose pilots are at pvPilots. The header must
+describe a valid layout.*/
+static uint64_t SymFrozen_headerChecksum(const struct FileHeader *psHeader,
+    const void *pvPilots);
+
+/* Helper function that returns the checksum of the slots and keys of a saved table whose
+header is *psHeader, and whose slots and keys are at pvSlots and pcKeys. The header must
+describe a valid layout.*/
+static uint64_t SymFrozen_bodyChecksum(const struct FileHeader *psHeader, const void *pvSlots,
+    const char *pcKeys);
+
+/* Helper function that writes the uSize bytes at pvBytes to file descriptor iFd. Returns 1 if
+successful and 0 otherwise.*/
+static int SymFrozen_writeAll(int iFd, const void *pvBytes, size_t uSize);
+
+/* Helper function that returns the key of psSlot, a slot of oSymFrozen, or NULL if the slot
+places it, or the '\0' after it, outside the block of keys, as only a corrupt file can.*/
+static const char* SymFrozen_slotKey(SymFrozen_T oSymFrozen, const struct Slot *psSlot);
+
+/* Helper function that returns the slot of oSymFrozen whose key is the uLength bytes at pcKey,
+or NULL if there is none.*/
+static const struct Slot* SymFrozen_find(SymFrozen_T oSymFrozen, const char *pcKey,
+    size_t uLength);
+
+SymFrozen_T SymTable_freeze(SymTable_T oSymTable) {
+    SymFrozen_T oSymFrozen;
+    uint64_t* puHashes;
+    size_t* puPositions;
+    size_t uCount;
+    size_t uAttempt;
+    int iBuilt = 0;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+
+    oSymFrozen = (SymFrozen_T)calloc(1, sizeof(struct SymFrozen));
+    if (oSymFrozen == NULL) {
+        return NULL;
+    }
+    uCount = SymTable_getLength(oSymTable);
+    oSymFrozen->uBucketCount = (uCount + KEYS_PER_BUCKET - 1) / KEYS_PER_BUCKET;
+    oSymFrozen->puPilots = (uint32_t*)calloc(oSymFrozen->uBucketCount + 1, sizeof(uint32_t));
+    puHashes = (uint64_t*)calloc(uCount + 1, sizeof(uint64_t));
+    puPositions = (size_t*)calloc(uCount + 1, sizeof(size_t));
+    if (oSymFrozen->puPilots == NULL || puHashes == NULL || puPositions == NULL ||
+            !SymFrozen_pack(oSymFrozen, oSymTable)) {
+        free(puHashes);
+        free(puPositions);
+        SymFrozen_free(oSymFrozen);
+        return NULL;
+    }
+
+    /* Search for pilots, trying another seed whenever a bucket finds none, as it cannot when two
+    of its keys have the same hash */
+    for (uAttempt = 0; uAttempt < MAX_ATTEMPTS && !iBuilt; uAttempt++) {
+        oSymFrozen->uSeed = uAttempt;
+        for (i = 0; i < uCount; i++) {
+            puHashes[i] = SymFrozen_hash(
+                oSymFrozen->pcKeys + (size_t)oSymFrozen->psSlots[i].uKeyOffset,
+                (size_t)oSymFrozen->psSlots[i].uKeyLength, oSymFrozen->uSeed);
+        }
+        iBuilt = SymFrozen_build(oSymFrozen, puHashes, uCount, puPositions);
+    }
+    free(puHashes);
+    if (!iBuilt) {
+        free(puPositions);
+        SymFrozen_free(oSymFrozen);
+        return NULL;
+    }
+
+    /* Move each binding to its slot. puPositions is a permutation, so following its cycles
+    places every binding with one move. */
+    for (i = 0; i < uCount; i++) {
+        struct Slot sSlot;
+        size_t uPosition;
+        size_t uNext;
+
+        if (puPositions[i] == i) {
+            continue;
+        }
+        sSlot = oSymFrozen->psSlots[i];
+        uPosition = puPositions[i];
+        puPositions[i] = i;
+        while (uPosition != i) {
+            struct Slot sDisplaced = oSymFrozen->psSlots[uPosition];
+            oSymFrozen->psSlots[uPosition] = sSlot;
+            sSlot = sDisplaced;
+            uNext = puPositions[uPosition];
+            puPositions[uPosition] = uPosition;
+            uPosition = uNext;
+        }
+        oSymFrozen->psSlots[i] = sSlot;
+    }
+    free(puPositions);
+    return oSymFrozen;
+}
+
+void SymFrozen_free(SymFrozen_T oSymFrozen) {
+    assert(oSymFrozen != NULL);
+
+    if (oSymFrozen->pvMapping != NULL) {
+        munmap(oSymFrozen->pvMapping, oSymFrozen->uMappingSize);
+    }
+    else {
+        free(oSymFrozen->psSlots);
+        free(oSymFrozen->pcKeys);
+        free(oSymFrozen->puPilots);
+    }
+    free(oSymFrozen);
+}
+
+int SymTable_save(SymTable_T oSymTable, const char *pcPath) {
+    SymFrozen_T oSymFrozen;
+    int iSuccessful;
+
+    assert(oSymTable != NULL);
+    assert(pcPath != NULL);
+
+    oSymFrozen = SymTable_freeze(oSymTable);
+    if (oSymFrozen == NULL) {
+        return 0;
+    }
+    iSuccessful = SymFrozen_save(oSymFrozen, pcPath);
+    SymFrozen_free(oSymFrozen);
+    return iSuccessful;
+}
+
+int SymFrozen_save(SymFrozen_T oSymFrozen, const char *pcPath) {
+    static const char acPadding[8] = {0};
+    struct FileHeader sHeader;
+    uint64_t uPilotsOffset;
+    uint64_t uKeysOffset;
+    size_t uPilotBytes;
+    char* pcTempPath;
+    int iFd;
+    int iSuccessful;
+
+    assert(oSymFrozen != NULL);
+    assert(pcPath != NULL);
+
+    memset(&sHeader, 0, sizeof(sHeader));
+    sHeader.uMagic = FILE_MAGIC;
+    sHeader.uVersion = FILE_VERSION;
+    sHeader.uHeaderSize = (uint32_t)sizeof(sHeader);
+    sHeader.uSizeBits = (uint32_t)(sizeof(size_t) * 8);
+    sHeader.uLength = oSymFrozen->length;
+    sHeader.uBucketCount = oSymFrozen->uBucketCount;
+    sHeader.uSeed = oSymFrozen->uSeed;
+    sHeader.uKeyBytes = oSymFrozen->uKeyBytes;
+    if (SymFrozen_layout(sHeader.uLength, sHeader.uBucketCount, sHeader.uKeyBytes,
+            &uPilotsOffset, &uKeysOffset) == 0) {
+        return 0;
+    }
+    uPilotBytes = oSymFrozen->uBucketCount * sizeof(uint32_t);
+
+    sHeader.uBodyChecksum = SymFrozen_bodyChecksum(&sHeader, oSymFrozen->psSlots,
+        oSymFrozen->pcKeys);
+    sHeader.uChecksum = SymFrozen_headerChecksum(&sHeader, oSymFrozen->puPilots);
+
+    /* Write a new file and rename it over the old one, so that a process never maps a file
+    half written, and processes that mapped the old one keep it */
+    pcTempPath = (char*)malloc(strlen(pcPath) + sizeof(".tmp"));
+    if (pcTempPath == NULL) {
+        return 0;
+    }
+    sprintf(pcTempPath, "%s.tmp", pcPath);
+    iFd = open(pcTempPath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (iFd < 0) {
+        free(pcTempPath);
+        return 0;
+    }
+    iSuccessful = SymFrozen_writeAll(iFd, &sHeader, sizeof(sHeader)) &&
+        SymFrozen_writeAll(iFd, oSymFrozen->psSlots, oSymFrozen->length * sizeof(struct Slot)) &&
+        SymFrozen_writeAll(iFd, oSymFrozen->puPilots, uPilotBytes) &&
+        SymFrozen_writeAll(iFd, acPadding, (size_t)(uKeysOffset - uPilotsOffset) - uPilotBytes) &&
+        SymFrozen_writeAll(iFd, oSymFrozen->pcKeys, oSymFrozen->uKeyBytes) &&
+        fsync(iFd) == 0;
+    if (close(iFd) != 0) {
+        iSuccessful = 0;
+    }
+    if (iSuccessful && rename(pcTempPath, pcPath) != 0) {
+        iSuccessful = 0;
+    }
+    if (!iSuccessful) {
+        unlink(pcTempPath);
+    }
+    free(pcTempPath);
+    return iSuccessful;
+}
+
+SymFrozen_T SymTable_openMapped(const char *pcPath) {
+    SymFrozen_T oSymFrozen;
+    struct FileHeader sHeader;
+    struct stat sStat;
+    const char* pcFile;
+    void* pvMapping;
+    size_t uSize;
+    uint64_t uPilotsOffset;
+    uint64_t uKeysOffset;
+    uint64_t uChecksum;
+    int iFd;
+
+    assert(pcPath != NULL);
+
+    iFd = open(pcPath, O_RDONLY);
+    if (iFd < 0) {
+        return NULL;
+    }
+    if (fstat(iFd, &sStat) != 0 || sStat.st_size < (off_t)sizeof(sHeader) ||
+            (uint64_t)sStat.st_size > (uint64_t)SIZE_MAX) {
+        close(iFd);
+        return NULL;
+    }
+    uSize = (size_t)sStat.st_size;
+    pvMapping = mmap(NULL, uSize, PROT_READ, MAP_SHARED, iFd, 0);
+    close(iFd);
+    if (pvMapping == MAP_FAILED) {
+        return NULL;
+    }
+    pcFile = (const char*)pvMapping;
+
+    /* Check the header, that the sizes it gives add up to the size of the file, and the
+    checksum of the header and pilots. The slots and keys are left to SymFrozen_verify, so that
+    only the pages a lookup reads are read. */
+    memcpy(&sHeader, pcFile, sizeof(sHeader));
+    uChecksum = sHeader.uChecksum;
+    sHeader.uChecksum = 0;
+    if (sHeader.uMagic != FILE_MAGIC || sHeader.uVersion != FILE_VERSION ||
+            sHeader.uHeaderSize != sizeof(sHeader) ||
+            sHeader.uSizeBits != sizeof(size_t) * 8 ||
+            SymFrozen_layout(sHeader.uLength, sHeader.uBucketCount, sHeader.uKeyBytes,
+                &uPilotsOffset, &uKeysOffset) != (uint64_t)uSize ||
+            SymFrozen_headerChecksum(&sHeader, pcFile + uPilotsOffset) != uChecksum) {
+        munmap(pvMapping, uSize);
+        return NULL;
+    }
+
+    oSymFrozen = (SymFrozen_T)calloc(1, sizeof(struct SymFrozen));
+    if (oSymFrozen == NULL) {
+        munmap(pvMapping, uSize);
+        return NULL;
+    }
+    oSymFrozen->psSlots = (struct Slot*)(pcFile + sizeof(sHeader));
+    oSymFrozen->length = (size_t)sHeader.uLength;
+    oSymFrozen->pcKeys = (char*)(pcFile + uKeysOffset);
+    oSymFrozen->uKeyBytes = (size_t)sHeader.uKeyBytes;
+    oSymFrozen->puPilots = (uint32_t*)(pcFile + uPilotsOffset);
+    oSymFrozen->uBucketCount = (size_t)sHeader.uBucketCount;
+    oSymFrozen->uSeed = (size_t)sHeader.uSeed;
+    oSymFrozen->pvMapping = pvMapping;
+    oSymFrozen->uMappingSize = uSize;
+    oSymFrozen->uBodyChecksum = sHeader.uBodyChecksum;
+    return oSymFrozen;
+}
+
+int SymFrozen_verify(SymFrozen_T oSymFrozen) {
+    struct FileHeader sHeader;
+
+    assert(oSymFrozen != NULL);
+
+    if (oSymFrozen->pvMapping == NULL) {
+        return 1;
+    }
+    memcpy(&sHeader, oSymFrozen->pvMapping, sizeof(sHeader));
+    return SymFrozen_bodyChecksum(&sHeader, oSymFrozen->psSlots, oSymFrozen->pcKeys) ==
+        oSymFrozen->uBodyChecksum;
+}
+
+size_t SymFrozen_getLength(SymFrozen_T oSymFrozen) {
+    assert(oSymFrozen != NULL);
+    return oSymFrozen->length;
+}
+
+int SymFrozen_contains(SymFrozen_T oSymFrozen, const char *pcKey) {
+    assert(pcKey != NULL);
+    return SymFrozen_containsN(oSymFrozen, pcKey, strlen(pcKey));
+}
+
+void *SymFrozen_get(SymFrozen_T oSymFrozen, const char *pcKey) {
+    assert(pcKey != NULL);
+    return SymFrozen_getN(oSymFrozen, pcKey, strlen(pcKey));
+}
+
+int SymFrozen_containsN(SymFrozen_T oSymFrozen, const char *pcKey, size_t uLength) {
+    assert(oSymFrozen != NULL);
+    assert(pcKey != NULL);
+    return SymFrozen_find(oSymFrozen, pcKey, uLength) != NULL;
+}
+
+void *SymFrozen_getN(SymFrozen_T oSymFrozen, const char *pcKey, size_t uLength) {
+    const struct Slot* psSlot;
+
+    assert(oSymFrozen != NULL);
+    assert(pcKey != NULL);
+
+    psSlot = SymFrozen_find(oSymFrozen, pcKey, uLength);
+    if (psSlot == NULL) {
+        return NULL;
+    }
+    return (void*)(uintptr_t)psSlot->uValue;
+}
+
+void SymFrozen_map(SymFrozen_T oSymFrozen,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    const struct Slot* psSlot;
+    const char* pcKey;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymFrozen != NULL);
+    assert(pfApply != NULL);
+
+    for (i = 0; i < oSymFrozen->length; i++) {
+        psSlot = &oSymFrozen->psSlots[i];
+        pcKey = SymFrozen_slotKey(oSymFrozen, psSlot);
+        if (pcKey != NULL) {
+            (*pfApply)(pcKey, (void*)(uintptr_t)psSlot->uValue, (void*)pvExtra);
+        }
+    }
+}
+
+/* Helper pack function */
+int SymFrozen_pack(SymFrozen_T oSymFrozen, SymTable_T oSymTable) {
+    SymTable_Iter sIter;
+    const char** ppcKeys;
+    const char* pcKey;
+    size_t uLength;
+    void* pvValue;
+    size_t uCount;
+    size_t uOffset = 0;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymFrozen != NULL);
+    assert(oSymTable != NULL);
+
+    uCount = SymTable_getLength(oSymTable);
+    oSymFrozen->psSlots = (struct Slot*)calloc(uCount + 1, sizeof(struct Slot));
+    ppcKeys = (const char**)calloc(uCount + 1, sizeof(const char*));
+    if (oSymFrozen->psSlots == NULL || ppcKeys == NULL) {
+        free(ppcKeys);
+        return 0;
+    }
+
+    /* Collect the bindings, with the keys where the table keeps them, and add up the room their
+    keys need */
+    SymTable_iterBegin(oSymTable, &sIter);
+    while (i < uCount && SymTable_iterNext(&sIter, &pcKey, &uLength, &pvValue)) {
+        ppcKeys[i] = pcKey;
+        oSymFrozen->psSlots[i].uKeyLength = uLength;
+        oSymFrozen->psSlots[i].uValue = (uint64_t)(uintptr_t)pvValue;
+        oSymFrozen->uKeyBytes += uLength + 1;
+        i++;
+    }
+    SymTable_iterEnd(&sIter);
+    assert(i == uCount);
+    oSymFrozen->length = uCount;
+
+    /* Copy the keys into one block */
+    oSymFrozen->pcKeys = (char*)malloc(oSymFrozen->uKeyBytes + 1);
+    if (oSymFrozen->pcKeys == NULL) {
+        free(ppcKeys);
+        return 0;
+    }
+    for (i = 0; i < uCount; i++) {
+        uLength = (size_t)oSymFrozen->psSlots[i].uKeyLength;
+        memcpy(oSymFrozen->pcKeys + uOffset, ppcKeys[i], uLength);
+        oSymFrozen->pcKeys[uOffset + uLength] = '\0';
+        oSymFrozen->psSlots[i].uKeyOffset = uOffset;
+        uOffset += uLength + 1;
+    }
+    free(ppcKeys);
+    return 1;
+}
+
+/* Helper hash function */
+uint64_t SymFrozen_hash(const char *pcKey, size_t uLength, size_t uSeed) {
+#if SIZE_MAX > 0xFFFFFFFFu
+    return (uint64_t)SymHash_hash(pcKey, uLength, uSeed);
+#else
+    /* With a 32-bit size_t, a table of a million keys would hold some with equal hashes, which
+    no pilot can separate, so two hashes are joined */
+    return ((uint64_t)SymHash_hash(pcKey, uLength, uSeed) << 32) |
+        (uint64_t)SymHash_hash(pcKey, uLength, ~uSeed);
+#endif
+}
+
+/* Helper reduce function */
+size_t SymFrozen_reduce(uint64_t uHash, size_t uRange) {
+    uint64_t uHigh = (uint64_t)uRange;
+
+    /* The high half of uHash * uRange, which takes no division */
+    SymHash_multiply(&uHash, &uHigh);
+    return (size_t)uHigh;
+}
+
+/* Helper position function */
+size_t SymFrozen_position(uint64_t uHash, uint32_t uPilot, size_t uSlotCount) {
+    /* The buckets use the high bits of the hash, which the keys of a bucket share, so the hash
+    is mixed with the pilot before it is reduced */
+    return SymFrozen_reduce(
+        SymHash_mix(uHash + (uint64_t)uPilot * SYMHASH_SECRET0, SYMHASH_SECRET3), uSlotCount);
+}
+
+/* Helper build function */
+int SymFrozen_build(SymFrozen_T oSymFrozen, const uint64_t *puHashes, size_t uCount,
+    size_t *puPositions) {
+    size_t uBucketCount;
+    size_t* puBucketStarts;
+    size_t* puBucketKeys;
+    size_t* puSizeStarts;
+    size_t* puBucketOrder;
+    unsigned char* pucTaken;
+    size_t uLargest = 0;
+    size_t uBucket;
+    size_t uSize;
+    size_t uFirst;
+    size_t uPilot;
+    size_t uPilotLimit;
+    size_t uPosition;
+    size_t j;
+    size_t k;
+    int iResult = 1;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymFrozen != NULL);
+    assert(puHashes != NULL);
+    assert(puPositions != NULL);
+
+    uBucketCount = oSymFrozen->uBucketCount;
+    puBucketStarts = (size_t*)calloc(uBucketCount + 2, sizeof(size_t));
+    puBucketKeys = (size_t*)calloc(uCount + 1, sizeof(size_t));
+    puSizeStarts = (size_t*)calloc(uCount + 2, sizeof(size_t));
+    puBucketOrder = (size_t*)calloc(uBucketCount + 1, sizeof(size_t));
+    pucTaken = (unsigned char*)calloc(uCount + 1, sizeof(unsigned char));
+    if (puBucketStarts == NULL || puBucketKeys == NULL || puSizeStarts == NULL ||
+            puBucketOrder == NULL || pucTaken == NULL) {
+        free(puBucketStarts);
+        free(puBucketKeys);
+        free(puSizeStarts);
+        free(puBucketOrder);
+        free(pucTaken);
+        return 0;
+    }
+
+    /* Sort the keys by bucket: puBucketKeys from puBucketStarts[b] up to puBucketStarts[b + 1]
+    are the keys of bucket b. The counts are made two places along, so that placing the keys
+    moves each start one place back to where it belongs. */
+    for (i = 0; i < uCount; i++) {
+        puBucketStarts[SymFrozen_reduce(puHashes[i], uBucketCount) + 2]++;
+    }
+    for (uBucket = 0; uBucket < uBucketCount; uBucket++) {
+        if (puBucketStarts[uBucket + 2] > uLargest) {
+            uLargest = puBucketStarts[uBucket + 2];
+        }
+        puBucketStarts[uBucket + 2] += puBucketStarts[uBucket + 1];
+    }
+    for (i = 0; i < uCount; i++) {
+        uBucket = SymFrozen_reduce(puHashes[i], uBucketCount);
+        puBucketKeys[puBucketStarts[uBucket + 1]++] = i;
+    }
+
+    /* Sort the buckets by size, largest first, since the large ones need the most free slots */
+    for (uBucket = 0; uBucket < uBucketCount; uBucket++) {
+        uSize = puBucketStarts[uBucket + 1] - puBucketStarts[uBucket];
+        puSizeStarts[uLargest - uSize + 1]++;
+    }
+    for (uSize = 0; uSize < uLargest; uSize++) {
+        puSizeStarts[uSize + 1] += puSizeStarts[uSize];
+    }
+    for (uBucket = 0; uBucket < uBucketCount; uBucket++) {
+        uSize = puBucketStarts[uBucket + 1] - puBucketStarts[uBucket];
+        puBucketOrder[puSizeStarts[uLargest - uSize]++] = uBucket;
+    }
+
+    /* Give each bucket in turn the least pilot that places its keys in distinct free slots */
+    uPilotLimit = uCount * PILOT_LIMIT_FACTOR + PILOT_LIMIT_BASE;
+    if (uPilotLimit > UINT32_MAX || uPilotLimit < uCount) {
+        uPilotLimit = UINT32_MAX;
+    }
+    for (i = 0; i < uBucketCount && iResult; i++) {
+        uBucket = puBucketOrder[i];
+        uFirst = puBucketStarts[uBucket];
+        uSize = puBucketStarts[uBucket + 1] - uFirst;
+        oSymFrozen->puPilots[uBucket] = 0;
+
+        /* Keys with the same hash would take the same slot under every pilot */
+        for (j = 1; j < uSize && iResult; j++) {
+            for (k = 0; k < j; k++) {
+                if (puHashes[puBucketKeys[uFirst + j]] ==
+                        puHashes[puBucketKeys[uFirst + k]]) {
+                    iResult = 0;
+                }
+            }
+        }
+
+        for (uPilot = 0; uSize > 0 && iResult; uPilot++) {
+            if (uPilot > uPilotLimit) {
+                iResult = 0;
+                break;
+            }
+            for (j = 0; j < uSize; j++) {
+                uPosition = SymFrozen_position(puHashes[puBucketKeys[uFirst + j]],
+                    (uint32_t)uPilot, uCount);
+                if (pucTaken[uPosition]) {
+                    break;
+                }
+                pucTaken[uPosition] = 1;
+                puPositions[puBucketKeys[uFirst + j]] = uPosition;
+            }
+            if (j == uSize) {
+                oSymFrozen->puPilots[uBucket] = (uint32_t)uPilot;
+                break;
+            }
+
+            /* Free the slots this pilot took before it failed */
+            while (j > 0) {
+                j--;
+                pucTaken[puPositions[puBucketKeys[uFirst + j]]] = 0;
+            }
+        }
+    }
+
+    free(puBucketStarts);
+    free(puBucketKeys);
+    free(puSizeStarts);
+    free(puBucketOrder);
+    free(pucTaken);
+    return iResult;
+}
+
+/* Helper layout function */
+uint64_t SymFrozen_layout(uint64_t uLength, uint64_t uBucketCount, uint64_t uKeyBytes,
+    uint64_t *puPilotsOffset, uint64_t *puKeysOffset) {
+    uint64_t uSize;
+
+    assert(puPilotsOffset != NULL);
+    assert(puKeysOffset != NULL);
+
+    /* Every key has a '\0' after it, and a table has one bucket per KEYS_PER_BUCKET bindings.
+    Bounding each section by 2^60 bytes keeps the sums from overflowing. */
+    if (uBucketCount != (uLength + KEYS_PER_BUCKET - 1) / KEYS_PER_BUCKET ||
+            uKeyBytes < uLength || uLength > ((uint64_t)1 << 60) / sizeof(struct Slot) ||
+            uKeyBytes > ((uint64_t)1 << 60)) {
+        return 0;
+    }
+    *puPilotsOffset = sizeof(struct FileHeader) + uLength * sizeof(struct Slot);
+    *puKeysOffset = *puPilotsOffset + (uBucketCount * sizeof(uint32_t) + 7) / 8 * 8;
+    uSize = *puKeysOffset + uKeyBytes;
+    if (uSize > (uint64_t)SIZE_MAX) {
+        return 0;
+    }
+    return uSize;
+}
+
+/* Helper checksum function */
+uint64_t SymFrozen_checksum(const void *pvBytes, size_t uSize, uint64_t uSeed) {
+    const unsigned char* pucBytes = (const unsigned char*)pvBytes;
+    uint64_t auLanes[4];
+    uint64_t uWord;
+    size_t i = 0;  /* loop counter */
+
+    assert(pvBytes != NULL || uSize == 0);
+
+    /* Four independent lanes of 8 bytes each, so that their multiplications overlap */
+    auLanes[0] = uSeed ^ SYMHASH_SECRET0;
+    auLanes[1] = uSeed ^ SYMHASH_SECRET1;
+    auLanes[2] = uSeed ^ SYMHASH_SECRET2;
+    auLanes[3] = uSeed ^ SYMHASH_SECRET3;
+    for (; i + 32 <= uSize; i += 32) {
+        auLanes[0] = SymHash_mix(auLanes[0] ^ SymHash_read8(pucBytes + i), SYMHASH_SECRET1);
+        auLanes[1] = SymHash_mix(auLanes[1] ^ SymHash_read8(pucBytes + i + 8), SYMHASH_SECRET2);
+        auLanes[2] = SymHash_mix(auLanes[2] ^ SymHash_read8(pucBytes + i + 16), SYMHASH_SECRET3);
+        auLanes[3] = SymHash_mix(auLanes[3] ^ SymHash_read8(pucBytes + i + 24), SYMHASH_SECRET0);
+    }
+    for (; i < uSize; i++) {
+        uWord = pucBytes[i];
+        auLanes[i % 4] = SymHash_mix(auLanes[i % 4] ^ (uWord + 1), SYMHASH_SECRET1);
+    }
+    return SymHash_mix(auLanes[0] ^ auLanes[2] ^ (uint64_t)uSize, SYMHASH_SECRET2) ^
+        SymHash_mix(auLanes[1] ^ auLanes[3], SYMHASH_SECRET3);
+}
+
+/* Helper header checksum function */
+uint64_t SymFrozen_headerChecksum(const struct FileHeader *psHeader, const void *pvPilots) {
+    uint64_t uChecksum;
+
+    assert(psHeader != NULL);
+
+    /* The padding after the pilots is left out, as it is always zero */
+    uChecksum = SymFrozen_checksum(psHeader, sizeof(*psHeader), 0);
+    return SymFrozen_checksum(pvPilots, (size_t)psHeader->uBucketCount * sizeof(uint32_t),
+        uChecksum);
+}
+
+/* Helper body checksum function */
+uint64_t SymFrozen_bodyChecksum(const struct FileHeader *psHeader, const void *pvSlots,
+    const char *pcKeys) {
+    uint64_t uChecksum;
+
+    assert(psHeader != NULL);
+
+    uChecksum = SymFrozen_checksum(pvSlots, (size_t)psHeader->uLength * sizeof(struct Slot),
+        psHeader->uLength);
+    return SymFrozen_checksum(pcKeys, (size_t)psHeader->uKeyBytes, uChecksum);
+}
+
+/* Helper write all function */
+int SymFrozen_writeAll(int iFd, const void *pvBytes, size_t uSize) {
+    const char* pcBytes = (const char*)pvBytes;
+    ssize_t iWritten;
+
+    while (uSize > 0) {
+        iWritten = write(iFd, pcBytes, uSize);
+        if (iWritten <= 0) {
+            return 0;
+        }
+        pcBytes += iWritten;
+        uSize -= (size_t)iWritten;
+    }
+    return 1;
+}
+
+/* Helper find function */
+const struct Slot* SymFrozen_find(SymFrozen_T oSymFrozen, const char *pcKey,
+    size_t uLength) {
+    const struct Slot* psSlot;
+    const char* pcSlotKey;
+    uint64_t uHash;
+    uint32_t uPilot;
+
+    assert(oSymFrozen != NULL);
+    assert(pcKey != NULL);
+
+    if (oSymFrozen->length == 0) {
+        return NULL;
+    }
+
+    /* Every key hashes to some slot, so the key there must still be compared */
+    uHash = SymFrozen_hash(pcKey, uLength, oSymFrozen->uSeed);
+    uPilot = oSymFrozen->puPilots[SymFrozen_reduce(uHash, oSymFrozen->uBucketCount)];
+    psSlot = &oSymFrozen->psSlots[SymFrozen_position(uHash, uPilot, oSymFrozen->length)];
+    if (psSlot->uKeyLength != uLength) {
+        return NULL;
+    }
+    pcSlotKey = SymFrozen_slotKey(oSymFrozen, psSlot);
+    if (pcSlotKey == NULL || memcmp(pcSlotKey, pcKey, uLength) != 0) {
+        return NULL;
+    }
+    return psSlot;
+}
+
+/* Helper slot key function */
+const char* SymFrozen_slotKey(SymFrozen_T oSymFrozen, const struct Slot *psSlot) {
+    uint64_t uOffset;
+    uint64_t uLength;
+
+    assert(oSymFrozen != NULL);
+    assert(psSlot != NULL);
+
+    /* The slots of a mapped file are not checked when it is opened, so each is checked as it is
+    read */
+    uOffset = psSlot->uKeyOffset;
+    uLength = psSlot->uKeyLength;
+    if (uOffset >= (uint64_t)oSymFrozen->uKeyBytes ||
+            uLength >= (uint64_t)oSymFrozen->uKeyBytes - uOffset ||
+            oSymFrozen->pcKeys[(size_t)(uOffset + uLength)] != '\0') {
+        return NULL;
+    }
+    return oSymFrozen->pcKeys + (size_t)uOffset;
+}
@@ -0,0 +1,69 @@
+/* symfrozen.h
+Author: Tinney Mak */
+
+#include <stddef.h>
+#include "symtable.h"
+#ifndef SYMFROZEN_INCLUDED
+#define SYMFROZEN_INCLUDED
+
+/* A SymFrozen_T object is a read-only copy of the bindings of a SymTable_T object. Its keys are
+packed into one block and found with a minimal perfect hash, so that a lookup takes one hash of
+the key, one slot and one key comparison. It works with any implementation of symtable.h */
+typedef struct SymFrozen* SymFrozen_T;
+
+/* Returns a new SymFrozen object holding a copy of each binding of oSymTable, or NULL if
+insufficient memory is available. The values are copied as addresses, as SymTable_put stores
+them. oSymTable is left unchanged and may be changed or freed afterwards without affecting the
+copy. oSymTable must not change while it is being frozen */
+SymFrozen_T SymTable_freeze(SymTable_T oSymTable);
+
+/* Frees all memory occupied by oSymFrozen, or unmaps the file it was opened from */
+void SymFrozen_free(SymFrozen_T oSymFrozen);
+
+/* Writes the bindings of oSymTable to the file at pcPath, replacing it as a whole if it exists,
+in a form that SymTable_openMapped can use without reading it into memory. Each value is saved
+as the number its address converts to, so only values that are not addresses, such as small
+integers cast to void*, keep their meaning in another process. Returns 1 if successful and 0 if
+the file cannot be written or there is insufficient memory */
+int SymTable_save(SymTable_T oSymTable, const char *pcPath);
+
+/* Like SymTable_save, for the bindings of oSymFrozen */
+int SymFrozen_save(SymFrozen_T oSymFrozen, const char *pcPath);
+
+/* Returns a SymFrozen object whose bindings are those of the file at pcPath, saved by
+SymTable_save or SymFrozen_save, or NULL if the file cannot be read, is not such a file, was
+saved on a machine of another byte order or size_t width, or is corrupt. The file is mapped into
+memory and read in place, so processes that open the same file share its pages. Only the
+checksum of its header and pilots is verified when it is opened, so that opening reads few of its
+pages; a lookup or SymFrozen_map that meets a slot whose key lies outside the file treats the
+slot as empty, and SymFrozen_verify checks the rest */
+SymFrozen_T SymTable_openMapped(const char *pcPath);
+
+/* Returns 1 if the slots and keys of oSymFrozen, opened by SymTable_openMapped, match the
+checksum saved with them, and 0 if the file is corrupt. It reads the whole file. Returns 1 for
+a table made by SymTable_freeze */
+int SymFrozen_verify(SymFrozen_T oSymFrozen);
+
+/* Returns the number of bindings in oSymFrozen */
+size_t SymFrozen_getLength(SymFrozen_T oSymFrozen);
+
+/* Return 1 if oSymFrozen contains a binding whose key is pcKey and 0 otherwise */
+int SymFrozen_contains(SymFrozen_T oSymFrozen, const char *pcKey);
+
+/* Return the value of the binding within oSymFrozen whose key is pcKey or NULL if no such
+binding exists */
+void *SymFrozen_get(SymFrozen_T oSymFrozen, const char *pcKey);
+
+/* Like SymFrozen_contains, with a key of uLength bytes that may include '\0' characters */
+int SymFrozen_containsN(SymFrozen_T oSymFrozen, const char *pcKey, size_t uLength);
+
+/* Like SymFrozen_get, with a key of uLength bytes that may include '\0' characters */
+void *SymFrozen_getN(SymFrozen_T oSymFrozen, const char *pcKey, size_t uLength);
+
+/* Apply function *pfApply to each binding in oSymFrozen, passing pvExtra as an extra
+parameter. Each key is passed '\0'-terminated, so a key with '\0' characters appears cut short */
+void SymFrozen_map(SymFrozen_T oSymFrozen,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra);
+
+#endif
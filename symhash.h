@@ -0,0 +1,131 @@
+/* symhash.h
+Author: Tinney Mak */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#ifndef SYMHASH_INCLUDED
+#define SYMHASH_INCLUDED
+
+/* The default hash of the SymTable implementations, in the style of wyhash: keys are read 8
+bytes at a time and mixed with 64x64->128-bit multiplications, folding the two halves of each
+product together. It is defined here, in the header, so that every implementation and the test
+client can use it without another source file to link. */
+
+/* Constants from wyhash */
+#define SYMHASH_SECRET0 0xa0761d6478bd642fULL
+#define SYMHASH_SECRET1 0xe7037ed1a0b428dbULL
+#define SYMHASH_SECRET2 0x8ebc6af09c88c6e3ULL
+#define SYMHASH_SECRET3 0x589965cc75374cc3ULL
+
+/* Multiplies *puA by *puB, storing the low 64 bits of the product in *puA and the high 64 bits
+in *puB */
+static inline void SymHash_multiply(uint64_t *puA, uint64_t *puB) {
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 SymHash_uint128;
+    SymHash_uint128 uProduct = (SymHash_uint128)*puA * *puB;
+    *puA = (uint64_t)uProduct;
+    *puB = (uint64_t)(uProduct >> 64);
+#else
+    /* Schoolbook multiplication of 32-bit halves */
+    uint64_t uAHigh = *puA >> 32, uALow = (uint32_t)*puA;
+    uint64_t uBHigh = *puB >> 32, uBLow = (uint32_t)*puB;
+    uint64_t uHighHigh = uAHigh * uBHigh, uHighLow = uAHigh * uBLow;
+    uint64_t uLowHigh = uALow * uBHigh, uLowLow = uALow * uBLow;
+    uint64_t uMiddle = (uLowLow >> 32) + (uint32_t)uHighLow + (uint32_t)uLowHigh;
+    *puA = (uMiddle << 32) | (uint32_t)uLowLow;
+    *puB = uHighHigh + (uHighLow >> 32) + (uLowHigh >> 32) + (uMiddle >> 32);
+#endif
+}
+
+/* Returns the low and high 64 bits of uA * uB, XORed together */
+static inline uint64_t SymHash_mix(uint64_t uA, uint64_t uB) {
+    SymHash_multiply(&uA, &uB);
+    return uA ^ uB;
+}
+
+/* Returns the 8 bytes at pucBytes as a little-endian number */
+static inline uint64_t SymHash_read8(const unsigned char *pucBytes) {
+    uint64_t uWord;
+    memcpy(&uWord, pucBytes, sizeof(uWord));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    uWord = __builtin_bswap64(uWord);
+#endif
+    return uWord;
+}
+
+/* Returns the 4 bytes at pucBytes as a little-endian number */
+static inline uint64_t SymHash_read4(const unsigned char *pucBytes) {
+    uint32_t uWord;
+    memcpy(&uWord, pucBytes, sizeof(uWord));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    uWord = __builtin_bswap32(uWord);
+#endif
+    return uWord;
+}
+
+/* Returns the hash of the uLength bytes at pvKey, varied by uSeed. On a machine with a 32-bit
+size_t, the hash is the low half of the 64-bit result. */
+static inline size_t SymHash_hash(const void *pvKey, size_t uLength, size_t uSeed) {
+    const unsigned char* pucKey = (const unsigned char*)pvKey;
+    uint64_t uSeed64 = (uint64_t)uSeed;
+    uint64_t uA;
+    uint64_t uB;
+
+    uSeed64 ^= SymHash_mix(uSeed64 ^ SYMHASH_SECRET0, SYMHASH_SECRET1);
+
+    if (uLength <= 16) {
+        /* Short keys are read as at most four overlapping 4-byte words, so no byte is read
+        twice for the common lengths and none is read outside the key */
+        if (uLength >= 4) {
+            size_t uOffset = (uLength >> 3) << 2;
+            uA = (SymHash_read4(pucKey) << 32) | SymHash_read4(pucKey + uOffset);
+            uB = (SymHash_read4(pucKey + uLength - 4) << 32) |
+                SymHash_read4(pucKey + uLength - 4 - uOffset);
+        } else if (uLength > 0) {
+            uA = ((uint64_t)pucKey[0] << 16) | ((uint64_t)pucKey[uLength >> 1] << 8) |
+                pucKey[uLength - 1];
+            uB = 0;
+        } else {
+            uA = 0;
+            uB = 0;
+        }
+    } else {
+        size_t uLeft = uLength;
+
+        /* Three independent lanes over 48-byte blocks keep the multiplier busy */
+        if (uLeft > 48) {
+            uint64_t uSeed1 = uSeed64;
+            uint64_t uSeed2 = uSeed64;
+            do {
+                uSeed64 = SymHash_mix(SymHash_read8(pucKey) ^ SYMHASH_SECRET1,
+                    SymHash_read8(pucKey + 8) ^ uSeed64);
+                uSeed1 = SymHash_mix(SymHash_read8(pucKey + 16) ^ SYMHASH_SECRET2,
+                    SymHash_read8(pucKey + 24) ^ uSeed1);
+                uSeed2 = SymHash_mix(SymHash_read8(pucKey + 32) ^ SYMHASH_SECRET3,
+                    SymHash_read8(pucKey + 40) ^ uSeed2);
+                pucKey += 48;
+                uLeft -= 48;
+            } while (uLeft > 48);
+            uSeed64 ^= uSeed1 ^ uSeed2;
+        }
+
+        while (uLeft > 16) {
+            uSeed64 = SymHash_mix(SymHash_read8(pucKey) ^ SYMHASH_SECRET1,
+                SymHash_read8(pucKey + 8) ^ uSeed64);
+            pucKey += 16;
+            uLeft -= 16;
+        }
+
+        /* The last 16 bytes, which may overlap bytes already mixed */
+        uA = SymHash_read8(pucKey + uLeft - 16);
+        uB = SymHash_read8(pucKey + uLeft - 8);
+    }
+
+    uA ^= SYMHASH_SECRET1;
+    uB ^= uSeed64;
+    SymHash_multiply(&uA, &uB);
+    return (size_t)SymHash_mix(uA ^ SYMHASH_SECRET0 ^ (uint64_t)uLength, uB ^ SYMHASH_SECRET1);
+}
+
+#endif
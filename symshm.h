@@ -0,0 +1,35 @@
+/* symshm.h
+Author: Tinney Mak */
+
+#include <stddef.h>
+#include "symtable.h"
+#ifndef SYMSHM_INCLUDED
+#define SYMSHM_INCLUDED
+
+/* The functions below are only in symtableshm.c, whose tables live in shared memory. One
+process, the one that made a table, changes it; others, whether forked from it after the table
+was made or attached to it by name, see its bindings as they change and may only look them up.
+Values are stored as addresses, so only values that are not addresses, such as small integers
+cast to void*, or addresses of memory that every reader shares, keep their meaning in another
+process */
+
+/* Returns a new SymTable object that contains no bindings and lives in a new POSIX shared
+memory object named pcName, such as "/symbols", of uSize bytes, replacing any object of that
+name; processes that attached to the old one keep it. Pages of the object are used only once
+bindings reach them, but the table can never hold more than uSize bytes of bindings, at which
+point puts fail as if memory were short. Returns NULL if the object cannot be made or mapped,
+uSize is too small for an empty table, or insufficient memory is available */
+SymTable_T SymTable_newShared(const char *pcName, size_t uSize);
+
+/* Returns a SymTable object for the table that the process calling SymTable_newShared(pcName,
+...) made, mapped read-only, or NULL if the object cannot be opened, was made on a machine of
+another size_t width, or holds no such table. The functions that change a table fail on it
+without changing anything. SymTable_free only unmaps the object */
+SymTable_T SymTable_attachShared(const char *pcName);
+
+/* Removes the name pcName of a shared memory object made by SymTable_newShared, so that no
+process can attach to it any more; the memory is released once every table using it has been
+freed. Returns 1 if successful and 0 otherwise */
+int SymTable_unlinkShared(const char *pcName);
+
+#endif
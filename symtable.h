@@ -12,12 +12,93 @@ typedef struct SymTable* SymTable_T;
 memory is available */
 SymTable_T SymTable_new(void);
 
+/* A SymTable_HashFunction returns the hash of the uLength bytes at pvKey, varied by uSeed. It
+must return equal hashes for equal keys and seeds. Bucket indices come from the low bits of the
+hash, so every bit should depend on the whole key */
+typedef size_t (*SymTable_HashFunction)(const void *pvKey, size_t uLength, size_t uSeed);
+
+/* Returns new SymTable object that contains no bindings and hashes keys with *pfHash and seed
+uSeed, or with the default hash and seed uSeed if pfHash is NULL. Returns NULL if insufficient
+memory is available. An implementation that does not hash ignores pfHash and uSeed */
+SymTable_T SymTable_newWithHash(SymTable_HashFunction pfHash, size_t uSeed);
+
+/* Returns new SymTable object that contains no bindings and has room for uCapacity bindings
+without growing, or NULL if insufficient memory is available */
+SymTable_T SymTable_newWithCapacity(size_t uCapacity);
+
+/* Returns new SymTable object that contains no bindings and whose functions may be called by
+several threads at once, each call behaving as if it ran alone. Returns NULL if insufficient
+memory is available or the implementation does not support concurrent use. SymTable_free must
+not overlap any other call on the table, *pfApply of SymTable_map must not call functions on the
+table it is applied to, and an address returned by SymTable_getOrPut may only be used while no
+other thread adds or removes bindings */
+SymTable_T SymTable_newConcurrent(void);
+
+/* Grow oSymTable, if needed, so that it holds uCapacity bindings without growing again, and
+keep it from shrinking by itself below that size until SymTable_shrinkToFit is called. Return 1
+if successful or 0 if there is insufficient memory, in which case oSymTable is unchanged. An
+implementation that does not grow does nothing and returns 1 */
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity);
+
+/* Shrink oSymTable to the smallest size that holds its bindings, releasing the memory left
+over from bindings that have been removed, and cancel any capacity reserved with
+SymTable_reserve. Return 1 if successful or 0 if there is insufficient memory for the smaller
+copy, in which case oSymTable is unchanged. Tables also shrink by themselves once removals
+leave them mostly empty */
+int SymTable_shrinkToFit(SymTable_T oSymTable);
+
 /* Frees all memory occupied by oSymTable */
 void SymTable_free(SymTable_T oSymTable);
 
 /* Returns the number of bindings in oSymTable */
 size_t SymTable_getLength(SymTable_T oSymTable);
 
+/* Returns the number of buckets that the bindings of oSymTable are spread over. An
+implementation without buckets, or a table still small enough to keep all its bindings in a
+single chain, returns 1 */
+size_t SymTable_getBucketCount(SymTable_T oSymTable);
+
+/* The number of entries in the histogram of a SymTable_Stats */
+enum {SYMTABLE_HISTOGRAM_SIZE = 16};
+
+/* A SymTable_Stats describes how evenly the bindings of a table are spread and what they cost.
+The caller declares it and SymTable_getStats fills it in */
+typedef struct SymTable_Stats {
+    /* The number of bindings, the number of buckets and the bindings per bucket */
+    size_t uLength;
+    size_t uBucketCount;
+    double dLoadFactor;
+
+    /* For an implementation that chains bindings, auHistogram[i] is the number of buckets whose
+    chain holds i bindings; for one that probes, it is the number of bindings found i probe steps
+    past where their search starts. The last entry also counts every longer chain or probe, and
+    uLongest is the longest of them all */
+    size_t auHistogram[SYMTABLE_HISTOGRAM_SIZE];
+    size_t uLongest;
+
+    /* The number of times the table has moved its bindings into new buckets */
+    size_t uResizeCount;
+
+    /* The bytes the nodes (or entries), the keys stored apart from them and the buckets (or
+    index) of the table take up. Memory freed by removals and kept for reuse is not counted */
+    size_t uNodeBytes;
+    size_t uKeyBytes;
+    size_t uBucketBytes;
+
+    /* The number of searches that found their key and that did not, whether to look it up, add
+    it or remove it, and the number of bindings whose keys they compared. These are counted only
+    in a build with SYMTABLE_STATS defined, and are 0 otherwise, so that other builds pay nothing
+    for them */
+    size_t uHits;
+    size_t uMisses;
+    size_t uCompares;
+} SymTable_Stats;
+
+/* Store in *psStats the statistics of oSymTable. This visits every bucket and binding, so it is
+for occasional inspection rather than for every operation. A concurrent table is kept from
+changing while it is inspected, although lookups continue */
+void SymTable_getStats(SymTable_T oSymTable, SymTable_Stats *psStats);
+
 /* If oSymTable doesn't contain a binding with key pcKey, add a new binding to
 oSymTable where the key is pcKey and the value is pvValue and return 1; otherwise,
 if the binding already exists or there is insufficient memory, leave oSymTable unchanged 
@@ -25,6 +106,27 @@ and return 0 */
 int SymTable_put(SymTable_T oSymTable, 
     const char *pcKey, const void *pvValue);
 
+/* If oSymTable contains a binding with key pcKey, return the address of that binding's value;
+otherwise, add a new binding whose key is pcKey and whose value is pvValue and return the
+address of its value. Return NULL if there is insufficient memory, leaving oSymTable unchanged.
+The address stays valid until the next call that adds or removes a binding of oSymTable or
+changes its capacity */
+void **SymTable_getOrPut(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue);
+
+/* Bind pcKey to pvValue in oSymTable, replacing the value of an existing binding with key pcKey
+or adding a new binding if there is none. Return 1 if successful or 0 if there is insufficient
+memory, in which case oSymTable is unchanged */
+int SymTable_upsert(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue);
+
+/* If oSymTable contains a binding with key pcKey, replace the binding's value with pvValue,
+store the old value in *ppvOldValue unless ppvOldValue is NULL, and return 0; otherwise, add a
+new binding whose key is pcKey and whose value is pvValue and return 1. Return -1 if there is
+insufficient memory, in which case oSymTable is unchanged */
+int SymTable_putOrReplace(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue, void **ppvOldValue);
+
 /* If oSymTable contains a binding with pcKey, replace the binding's value with pvValue
 and return the old value; otherwise, leave oSymTable unchanged and return NULL */
 void *SymTable_replace(SymTable_T oSymTable,
@@ -41,10 +143,104 @@ void *SymTable_get(SymTable_T oSymTable, const char *pcKey);
 binding's value; otherwise, make no changes and return NULL */
 void *SymTable_remove(SymTable_T oSymTable, const char *pcKey);
 
+/* The functions below behave like the ones above without the N, except that the key is the
+uLength bytes at pcKey instead of a string. The bytes may include '\0' characters, and
+pcKey need not be '\0'-terminated. A string key equals the key of its characters without the
+terminating '\0' */
+
+/* Like SymTable_put, with a key of uLength bytes */
+int SymTable_putN(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength, const void *pvValue);
+
+/* Like SymTable_replace, with a key of uLength bytes */
+void *SymTable_replaceN(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength, const void *pvValue);
+
+/* Like SymTable_contains, with a key of uLength bytes */
+int SymTable_containsN(SymTable_T oSymTable, const char *pcKey, size_t uLength);
+
+/* Like SymTable_get, with a key of uLength bytes */
+void *SymTable_getN(SymTable_T oSymTable, const char *pcKey, size_t uLength);
+
+/* Like SymTable_remove, with a key of uLength bytes */
+void *SymTable_removeN(SymTable_T oSymTable, const char *pcKey, size_t uLength);
+
+/* Store in ppvValues[i] the value of the binding in oSymTable whose key is ppcKeys[i], or NULL
+if there is none, for 0 <= i < uCount. This gives the same results as uCount calls of
+SymTable_get, but looks up many keys at once, so that their cache misses overlap */
+void SymTable_getBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    void **ppvValues);
+
+/* Store in piFound[i] 1 if oSymTable contains a binding whose key is ppcKeys[i] and 0
+otherwise, for 0 <= i < uCount, looking up many keys at once as SymTable_getBatch does */
+void SymTable_containsBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    int *piFound);
+
+/* Add a binding of ppcKeys[i] to ppvValues[i] to oSymTable for each 0 <= i < uCount whose key
+is not already in oSymTable or earlier in ppcKeys. The table is grown once, up front, to hold
+all of them. Unless piRejected is NULL, set piRejected[i] to 1 if the binding of ppcKeys[i] was
+not added because its key was already present and 0 otherwise. Return 1 if successful, or 0 if
+there is insufficient memory, in which case oSymTable may hold some of the new bindings and
+the contents of piRejected are undefined */
+int SymTable_putBatch(SymTable_T oSymTable, const char **ppcKeys, void **ppvValues,
+    size_t uCount, int *piRejected);
+
+/* Return a new SymTable object holding the bindings that SymTable_putBatch would add to an
+empty one, reporting rejected keys in the same way, or NULL if there is insufficient memory */
+SymTable_T SymTable_bulkLoad(const char **ppcKeys, void **ppvValues, size_t uCount,
+    int *piRejected);
+
 /* Apply function *pfApply to each binding in oSymTable, passing pvExtra as an extra 
-parameter */
+parameter. Each key is passed '\0'-terminated, so a key with '\0' characters appears cut short */
 void SymTable_map(SymTable_T oSymTable,
     void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
     const void *pvExtra);
 
+/* Apply function *pfApply to each binding in oSymTable like SymTable_map, but split the work
+among uThreadCount workers: the calling thread and uThreadCount - 1 threads started for the
+call. Worker i passes ppvExtras[i] as the extra parameter, or NULL if ppvExtras is NULL, so that
+each worker can keep an accumulator of its own. The workers call *pfApply for different bindings
+at the same time and in no particular order, and it must not call functions on oSymTable. If a
+thread cannot be started, the other workers do its share. An implementation that cannot split
+its bindings applies *pfApply to all of them in the calling thread, as worker 0 */
+void SymTable_mapParallel(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    void **ppvExtras, size_t uThreadCount);
+
+/* A SymTable_Iter is a position in a walk over the bindings of a table. The caller declares it,
+so walking needs no memory, and its fields are for the implementation only */
+typedef struct SymTable_Iter {
+    SymTable_T oSymTable;
+    size_t uIndex;
+    void *pvNext;
+} SymTable_Iter;
+
+/* Start a walk over the bindings of oSymTable at psIter. From then until SymTable_iterEnd, no
+binding may be added to or removed from oSymTable and its capacity may not change, although
+bindings may be looked up and their values replaced. A concurrent table is kept from changing
+until SymTable_iterEnd, so the walking thread may only look bindings up in it */
+void SymTable_iterBegin(SymTable_T oSymTable, SymTable_Iter *psIter);
+
+/* If the walk at psIter has bindings left, store the key of the next one in *ppcKey, the length
+of the key in *puLength and its value in *ppvValue, skipping any of them that is NULL, and return
+1; otherwise return 0. The bindings come in no particular order, each exactly once */
+int SymTable_iterNext(SymTable_Iter *psIter, const char **ppcKey, size_t *puLength,
+    void **ppvValue);
+
+/* End the walk at psIter, whether or not it reached the last binding */
+void SymTable_iterEnd(SymTable_Iter *psIter);
+
+/* Apply function *pfApply to some of the bindings of oSymTable, passing pvExtra as an extra
+parameter, and return the cursor for the next call, or 0 once every binding has been visited.
+A scan starts with uCursor 0 and passes each call the cursor the previous one returned. Each call
+visits at least uCount bindings unless the scan ends first, or it has passed over many empty
+buckets. Bindings may be added and removed, and the table may grow and shrink, between calls:
+every binding present from the start of the scan to its end is visited at least once, others
+may or may not be, and some may be visited more than once. *pfApply must not call functions on
+oSymTable. An implementation that cannot resume a scan safely visits every binding in the first
+call and returns 0 */
+size_t SymTable_scan(SymTable_T oSymTable, size_t uCursor, size_t uCount,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,1180 @@
+/* symtabledict.c
+Author: Tinney Mak */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "symtable.h"
+#include "symhash.h"
+
+/* A compact table in the style of the dict of Python 3.6: the bindings are kept in a dense array
+of entries in the order they were added, and the hash index holds only the positions of entries
+in that array. Walking the bindings is a scan of the entries, however large the index, and the
+index takes 1, 2 or 4 bytes per slot depending on how many entries it must number. */
+
+/* The index has a power-of-two number of slots, at least MIN_INDEX_SIZE and at most
+MAX_INDEX_SIZE, and is probed linearly from the low bits of a key's hash. */
+enum {MIN_INDEX_SIZE = 8};
+enum {MAX_INDEX_SIZE = 1 << 30};
+
+/* The entry array has room for USABLE_NUMERATOR / USABLE_DENOMINATOR as many entries as the
+index has slots, so that probes stay short. Once it is full, the table is rebuilt into an index
+with room for twice as many bindings as remain, dropping the entries of removed bindings. */
+enum {USABLE_NUMERATOR = 2, USABLE_DENOMINATOR = 3};
+
+/* Once a removal leaves fewer than one binding per SHRINK_DIVISOR index slots, the table is
+rebuilt into about half as many slots as its bindings would fill, but no fewer than the capacity
+reserved with SymTable_reserve needs. Defining SYMTABLE_NO_AUTO_SHRINK turns this off. */
+enum {SHRINK_DIVISOR = 8};
+
+/* The batch functions look up BATCH_SIZE keys at a time: they hash them all and prefetch the
+index slots where their probes start, then prefetch the entries those slots name, and only
+then search, so that the cache misses of the keys overlap. */
+enum {BATCH_SIZE = 16};
+
+/* The workers of SymTable_mapParallel claim MAP_STEP entries at a time, so that workers that
+finish early take on more of the rest. */
+enum {MAP_STEP = 16384};
+
+/* Index slot values other than the position of an entry. Filling an index with 0xFF bytes makes
+every slot INDEX_EMPTY, whatever its width. */
+enum {INDEX_EMPTY = -1, INDEX_DELETED = -2};
+
+/* Hints that the memory at pv will be read soon */
+#if defined(__GNUC__)
+#define SymTable_prefetch(pv) __builtin_prefetch(pv)
+#else
+#define SymTable_prefetch(pv) ((void)(pv))
+#endif
+
+/* The seed of the default hash for tables made by SymTable_new */
+enum {DEFAULT_SEED = 0};
+
+/* Keys shorter than INLINE_KEY_SIZE - 1 bytes are stored inside their entry, which makes an
+entry 40 bytes on a 64-bit machine. The last byte of the entry's key holds the length of an
+inline key, HEAP_KEY for a key stored on the heap, or DELETED_KEY once the binding has been
+removed. */
+enum {INLINE_KEY_SIZE = 24, HEAP_KEY = 0xFF, DELETED_KEY = 0xFE};
+
+/* Each Entry contains a binding, consisting of a key and value. Entries are stored contiguously
+in the order their bindings were added. */
+struct Entry {
+    /* The key, followed by a '\0'. A short key is copied into acInline, whose last byte is
+    its length; a longer key is copied to the heap, sHeap holds the address of the copy and its
+    length, and the last byte of acInline is HEAP_KEY. */
+    union {
+        char acInline[INLINE_KEY_SIZE];
+        struct {
+            char* pcHeap;
+            size_t uLength;
+        } sHeap;
+    } uKey;
+
+    /* The full hash of the key, kept so that the table can be rebuilt and searched without
+    rereading keys */
+    size_t uHash;
+
+    /* The value */
+    void* pvValue;
+};
+
+/* A SymTable is a hash index of small integers over a dense array of entries. */
+struct SymTable {
+    /* The address of the index, an array of uIndexSize signed integers of uIndexWidth bytes,
+    each the position of an entry, INDEX_EMPTY or INDEX_DELETED */
+    void* pvIndex;
+
+    /* The number of index slots, a power of two */
+    size_t uIndexSize;
+
+    /* The number of bytes of each index slot: 1, 2 or 4 */
+    size_t uIndexWidth;
+
+    /* The address of the array of entries */
+    struct Entry* psEntries;
+
+    /* The number of entries in use, including those of removed bindings */
+    size_t uEntryCount;
+
+    /* The number of entries there is room for */
+    size_t uEntryCapacity;
+
+    /* The number of the bindings in the symbol table */
+    size_t length;
+
+    /* The number of index slots below which the table does not shrink by itself */
+    size_t uMinIndexSize;
+
+    /* The hash function and its seed */
+    SymTable_HashFunction pfHash;
+    size_t uSeed;
+
+    /* The number of times the table has been rebuilt */
+    size_t uResizeCount;
+#ifdef SYMTABLE_STATS
+    /* The operation counters of SymTable_getStats */
+    size_t uHits;
+    size_t uMisses;
+    size_t uCompares;
+#endif
+};
+
+/* Adds uAmount to the operation counter uCounter of oSymTable in a build with SYMTABLE_STATS
+defined, and does nothing otherwise */
+#ifdef SYMTABLE_STATS
+#define SymTable_count(oSymTable, uCounter, uAmount) ((oSymTable)->uCounter += (uAmount))
+#else
+#define SymTable_count(oSymTable, uCounter, uAmount) ((void)0)
+#endif
+
+/* A MapJob is the work that the workers of SymTable_mapParallel share. */
+struct MapJob {
+    /* The table */
+    SymTable_T oSymTable;
+
+    /* The function to apply */
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra);
+
+    /* The number of entries claimed so far */
+    size_t uNext;
+};
+
+/* A MapWorker is one worker of SymTable_mapParallel. */
+struct MapWorker {
+    /* The shared work */
+    struct MapJob* psJob;
+
+    /* The extra parameter of the worker */
+    void* pvExtra;
+
+    /* The thread of the worker, and whether it was started */
+    pthread_t sThread;
+    int iStarted;
+};
+
+/* Helper function that returns the key of the binding in psEntry.*/
+static const char* SymTable_entryKey(const struct Entry *psEntry);
+
+/* Helper function that returns the length of the key of the binding in psEntry.*/
+static size_t SymTable_entryKeyLength(const struct Entry *psEntry);
+
+/* Helper function that returns 1 if the binding of psEntry has been removed and 0 otherwise.*/
+static int SymTable_isDeleted(const struct Entry *psEntry);
+
+/* Helper function that stores in psEntry a defensive copy of the uLength bytes at pcKey.
+Returns 1 if successful and 0 if there is insufficient memory.*/
+static int SymTable_setEntryKey(struct Entry *psEntry, const char *pcKey, size_t uLength);
+
+/* Helper function that frees the heap copy of the key in psEntry, if there is one.*/
+static void SymTable_freeEntryKey(struct Entry *psEntry);
+
+/* Helper function that returns the hash of the uLength bytes at pcKey under the hash function
+and seed of oSymTable.*/
+static size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey, size_t uLength);
+
+/* Helper function that returns the value of index slot uSlot of oSymTable.*/
+static int32_t SymTable_indexLoad(SymTable_T oSymTable, size_t uSlot);
+
+/* Helper function that sets index slot uSlot of oSymTable to iValue.*/
+static void SymTable_indexStore(SymTable_T oSymTable, size_t uSlot, int32_t iValue);
+
+/* Helper function that returns the number of bytes an index slot needs to number the entries
+of an index of uIndexSize slots.*/
+static size_t SymTable_indexWidthFor(size_t uIndexSize);
+
+/* Helper function that returns the number of entries there is room for beside an index of
+uIndexSize slots.*/
+static size_t SymTable_usableFor(size_t uIndexSize);
+
+/* Helper function that returns the number of index slots a table needs to hold uBindingCount
+bindings without being rebuilt: the least power of two, no less than MIN_INDEX_SIZE, with room
+for that many entries, or MAX_INDEX_SIZE if that is less.*/
+static size_t SymTable_indexSizeFor(size_t uBindingCount);
+
+/* Helper function that searches oSymTable for the index slot that names the entry whose key is
+the uLength bytes at pcKey, whose hash is uHash, and returns it. If there is none, returns
+oSymTable->uIndexSize and, unless puFreeSlot is NULL, stores in *puFreeSlot the first empty or
+deleted slot on the key's probe sequence.*/
+static size_t SymTable_find(SymTable_T oSymTable, const char *pcKey, size_t uLength,
+    size_t uHash, size_t *puFreeSlot);
+
+/* Helper function that stores in puSlots[i] the index slot of oSymTable that names the entry
+whose key is ppcKeys[i], or oSymTable->uIndexSize if there is none, for 0 <= i < uCount, where
+uCount is at most BATCH_SIZE.*/
+static void SymTable_findBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    size_t *puSlots);
+
+/* Helper function that returns the entry of oSymTable whose key is the uLength bytes at pcKey,
+first adding a new binding of that key to pvValue if there is none. Sets *piAdded to 1 if the
+binding was added and 0 otherwise. Returns NULL if there is insufficient memory, leaving the
+bindings of oSymTable unchanged.*/
+static struct Entry* SymTable_findOrAdd(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, const void *pvValue, int *piAdded);
+
+/* Helper function that moves every binding of oSymTable, in order, into a new entry array
+beside a new index of uNewIndexSize slots, dropping the entries of removed bindings. Returns 1 if
+successful and 0 if there is insufficient memory, in which case oSymTable is unchanged.*/
+static int SymTable_rebuild(SymTable_T oSymTable, size_t uNewIndexSize);
+
+/* Helper function that rebuilds oSymTable into enough index slots to hold uBindingCount
+bindings without being rebuilt again, unless it already has them. Returns 1 if successful and 0
+if there is insufficient memory, in which case oSymTable is unchanged.*/
+static int SymTable_growTo(SymTable_T oSymTable, size_t uBindingCount);
+
+/* Helper function that applies the function of the job of the MapWorker at pvWorker to the
+bindings of the entries it claims, until there are none left. Returns NULL.*/
+static void* SymTable_mapWork(void *pvWorker);
+
+/* Helper function that applies *pfApply to each binding of oSymTable whose probe starts at index
+slot uHome, passing pvExtra. Those are all named by the slots from uHome up to the first empty
+one. Returns the number of bindings visited.*/
+static size_t SymTable_scanSlot(SymTable_T oSymTable, size_t uHome,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra), void *pvExtra);
+
+/* Helper function that returns the cursor of SymTable_scan that follows uCursor for index slots
+chosen by the bits of uMask. Cursors advance by adding one to their reversed bits, so each slot
+of a larger or smaller index covers a run of cursors, and rebuilding between calls skips no
+binding. Returns 0 after the last cursor.*/
+static size_t SymTable_nextCursor(size_t uCursor, size_t uMask);
+
+SymTable_T SymTable_new(void) {
+    return SymTable_newWithHash(NULL, DEFAULT_SEED);
+}
+
+SymTable_T SymTable_newWithHash(SymTable_HashFunction pfHash, size_t uSeed) {
+    SymTable_T oSymTable;
+
+    oSymTable = (SymTable_T)calloc(1, sizeof(struct SymTable));
+    if (oSymTable == NULL) {
+        return NULL;
+    }
+
+    oSymTable->uIndexWidth = SymTable_indexWidthFor(MIN_INDEX_SIZE);
+    oSymTable->uEntryCapacity = SymTable_usableFor(MIN_INDEX_SIZE);
+    oSymTable->pvIndex = malloc(MIN_INDEX_SIZE * oSymTable->uIndexWidth);
+    oSymTable->psEntries = (struct Entry*)malloc(
+        oSymTable->uEntryCapacity * sizeof(struct Entry));
+    if (oSymTable->pvIndex == NULL || oSymTable->psEntries == NULL) {
+        free(oSymTable->pvIndex);
+        free(oSymTable->psEntries);
+        free(oSymTable);
+        return NULL;
+    }
+    memset(oSymTable->pvIndex, 0xFF, MIN_INDEX_SIZE * oSymTable->uIndexWidth);
+
+    oSymTable->uIndexSize = MIN_INDEX_SIZE;
+    oSymTable->uEntryCount = 0;
+    oSymTable->length = 0;
+    oSymTable->uMinIndexSize = MIN_INDEX_SIZE;
+    oSymTable->pfHash = (pfHash != NULL) ? pfHash : SymHash_hash;
+    oSymTable->uSeed = uSeed;
+    oSymTable->uResizeCount = 0;
+    return oSymTable;
+}
+
+SymTable_T SymTable_newWithCapacity(size_t uCapacity) {
+    SymTable_T oSymTable;
+
+    oSymTable = SymTable_new();
+    if (oSymTable == NULL) {
+        return NULL;
+    }
+    if (!SymTable_reserve(oSymTable, uCapacity)) {
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+    return oSymTable;
+}
+
+SymTable_T SymTable_newConcurrent(void) {
+    /* Every addition appends to the one entry array, so no part of the table can be guarded
+    on its own */
+    return NULL;
+}
+
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity) {
+    size_t uIndexSize;
+
+    assert(oSymTable != NULL);
+
+    if (!SymTable_growTo(oSymTable, uCapacity)) {
+        return 0;
+    }
+    uIndexSize = SymTable_indexSizeFor(uCapacity);
+    if (uIndexSize > oSymTable->uMinIndexSize) {
+        oSymTable->uMinIndexSize = uIndexSize;
+    }
+    return 1;
+}
+
+int SymTable_shrinkToFit(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    /* Rebuilding also drops the entries of removed bindings */
+    if (!SymTable_rebuild(oSymTable, SymTable_indexSizeFor(oSymTable->length))) {
+        return 0;
+    }
+    oSymTable->uMinIndexSize = MIN_INDEX_SIZE;
+    return 1;
+}
+
+void SymTable_free(SymTable_T oSymTable) {
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+
+    for (i = 0; i < oSymTable->uEntryCount; i++) {
+        SymTable_freeEntryKey(&oSymTable->psEntries[i]);
+    }
+
+    free(oSymTable->pvIndex);
+    free(oSymTable->psEntries);
+    free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+    return oSymTable->length;
+}
+
+size_t SymTable_getBucketCount(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+    return oSymTable->uIndexSize;
+}
+
+void SymTable_getStats(SymTable_T oSymTable, SymTable_Stats *psStats) {
+    const struct Entry* psEntry;
+    int32_t iEntry;
+    size_t uMask;
+    size_t uDistance;
+    size_t uSlot;
+
+    assert(oSymTable != NULL);
+    assert(psStats != NULL);
+
+    memset(psStats, 0, sizeof(SymTable_Stats));
+
+    psStats->uLength = oSymTable->length;
+    psStats->uBucketCount = oSymTable->uIndexSize;
+    psStats->dLoadFactor = (double)oSymTable->length / (double)oSymTable->uIndexSize;
+    psStats->uResizeCount = oSymTable->uResizeCount;
+
+    /* A binding's probe length is the number of slots between the one its probe starts at,
+    given by its cached hash, and the one that names its entry */
+    uMask = oSymTable->uIndexSize - 1;
+    for (uSlot = 0; uSlot < oSymTable->uIndexSize; uSlot++) {
+        iEntry = SymTable_indexLoad(oSymTable, uSlot);
+        if (iEntry < 0) {
+            continue;
+        }
+        psEntry = &oSymTable->psEntries[iEntry];
+        uDistance = (uSlot - psEntry->uHash) & uMask;
+
+        psStats->auHistogram[uDistance < SYMTABLE_HISTOGRAM_SIZE ?
+            uDistance : SYMTABLE_HISTOGRAM_SIZE - 1]++;
+        if (uDistance > psStats->uLongest) {
+            psStats->uLongest = uDistance;
+        }
+        if ((unsigned char)psEntry->uKey.acInline[INLINE_KEY_SIZE - 1] == HEAP_KEY) {
+            psStats->uKeyBytes += psEntry->uKey.sHeap.uLength + 1;
+        }
+    }
+
+    /* The entry array is allocated whole, including the entries of removed bindings and the
+    room left for new ones */
+    psStats->uNodeBytes = oSymTable->uEntryCapacity * sizeof(struct Entry);
+    psStats->uBucketBytes = oSymTable->uIndexSize * oSymTable->uIndexWidth;
+
+#ifdef SYMTABLE_STATS
+    psStats->uHits = oSymTable->uHits;
+    psStats->uMisses = oSymTable->uMisses;
+    psStats->uCompares = oSymTable->uCompares;
+#endif
+}
+
+int SymTable_put(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue) {
+    assert(pcKey != NULL);
+    return SymTable_putN(oSymTable, pcKey, strlen(pcKey), pvValue);
+}
+
+int SymTable_putN(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength, const void *pvValue) {
+    struct Entry* psEntry;
+    int iAdded;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psEntry = SymTable_findOrAdd(oSymTable, pcKey, uLength, pvValue, &iAdded);
+    return (psEntry != NULL) && iAdded;
+}
+
+void **SymTable_getOrPut(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue) {
+    struct Entry* psEntry;
+    int iAdded;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psEntry = SymTable_findOrAdd(oSymTable, pcKey, strlen(pcKey), pvValue, &iAdded);
+    if (psEntry == NULL) {
+        return NULL;
+    }
+    return &psEntry->pvValue;
+}
+
+int SymTable_upsert(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue) {
+    return SymTable_putOrReplace(oSymTable, pcKey, pvValue, NULL) >= 0;
+}
+
+int SymTable_putOrReplace(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue, void **ppvOldValue) {
+    struct Entry* psEntry;
+    int iAdded;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psEntry = SymTable_findOrAdd(oSymTable, pcKey, strlen(pcKey), pvValue, &iAdded);
+    if (psEntry == NULL) {
+        return -1;
+    }
+    if (iAdded) {
+        return 1;
+    }
+
+    if (ppvOldValue != NULL) {
+        *ppvOldValue = psEntry->pvValue;
+    }
+    psEntry->pvValue = (void*)pvValue;
+    return 0;
+}
+
+void *SymTable_replace(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue) {
+    assert(pcKey != NULL);
+    return SymTable_replaceN(oSymTable, pcKey, strlen(pcKey), pvValue);
+}
+
+void *SymTable_replaceN(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength, const void *pvValue) {
+    struct Entry* psEntry;
+    void* pvOldValue;
+    size_t uSlot;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uSlot = SymTable_find(oSymTable, pcKey, uLength,
+        SymTable_hash(oSymTable, pcKey, uLength), NULL);
+    if (uSlot == oSymTable->uIndexSize) {
+        return NULL;
+    }
+
+    psEntry = &oSymTable->psEntries[SymTable_indexLoad(oSymTable, uSlot)];
+    pvOldValue = psEntry->pvValue;
+    psEntry->pvValue = (void*)pvValue;
+    return pvOldValue;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+    assert(pcKey != NULL);
+    return SymTable_containsN(oSymTable, pcKey, strlen(pcKey));
+}
+
+int SymTable_containsN(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return SymTable_find(oSymTable, pcKey, uLength,
+        SymTable_hash(oSymTable, pcKey, uLength), NULL) !=
+        oSymTable->uIndexSize;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+    assert(pcKey != NULL);
+    return SymTable_getN(oSymTable, pcKey, strlen(pcKey));
+}
+
+void *SymTable_getN(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
+    size_t uSlot;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uSlot = SymTable_find(oSymTable, pcKey, uLength,
+        SymTable_hash(oSymTable, pcKey, uLength), NULL);
+    if (uSlot == oSymTable->uIndexSize) {
+        return NULL;
+    }
+    return oSymTable->psEntries[SymTable_indexLoad(oSymTable, uSlot)].pvValue;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+    assert(pcKey != NULL);
+    return SymTable_removeN(oSymTable, pcKey, strlen(pcKey));
+}
+
+void *SymTable_removeN(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
+    struct Entry* psEntry;
+    void* pvOldValue;
+    size_t uSlot;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uSlot = SymTable_find(oSymTable, pcKey, uLength,
+        SymTable_hash(oSymTable, pcKey, uLength), NULL);
+    if (uSlot == oSymTable->uIndexSize) {
+        return NULL;
+    }
+
+    /* The entry stays in place, marked, so that the positions of the later ones still hold;
+    the next rebuild drops it. The slot keeps later probes going. */
+    psEntry = &oSymTable->psEntries[SymTable_indexLoad(oSymTable, uSlot)];
+    pvOldValue = psEntry->pvValue;
+    SymTable_freeEntryKey(psEntry);
+    psEntry->uKey.acInline[INLINE_KEY_SIZE - 1] = (char)DELETED_KEY;
+    psEntry->pvValue = NULL;
+    SymTable_indexStore(oSymTable, uSlot, INDEX_DELETED);
+
+    (oSymTable->length)--;
+
+#ifndef SYMTABLE_NO_AUTO_SHRINK
+    /* If shrinking fails, the table keeps working at its current size */
+    if (oSymTable->length * SHRINK_DIVISOR < oSymTable->uIndexSize &&
+            oSymTable->uIndexSize > oSymTable->uMinIndexSize) {
+        size_t uNewIndexSize = SymTable_indexSizeFor(oSymTable->length * 2);
+        if (uNewIndexSize < oSymTable->uMinIndexSize) {
+            uNewIndexSize = oSymTable->uMinIndexSize;
+        }
+        (void)SymTable_rebuild(oSymTable, uNewIndexSize);
+    }
+#endif
+    return pvOldValue;
+}
+
+void SymTable_getBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    void **ppvValues) {
+    size_t auSlots[BATCH_SIZE];
+    size_t uBatch;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(ppcKeys != NULL || uCount == 0);
+    assert(ppvValues != NULL || uCount == 0);
+
+    for (; uCount > 0; uCount -= uBatch, ppcKeys += uBatch, ppvValues += uBatch) {
+        uBatch = uCount < BATCH_SIZE ? uCount : BATCH_SIZE;
+        SymTable_findBatch(oSymTable, ppcKeys, uBatch, auSlots);
+        for (i = 0; i < uBatch; i++) {
+            ppvValues[i] = auSlots[i] != oSymTable->uIndexSize ?
+                oSymTable->psEntries[SymTable_indexLoad(oSymTable, auSlots[i])].pvValue :
+                NULL;
+        }
+    }
+}
+
+void SymTable_containsBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    int *piFound) {
+    size_t auSlots[BATCH_SIZE];
+    size_t uBatch;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(ppcKeys != NULL || uCount == 0);
+    assert(piFound != NULL || uCount == 0);
+
+    for (; uCount > 0; uCount -= uBatch, ppcKeys += uBatch, piFound += uBatch) {
+        uBatch = uCount < BATCH_SIZE ? uCount : BATCH_SIZE;
+        SymTable_findBatch(oSymTable, ppcKeys, uBatch, auSlots);
+        for (i = 0; i < uBatch; i++) {
+            piFound[i] = auSlots[i] != oSymTable->uIndexSize;
+        }
+    }
+}
+
+int SymTable_putBatch(SymTable_T oSymTable, const char **ppcKeys, void **ppvValues,
+    size_t uCount, int *piRejected) {
+    struct Entry* psEntry;
+    int iAdded;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(ppcKeys != NULL || uCount == 0);
+    assert(ppvValues != NULL || uCount == 0);
+
+    /* If the arrays cannot be allocated, the puts below still grow the table step by step */
+    (void)SymTable_growTo(oSymTable, oSymTable->length + uCount);
+
+    for (i = 0; i < uCount; i++) {
+        assert(ppcKeys[i] != NULL);
+        psEntry = SymTable_findOrAdd(oSymTable, ppcKeys[i], strlen(ppcKeys[i]), ppvValues[i],
+            &iAdded);
+        if (psEntry == NULL) {
+            return 0;
+        }
+        if (piRejected != NULL) {
+            piRejected[i] = !iAdded;
+        }
+    }
+    return 1;
+}
+
+SymTable_T SymTable_bulkLoad(const char **ppcKeys, void **ppvValues, size_t uCount,
+    int *piRejected) {
+    SymTable_T oSymTable;
+
+    oSymTable = SymTable_new();
+    if (oSymTable == NULL) {
+        return NULL;
+    }
+    if (!SymTable_putBatch(oSymTable, ppcKeys, ppvValues, uCount, piRejected)) {
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+    return oSymTable;
+}
+
+void SymTable_map(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    const struct Entry* psEntry;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    for (i = 0; i < oSymTable->uEntryCount; i++) {
+        psEntry = &oSymTable->psEntries[i];
+        if (!SymTable_isDeleted(psEntry)) {
+            (*pfApply)(SymTable_entryKey(psEntry), psEntry->pvValue, (void*)pvExtra);
+        }
+    }
+}
+
+void SymTable_mapParallel(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    void **ppvExtras, size_t uThreadCount) {
+    struct MapJob sJob;
+    struct MapWorker* psWorkers;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    sJob.oSymTable = oSymTable;
+    sJob.pfApply = pfApply;
+    sJob.uNext = 0;
+
+    /* Without memory for the workers, the calling thread does it all */
+    if (uThreadCount == 0) {
+        uThreadCount = 1;
+    }
+    psWorkers = (struct MapWorker*)calloc(uThreadCount, sizeof(struct MapWorker));
+    if (psWorkers == NULL) {
+        struct MapWorker sWorker;
+        sWorker.psJob = &sJob;
+        sWorker.pvExtra = (ppvExtras != NULL) ? ppvExtras[0] : NULL;
+        (void)SymTable_mapWork(&sWorker);
+        return;
+    }
+
+    for (i = 0; i < uThreadCount; i++) {
+        psWorkers[i].psJob = &sJob;
+        psWorkers[i].pvExtra = (ppvExtras != NULL) ? ppvExtras[i] : NULL;
+    }
+    for (i = 1; i < uThreadCount; i++) {
+        psWorkers[i].iStarted = pthread_create(&psWorkers[i].sThread, NULL,
+            SymTable_mapWork, &psWorkers[i]) == 0;
+    }
+    (void)SymTable_mapWork(&psWorkers[0]);
+    for (i = 1; i < uThreadCount; i++) {
+        if (psWorkers[i].iStarted) {
+            pthread_join(psWorkers[i].sThread, NULL);
+        }
+    }
+    free(psWorkers);
+}
+
+void SymTable_iterBegin(SymTable_T oSymTable, SymTable_Iter *psIter) {
+    assert(oSymTable != NULL);
+    assert(psIter != NULL);
+
+    psIter->oSymTable = oSymTable;
+    psIter->uIndex = 0;
+    psIter->pvNext = NULL;
+}
+
+int SymTable_iterNext(SymTable_Iter *psIter, const char **ppcKey, size_t *puLength,
+    void **ppvValue) {
+    SymTable_T oSymTable;
+    const struct Entry* psEntry;
+
+    assert(psIter != NULL);
+    assert(psIter->oSymTable != NULL);
+
+    /* uIndex is the entry after the last one returned, so the bindings come in the order they
+    were added */
+    oSymTable = psIter->oSymTable;
+    while (psIter->uIndex < oSymTable->uEntryCount &&
+            SymTable_isDeleted(&oSymTable->psEntries[psIter->uIndex])) {
+        psIter->uIndex++;
+    }
+    if (psIter->uIndex == oSymTable->uEntryCount) {
+        return 0;
+    }
+    psEntry = &oSymTable->psEntries[psIter->uIndex];
+    psIter->uIndex++;
+
+    if (ppcKey != NULL) {
+        *ppcKey = SymTable_entryKey(psEntry);
+    }
+    if (puLength != NULL) {
+        *puLength = SymTable_entryKeyLength(psEntry);
+    }
+    if (ppvValue != NULL) {
+        *ppvValue = psEntry->pvValue;
+    }
+    return 1;
+}
+
+void SymTable_iterEnd(SymTable_Iter *psIter) {
+    assert(psIter != NULL);
+    psIter->oSymTable = NULL;
+}
+
+size_t SymTable_scan(SymTable_T oSymTable, size_t uCursor, size_t uCount,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    size_t uApplied = 0;
+    size_t uSlotsPassed = 0;
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    /* Rebuilding moves entries, so cursors pick the index slot where the probes of bindings
+    start rather than a position in the entries. A call stops early once it has passed over as
+    many slots as bindings it was asked to visit, so that a scan of a sparse table still returns
+    now and then. */
+    do {
+        uApplied += SymTable_scanSlot(oSymTable, uCursor & (oSymTable->uIndexSize - 1),
+            pfApply, (void*)pvExtra);
+        uCursor = SymTable_nextCursor(uCursor, oSymTable->uIndexSize - 1);
+        uSlotsPassed++;
+    } while (uCursor != 0 && uApplied < uCount && uSlotsPassed < uCount);
+    return uCursor;
+}
+
+/* Helper map worker function */
+void* SymTable_mapWork(void *pvWorker) {
+    struct MapWorker* psWorker = (struct MapWorker*)pvWorker;
+    struct MapJob* psJob;
+    SymTable_T oSymTable;
+    const struct Entry* psEntry;
+    size_t uStart;
+    size_t uEnd;
+    size_t i = 0;  /* loop counter */
+
+    assert(psWorker != NULL);
+
+    psJob = psWorker->psJob;
+    oSymTable = psJob->oSymTable;
+    for (;;) {
+        uStart = __atomic_fetch_add(&psJob->uNext, MAP_STEP, __ATOMIC_RELAXED);
+        if (uStart >= oSymTable->uEntryCount) {
+            return NULL;
+        }
+        uEnd = uStart + MAP_STEP;
+        if (uEnd > oSymTable->uEntryCount) {
+            uEnd = oSymTable->uEntryCount;
+        }
+
+        for (i = uStart; i < uEnd; i++) {
+            psEntry = &oSymTable->psEntries[i];
+            if (!SymTable_isDeleted(psEntry)) {
+                (*psJob->pfApply)(SymTable_entryKey(psEntry), psEntry->pvValue,
+                    psWorker->pvExtra);
+            }
+        }
+    }
+}
+
+/* Helper scan slot function */
+size_t SymTable_scanSlot(SymTable_T oSymTable, size_t uHome,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra), void *pvExtra) {
+    const struct Entry* psEntry;
+    size_t uMask;
+    size_t uSlot;
+    int32_t iEntry;
+    size_t uVisited = 0;
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    /* The entry array is never full enough to fill the index, so some slot is empty */
+    uMask = oSymTable->uIndexSize - 1;
+    for (uSlot = uHome; ; uSlot = (uSlot + 1) & uMask) {
+        iEntry = SymTable_indexLoad(oSymTable, uSlot);
+        if (iEntry == INDEX_EMPTY) {
+            return uVisited;
+        }
+        if (iEntry == INDEX_DELETED) {
+            continue;
+        }
+        psEntry = &oSymTable->psEntries[iEntry];
+        if ((psEntry->uHash & uMask) == uHome) {
+            (*pfApply)(SymTable_entryKey(psEntry), psEntry->pvValue, pvExtra);
+            uVisited++;
+        }
+    }
+}
+
+/* Helper next cursor function */
+size_t SymTable_nextCursor(size_t uCursor, size_t uMask) {
+    size_t uBit;
+
+    /* Clear the highest bits of the cursor that are set, and set the highest one that is not */
+    uCursor &= uMask;
+    for (uBit = (uMask + 1) / 2; uBit != 0 && (uCursor & uBit) != 0; uBit /= 2) {
+        uCursor &= ~uBit;
+    }
+    return uCursor | uBit;
+}
+
+/* Helper find function */
+size_t SymTable_find(SymTable_T oSymTable, const char *pcKey, size_t uLength,
+    size_t uHash, size_t *puFreeSlot) {
+    const struct Entry* psEntry;
+    size_t uMask;
+    size_t uSlot;
+    int32_t iEntry;
+    int iFreeFound = 0;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    /* Visit slots in order, wrapping around. The entry array is never full enough to fill the
+    index, so some slot is empty, ending the search. */
+    uMask = oSymTable->uIndexSize - 1;
+    for (uSlot = uHash & uMask; ; uSlot = (uSlot + 1) & uMask) {
+        iEntry = SymTable_indexLoad(oSymTable, uSlot);
+        if (iEntry < 0) {
+            if (puFreeSlot != NULL && !iFreeFound) {
+                *puFreeSlot = uSlot;
+                iFreeFound = 1;
+            }
+            if (iEntry == INDEX_EMPTY) {
+                SymTable_count(oSymTable, uMisses, 1);
+                return oSymTable->uIndexSize;
+            }
+            continue;
+        }
+
+        /* Only compare the bytes of keys whose cached hash and length match */
+        psEntry = &oSymTable->psEntries[iEntry];
+        SymTable_count(oSymTable, uCompares, 1);
+        if (psEntry->uHash == uHash && SymTable_entryKeyLength(psEntry) == uLength &&
+                memcmp(SymTable_entryKey(psEntry), pcKey, uLength) == 0) {
+            SymTable_count(oSymTable, uHits, 1);
+            return uSlot;
+        }
+    }
+}
+
+/* Helper batch find function */
+void SymTable_findBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    size_t *puSlots) {
+    size_t auHashes[BATCH_SIZE];
+    size_t auLengths[BATCH_SIZE];
+    size_t uMask;
+    int32_t iEntry;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(ppcKeys != NULL);
+    assert(puSlots != NULL);
+    assert(uCount <= BATCH_SIZE);
+
+    uMask = oSymTable->uIndexSize - 1;
+    for (i = 0; i < uCount; i++) {
+        assert(ppcKeys[i] != NULL);
+        auLengths[i] = strlen(ppcKeys[i]);
+        auHashes[i] = SymTable_hash(oSymTable, ppcKeys[i], auLengths[i]);
+        SymTable_prefetch((const char*)oSymTable->pvIndex +
+            (auHashes[i] & uMask) * oSymTable->uIndexWidth);
+    }
+
+    /* Most keys that are present are named by the first slot of their probe sequence */
+    for (i = 0; i < uCount; i++) {
+        iEntry = SymTable_indexLoad(oSymTable, auHashes[i] & uMask);
+        if (iEntry >= 0) {
+            SymTable_prefetch(&oSymTable->psEntries[iEntry]);
+        }
+    }
+
+    for (i = 0; i < uCount; i++) {
+        puSlots[i] = SymTable_find(oSymTable, ppcKeys[i], auLengths[i], auHashes[i], NULL);
+    }
+}
+
+/* Helper find-or-add function */
+struct Entry* SymTable_findOrAdd(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, const void *pvValue, int *piAdded) {
+    struct Entry* psEntry;
+    size_t uHash;
+    size_t uSlot;
+    size_t uFreeSlot = 0;
+    size_t uNewIndexSize;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(piAdded != NULL);
+
+    *piAdded = 0;
+    uHash = SymTable_hash(oSymTable, pcKey, uLength);
+
+    uSlot = SymTable_find(oSymTable, pcKey, uLength, uHash, &uFreeSlot);
+    if (uSlot != oSymTable->uIndexSize) {
+        return &oSymTable->psEntries[SymTable_indexLoad(oSymTable, uSlot)];
+    }
+
+    /* Once the entries run out, rebuild with room for twice the bindings that remain, which
+    just compacts the table if removed bindings took up the room */
+    if (oSymTable->uEntryCount == oSymTable->uEntryCapacity) {
+        uNewIndexSize = SymTable_indexSizeFor(oSymTable->length * 2);
+        if (uNewIndexSize < oSymTable->uMinIndexSize) {
+            uNewIndexSize = oSymTable->uMinIndexSize;
+        }
+        if (!SymTable_rebuild(oSymTable, uNewIndexSize) ||
+                oSymTable->uEntryCount == oSymTable->uEntryCapacity) {
+            return NULL;
+        }
+        (void)SymTable_find(oSymTable, pcKey, uLength, uHash, &uFreeSlot);
+    }
+
+    psEntry = &oSymTable->psEntries[oSymTable->uEntryCount];
+    if (!SymTable_setEntryKey(psEntry, pcKey, uLength)) {
+        return NULL;
+    }
+    psEntry->uHash = uHash;
+    psEntry->pvValue = (void*)pvValue;
+    SymTable_indexStore(oSymTable, uFreeSlot, (int32_t)oSymTable->uEntryCount);
+
+    (oSymTable->uEntryCount)++;
+    (oSymTable->length)++;
+    *piAdded = 1;
+    return psEntry;
+}
+
+/* Helper rebuild function */
+int SymTable_rebuild(SymTable_T oSymTable, size_t uNewIndexSize) {
+    struct Entry* psOldEntries;
+    size_t uOldEntryCount;
+    size_t uNewWidth;
+    size_t uNewCapacity;
+    void* pvNewIndex;
+    struct Entry* psNewEntries;
+    size_t uMask;
+    size_t uSlot;
+    size_t uNewCount = 0;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(uNewIndexSize > 0 && (uNewIndexSize & (uNewIndexSize - 1)) == 0);
+    assert(SymTable_usableFor(uNewIndexSize) >= oSymTable->length);
+
+    uNewWidth = SymTable_indexWidthFor(uNewIndexSize);
+    uNewCapacity = SymTable_usableFor(uNewIndexSize);
+    pvNewIndex = malloc(uNewIndexSize * uNewWidth);
+    psNewEntries = (struct Entry*)malloc(uNewCapacity * sizeof(struct Entry));
+    if (pvNewIndex == NULL || psNewEntries == NULL) {
+        free(pvNewIndex);
+        free(psNewEntries);
+        return 0;
+    }
+    memset(pvNewIndex, 0xFF, uNewIndexSize * uNewWidth);
+
+    psOldEntries = oSymTable->psEntries;
+    uOldEntryCount = oSymTable->uEntryCount;
+    free(oSymTable->pvIndex);
+    oSymTable->pvIndex = pvNewIndex;
+    oSymTable->uIndexSize = uNewIndexSize;
+    oSymTable->uIndexWidth = uNewWidth;
+    oSymTable->psEntries = psNewEntries;
+    oSymTable->uEntryCapacity = uNewCapacity;
+
+    /* The live entries keep their order, and each goes into the first empty slot on its probe
+    sequence, as the new index has no deleted slots */
+    uMask = uNewIndexSize - 1;
+    for (i = 0; i < uOldEntryCount; i++) {
+        if (SymTable_isDeleted(&psOldEntries[i])) {
+            continue;
+        }
+        psNewEntries[uNewCount] = psOldEntries[i];
+        uSlot = psOldEntries[i].uHash & uMask;
+        while (SymTable_indexLoad(oSymTable, uSlot) != INDEX_EMPTY) {
+            uSlot = (uSlot + 1) & uMask;
+        }
+        SymTable_indexStore(oSymTable, uSlot, (int32_t)uNewCount);
+        uNewCount++;
+    }
+
+    free(psOldEntries);
+    oSymTable->uEntryCount = uNewCount;
+    oSymTable->uResizeCount++;
+    return 1;
+}
+
+/* Helper grow-to function */
+int SymTable_growTo(SymTable_T oSymTable, size_t uBindingCount) {
+    size_t uNewIndexSize;
+
+    assert(oSymTable != NULL);
+
+    uNewIndexSize = SymTable_indexSizeFor(uBindingCount);
+    if (uNewIndexSize <= oSymTable->uIndexSize) {
+        return 1;
+    }
+    return SymTable_rebuild(oSymTable, uNewIndexSize);
+}
+
+/* Helper index size function */
+size_t SymTable_indexSizeFor(size_t uBindingCount) {
+    size_t uIndexSize = MIN_INDEX_SIZE;
+
+    while (SymTable_usableFor(uIndexSize) < uBindingCount && uIndexSize < MAX_INDEX_SIZE) {
+        uIndexSize *= 2;
+    }
+    return uIndexSize;
+}
+
+/* Helper usable function */
+size_t SymTable_usableFor(size_t uIndexSize) {
+    return uIndexSize * USABLE_NUMERATOR / USABLE_DENOMINATOR;
+}
+
+/* Helper index width function */
+size_t SymTable_indexWidthFor(size_t uIndexSize) {
+    /* The entries number fewer than the slots, so a slot only needs to hold positions below
+    uIndexSize besides the negative markers */
+    if (uIndexSize <= INT8_MAX + 1) {
+        return sizeof(int8_t);
+    }
+    if (uIndexSize <= INT16_MAX + 1) {
+        return sizeof(int16_t);
+    }
+    return sizeof(int32_t);
+}
+
+/* Helper index load function */
+int32_t SymTable_indexLoad(SymTable_T oSymTable, size_t uSlot) {
+    assert(oSymTable != NULL);
+    assert(uSlot < oSymTable->uIndexSize);
+
+    switch (oSymTable->uIndexWidth) {
+        case sizeof(int8_t):
+            return ((const int8_t*)oSymTable->pvIndex)[uSlot];
+        case sizeof(int16_t):
+            return ((const int16_t*)oSymTable->pvIndex)[uSlot];
+        default:
+            return ((const int32_t*)oSymTable->pvIndex)[uSlot];
+    }
+}
+
+/* Helper index store function */
+void SymTable_indexStore(SymTable_T oSymTable, size_t uSlot, int32_t iValue) {
+    assert(oSymTable != NULL);
+    assert(uSlot < oSymTable->uIndexSize);
+
+    switch (oSymTable->uIndexWidth) {
+        case sizeof(int8_t):
+            ((int8_t*)oSymTable->pvIndex)[uSlot] = (int8_t)iValue;
+            break;
+        case sizeof(int16_t):
+            ((int16_t*)oSymTable->pvIndex)[uSlot] = (int16_t)iValue;
+            break;
+        default:
+            ((int32_t*)oSymTable->pvIndex)[uSlot] = iValue;
+            break;
+    }
+}
+
+/* Helper entry key function */
+const char* SymTable_entryKey(const struct Entry *psEntry) {
+    assert(psEntry != NULL);
+
+    if ((unsigned char)psEntry->uKey.acInline[INLINE_KEY_SIZE - 1] == HEAP_KEY) {
+        return psEntry->uKey.sHeap.pcHeap;
+    }
+    return psEntry->uKey.acInline;
+}
+
+/* Helper entry key length function */
+size_t SymTable_entryKeyLength(const struct Entry *psEntry) {
+    unsigned char ucLast;
+
+    assert(psEntry != NULL);
+
+    ucLast = (unsigned char)psEntry->uKey.acInline[INLINE_KEY_SIZE - 1];
+    if (ucLast == HEAP_KEY) {
+        return psEntry->uKey.sHeap.uLength;
+    }
+    return ucLast;
+}
+
+/* Helper is-deleted function */
+int SymTable_isDeleted(const struct Entry *psEntry) {
+    assert(psEntry != NULL);
+    return (unsigned char)psEntry->uKey.acInline[INLINE_KEY_SIZE - 1] == DELETED_KEY;
+}
+
+/* Helper set entry key function */
+int SymTable_setEntryKey(struct Entry *psEntry, const char *pcKey, size_t uLength) {
+    char* pcKeyCopy;
+
+    assert(psEntry != NULL);
+    assert(pcKey != NULL);
+
+    if (uLength < INLINE_KEY_SIZE - 1) {
+        memset(psEntry->uKey.acInline, 0, INLINE_KEY_SIZE);
+        memcpy(psEntry->uKey.acInline, pcKey, uLength);
+        psEntry->uKey.acInline[INLINE_KEY_SIZE - 1] = (char)uLength;
+        return 1;
+    }
+
+    /* makes defensive copy of key */
+    pcKeyCopy = (char*)malloc(uLength + 1);
+    if (pcKeyCopy == NULL) {
+        return 0;
+    }
+    memcpy(pcKeyCopy, pcKey, uLength);
+    pcKeyCopy[uLength] = '\0';
+    psEntry->uKey.sHeap.pcHeap = pcKeyCopy;
+    psEntry->uKey.sHeap.uLength = uLength;
+    psEntry->uKey.acInline[INLINE_KEY_SIZE - 1] = (char)HEAP_KEY;
+    return 1;
+}
+
+/* Helper free entry key function */
+void SymTable_freeEntryKey(struct Entry *psEntry) {
+    assert(psEntry != NULL);
+
+    if ((unsigned char)psEntry->uKey.acInline[INLINE_KEY_SIZE - 1] == HEAP_KEY) {
+        free(psEntry->uKey.sHeap.pcHeap);
+    }
+}
+
+/* Helper hash function */
+size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return (*oSymTable->pfHash)(pcKey, uLength, oSymTable->uSeed);
+}
@@ -1,385 +1,2386 @@
 /* symtablehash.c
 Author: Tinney Mak */
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stddef.h>
 #include <string.h>
 #include "symtable.h"
+#include "symhash.h"
+
+/* Bucket counts are powers of two, so the bucket of a key is the low bits of its hash. A
+table starts small, with its bindings in a single chain and no bucket array. Once it holds
+SMALL_NODE_COUNT bindings it gets INITIAL_BUCKET_COUNT buckets, and then doubles until it holds
+MAX_BUCKET_COUNT. */
+enum {SMALL_NODE_COUNT = 8};
+enum {INITIAL_BUCKET_COUNT = 512};
+enum {MAX_BUCKET_COUNT = 1 << 30};
+
+/* The seed of the default hash for tables made by SymTable_new */
+enum {DEFAULT_SEED = 0};
+
+/* While the table grows, each operation moves MIGRATE_STEP buckets of the old bucket array
+into the new one, so that no single call pays for the whole rehash. The new array has about
+twice as many buckets as the old one, so migration finishes well before the next growth.
+Defining SYMTABLE_FULL_REHASH moves every bucket as soon as the table grows instead. */
+enum {MIGRATE_STEP = 8};
+
+/* Once a removal leaves fewer than one binding per SHRINK_DIVISOR buckets, the table shrinks to
+about two buckets per binding, copying its nodes into a fresh arena so that the memory of the
+removed bindings is released. It never shrinks below INITIAL_BUCKET_COUNT buckets or the
+capacity reserved with SymTable_reserve. Defining SYMTABLE_NO_AUTO_SHRINK turns this off. */
+enum {SHRINK_DIVISOR = 8};
+
+/* The batch functions look up BATCH_SIZE keys at a time: they hash them all and prefetch their
+buckets, then prefetch the first node of each bucket, and only then search the chains, so that
+the cache misses of the keys overlap. */
+enum {BATCH_SIZE = 16};
+
+/* A concurrent table guards its buckets with STRIPE_COUNT locks, the bucket with index i by
+lock i % STRIPE_COUNT. It starts with INITIAL_BUCKET_COUNT buckets and never has fewer, so a key
+keeps its stripe when the table grows or shrinks. Shrinking takes a lock that keeps every other
+operation but lookups out. */
+enum {STRIPE_COUNT = 64};
+
+/* A concurrent table grows cooperatively. Starting and finishing take the lock that keeps other
+writers out, but only for a moment; in between, each writer that uses the table claims the next
+TRANSFER_STEP buckets of the old array and copies their bindings into the new one, leaving a
+forwarding marker at the head of each old bucket it has done. Until then, operations on the
+bindings of that bucket use the old array. */
+enum {TRANSFER_STEP = 64};
+
+/* Lookups in a concurrent table take no lock. Writers publish nodes and bucket arrays with
+release stores that lookups read with acquire loads, and a removed node waits in its stripe's
+limbo list until LIMBO_SIZE of them have gathered, and then for a grace period: the epoch is
+advanced and every lookup that began before that is waited for, after which no lookup can still
+see the nodes. A bucket array replaced by growth or shrinkage waits for a grace period too. */
+enum {LIMBO_SIZE = 64};
+
+/* Each lookup announces itself in one of READER_SLOT_COUNT counters chosen by the address of
+its stack, so that threads seldom share the cache line of a counter */
+enum {READER_SLOT_COUNT = 64};
+enum {CACHE_LINE_SIZE = 64};
+
+/* The workers of SymTable_mapParallel claim MAP_STEP buckets at a time, so that workers that
+finish early take on more of the rest. */
+enum {MAP_STEP = 1024};
+
+/* A call of SymTable_scan stops early once it has passed over SCAN_BUCKET_FACTOR buckets for each
+binding it was asked to visit, so that a scan of a sparse table still returns now and then. */
+enum {SCAN_BUCKET_FACTOR = 10};
+
+/* Hints that the memory at pv will be read soon */
+#if defined(__GNUC__)
+#define SymTable_prefetch(pv) __builtin_prefetch(pv)
+#else
+#define SymTable_prefetch(pv) ((void)(pv))
+#endif
+
+/* Nodes and key copies are carved out of slabs owned by the table, in chunks that are
+multiples of ARENA_ALIGNMENT bytes, nodes from one slab and key copies from another. An arena's
+first slab has ARENA_MIN_SLAB_SIZE bytes, twice the slab inside a table, and each later one
+twice as many as the one before, up to ARENA_MAX_SLAB_SIZE, so that a table with few bindings
+does not pay for a large slab. A key copy longer than ARENA_MAX_KEY_CHUNK bytes gets a slab of
+its own. */
+enum {ARENA_MIN_SLAB_SIZE = 1024};
+enum {ARENA_MAX_SLAB_SIZE = 65536};
+enum {ARENA_ALIGNMENT = 16};
+enum {ARENA_MAX_KEY_CHUNK = 256};
+
+/* The number of sizes of key chunk that removed key copies are kept for, one free list each */
+enum {ARENA_KEY_CLASS_COUNT = ARENA_MAX_KEY_CHUNK / ARENA_ALIGNMENT};
+
+/* A Slab heads a block of memory from which an Arena carves chunks. Slabs are linked in both
+directions so that a slab holding a single long key can be released on its own. */
+struct Slab {
+    /* The address of the previous Slab */
+    struct Slab* psPrevSlab;
+
+    /* The address of the next Slab */
+    struct Slab* psNextSlab;
+};
+
+/* A FreeChunk is a removed node or key copy waiting to be reused. */
+struct FreeChunk {
+    /* The address of the next FreeChunk of the same size */
+    struct FreeChunk* psNextChunk;
+};
+
+/* A Region is the unused part of the slab that an Arena carves one kind of chunk from. */
+struct Region {
+    /* The address of the unused part of the slab */
+    char* pcNext;
+
+    /* The number of unused bytes at pcNext */
+    size_t uRemaining;
+};
+
+/* An Arena hands out the nodes and key copies of one table. */
+struct Arena {
+    /* The address of the first Slab */
+    struct Slab* psSlabs;
+
+    /* The slab that nodes are carved from */
+    struct Region sNodes;
+
+    /* The slab that key copies are carved from */
+    struct Region sKeys;
+
+    /* The size of the next slab, or 0 before the first */
+    size_t uSlabSize;
+
+    /* The list of removed nodes */
+    struct FreeChunk* psFreeNodes;
+
+    /* The lists of removed key chunks, indexed by chunk size / ARENA_ALIGNMENT - 1 */
+    struct FreeChunk* apsFreeKeys[ARENA_KEY_CLASS_COUNT];
+};
+
+/* A Stripe is one lock of a concurrent table and the arena for the nodes and key copies of
+the buckets it guards. */
+struct Stripe {
+    /* The lock of the buckets */
+    pthread_mutex_t sLock;
+
+    /* The arena of their nodes and key copies */
+    struct Arena sArena;
+
+    /* The nodes removed from the buckets that lookups may still be reading, and their number */
+    struct Node* apsLimbo[LIMBO_SIZE];
+    size_t uLimboCount;
+};
+
+/* A BucketArray is the bucket array of a concurrent table as lookups see it. */
+struct BucketArray {
+    /* The buckets */
+    struct Node** ppsBuckets;
+
+    /* The number of buckets, a power of two */
+    size_t uBucketCount;
+
+    /* The array that the bindings of forwarded buckets are in, while the table grows, and
+    NULL otherwise */
+    struct BucketArray* psNextArray;
+};
+
+/* A ReaderSlot counts the lookups in progress that began in an even epoch and those that
+began in an odd one. */
+struct ReaderSlot {
+    /* The counts, indexed by epoch % 2 */
+    size_t auReaders[2];
+
+    /* Padding to keep the counts of different slots in different cache lines */
+    char acPadding[CACHE_LINE_SIZE - 2 * sizeof(size_t)];
+};
+
+/* A MapJob is the work that the workers of SymTable_mapParallel share. */
+struct MapJob {
+    /* The table */
+    SymTable_T oSymTable;
+
+    /* The function to apply */
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra);
+
+    /* The number of buckets claimed so far, in the order of SymTable_walkHead */
+    size_t uNext;
+
+    /* The number of buckets in all */
+    size_t uTotal;
+};
+
+/* A MapWorker is one worker of SymTable_mapParallel. */
+struct MapWorker {
+    /* The shared work */
+    struct MapJob* psJob;
 
-/* Array of bucket counts for hash table */
-static const size_t auBucketCounts[] = {
-    509, 1021, 2039, 4093, 8191, 16381, 32749, 65521
+    /* The extra parameter of the worker */
+    void* pvExtra;
+
+    /* The thread of the worker, and whether it was started */
+    pthread_t sThread;
+    int iStarted;
 };
 
-/* Variable for keeping track of bucket count array index*/
-static size_t counter = 0;
+/* Keys shorter than INLINE_KEY_SIZE characters are stored inside their node. */
+enum {INLINE_KEY_SIZE = 24};
 
 /* Each Node contains a binding, consisting of a key and value. Nodes are linked
 to form a list. */
 struct Node {
-    /* The key */
+    /* The key, followed by a '\0'. It points to acInline if the key is short enough, and to a
+    copy in the arena otherwise */
     const char* pcKey;
 
+    /* The full hash of the key, kept so that chains can be searched and rehashed without
+    rereading the key */
+    size_t uHash;
+
+    /* The length of the key */
+    size_t uLength;
+
     /* The value */
     void* pvValue;
 
     /* The address of the next Node */
     struct Node* psNextNode;
+
+    /* The storage for a short key */
+    char acInline[INLINE_KEY_SIZE];
 };
 
-/* Helper function that returns a hash code for pcKey that is between 0 and uBucketCount-1, inclusive.*/
-static size_t SymTable_hash(const char *pcKey, size_t uBucketCount);
+/* The size of the slab inside each table, which holds the nodes of a small table */
+enum {SMALL_SLAB_SIZE = SMALL_NODE_COUNT *
+    ((sizeof(struct Node) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT)};
 
 /* Helper function that inserts node psToInsert into the array that ppsSymNode points to where the index of the bucket 
 equals hashCode. Returns 1 if successful and 0 if not.*/
 static int SymTable_insert(struct Node** ppsSymNode, struct Node* psToInsert, size_t hashCode);
 
-/* Helper function that, for oSymTable, goes into the array of buckets where the index equals hashCode and removes the 
-node corresponding to pcKey. Returns 1 if successful and 0 if not.*/
-static int SymTable_delete(SymTable_T oSymTable, const char *pcKey, size_t hashCode);
+/* Helper function that returns the address of the bucket of oSymTable that holds, or would
+hold, the binding whose key has full hash uHash. While the table grows that is the key's
+bucket in the old array if it has not been migrated yet, and its bucket in the new array
+otherwise.*/
+static struct Node** SymTable_bucket(SymTable_T oSymTable, size_t uHash);
+
+/* Helper function that returns the full hash of the key of uLength bytes at pcKey in
+oSymTable.*/
+static size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey, size_t uLength);
+
+/* Helper function that searches the bucket of oSymTable that the key of uLength bytes at pcKey,
+whose full hash is uHash, hashes to. Returns the address of the link (the bucket head or a
+psNextNode field) that points to the node with that key, or to the NULL ending the chain if
+there is none.*/
+static struct Node** SymTable_find(SymTable_T oSymTable, const char *pcKey, size_t uLength,
+    size_t uHash);
+
+/* Helper function that stores in ppsNodes[i] the node of oSymTable whose key is ppcKeys[i], or
+NULL if there is none, for 0 <= i < uCount, where uCount is at most BATCH_SIZE.*/
+static void SymTable_findBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    struct Node **ppsNodes);
+
+/* Helper function that returns the node of oSymTable whose key is the uLength bytes at pcKey,
+whose full hash is uHash, first adding a new binding of that key to pvValue if there is none.
+Sets *piAdded to 1 if the binding was added and 0 otherwise. Returns NULL if there is
+insufficient memory, leaving oSymTable unchanged.*/
+static struct Node* SymTable_findOrAdd(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, size_t uHash, const void *pvValue, int *piAdded);
+
+/* Helper function that returns the arena of oSymTable for the nodes and key copies of keys
+whose full hash is uHash.*/
+static struct Arena* SymTable_arena(SymTable_T oSymTable, size_t uHash);
+
+/* Helper function that returns node psNode and its key copy, if any, to psArena for reuse.*/
+static void SymTable_freeBinding(struct Arena *psArena, struct Node *psNode);
+
+/* Helper function that stores in *ppvValue the value of the binding of concurrent table
+oSymTable whose key is the uLength bytes at pcKey, whose full hash is uHash, without taking any
+lock. Returns 1 if there is such a binding and 0 otherwise, in which case *ppvValue is
+unchanged.*/
+static int SymTable_read(SymTable_T oSymTable, const char *pcKey, size_t uLength,
+    size_t uHash, void **ppvValue);
+
+/* Helper function that announces a lookup in concurrent table oSymTable, storing in *ppsSlot
+the slot it is counted in. Returns the parity of the epoch the lookup is counted under. End the
+lookup with SymTable_exitRead.*/
+static size_t SymTable_enterRead(SymTable_T oSymTable, struct ReaderSlot **ppsSlot);
+
+/* Helper function that ends the lookup counted in psSlot under parity uParity.*/
+static void SymTable_exitRead(struct ReaderSlot *psSlot, size_t uParity);
+
+/* Helper function that waits for a grace period of concurrent table oSymTable: until every
+lookup that began before the call has ended.*/
+static void SymTable_synchronize(SymTable_T oSymTable);
+
+/* Helper function that puts node psNode, just unlinked from concurrent table oSymTable, in the
+limbo list of the stripe of keys whose full hash is uHash, whose lock the caller holds, and
+frees the list after a grace period once it is full.*/
+static void SymTable_retire(SymTable_T oSymTable, size_t uHash, struct Node *psNode);
+
+/* Helper function that starts growing concurrent table oSymTable into a bucket array twice the
+size. The caller holds its resize lock for writing. Returns 1 if successful and 0 if there is
+insufficient memory or the table is at MAX_BUCKET_COUNT.*/
+static int SymTable_startTransfer(SymTable_T oSymTable);
+
+/* Helper function that copies the bindings of the next TRANSFER_STEP unclaimed buckets of the
+old array of growing concurrent table oSymTable into the new one. The caller holds its resize
+lock for reading. Returns 1 if every bucket has now been copied and 0 otherwise.*/
+static int SymTable_helpTransfer(SymTable_T oSymTable);
+
+/* Helper function that copies the bindings of bucket uBucket of the old array of growing
+concurrent table oSymTable into the new one, replaces the bucket's head with the forwarding
+marker and retires the old nodes. Returns 1 if the bucket has been forwarded, now or earlier,
+and 0 if there is insufficient memory, in which case it is unchanged.*/
+static int SymTable_transferBucket(SymTable_T oSymTable, size_t uBucket);
+
+/* Helper function that copies the buckets of growing concurrent table oSymTable that have not
+been yet, makes the new array the table's only one and frees the old one after a grace period.
+The caller holds its resize lock for writing. Returns 1 if successful and 0 if there is
+insufficient memory, in which case the table keeps growing.*/
+static int SymTable_finishTransfer(SymTable_T oSymTable);
+
+/* Helper function that returns a copy of node psNode and its key made in psArena, or NULL if
+there is insufficient memory.*/
+static struct Node* SymTable_copyNode(struct Arena *psArena, const struct Node *psNode);
+
+/* Helper function that applies the function of the job of the MapWorker at pvWorker to the
+bindings of the buckets it claims, until there are none left. Returns NULL.*/
+static void* SymTable_mapWork(void *pvWorker);
+
+/* Helper function that returns the number of buckets a walk over the bindings of oSymTable
+visits: the unmigrated buckets of the old array while the table grows, then those of the current
+one.*/
+static size_t SymTable_walkCount(SymTable_T oSymTable);
+
+/* Helper function that returns the first node of bucket uIndex of a walk over the bindings of
+oSymTable, counting as SymTable_walkCount does, or NULL if its bindings have all moved on.*/
+static struct Node* SymTable_walkHead(SymTable_T oSymTable, size_t uIndex);
+
+/* Helper function that applies *pfApply to the bindings of oSymTable in the buckets of cursor
+uCursor of SymTable_scan, passing pvExtra. While the table grows, those are the old bucket given
+by the low bits of uCursor and both current buckets that it splits into. Returns the number of
+bindings visited.*/
+static size_t SymTable_scanBucket(SymTable_T oSymTable, size_t uCursor,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra), void *pvExtra);
+
+/* Helper function that applies *pfApply to each binding of the chain starting at psNode, up to
+its end or a forwarded bucket, passing pvExtra. Returns the number of bindings visited.*/
+static size_t SymTable_applyChain(struct Node *psNode,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra), void *pvExtra);
+
+/* Helper function that adds the chain starting at psNode, up to its end or a forwarded bucket,
+to the histogram and the node and key bytes of *psStats.*/
+static void SymTable_addChainStats(struct Node *psNode, SymTable_Stats *psStats);
+
+/* Helper function that returns the cursor of SymTable_scan that follows uCursor for buckets
+chosen by the bits of uMask. Cursors advance by adding one to their reversed bits, so each
+bucket of a larger or smaller array covers a run of cursors, and growing or shrinking between
+calls skips no binding. Returns 0 after the last cursor.*/
+static size_t SymTable_nextCursor(size_t uCursor, size_t uMask);
+
+/* Helper function that returns a chunk of uSize bytes, a multiple of ARENA_ALIGNMENT no
+larger than ARENA_MIN_SLAB_SIZE, carved from psRegion, one of the regions of psArena, or NULL if
+there is insufficient memory.*/
+static void* SymTable_arenaCarve(struct Arena *psArena, struct Region *psRegion, size_t uSize);
+
+/* Helper function that returns an uninitialized node from psArena, or NULL if there is
+insufficient memory.*/
+static struct Node* SymTable_allocNode(struct Arena *psArena);
+
+/* Helper function that returns node psNode to psArena for reuse.*/
+static void SymTable_freeNode(struct Arena *psArena, struct Node *psNode);
+
+/* Helper function that returns a copy of the uLength bytes at pcKey followed by a '\0', made in
+psArena, or NULL if there is insufficient memory.*/
+static char* SymTable_copyKey(struct Arena *psArena, const char *pcKey, size_t uLength);
+
+/* Helper function that returns key copy pcKey, whose length is uLength, to psArena for
+reuse.*/
+static void SymTable_freeKey(struct Arena *psArena, char *pcKey, size_t uLength);
+
+/* Helper function that releases every slab of psArena at once.*/
+static void SymTable_arenaFree(struct Arena *psArena);
+
+/* Helper function that starts moving the bindings of oSymTable into a bucket array twice the
+size, first finishing any earlier migration. Returns 1 if successful and 0 if there is
+insufficient memory or the table is at MAX_BUCKET_COUNT, in which case the bucket array is
+unchanged.*/
+static int SymTable_expand(SymTable_T oSymTable);
+
+/* Helper function that moves the bindings of up to uBucketCount more buckets of the old bucket
+array of oSymTable into the new one, and frees the old array once it is empty.*/
+static void SymTable_migrate(SymTable_T oSymTable, size_t uBucketCount);
+
+/* Helper function that returns the number of buckets a table needs to hold uBindingCount
+bindings without growing: the least power of two that is at least uBindingCount and
+INITIAL_BUCKET_COUNT, or MAX_BUCKET_COUNT if that is less.*/
+static size_t SymTable_bucketCountFor(size_t uBindingCount);
+
+/* Helper function that moves every binding of oSymTable at once into a bucket array large
+enough to hold uBindingCount bindings without growing again, unless the current one already
+is. Returns 1 if successful and 0 if there is insufficient memory, in which case the bindings
+stay where they are.*/
+static int SymTable_growTo(SymTable_T oSymTable, size_t uBindingCount);
+
+/* Helper function that moves every binding of oSymTable at once into a new bucket array of
+uNewBucketCount buckets, a power of two, first finishing any migration. If iCompact is
+nonzero, it also copies every node and key into a new arena and frees the old one. Returns 1 if
+successful and 0 if there is insufficient memory, in which case oSymTable is unchanged.*/
+static int SymTable_rebuild(SymTable_T oSymTable, size_t uNewBucketCount, int iCompact);
+
+/* The head of a bucket of an old array whose bindings have been copied into the new one */
+static struct Node sForwardNode;
+#define FORWARD_NODE (&sForwardNode)
+
+/* Helper function that returns 1 if oSymTable is small, keeping its bindings in one chain
+without a bucket array, and 0 otherwise.*/
+static int SymTable_isSmall(SymTable_T oSymTable);
+
+/* Helper function that returns 1 if removals have left oSymTable sparse enough to shrink by
+itself, and 0 otherwise.*/
+static int SymTable_isSparse(SymTable_T oSymTable);
+
+#ifndef SYMTABLE_NO_AUTO_SHRINK
+/* Helper function that shrinks sparse table oSymTable to about two buckets per binding, but
+no fewer than its minimum, relinking its nodes rather than copying them unless it is concurrent.
+Its arena keeps the slabs of the removed nodes for reuse; SymTable_shrinkToFit releases them. If
+that fails, the table keeps working at its current size.*/
+static void SymTable_shrink(SymTable_T oSymTable);
+#endif
+
+/* Helper function that adds iDelta, 1 or -1, to the number of bindings of oSymTable.*/
+static void SymTable_addLength(SymTable_T oSymTable, int iDelta);
+
+/* Helper function that, if oSymTable is concurrent, first helps it grow if it is growing, and
+then waits until the bucket of keys whose full hash is uHash is free and locks it. Release it
+with SymTable_unlock.*/
+static void SymTable_lock(SymTable_T oSymTable, size_t uHash);
+
+/* Helper function that locks the bucket of keys whose full hash is uHash like SymTable_lock,
+but first starts growing a concurrent table that is full.*/
+static void SymTable_lockForAdd(SymTable_T oSymTable, size_t uHash);
+
+/* Helper function that locks the bucket of keys whose full hash is uHash like SymTable_lock,
+starting to grow a full table first if iAdding is nonzero.*/
+static void SymTable_lockStripe(SymTable_T oSymTable, size_t uHash, int iAdding);
+
+/* Helper function that releases the lock of SymTable_lock or SymTable_lockForAdd.*/
+static void SymTable_unlock(SymTable_T oSymTable, size_t uHash);
+
+/* Helper function that, if oSymTable is concurrent, waits until no other operation but lookups
+is using it and keeps them out until SymTable_unlockAll is called. A table that is growing
+finishes growing first, if it can.*/
+static void SymTable_lockAll(SymTable_T oSymTable);
+
+/* Helper function that releases the lock of SymTable_lockAll.*/
+static void SymTable_unlockAll(SymTable_T oSymTable);
+
+/* Adds uAmount to the operation counter uCounter of oSymTable in a build with SYMTABLE_STATS
+defined, and does nothing otherwise. Lookups in a concurrent table count without a lock. */
+#ifdef SYMTABLE_STATS
+#define SymTable_count(oSymTable, uCounter, uAmount) \
+    ((oSymTable)->psStripes != NULL ? \
+        (void)__atomic_fetch_add(&(oSymTable)->uCounter, (uAmount), __ATOMIC_RELAXED) : \
+        (void)((oSymTable)->uCounter += (uAmount)))
+#else
+#define SymTable_count(oSymTable, uCounter, uAmount) ((void)0)
+#endif
 
 /* A SymTable is a structure that points to the first Node of the array of head nodes. */
 struct SymTable {
-    /* The address of the node pointing to the array of buckets */
+    /* The address of the node pointing to the array of buckets, which is psSmallBucket while
+    the table is small */
     struct Node** ppsSymNode;
 
-    /* The number of the bindings in the symbol table */
+    /* The number of the bindings in the symbol table, updated atomically if the table is
+    concurrent */
     size_t length;
+
+    /* The number of buckets, a power of two */
+    size_t uBucketCount;
+
+    /* The address of the old array of buckets while the table grows, and NULL otherwise. It
+    has half as many buckets as the current one */
+    struct Node** ppsOldSymNode;
+
+    /* The number of buckets of the old array whose bindings have been moved. A concurrent
+    table marks the moved buckets instead, and leaves this 0 */
+    size_t uMigrated;
+
+    /* While a concurrent table grows, the number of buckets of the old array claimed for
+    copying, and the number copied */
+    size_t uTransferIndex;
+    size_t uTransferDone;
+
+    /* The number of buckets below which the table does not shrink by itself */
+    size_t uMinBucketCount;
+
+    /* The arena that holds the nodes and key copies */
+    struct Arena sArena;
+
+    /* The hash function and its seed */
+    SymTable_HashFunction pfHash;
+    size_t uSeed;
+
+    /* The stripes of a concurrent table, whose arenas take the place of sArena, and NULL
+    otherwise */
+    struct Stripe* psStripes;
+
+    /* The lock that each operation on a concurrent table other than a lookup holds for reading,
+    and that growing, shrinking and the other operations on every bucket hold for writing */
+    pthread_rwlock_t sResizeLock;
+
+    /* The bucket array of a concurrent table as lookups see it */
+    struct BucketArray* psPublished;
+
+    /* The counters of the lookups in progress in a concurrent table */
+    struct ReaderSlot* psReaderSlots;
+
+    /* The epoch of a concurrent table, advanced by each grace period */
+    size_t uEpoch;
+
+    /* The lock that keeps grace periods from overlapping */
+    pthread_mutex_t sEpochLock;
+
+    /* The number of times the bindings have been moved into a new bucket array */
+    size_t uResizeCount;
+#ifdef SYMTABLE_STATS
+    /* The operation counters of SymTable_getStats, updated atomically if the table is
+    concurrent */
+    size_t uHits;
+    size_t uMisses;
+    size_t uCompares;
+#endif
+
+    /* The only bucket of a small table */
+    struct Node* psSmallBucket;
+
+    /* The first slab of the arena's nodes, so that a small table with short keys needs no
+    memory of its own beyond this structure. Growing the table leaves its nodes where they
+    are. */
+    union {
+        char acBytes[SMALL_SLAB_SIZE];
+        struct Node sAlignment;
+    } uSmallSlab;
 };
 
 SymTable_T SymTable_new(void) {
+    return SymTable_newWithHash(NULL, DEFAULT_SEED);
+}
+
+SymTable_T SymTable_newWithHash(SymTable_HashFunction pfHash, size_t uSeed) {
     SymTable_T oSymTable;
 
+    /* calloc also leaves the arena with no slabs and no free chunks */
     oSymTable = (SymTable_T)calloc(1, sizeof(struct SymTable));
     if (oSymTable == NULL) {
         return NULL;
     }
 
-    /* Allocates memory for array of buckets and initializes them to NULL */
-    oSymTable->ppsSymNode = (struct Node**)calloc(auBucketCounts[0], sizeof(struct Node*));
-    if (oSymTable->ppsSymNode == NULL) {
-        free(oSymTable);
+    /* The table starts small, with one bucket and nodes carved from its own slab */
+    oSymTable->psSmallBucket = NULL;
+    oSymTable->ppsSymNode = &oSymTable->psSmallBucket;
+    oSymTable->sArena.sNodes.pcNext = oSymTable->uSmallSlab.acBytes;
+    oSymTable->sArena.sNodes.uRemaining = SMALL_SLAB_SIZE;
+
+    oSymTable->length = 0;
+    oSymTable->uBucketCount = 1;
+    oSymTable->ppsOldSymNode = NULL;
+    oSymTable->uMigrated = 0;
+    oSymTable->uMinBucketCount = INITIAL_BUCKET_COUNT;
+    oSymTable->pfHash = (pfHash != NULL) ? pfHash : SymHash_hash;
+    oSymTable->uSeed = uSeed;
+    oSymTable->psStripes = NULL;
+    oSymTable->uResizeCount = 0;
+    return oSymTable;
+}
+
+SymTable_T SymTable_newWithCapacity(size_t uCapacity) {
+    SymTable_T oSymTable;
+
+    oSymTable = SymTable_new();
+    if (oSymTable == NULL) {
+        return NULL;
+    }
+    if (!SymTable_reserve(oSymTable, uCapacity)) {
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+    return oSymTable;
+}
+
+SymTable_T SymTable_newConcurrent(void) {
+    SymTable_T oSymTable;
+    struct Stripe* psStripes;
+    struct ReaderSlot* psReaderSlots;
+    struct BucketArray* psPublished;
+    size_t i = 0;  /* loop counter */
+
+    oSymTable = SymTable_new();
+    if (oSymTable == NULL) {
+        return NULL;
+    }
+
+    /* The stripes rely on the table never being small, so it gets its bucket array first */
+    psStripes = (struct Stripe*)calloc(STRIPE_COUNT, sizeof(struct Stripe));
+    psReaderSlots = (struct ReaderSlot*)calloc(READER_SLOT_COUNT, sizeof(struct ReaderSlot));
+    psPublished = (struct BucketArray*)malloc(sizeof(struct BucketArray));
+    if (psStripes == NULL || psReaderSlots == NULL || psPublished == NULL ||
+            !SymTable_rebuild(oSymTable, INITIAL_BUCKET_COUNT, 0)) {
+        free(psStripes);
+        free(psReaderSlots);
+        free(psPublished);
+        SymTable_free(oSymTable);
         return NULL;
     }
 
-    oSymTable->length = 0;
+    if (pthread_rwlock_init(&oSymTable->sResizeLock, NULL) != 0) {
+        free(psStripes);
+        free(psReaderSlots);
+        free(psPublished);
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+    if (pthread_mutex_init(&oSymTable->sEpochLock, NULL) != 0) {
+        pthread_rwlock_destroy(&oSymTable->sResizeLock);
+        free(psStripes);
+        free(psReaderSlots);
+        free(psPublished);
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+    for (i = 0; i < STRIPE_COUNT; i++) {
+        if (pthread_mutex_init(&psStripes[i].sLock, NULL) != 0) {
+            while (i > 0) {
+                pthread_mutex_destroy(&psStripes[--i].sLock);
+            }
+            pthread_mutex_destroy(&oSymTable->sEpochLock);
+            pthread_rwlock_destroy(&oSymTable->sResizeLock);
+            free(psStripes);
+            free(psReaderSlots);
+            free(psPublished);
+            SymTable_free(oSymTable);
+            return NULL;
+        }
+    }
+
+    psPublished->ppsBuckets = oSymTable->ppsSymNode;
+    psPublished->uBucketCount = oSymTable->uBucketCount;
+    psPublished->psNextArray = NULL;
+    oSymTable->psPublished = psPublished;
+    oSymTable->uTransferIndex = 0;
+    oSymTable->uTransferDone = 0;
+    oSymTable->psReaderSlots = psReaderSlots;
+    oSymTable->uEpoch = 0;
+    oSymTable->psStripes = psStripes;
     return oSymTable;
 }
 
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity) {
+    size_t uBucketCount;
+    int iSuccess;
+
+    assert(oSymTable != NULL);
+
+    SymTable_lockAll(oSymTable);
+    iSuccess = SymTable_growTo(oSymTable, uCapacity);
+    if (iSuccess) {
+        uBucketCount = SymTable_bucketCountFor(uCapacity);
+        if (uBucketCount > oSymTable->uMinBucketCount) {
+            oSymTable->uMinBucketCount = uBucketCount;
+        }
+    }
+    SymTable_unlockAll(oSymTable);
+    return iSuccess;
+}
+
+int SymTable_shrinkToFit(SymTable_T oSymTable) {
+    int iSuccess;
+
+    assert(oSymTable != NULL);
+
+    /* A small table has no bucket array to shrink, and its nodes are in its own slab */
+    if (SymTable_isSmall(oSymTable)) {
+        return 1;
+    }
+
+    SymTable_lockAll(oSymTable);
+    iSuccess = SymTable_rebuild(oSymTable, SymTable_bucketCountFor(oSymTable->length), 1);
+    if (iSuccess) {
+        oSymTable->uMinBucketCount = INITIAL_BUCKET_COUNT;
+    }
+    SymTable_unlockAll(oSymTable);
+    return iSuccess;
+}
+
 void SymTable_free(SymTable_T oSymTable) {
-    struct Node* psCurrentNode;
-    struct Node* psNextNode;
     size_t i = 0;  /* loop counter */
 
     assert(oSymTable != NULL);
 
-    for (i = 0; i < auBucketCounts[counter]; i++) {
-        for (psCurrentNode = oSymTable->ppsSymNode[i]; 
-                psCurrentNode != NULL; 
-                psCurrentNode = psNextNode) {
-                psNextNode = psCurrentNode->psNextNode;
-                free((char*)(psCurrentNode->pcKey));
-                free(psCurrentNode);
+    /* Every node and key copy lives in the arenas, so there is no need to visit them */
+    SymTable_arenaFree(&oSymTable->sArena);
+    if (oSymTable->psStripes != NULL) {
+        for (i = 0; i < STRIPE_COUNT; i++) {
+            SymTable_arenaFree(&oSymTable->psStripes[i].sArena);
+            pthread_mutex_destroy(&oSymTable->psStripes[i].sLock);
         }
+        pthread_mutex_destroy(&oSymTable->sEpochLock);
+        pthread_rwlock_destroy(&oSymTable->sResizeLock);
+        free(oSymTable->psStripes);
+        free(oSymTable->psReaderSlots);
+        free(oSymTable->psPublished->psNextArray);
+        free(oSymTable->psPublished);
+    }
+    free(oSymTable->ppsOldSymNode);
+    if (!SymTable_isSmall(oSymTable)) {
+        free(oSymTable->ppsSymNode);
     }
-
-    free(oSymTable->ppsSymNode);
     free(oSymTable);
 }
 
 size_t SymTable_getLength(SymTable_T oSymTable) {
     assert(oSymTable != NULL);
+    if (oSymTable->psStripes != NULL) {
+        return __atomic_load_n(&oSymTable->length, __ATOMIC_RELAXED);
+    }
     return oSymTable->length;
 }
 
+size_t SymTable_getBucketCount(SymTable_T oSymTable) {
+    size_t uBucketCount;
+
+    assert(oSymTable != NULL);
+
+    SymTable_lockAll(oSymTable);
+    uBucketCount = oSymTable->uBucketCount;
+    SymTable_unlockAll(oSymTable);
+    return uBucketCount;
+}
+
+void SymTable_getStats(SymTable_T oSymTable, SymTable_Stats *psStats) {
+    size_t uWalkCount;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(psStats != NULL);
+
+    memset(psStats, 0, sizeof(SymTable_Stats));
+    SymTable_lockAll(oSymTable);
+
+    psStats->uLength = SymTable_getLength(oSymTable);
+    psStats->uBucketCount = oSymTable->uBucketCount;
+    psStats->dLoadFactor = (double)psStats->uLength / (double)oSymTable->uBucketCount;
+    psStats->uResizeCount = oSymTable->uResizeCount;
+
+    /* While the table grows, the old buckets that have not moved yet count as well */
+    uWalkCount = SymTable_walkCount(oSymTable);
+    for (i = 0; i < uWalkCount; i++) {
+        SymTable_addChainStats(SymTable_walkHead(oSymTable, i), psStats);
+    }
+    if (!SymTable_isSmall(oSymTable)) {
+        psStats->uBucketBytes = oSymTable->uBucketCount * sizeof(struct Node*);
+    }
+    if (oSymTable->ppsOldSymNode != NULL) {
+        psStats->uBucketBytes += oSymTable->uBucketCount / 2 * sizeof(struct Node*);
+    }
+
+#ifdef SYMTABLE_STATS
+    psStats->uHits = __atomic_load_n(&oSymTable->uHits, __ATOMIC_RELAXED);
+    psStats->uMisses = __atomic_load_n(&oSymTable->uMisses, __ATOMIC_RELAXED);
+    psStats->uCompares = __atomic_load_n(&oSymTable->uCompares, __ATOMIC_RELAXED);
+#endif
+    SymTable_unlockAll(oSymTable);
+}
+
 int SymTable_put(SymTable_T oSymTable, 
     const char *pcKey, const void *pvValue) {
-        struct Node* psNewNode;
-        size_t hashCode; /* hash code for the bucket the binding will be put in */
-        int check = 1; /* check variable for insufficient memory case */
+        assert(pcKey != NULL);
+        return SymTable_putN(oSymTable, pcKey, strlen(pcKey), pvValue);
+}
+
+int SymTable_putN(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength, const void *pvValue) {
+        struct Node* psNode;
+        int iAdded;
+        size_t uHash; /* full hash of the key of the binding */
 
         assert(oSymTable != NULL);
         assert(pcKey != NULL);
 
-        if (SymTable_contains(oSymTable, pcKey) == 1) {
-            return 0;
-        }
-
-        /* Expand if number of bindings is greater than number of buckets */
-        if (SymTable_getLength(oSymTable) > auBucketCounts[counter]) {
-            struct Node** psNewMem;
-            struct Node* psCurrentNode;
-            size_t newHashCode;
-            size_t i = 0;  /* loop counter */
+        uHash = SymTable_hash(oSymTable, pcKey, uLength);
+        SymTable_lockForAdd(oSymTable, uHash);
+        psNode = SymTable_findOrAdd(oSymTable, pcKey, uLength, uHash, pvValue, &iAdded);
+        SymTable_unlock(oSymTable, uHash);
+        return (psNode != NULL) && iAdded;
+}
 
-            counter++;
+void **SymTable_getOrPut(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue) {
+        struct Node* psNode;
+        int iAdded;
+        size_t uLength;
+        size_t uHash; /* full hash of the key of the binding */
 
-            /* Allocate memory for new bucket array */
-            psNewMem = (struct Node**)calloc(auBucketCounts[counter], sizeof(struct Node*));
-            if (psNewMem == NULL) {
-                counter--;
-                check = 0;
-            }
-            
-            /* If there is sufficient memory, continue into loop */
-            if (check == 1) {
-                /* Loop to rehash keys and "move" them into the new bucket array */
-                for (i = 0; i < auBucketCounts[counter]; i++) {
-                    for (psCurrentNode = oSymTable->ppsSymNode[i];
-                            psCurrentNode != NULL; 
-                            psCurrentNode = psCurrentNode->psNextNode) {
-                        
-                    /* Calculate past and new hash code */
-                    hashCode = SymTable_hash(psCurrentNode->pcKey, auBucketCounts[counter-1]);
-                    newHashCode = SymTable_hash(psCurrentNode->pcKey, auBucketCounts[counter]);
-                    
-                    /* Insert node in new bucket array and delete from old bucket array */
-                    SymTable_insert(psNewMem, psCurrentNode, newHashCode);
-                    SymTable_delete(oSymTable, pcKey, hashCode);
-                    }
-                }
+        assert(oSymTable != NULL);
+        assert(pcKey != NULL);
 
-                free(oSymTable->ppsSymNode);
-                oSymTable->ppsSymNode = psNewMem;
-            }
-        } 
-        
-        /* Allocate space for new node to be inserted */
-        psNewNode = (struct Node*)calloc(1, sizeof(struct Node));
-        if (psNewNode == NULL) {
-            return 0;
+        uLength = strlen(pcKey);
+        uHash = SymTable_hash(oSymTable, pcKey, uLength);
+        SymTable_lockForAdd(oSymTable, uHash);
+        psNode = SymTable_findOrAdd(oSymTable, pcKey, uLength, uHash, pvValue, &iAdded);
+        SymTable_unlock(oSymTable, uHash);
+        if (psNode == NULL) {
+            return NULL;
         }
+        return &psNode->pvValue;
+}
 
-        /* makes defensive copy of key */
-        psNewNode->pcKey = (char*)malloc(strlen(pcKey) + 1);
-        if (psNewNode->pcKey == NULL) {
-            free(psNewNode);
-            return 0;
-        }
-        strcpy((void*)(psNewNode->pcKey), pcKey);
-        psNewNode->pvValue = (void*)pvValue;
+int SymTable_upsert(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue) {
+        return SymTable_putOrReplace(oSymTable, pcKey, pvValue, NULL) >= 0;
+}
 
-        /* Hash key and put in corresponding bucket */
-        hashCode = SymTable_hash(pcKey, auBucketCounts[counter]);
+int SymTable_putOrReplace(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue, void **ppvOldValue) {
+        struct Node* psNode;
+        int iAdded;
+        size_t uLength;
+        size_t uHash; /* full hash of the key of the binding */
 
-        if (oSymTable->ppsSymNode == NULL) {
-            return 0;
-        }
+        assert(oSymTable != NULL);
+        assert(pcKey != NULL);
 
-        /* If bucket is empty */
-        if (oSymTable->ppsSymNode[hashCode] == NULL) {
-            oSymTable->ppsSymNode[hashCode] = psNewNode;
-            psNewNode->psNextNode = NULL;
-        } else {
-            psNewNode->psNextNode = oSymTable->ppsSymNode[hashCode];
-            oSymTable->ppsSymNode[hashCode] = psNewNode;
+        uLength = strlen(pcKey);
+        uHash = SymTable_hash(oSymTable, pcKey, uLength);
+        SymTable_lockForAdd(oSymTable, uHash);
+        psNode = SymTable_findOrAdd(oSymTable, pcKey, uLength, uHash, pvValue, &iAdded);
+        if (psNode != NULL && !iAdded) {
+            if (ppvOldValue != NULL) {
+                *ppvOldValue = psNode->pvValue;
+            }
+            __atomic_store_n(&psNode->pvValue, (void*)pvValue, __ATOMIC_RELEASE);
         }
+        SymTable_unlock(oSymTable, uHash);
 
-        (oSymTable->length)++;
-        return 1;
+        if (psNode == NULL) {
+            return -1;
+        }
+        return iAdded;
 }
 
 void *SymTable_replace(SymTable_T oSymTable, 
     const char *pcKey, const void *pvValue) {
+        assert(pcKey != NULL);
+        return SymTable_replaceN(oSymTable, pcKey, strlen(pcKey), pvValue);
+}
+
+void *SymTable_replaceN(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength, const void *pvValue) {
         void* pvOldValue;
         struct Node* psCurrentNode;
-        size_t hashCode; /* hash code for the bucket the binding will be put in */
+        size_t uHash; /* full hash of the key of the binding */
 
         assert(oSymTable != NULL);
         assert(pcKey != NULL);
 
-        if (SymTable_contains(oSymTable, pcKey) == 0) {
-            return NULL;
-        }
-
-        hashCode = SymTable_hash(pcKey, auBucketCounts[counter]);
-
-        for (psCurrentNode = oSymTable->ppsSymNode[hashCode]; 
-                psCurrentNode != NULL; 
-                psCurrentNode = psCurrentNode->psNextNode) {
-            if (strcmp(psCurrentNode->pcKey, pcKey) == 0) {
-                pvOldValue = psCurrentNode->pvValue;
-                psCurrentNode->pvValue = (void*)pvValue;
-                return (void*)pvOldValue;
-            }
+        uHash = SymTable_hash(oSymTable, pcKey, uLength);
+        SymTable_lock(oSymTable, uHash);
+        psCurrentNode = *SymTable_find(oSymTable, pcKey, uLength, uHash);
+        pvOldValue = NULL;
+        if (psCurrentNode != NULL) {
+            pvOldValue = psCurrentNode->pvValue;
+            __atomic_store_n(&psCurrentNode->pvValue, (void*)pvValue, __ATOMIC_RELEASE);
         }
-        return NULL;
+        SymTable_unlock(oSymTable, uHash);
+        return pvOldValue;
 }
 
 int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
-    struct Node* psCurrentNode;
-    size_t hashCode; /* hash code for the bucket the binding will be put in */
+    assert(pcKey != NULL);
+    return SymTable_containsN(oSymTable, pcKey, strlen(pcKey));
+}
+
+int SymTable_containsN(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
+    int iFound;
+    size_t uHash; /* full hash of the key of the binding */
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    hashCode = SymTable_hash(pcKey, auBucketCounts[counter]);
-
-    if (oSymTable->ppsSymNode[hashCode] == NULL) {
-        return 0;
+    uHash = SymTable_hash(oSymTable, pcKey, uLength);
+    if (oSymTable->psStripes != NULL) {
+        void* pvValue;
+        return SymTable_read(oSymTable, pcKey, uLength, uHash, &pvValue);
     }
-
-    for (psCurrentNode = oSymTable->ppsSymNode[hashCode]; 
-            psCurrentNode != NULL; 
-            psCurrentNode = psCurrentNode->psNextNode) {
-        if (strcmp(psCurrentNode->pcKey, pcKey) == 0) {
-                return 1;
-            }
-        }
-
-    return 0;
+    SymTable_lock(oSymTable, uHash);
+    iFound = *SymTable_find(oSymTable, pcKey, uLength, uHash) != NULL;
+    SymTable_unlock(oSymTable, uHash);
+    return iFound;
 }
 
 void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+    assert(pcKey != NULL);
+    return SymTable_getN(oSymTable, pcKey, strlen(pcKey));
+}
+
+void *SymTable_getN(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
     struct Node* psCurrentNode;
-    size_t hashCode; /* hash code for the bucket the binding will be put in */
+    void* pvValue;
+    size_t uHash; /* full hash of the key of the binding */
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    if (SymTable_contains(oSymTable, pcKey) == 0) {
-            return NULL;
-        }
-    
-    hashCode = SymTable_hash(pcKey, auBucketCounts[counter]);
-
-    for (psCurrentNode = oSymTable->ppsSymNode[hashCode]; 
-            psCurrentNode != NULL; 
-            psCurrentNode = psCurrentNode->psNextNode) {
-        if (strcmp(psCurrentNode->pcKey, pcKey) == 0) {
-                return (void*)psCurrentNode->pvValue;
-            }
-        }
-
-    return NULL;
+    uHash = SymTable_hash(oSymTable, pcKey, uLength);
+    if (oSymTable->psStripes != NULL) {
+        pvValue = NULL;
+        (void)SymTable_read(oSymTable, pcKey, uLength, uHash, &pvValue);
+        return pvValue;
+    }
+    SymTable_lock(oSymTable, uHash);
+    psCurrentNode = *SymTable_find(oSymTable, pcKey, uLength, uHash);
+    pvValue = psCurrentNode != NULL ? psCurrentNode->pvValue : NULL;
+    SymTable_unlock(oSymTable, uHash);
+    return pvValue;
 }
 
 void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+    assert(pcKey != NULL);
+    return SymTable_removeN(oSymTable, pcKey, strlen(pcKey));
+}
+
+void *SymTable_removeN(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
     void* pvOldValue;
+    struct Node** ppsLink;
     struct Node* psCurrentNode;
-    struct Node* psNextNode;
-    struct Node* psPreviousNode;
-    size_t hashCode; /* hash code for the bucket the binding will be put in */
+    int iSparse;
+    size_t uHash; /* full hash of the key of the binding */
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    if (SymTable_contains(oSymTable, pcKey) == 0) {
-            return NULL;
+    uHash = SymTable_hash(oSymTable, pcKey, uLength);
+    SymTable_lock(oSymTable, uHash);
+    ppsLink = SymTable_find(oSymTable, pcKey, uLength, uHash);
+    psCurrentNode = *ppsLink;
+    if (psCurrentNode == NULL) {
+        SymTable_unlock(oSymTable, uHash);
+        return NULL;
+    }
+
+    /* Unlink the node, whether it heads the bucket or not. Lookups of a concurrent table may
+    still be reading it, so it is freed only after a grace period. */
+    __atomic_store_n(ppsLink, psCurrentNode->psNextNode, __ATOMIC_RELEASE);
+    pvOldValue = psCurrentNode->pvValue;
+    if (oSymTable->psStripes != NULL) {
+        SymTable_retire(oSymTable, uHash, psCurrentNode);
+    } else {
+        SymTable_freeBinding(&oSymTable->sArena, psCurrentNode);
+    }
+    SymTable_addLength(oSymTable, -1);
+    iSparse = SymTable_isSparse(oSymTable);
+    SymTable_unlock(oSymTable, uHash);
+
+#ifndef SYMTABLE_NO_AUTO_SHRINK
+    /* A concurrent table shrinks only once it has every bucket to itself, by which time other
+    threads may have added bindings, so check again */
+    if (iSparse) {
+        SymTable_lockAll(oSymTable);
+        if (SymTable_isSparse(oSymTable)) {
+            SymTable_shrink(oSymTable);
         }
+        SymTable_unlockAll(oSymTable);
+    }
+#else
+    (void)iSparse;
+#endif
+    return pvOldValue;
+}
 
-    hashCode = SymTable_hash(pcKey, auBucketCounts[counter]);
+void SymTable_getBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    void **ppvValues) {
+        struct Node* apsNodes[BATCH_SIZE];
+        size_t uBatch;
+        size_t i = 0;  /* loop counter */
 
-    psPreviousNode = oSymTable->ppsSymNode[hashCode];
+        assert(oSymTable != NULL);
+        assert(ppcKeys != NULL || uCount == 0);
+        assert(ppvValues != NULL || uCount == 0);
+
+        /* The keys of a batch span many stripes, so a concurrent table looks them up one by
+        one */
+        if (oSymTable->psStripes != NULL) {
+            for (i = 0; i < uCount; i++) {
+                assert(ppcKeys[i] != NULL);
+                ppvValues[i] = SymTable_getN(oSymTable, ppcKeys[i], strlen(ppcKeys[i]));
+            }
+            return;
+        }
 
-    for (psCurrentNode = oSymTable->ppsSymNode[hashCode]; 
-            psCurrentNode != NULL; 
-            psCurrentNode = psCurrentNode->psNextNode) {
-        /* If key matches */
-        if (strcmp(psCurrentNode->pcKey, pcKey) == 0) {
-                pvOldValue = psCurrentNode->pvValue;
-                psNextNode = psCurrentNode->psNextNode;
-                /* If key to be freed is the first one */
-                if (psCurrentNode->pcKey == (oSymTable->ppsSymNode[hashCode])->pcKey) {
-                    oSymTable->ppsSymNode[hashCode] = psNextNode;
-                    free((char*)(psCurrentNode->pcKey));
-                    free(psCurrentNode);
-                    (oSymTable->length)--;
-                    return (void*)pvOldValue;
-                } else {
-                    psPreviousNode->psNextNode = psNextNode;
-                    free((char*)(psCurrentNode->pcKey));
-                    free(psCurrentNode);
-                    (oSymTable->length)--;
-                    return (void*)pvOldValue;
-                }
+        for (; uCount > 0; uCount -= uBatch, ppcKeys += uBatch, ppvValues += uBatch) {
+            uBatch = uCount < BATCH_SIZE ? uCount : BATCH_SIZE;
+            SymTable_findBatch(oSymTable, ppcKeys, uBatch, apsNodes);
+            for (i = 0; i < uBatch; i++) {
+                ppvValues[i] = apsNodes[i] != NULL ? apsNodes[i]->pvValue : NULL;
             }
-            psNextNode = psCurrentNode->psNextNode;
-            psPreviousNode = psCurrentNode;
         }
-    
-        return NULL;
 }
 
-void SymTable_map(SymTable_T oSymTable,
-    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
-    const void *pvExtra) {
-        struct Node* psCurrentNode;
+void SymTable_containsBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    int *piFound) {
+        struct Node* apsNodes[BATCH_SIZE];
+        size_t uBatch;
         size_t i = 0;  /* loop counter */
 
         assert(oSymTable != NULL);
-        assert(pfApply != NULL);
+        assert(ppcKeys != NULL || uCount == 0);
+        assert(piFound != NULL || uCount == 0);
 
-        for (i = 0; i < auBucketCounts[counter]; i++) {
-            for (psCurrentNode = oSymTable->ppsSymNode[i]; 
-                    psCurrentNode != NULL; 
-                    psCurrentNode = psCurrentNode->psNextNode) {
-                (*pfApply)((void*)psCurrentNode->pcKey, (void*)psCurrentNode->pvValue, (void*)pvExtra);
+        if (oSymTable->psStripes != NULL) {
+            for (i = 0; i < uCount; i++) {
+                assert(ppcKeys[i] != NULL);
+                piFound[i] = SymTable_containsN(oSymTable, ppcKeys[i], strlen(ppcKeys[i]));
             }
+            return;
         }
-    }
-
-/* Helper insert function */
-int SymTable_insert(struct Node** ppsSymNode, struct Node* psToInsert, size_t hashCode) {
-    assert(ppsSymNode != NULL);
-    assert(psToInsert != NULL);
 
-    if (ppsSymNode[hashCode] == NULL) {
-        ppsSymNode[hashCode] = psToInsert;
-        psToInsert->psNextNode = NULL;
-        return 1;
-    } else {
-        psToInsert->psNextNode = ppsSymNode[hashCode];
-        ppsSymNode[hashCode] = psToInsert;
-        return 1;
-    }
+        for (; uCount > 0; uCount -= uBatch, ppcKeys += uBatch, piFound += uBatch) {
+            uBatch = uCount < BATCH_SIZE ? uCount : BATCH_SIZE;
+            SymTable_findBatch(oSymTable, ppcKeys, uBatch, apsNodes);
+            for (i = 0; i < uBatch; i++) {
+                piFound[i] = apsNodes[i] != NULL;
+            }
+        }
 }
 
-/* Helper delete function without freeing Node */
-int SymTable_delete(SymTable_T oSymTable, const char *pcKey, size_t hashCode) {
-    struct Node* psCurrentNode;
-    struct Node* psNextNode;
-    struct Node* psPreviousNode;
-
-    assert(pcKey != NULL);
+int SymTable_putBatch(SymTable_T oSymTable, const char **ppcKeys, void **ppvValues,
+    size_t uCount, int *piRejected) {
+        struct Node* psNode;
+        int iAdded;
+        size_t uLength;
+        size_t uHash; /* full hash of the key of the binding */
+        size_t i = 0;  /* loop counter */
 
-    for (psCurrentNode = oSymTable->ppsSymNode[hashCode]; 
-            psCurrentNode != NULL; 
-            psCurrentNode = psCurrentNode->psNextNode) {
-        /* If key matches */
-        if (strcmp(psCurrentNode->pcKey, pcKey) == 0) {
-                psNextNode = psCurrentNode->psNextNode;
-                /* If key to be deleted is the first one */
-                if (psCurrentNode->pcKey == (oSymTable->ppsSymNode[hashCode])->pcKey) {
-                    oSymTable->ppsSymNode[hashCode] = psNextNode;
-                    (oSymTable->length)--;
-                    return 1;
-                } else {
-                    psPreviousNode = psCurrentNode;
-                    psPreviousNode->psNextNode = psNextNode;
-                    (oSymTable->length)--;
-                    return 1;
-                }
+        assert(oSymTable != NULL);
+        assert(ppcKeys != NULL || uCount == 0);
+        assert(ppvValues != NULL || uCount == 0);
+
+        /* If the array cannot be allocated, the puts below still grow the table step by
+        step */
+        SymTable_lockAll(oSymTable);
+        (void)SymTable_growTo(oSymTable, oSymTable->length + uCount);
+        SymTable_unlockAll(oSymTable);
+
+        for (i = 0; i < uCount; i++) {
+            assert(ppcKeys[i] != NULL);
+            uLength = strlen(ppcKeys[i]);
+            uHash = SymTable_hash(oSymTable, ppcKeys[i], uLength);
+            SymTable_lockForAdd(oSymTable, uHash);
+            psNode = SymTable_findOrAdd(oSymTable, ppcKeys[i], uLength, uHash, ppvValues[i],
+                &iAdded);
+            SymTable_unlock(oSymTable, uHash);
+            if (psNode == NULL) {
+                return 0;
+            }
+            if (piRejected != NULL) {
+                piRejected[i] = !iAdded;
             }
-            psNextNode = psCurrentNode->psNextNode;
-            psPreviousNode = psCurrentNode;
         }
-    return 0;
+        return 1;
 }
 
-/* Helper hash function */
-size_t SymTable_hash(const char *pcKey, size_t uBucketCount)
-{
-   const size_t HASH_MULTIPLIER = 65599;
-   size_t u;
-   size_t uHash = 0;
+SymTable_T SymTable_bulkLoad(const char **ppcKeys, void **ppvValues, size_t uCount,
+    int *piRejected) {
+        SymTable_T oSymTable;
 
-   assert(pcKey != NULL);
+        oSymTable = SymTable_new();
+        if (oSymTable == NULL) {
+            return NULL;
+        }
+        if (!SymTable_putBatch(oSymTable, ppcKeys, ppvValues, uCount, piRejected)) {
+            SymTable_free(oSymTable);
+            return NULL;
+        }
+        return oSymTable;
+}
 
-   for (u = 0; pcKey[u] != '\0'; u++)
-      uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+void SymTable_map(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+        size_t uCount;
+        size_t i = 0;  /* loop counter */
 
-   return uHash % uBucketCount;
+        assert(oSymTable != NULL);
+        assert(pfApply != NULL);
+
+        SymTable_lockAll(oSymTable);
+
+        /* While the table grows, the buckets of the old array that have not been migrated
+        hold the rest of the bindings */
+        uCount = SymTable_walkCount(oSymTable);
+        for (i = 0; i < uCount; i++) {
+            (void)SymTable_applyChain(SymTable_walkHead(oSymTable, i), pfApply,
+                (void*)pvExtra);
+        }
+
+        SymTable_unlockAll(oSymTable);
+    }
+
+void SymTable_mapParallel(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    void **ppvExtras, size_t uThreadCount) {
+        struct MapJob sJob;
+        struct MapWorker* psWorkers;
+        size_t i = 0;  /* loop counter */
+
+        assert(oSymTable != NULL);
+        assert(pfApply != NULL);
+
+        SymTable_lockAll(oSymTable);
+
+        sJob.oSymTable = oSymTable;
+        sJob.pfApply = pfApply;
+        sJob.uNext = 0;
+        sJob.uTotal = SymTable_walkCount(oSymTable);
+
+        /* Without memory for the workers, the calling thread does it all */
+        if (uThreadCount == 0) {
+            uThreadCount = 1;
+        }
+        psWorkers = (struct MapWorker*)calloc(uThreadCount, sizeof(struct MapWorker));
+        if (psWorkers == NULL) {
+            struct MapWorker sWorker;
+            sWorker.psJob = &sJob;
+            sWorker.pvExtra = (ppvExtras != NULL) ? ppvExtras[0] : NULL;
+            (void)SymTable_mapWork(&sWorker);
+            SymTable_unlockAll(oSymTable);
+            return;
+        }
+
+        for (i = 0; i < uThreadCount; i++) {
+            psWorkers[i].psJob = &sJob;
+            psWorkers[i].pvExtra = (ppvExtras != NULL) ? ppvExtras[i] : NULL;
+        }
+        for (i = 1; i < uThreadCount; i++) {
+            psWorkers[i].iStarted = pthread_create(&psWorkers[i].sThread, NULL,
+                SymTable_mapWork, &psWorkers[i]) == 0;
+        }
+        (void)SymTable_mapWork(&psWorkers[0]);
+        for (i = 1; i < uThreadCount; i++) {
+            if (psWorkers[i].iStarted) {
+                pthread_join(psWorkers[i].sThread, NULL);
+            }
+        }
+
+        free(psWorkers);
+        SymTable_unlockAll(oSymTable);
+    }
+
+void SymTable_iterBegin(SymTable_T oSymTable, SymTable_Iter *psIter) {
+    assert(oSymTable != NULL);
+    assert(psIter != NULL);
+
+    /* Lookups move buckets of a growing table, so the walk moves the rest of them first */
+    SymTable_lockAll(oSymTable);
+    if (oSymTable->ppsOldSymNode != NULL && oSymTable->psStripes == NULL) {
+        SymTable_migrate(oSymTable, oSymTable->uBucketCount / 2);
+    }
+
+    psIter->oSymTable = oSymTable;
+    psIter->uIndex = 0;
+    psIter->pvNext = NULL;
+}
+
+int SymTable_iterNext(SymTable_Iter *psIter, const char **ppcKey, size_t *puLength,
+    void **ppvValue) {
+    struct Node* psNode;
+    size_t uCount;
+
+    assert(psIter != NULL);
+    assert(psIter->oSymTable != NULL);
+
+    /* pvNext is the next node of the current bucket, and uIndex the bucket after it */
+    psNode = (struct Node*)psIter->pvNext;
+    if (psNode == NULL) {
+        uCount = SymTable_walkCount(psIter->oSymTable);
+        while (psNode == NULL && psIter->uIndex < uCount) {
+            psNode = SymTable_walkHead(psIter->oSymTable, psIter->uIndex);
+            psIter->uIndex++;
+        }
+        if (psNode == NULL) {
+            return 0;
+        }
+    }
+    psIter->pvNext = psNode->psNextNode;
+
+    if (ppcKey != NULL) {
+        *ppcKey = psNode->pcKey;
+    }
+    if (puLength != NULL) {
+        *puLength = psNode->uLength;
+    }
+    if (ppvValue != NULL) {
+        *ppvValue = psNode->pvValue;
+    }
+    return 1;
+}
+
+void SymTable_iterEnd(SymTable_Iter *psIter) {
+    assert(psIter != NULL);
+    assert(psIter->oSymTable != NULL);
+
+    SymTable_unlockAll(psIter->oSymTable);
+    psIter->oSymTable = NULL;
+}
+
+size_t SymTable_scan(SymTable_T oSymTable, size_t uCursor, size_t uCount,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    size_t uMask;
+    size_t uApplied = 0;
+    size_t uBucketsPassed = 0;
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    SymTable_lockAll(oSymTable);
+
+    /* While the table grows, cursors advance through the old array, each covering the two
+    current buckets that its old bucket splits into */
+    uMask = oSymTable->uBucketCount - 1;
+    if (oSymTable->ppsOldSymNode != NULL) {
+        uMask = oSymTable->uBucketCount / 2 - 1;
+    }
+    do {
+        uApplied += SymTable_scanBucket(oSymTable, uCursor, pfApply, (void*)pvExtra);
+        uCursor = SymTable_nextCursor(uCursor, uMask);
+        uBucketsPassed++;
+    } while (uCursor != 0 && uApplied < uCount &&
+        uBucketsPassed / SCAN_BUCKET_FACTOR < uCount);
+
+    SymTable_unlockAll(oSymTable);
+    return uCursor;
+}
+
+/* Helper map worker function */
+void* SymTable_mapWork(void *pvWorker) {
+    struct MapWorker* psWorker = (struct MapWorker*)pvWorker;
+    struct MapJob* psJob;
+    SymTable_T oSymTable;
+    size_t uStart;
+    size_t uEnd;
+    size_t i = 0;  /* loop counter */
+
+    assert(psWorker != NULL);
+
+    psJob = psWorker->psJob;
+    oSymTable = psJob->oSymTable;
+    for (;;) {
+        uStart = __atomic_fetch_add(&psJob->uNext, MAP_STEP, __ATOMIC_RELAXED);
+        if (uStart >= psJob->uTotal) {
+            return NULL;
+        }
+        uEnd = uStart + MAP_STEP;
+        if (uEnd > psJob->uTotal) {
+            uEnd = psJob->uTotal;
+        }
+
+        for (i = uStart; i < uEnd; i++) {
+            (void)SymTable_applyChain(SymTable_walkHead(oSymTable, i), psJob->pfApply,
+                psWorker->pvExtra);
+        }
+    }
+}
+
+/* Helper walk count function */
+size_t SymTable_walkCount(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    if (oSymTable->ppsOldSymNode != NULL) {
+        return oSymTable->uBucketCount / 2 - oSymTable->uMigrated + oSymTable->uBucketCount;
+    }
+    return oSymTable->uBucketCount;
+}
+
+/* Helper walk head function */
+struct Node* SymTable_walkHead(SymTable_T oSymTable, size_t uIndex) {
+    struct Node* psNode;
+    size_t uOldCount = 0;
+
+    assert(oSymTable != NULL);
+
+    if (oSymTable->ppsOldSymNode != NULL) {
+        uOldCount = oSymTable->uBucketCount / 2 - oSymTable->uMigrated;
+        if (uIndex < uOldCount) {
+            psNode = oSymTable->ppsOldSymNode[oSymTable->uMigrated + uIndex];
+            return psNode != FORWARD_NODE ? psNode : NULL;
+        }
+    }
+    return oSymTable->ppsSymNode[uIndex - uOldCount];
+}
+
+/* Helper scan bucket function */
+size_t SymTable_scanBucket(SymTable_T oSymTable, size_t uCursor,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra), void *pvExtra) {
+    size_t uOldCount;
+    size_t uBucket;
+    size_t uVisited = 0;
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    if (oSymTable->ppsOldSymNode == NULL) {
+        return SymTable_applyChain(
+            oSymTable->ppsSymNode[uCursor & (oSymTable->uBucketCount - 1)], pfApply, pvExtra);
+    }
+
+    /* The chain of a migrated old bucket has been relinked into the current array */
+    uOldCount = oSymTable->uBucketCount / 2;
+    uBucket = uCursor & (uOldCount - 1);
+    if (oSymTable->psStripes != NULL || uBucket >= oSymTable->uMigrated) {
+        uVisited += SymTable_applyChain(oSymTable->ppsOldSymNode[uBucket], pfApply, pvExtra);
+    }
+    uVisited += SymTable_applyChain(oSymTable->ppsSymNode[uBucket], pfApply, pvExtra);
+    uVisited += SymTable_applyChain(oSymTable->ppsSymNode[uBucket + uOldCount], pfApply,
+        pvExtra);
+    return uVisited;
+}
+
+/* Helper apply chain function */
+size_t SymTable_applyChain(struct Node *psNode,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra), void *pvExtra) {
+    size_t uVisited = 0;
+
+    assert(pfApply != NULL);
+
+    for (; psNode != NULL && psNode != FORWARD_NODE; psNode = psNode->psNextNode) {
+        (*pfApply)(psNode->pcKey, psNode->pvValue, pvExtra);
+        uVisited++;
+    }
+    return uVisited;
+}
+
+/* Helper next cursor function */
+size_t SymTable_nextCursor(size_t uCursor, size_t uMask) {
+    size_t uBit;
+
+    /* Clear the highest bits of the cursor that are set, and set the highest one that is not */
+    uCursor &= uMask;
+    for (uBit = (uMask + 1) / 2; uBit != 0 && (uCursor & uBit) != 0; uBit /= 2) {
+        uCursor &= ~uBit;
+    }
+    return uCursor | uBit;
+}
+
+/* Helper insert function */
+int SymTable_insert(struct Node** ppsSymNode, struct Node* psToInsert, size_t hashCode) {
+    assert(ppsSymNode != NULL);
+    assert(psToInsert != NULL);
+
+    if (ppsSymNode[hashCode] == NULL) {
+        ppsSymNode[hashCode] = psToInsert;
+        psToInsert->psNextNode = NULL;
+        return 1;
+    } else {
+        psToInsert->psNextNode = ppsSymNode[hashCode];
+        ppsSymNode[hashCode] = psToInsert;
+        return 1;
+    }
+}
+
+/* Helper hash function */
+size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+    return (*oSymTable->pfHash)(pcKey, uLength, oSymTable->uSeed);
+}
+
+/* Helper find function */
+struct Node** SymTable_find(SymTable_T oSymTable, const char *pcKey, size_t uLength,
+    size_t uHash) {
+    struct Node** ppsLink;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    /* Every operation searches, so this is where growth makes progress. A concurrent table
+    grows in SymTable_lock instead. */
+    if (oSymTable->ppsOldSymNode != NULL && oSymTable->psStripes == NULL) {
+        SymTable_migrate(oSymTable, MIGRATE_STEP);
+    }
+
+    /* Only compare the bytes of keys whose cached hash and length match */
+    for (ppsLink = SymTable_bucket(oSymTable, uHash);
+            *ppsLink != NULL;
+            ppsLink = &(*ppsLink)->psNextNode) {
+        SymTable_count(oSymTable, uCompares, 1);
+        if ((*ppsLink)->uHash == uHash && (*ppsLink)->uLength == uLength &&
+                memcmp((*ppsLink)->pcKey, pcKey, uLength) == 0) {
+            break;
+        }
+    }
+
+    if (*ppsLink != NULL) {
+        SymTable_count(oSymTable, uHits, 1);
+    } else {
+        SymTable_count(oSymTable, uMisses, 1);
+    }
+    return ppsLink;
+}
+
+/* Helper batch find function */
+void SymTable_findBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    struct Node **ppsNodes) {
+    struct Node** appsBuckets[BATCH_SIZE];
+    size_t auHashes[BATCH_SIZE];
+    size_t auLengths[BATCH_SIZE];
+    struct Node* psCurrentNode;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(ppcKeys != NULL);
+    assert(ppsNodes != NULL);
+    assert(uCount <= BATCH_SIZE);
+
+    /* Growth makes as much progress as it would for uCount separate lookups */
+    if (oSymTable->ppsOldSymNode != NULL) {
+        SymTable_migrate(oSymTable, MIGRATE_STEP * uCount);
+    }
+
+    for (i = 0; i < uCount; i++) {
+        assert(ppcKeys[i] != NULL);
+        auLengths[i] = strlen(ppcKeys[i]);
+        auHashes[i] = (*oSymTable->pfHash)(ppcKeys[i], auLengths[i], oSymTable->uSeed);
+        appsBuckets[i] = SymTable_bucket(oSymTable, auHashes[i]);
+        SymTable_prefetch(appsBuckets[i]);
+    }
+
+    for (i = 0; i < uCount; i++) {
+        ppsNodes[i] = *appsBuckets[i];
+        if (ppsNodes[i] != NULL) {
+            SymTable_prefetch(ppsNodes[i]);
+        }
+    }
+
+    /* Only compare the bytes of keys whose cached hash and length match */
+    for (i = 0; i < uCount; i++) {
+        for (psCurrentNode = ppsNodes[i];
+                psCurrentNode != NULL;
+                psCurrentNode = psCurrentNode->psNextNode) {
+            SymTable_count(oSymTable, uCompares, 1);
+            if (psCurrentNode->uHash == auHashes[i] && psCurrentNode->uLength == auLengths[i] &&
+                    memcmp(psCurrentNode->pcKey, ppcKeys[i], auLengths[i]) == 0) {
+                break;
+            }
+        }
+        ppsNodes[i] = psCurrentNode;
+        if (psCurrentNode != NULL) {
+            SymTable_count(oSymTable, uHits, 1);
+        } else {
+            SymTable_count(oSymTable, uMisses, 1);
+        }
+    }
+}
+
+/* Helper find-or-add function */
+struct Node* SymTable_findOrAdd(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, size_t uHash, const void *pvValue, int *piAdded) {
+        struct Node* psNewNode;
+        struct Node** ppsBucket;
+        struct Arena* psArena;
+
+        assert(oSymTable != NULL);
+        assert(pcKey != NULL);
+        assert(piAdded != NULL);
+
+        *piAdded = 0;
+
+        /* Expand if number of bindings is greater than number of buckets, or give a small
+        table its first bucket array once it is full. If that fails, keep using the current
+        buckets. Expanding before the search keeps the bucket it finds valid for the
+        insertion. A concurrent table grows in SymTable_lockForAdd instead. */
+        if (oSymTable->psStripes == NULL) {
+            if (SymTable_isSmall(oSymTable)) {
+                if (oSymTable->length >= SMALL_NODE_COUNT) {
+                    (void)SymTable_rebuild(oSymTable, INITIAL_BUCKET_COUNT, 0);
+                }
+            } else if (oSymTable->length > oSymTable->uBucketCount) {
+                (void)SymTable_expand(oSymTable);
+            }
+        }
+
+        psNewNode = *SymTable_find(oSymTable, pcKey, uLength, uHash);
+        if (psNewNode != NULL) {
+            return psNewNode;
+        }
+
+        /* Allocate space for new node to be inserted */
+        psArena = SymTable_arena(oSymTable, uHash);
+        psNewNode = SymTable_allocNode(psArena);
+        if (psNewNode == NULL) {
+            return NULL;
+        }
+
+        /* makes defensive copy of key, inside the node if it fits */
+        if (uLength < INLINE_KEY_SIZE) {
+            memcpy(psNewNode->acInline, pcKey, uLength);
+            psNewNode->acInline[uLength] = '\0';
+            psNewNode->pcKey = psNewNode->acInline;
+        } else {
+            psNewNode->pcKey = SymTable_copyKey(psArena, pcKey, uLength);
+            if (psNewNode->pcKey == NULL) {
+                SymTable_freeNode(psArena, psNewNode);
+                return NULL;
+            }
+        }
+        psNewNode->uHash = uHash;
+        psNewNode->uLength = uLength;
+        psNewNode->pvValue = (void*)pvValue;
+
+        /* The search has already done this call's migration, so the bucket stays put */
+        ppsBucket = SymTable_bucket(oSymTable, uHash);
+        psNewNode->psNextNode = *ppsBucket;
+        __atomic_store_n(ppsBucket, psNewNode, __ATOMIC_RELEASE);
+        SymTable_addLength(oSymTable, 1);
+        *piAdded = 1;
+        return psNewNode;
+}
+
+/* Helper bucket function */
+struct Node** SymTable_bucket(SymTable_T oSymTable, size_t uHash) {
+    size_t uOldBucket;
+
+    assert(oSymTable != NULL);
+
+    if (oSymTable->ppsOldSymNode != NULL) {
+        uOldBucket = uHash & (oSymTable->uBucketCount / 2 - 1);
+        if (oSymTable->psStripes != NULL) {
+            if (oSymTable->ppsOldSymNode[uOldBucket] != FORWARD_NODE) {
+                return &oSymTable->ppsOldSymNode[uOldBucket];
+            }
+        } else if (uOldBucket >= oSymTable->uMigrated) {
+            return &oSymTable->ppsOldSymNode[uOldBucket];
+        }
+    }
+    return &oSymTable->ppsSymNode[uHash & (oSymTable->uBucketCount - 1)];
+}
+
+/* Helper expand function */
+int SymTable_expand(SymTable_T oSymTable) {
+    struct Node** ppsNewSymNode;
+    size_t uNewBucketCount;
+
+    assert(oSymTable != NULL);
+
+    if (oSymTable->uBucketCount >= MAX_BUCKET_COUNT) {
+        return 0;
+    }
+
+    /* Allocate memory for new bucket array */
+    uNewBucketCount = oSymTable->uBucketCount * 2;
+    ppsNewSymNode = (struct Node**)calloc(uNewBucketCount, sizeof(struct Node*));
+    if (ppsNewSymNode == NULL) {
+        return 0;
+    }
+
+    /* Only two bucket arrays are live at a time */
+    if (oSymTable->ppsOldSymNode != NULL) {
+        SymTable_migrate(oSymTable, oSymTable->uBucketCount / 2);
+    }
+
+    oSymTable->ppsOldSymNode = oSymTable->ppsSymNode;
+    oSymTable->ppsSymNode = ppsNewSymNode;
+    oSymTable->uMigrated = 0;
+    oSymTable->uBucketCount = uNewBucketCount;
+    oSymTable->uResizeCount++;
+
+#ifdef SYMTABLE_FULL_REHASH
+    SymTable_migrate(oSymTable, oSymTable->uBucketCount / 2);
+#endif
+    return 1;
+}
+
+/* Helper bucket count function */
+size_t SymTable_bucketCountFor(size_t uBindingCount) {
+    size_t uBucketCount = INITIAL_BUCKET_COUNT;
+
+    while (uBucketCount < uBindingCount && uBucketCount < MAX_BUCKET_COUNT) {
+        uBucketCount *= 2;
+    }
+    return uBucketCount;
+}
+
+/* Helper grow-to function */
+int SymTable_growTo(SymTable_T oSymTable, size_t uBindingCount) {
+    size_t uNewBucketCount;
+
+    assert(oSymTable != NULL);
+
+    if (SymTable_isSmall(oSymTable) && uBindingCount <= SMALL_NODE_COUNT) {
+        return 1;
+    }
+    uNewBucketCount = SymTable_bucketCountFor(uBindingCount);
+    if (uNewBucketCount <= oSymTable->uBucketCount) {
+        return 1;
+    }
+    return SymTable_rebuild(oSymTable, uNewBucketCount, 0);
+}
+
+/* Helper rebuild function */
+int SymTable_rebuild(SymTable_T oSymTable, size_t uNewBucketCount, int iCompact) {
+    struct Node** ppsNewSymNode;
+    struct Arena* psNewArenas = NULL;
+    struct Arena* psArena;
+    struct BucketArray* psNewPublished = NULL;
+    struct Node* psCurrentNode;
+    struct Node* psNextNode;
+    struct Node* psNewNode;
+    size_t uArenaCount;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(uNewBucketCount > 0 && (uNewBucketCount & (uNewBucketCount - 1)) == 0);
+
+    /* A growing concurrent table must finish growing first, as its old buckets can only be
+    forwarded into one new array */
+    if (oSymTable->psStripes != NULL && oSymTable->ppsOldSymNode != NULL &&
+            !SymTable_finishTransfer(oSymTable)) {
+        return 0;
+    }
+
+    ppsNewSymNode = (struct Node**)calloc(uNewBucketCount, sizeof(struct Node*));
+    if (ppsNewSymNode == NULL) {
+        return 0;
+    }
+
+    /* Lookups may be walking the chains of a concurrent table, so its nodes are copied rather
+    than relinked, each stripe into an arena of its own */
+    uArenaCount = 1;
+    if (oSymTable->psStripes != NULL) {
+        uArenaCount = STRIPE_COUNT;
+        iCompact = 1;
+        psNewPublished = (struct BucketArray*)malloc(sizeof(struct BucketArray));
+        if (psNewPublished == NULL) {
+            free(ppsNewSymNode);
+            return 0;
+        }
+    }
+    if (iCompact) {
+        psNewArenas = (struct Arena*)calloc(uArenaCount, sizeof(struct Arena));
+        if (psNewArenas == NULL) {
+            free(psNewPublished);
+            free(ppsNewSymNode);
+            return 0;
+        }
+    }
+
+    /* Every bucket is about to move, so there is no point moving the old ones in steps */
+    if (oSymTable->ppsOldSymNode != NULL) {
+        SymTable_migrate(oSymTable, oSymTable->uBucketCount / 2);
+    }
+
+    for (i = 0; i < oSymTable->uBucketCount; i++) {
+        for (psCurrentNode = oSymTable->ppsSymNode[i];
+                psCurrentNode != NULL;
+                psCurrentNode = psNextNode) {
+            psNextNode = psCurrentNode->psNextNode;
+            psNewNode = psCurrentNode;
+
+            /* A copy is linked only into the new array, so on failure the old array and
+            arena are still intact */
+            if (iCompact) {
+                psNewNode = SymTable_copyNode(
+                    &psNewArenas[psCurrentNode->uHash & (uArenaCount - 1)], psCurrentNode);
+                if (psNewNode == NULL) {
+                    for (i = 0; i < uArenaCount; i++) {
+                        SymTable_arenaFree(&psNewArenas[i]);
+                    }
+                    free(psNewArenas);
+                    free(psNewPublished);
+                    free(ppsNewSymNode);
+                    return 0;
+                }
+            }
+            SymTable_insert(ppsNewSymNode, psNewNode,
+                psNewNode->uHash & (uNewBucketCount - 1));
+        }
+    }
+
+    /* Once no lookup can see the old array, it and the old arenas, with the nodes in limbo,
+    can go */
+    if (psNewPublished != NULL) {
+        psNewPublished->ppsBuckets = ppsNewSymNode;
+        psNewPublished->uBucketCount = uNewBucketCount;
+        psNewPublished->psNextArray = NULL;
+        psNewPublished = __atomic_exchange_n(&oSymTable->psPublished, psNewPublished,
+            __ATOMIC_ACQ_REL);
+        SymTable_synchronize(oSymTable);
+        free(psNewPublished);
+        for (i = 0; i < STRIPE_COUNT; i++) {
+            oSymTable->psStripes[i].uLimboCount = 0;
+        }
+    }
+    if (iCompact) {
+        for (i = 0; i < uArenaCount; i++) {
+            psArena = SymTable_arena(oSymTable, i);
+            SymTable_arenaFree(psArena);
+            *psArena = psNewArenas[i];
+        }
+        free(psNewArenas);
+    }
+    if (!SymTable_isSmall(oSymTable)) {
+        free(oSymTable->ppsSymNode);
+    }
+    oSymTable->ppsSymNode = ppsNewSymNode;
+    oSymTable->uBucketCount = uNewBucketCount;
+    oSymTable->uResizeCount++;
+    return 1;
+}
+
+/* Helper is-small function */
+int SymTable_isSmall(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+    return oSymTable->ppsSymNode == &oSymTable->psSmallBucket;
+}
+
+/* Helper is-sparse function */
+int SymTable_isSparse(SymTable_T oSymTable) {
+    size_t uLength;
+
+    assert(oSymTable != NULL);
+
+    uLength = SymTable_getLength(oSymTable);
+    return uLength * SHRINK_DIVISOR < oSymTable->uBucketCount &&
+        oSymTable->uBucketCount > oSymTable->uMinBucketCount;
+}
+
+#ifndef SYMTABLE_NO_AUTO_SHRINK
+/* Helper shrink function */
+void SymTable_shrink(SymTable_T oSymTable) {
+    size_t uNewBucketCount;
+
+    assert(oSymTable != NULL);
+
+    uNewBucketCount = SymTable_bucketCountFor(oSymTable->length * 2);
+    if (uNewBucketCount < oSymTable->uMinBucketCount) {
+        uNewBucketCount = oSymTable->uMinBucketCount;
+    }
+    (void)SymTable_rebuild(oSymTable, uNewBucketCount, 0);
+}
+#endif
+
+/* Helper length function */
+void SymTable_addLength(SymTable_T oSymTable, int iDelta) {
+    assert(oSymTable != NULL);
+    assert(iDelta == 1 || iDelta == -1);
+
+    /* Threads holding different stripes may add and remove bindings at the same time */
+    if (oSymTable->psStripes != NULL) {
+        if (iDelta > 0) {
+            __atomic_add_fetch(&oSymTable->length, 1, __ATOMIC_RELAXED);
+        } else {
+            __atomic_sub_fetch(&oSymTable->length, 1, __ATOMIC_RELAXED);
+        }
+    } else if (iDelta > 0) {
+        (oSymTable->length)++;
+    } else {
+        (oSymTable->length)--;
+    }
+}
+
+/* Helper arena function */
+struct Arena* SymTable_arena(SymTable_T oSymTable, size_t uHash) {
+    assert(oSymTable != NULL);
+
+    if (oSymTable->psStripes != NULL) {
+        return &oSymTable->psStripes[uHash & (STRIPE_COUNT - 1)].sArena;
+    }
+    return &oSymTable->sArena;
+}
+
+/* Helper lock function */
+void SymTable_lock(SymTable_T oSymTable, size_t uHash) {
+    SymTable_lockStripe(oSymTable, uHash, 0);
+}
+
+/* Helper lock-for-add function */
+void SymTable_lockForAdd(SymTable_T oSymTable, size_t uHash) {
+    SymTable_lockStripe(oSymTable, uHash, 1);
+}
+
+/* Helper stripe lock function */
+void SymTable_lockStripe(SymTable_T oSymTable, size_t uHash, int iAdding) {
+    int iFull;
+    int iSwitch;
+
+    assert(oSymTable != NULL);
+
+    if (oSymTable->psStripes == NULL) {
+        return;
+    }
+
+    /* The thread that copies the last old bucket finishes growing. A table whose copying has
+    stalled for lack of memory tries again once it fills up. */
+    pthread_rwlock_rdlock(&oSymTable->sResizeLock);
+    iFull = iAdding && SymTable_getLength(oSymTable) > oSymTable->uBucketCount &&
+        oSymTable->uBucketCount < MAX_BUCKET_COUNT;
+    if (oSymTable->ppsOldSymNode != NULL) {
+        iSwitch = SymTable_helpTransfer(oSymTable) || iFull;
+    } else {
+        iSwitch = iFull;
+    }
+
+    /* Other threads may have started or finished growing while the lock was released. If
+    growing cannot start, the table keeps working at its current size. */
+    if (iSwitch) {
+        pthread_rwlock_unlock(&oSymTable->sResizeLock);
+        pthread_rwlock_wrlock(&oSymTable->sResizeLock);
+        if (oSymTable->ppsOldSymNode != NULL) {
+            (void)SymTable_finishTransfer(oSymTable);
+        } else if (oSymTable->length > oSymTable->uBucketCount &&
+                oSymTable->uBucketCount < MAX_BUCKET_COUNT &&
+                SymTable_startTransfer(oSymTable)) {
+#ifdef SYMTABLE_FULL_REHASH
+            (void)SymTable_finishTransfer(oSymTable);
+#endif
+        }
+        pthread_rwlock_unlock(&oSymTable->sResizeLock);
+        pthread_rwlock_rdlock(&oSymTable->sResizeLock);
+    }
+    pthread_mutex_lock(&oSymTable->psStripes[uHash & (STRIPE_COUNT - 1)].sLock);
+}
+
+/* Helper unlock function */
+void SymTable_unlock(SymTable_T oSymTable, size_t uHash) {
+    assert(oSymTable != NULL);
+
+    if (oSymTable->psStripes != NULL) {
+        pthread_mutex_unlock(&oSymTable->psStripes[uHash & (STRIPE_COUNT - 1)].sLock);
+        pthread_rwlock_unlock(&oSymTable->sResizeLock);
+    }
+}
+
+/* Helper lock-all function */
+void SymTable_lockAll(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    if (oSymTable->psStripes != NULL) {
+        pthread_rwlock_wrlock(&oSymTable->sResizeLock);
+        if (oSymTable->ppsOldSymNode != NULL) {
+            (void)SymTable_finishTransfer(oSymTable);
+        }
+    }
+}
+
+/* Helper unlock-all function */
+void SymTable_unlockAll(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    if (oSymTable->psStripes != NULL) {
+        pthread_rwlock_unlock(&oSymTable->sResizeLock);
+    }
+}
+
+/* Helper lock-free read function */
+int SymTable_read(SymTable_T oSymTable, const char *pcKey, size_t uLength,
+    size_t uHash, void **ppvValue) {
+    struct ReaderSlot* psSlot;
+    struct BucketArray* psPublished;
+    struct Node* psCurrentNode;
+    size_t uParity;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->psStripes != NULL);
+    assert(pcKey != NULL);
+    assert(ppvValue != NULL);
+
+    uParity = SymTable_enterRead(oSymTable, &psSlot);
+
+    /* While the table grows, a forwarded bucket's bindings are in the next array */
+    psPublished = __atomic_load_n(&oSymTable->psPublished, __ATOMIC_ACQUIRE);
+    for (;;) {
+        psCurrentNode = __atomic_load_n(
+            &psPublished->ppsBuckets[uHash & (psPublished->uBucketCount - 1)],
+            __ATOMIC_ACQUIRE);
+        if (psCurrentNode != FORWARD_NODE) {
+            break;
+        }
+        psPublished = __atomic_load_n(&psPublished->psNextArray, __ATOMIC_ACQUIRE);
+    }
+    for (;
+            psCurrentNode != NULL;
+            psCurrentNode = __atomic_load_n(&psCurrentNode->psNextNode, __ATOMIC_ACQUIRE)) {
+        SymTable_count(oSymTable, uCompares, 1);
+        if (psCurrentNode->uHash == uHash && psCurrentNode->uLength == uLength &&
+                memcmp(psCurrentNode->pcKey, pcKey, uLength) == 0) {
+            *ppvValue = __atomic_load_n(&psCurrentNode->pvValue, __ATOMIC_ACQUIRE);
+            break;
+        }
+    }
+    SymTable_exitRead(psSlot, uParity);
+
+    if (psCurrentNode != NULL) {
+        SymTable_count(oSymTable, uHits, 1);
+    } else {
+        SymTable_count(oSymTable, uMisses, 1);
+    }
+    return psCurrentNode != NULL;
+}
+
+/* Helper enter-read function */
+size_t SymTable_enterRead(SymTable_T oSymTable, struct ReaderSlot **ppsSlot) {
+    struct ReaderSlot* psSlot;
+    size_t uEpoch;
+    char cOnStack;
+
+    assert(oSymTable != NULL);
+    assert(ppsSlot != NULL);
+
+    /* The stacks of different threads are far apart, so a hash of the bits above a thread's
+    stack depth spreads threads over the slots */
+    psSlot = &oSymTable->psReaderSlots[
+        (size_t)(((uint64_t)((uintptr_t)&cOnStack >> 16) * 0x9E3779B97F4A7C15ULL) >> 32) %
+        READER_SLOT_COUNT];
+    *ppsSlot = psSlot;
+
+    /* If the epoch advanced before the lookup was counted, the grace period that advanced it
+    may not have seen the count, so count it again under the new epoch */
+    for (;;) {
+        uEpoch = __atomic_load_n(&oSymTable->uEpoch, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&psSlot->auReaders[uEpoch & 1], 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&oSymTable->uEpoch, __ATOMIC_SEQ_CST) == uEpoch) {
+            return uEpoch & 1;
+        }
+        __atomic_sub_fetch(&psSlot->auReaders[uEpoch & 1], 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+/* Helper exit-read function */
+void SymTable_exitRead(struct ReaderSlot *psSlot, size_t uParity) {
+    assert(psSlot != NULL);
+    __atomic_sub_fetch(&psSlot->auReaders[uParity], 1, __ATOMIC_RELEASE);
+}
+
+/* Helper synchronize function */
+void SymTable_synchronize(SymTable_T oSymTable) {
+    size_t uEpoch;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+
+    /* A lookup counted under the old epoch may have seen what the caller unlinked; one that
+    began later sees the new epoch, and so the unlinking before it */
+    pthread_mutex_lock(&oSymTable->sEpochLock);
+    uEpoch = oSymTable->uEpoch;
+    __atomic_store_n(&oSymTable->uEpoch, uEpoch + 1, __ATOMIC_SEQ_CST);
+    for (i = 0; i < READER_SLOT_COUNT; i++) {
+        while (__atomic_load_n(&oSymTable->psReaderSlots[i].auReaders[uEpoch & 1],
+                __ATOMIC_SEQ_CST) != 0) {
+            sched_yield();
+        }
+    }
+    pthread_mutex_unlock(&oSymTable->sEpochLock);
+}
+
+/* Helper retire function */
+void SymTable_retire(SymTable_T oSymTable, size_t uHash, struct Node *psNode) {
+    struct Stripe* psStripe;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->psStripes != NULL);
+    assert(psNode != NULL);
+
+    psStripe = &oSymTable->psStripes[uHash & (STRIPE_COUNT - 1)];
+    psStripe->apsLimbo[psStripe->uLimboCount++] = psNode;
+    if (psStripe->uLimboCount < LIMBO_SIZE) {
+        return;
+    }
+
+    SymTable_synchronize(oSymTable);
+    for (i = 0; i < LIMBO_SIZE; i++) {
+        SymTable_freeBinding(&psStripe->sArena, psStripe->apsLimbo[i]);
+    }
+    psStripe->uLimboCount = 0;
+}
+
+/* Helper start-transfer function */
+int SymTable_startTransfer(SymTable_T oSymTable) {
+    struct Node** ppsNewSymNode;
+    struct BucketArray* psNewPublished;
+    size_t uNewBucketCount;
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->psStripes != NULL);
+    assert(oSymTable->ppsOldSymNode == NULL);
+
+    if (oSymTable->uBucketCount >= MAX_BUCKET_COUNT) {
+        return 0;
+    }
+
+    uNewBucketCount = oSymTable->uBucketCount * 2;
+    ppsNewSymNode = (struct Node**)calloc(uNewBucketCount, sizeof(struct Node*));
+    psNewPublished = (struct BucketArray*)malloc(sizeof(struct BucketArray));
+    if (ppsNewSymNode == NULL || psNewPublished == NULL) {
+        free(ppsNewSymNode);
+        free(psNewPublished);
+        return 0;
+    }
+    psNewPublished->ppsBuckets = ppsNewSymNode;
+    psNewPublished->uBucketCount = uNewBucketCount;
+    psNewPublished->psNextArray = NULL;
+    __atomic_store_n(&oSymTable->psPublished->psNextArray, psNewPublished, __ATOMIC_RELEASE);
+
+    oSymTable->ppsOldSymNode = oSymTable->ppsSymNode;
+    oSymTable->ppsSymNode = ppsNewSymNode;
+    oSymTable->uBucketCount = uNewBucketCount;
+    oSymTable->uTransferIndex = 0;
+    oSymTable->uTransferDone = 0;
+    oSymTable->uResizeCount++;
+    return 1;
+}
+
+/* Helper help-transfer function */
+int SymTable_helpTransfer(SymTable_T oSymTable) {
+    size_t uOldBucketCount;
+    size_t uStart;
+    size_t uEnd;
+    size_t uDone = 0;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->ppsOldSymNode != NULL);
+
+    uOldBucketCount = oSymTable->uBucketCount / 2;
+    uStart = __atomic_fetch_add(&oSymTable->uTransferIndex, TRANSFER_STEP, __ATOMIC_RELAXED);
+    if (uStart >= uOldBucketCount) {
+        return 0;
+    }
+    uEnd = uStart + TRANSFER_STEP;
+    if (uEnd > uOldBucketCount) {
+        uEnd = uOldBucketCount;
+    }
+
+    for (i = uStart; i < uEnd; i++) {
+        uDone += SymTable_transferBucket(oSymTable, i);
+    }
+    return __atomic_add_fetch(&oSymTable->uTransferDone, uDone, __ATOMIC_ACQ_REL) ==
+        uOldBucketCount;
+}
+
+/* Helper transfer-bucket function */
+int SymTable_transferBucket(SymTable_T oSymTable, size_t uBucket) {
+    struct Stripe* psStripe;
+    struct Node* apsHeads[2] = {NULL, NULL};
+    struct Node* psCurrentNode;
+    struct Node* psNextNode;
+    struct Node* psNewNode;
+    size_t uOldBucketCount;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->ppsOldSymNode != NULL);
+
+    uOldBucketCount = oSymTable->uBucketCount / 2;
+    psStripe = &oSymTable->psStripes[uBucket & (STRIPE_COUNT - 1)];
+    pthread_mutex_lock(&psStripe->sLock);
+    if (oSymTable->ppsOldSymNode[uBucket] == FORWARD_NODE) {
+        pthread_mutex_unlock(&psStripe->sLock);
+        return 1;
+    }
+
+    /* Lookups may be walking the old chain, so its nodes are copied rather than relinked. The
+    bindings of the old bucket go to two new ones, told apart by the next bit of their hash. */
+    for (psCurrentNode = oSymTable->ppsOldSymNode[uBucket];
+            psCurrentNode != NULL;
+            psCurrentNode = psCurrentNode->psNextNode) {
+        psNewNode = SymTable_copyNode(&psStripe->sArena, psCurrentNode);
+        if (psNewNode == NULL) {
+            for (i = 0; i < 2; i++) {
+                for (psNewNode = apsHeads[i]; psNewNode != NULL; psNewNode = psNextNode) {
+                    psNextNode = psNewNode->psNextNode;
+                    SymTable_freeBinding(&psStripe->sArena, psNewNode);
+                }
+            }
+            pthread_mutex_unlock(&psStripe->sLock);
+            return 0;
+        }
+        i = (psCurrentNode->uHash & uOldBucketCount) != 0;
+        psNewNode->psNextNode = apsHeads[i];
+        apsHeads[i] = psNewNode;
+    }
+
+    /* Nothing reaches the two new buckets before the old one is forwarded, so they are empty */
+    oSymTable->ppsSymNode[uBucket] = apsHeads[0];
+    oSymTable->ppsSymNode[uBucket + uOldBucketCount] = apsHeads[1];
+    psCurrentNode = oSymTable->ppsOldSymNode[uBucket];
+    __atomic_store_n(&oSymTable->ppsOldSymNode[uBucket], FORWARD_NODE, __ATOMIC_RELEASE);
+
+    for (; psCurrentNode != NULL; psCurrentNode = psNextNode) {
+        psNextNode = psCurrentNode->psNextNode;
+        SymTable_retire(oSymTable, psCurrentNode->uHash, psCurrentNode);
+    }
+    pthread_mutex_unlock(&psStripe->sLock);
+    return 1;
+}
+
+/* Helper finish-transfer function */
+int SymTable_finishTransfer(SymTable_T oSymTable) {
+    struct BucketArray* psOldPublished;
+    size_t uOldBucketCount;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->ppsOldSymNode != NULL);
+
+    /* Copy whatever the helpers have not, such as buckets they had no memory for */
+    uOldBucketCount = oSymTable->uBucketCount / 2;
+    if (oSymTable->uTransferDone < uOldBucketCount) {
+        for (i = 0; i < uOldBucketCount; i++) {
+            if (!SymTable_transferBucket(oSymTable, i)) {
+                return 0;
+            }
+        }
+    }
+
+    psOldPublished = oSymTable->psPublished;
+    __atomic_store_n(&oSymTable->psPublished, psOldPublished->psNextArray, __ATOMIC_RELEASE);
+    SymTable_synchronize(oSymTable);
+    free(psOldPublished);
+    free(oSymTable->ppsOldSymNode);
+    oSymTable->ppsOldSymNode = NULL;
+    oSymTable->uTransferIndex = 0;
+    oSymTable->uTransferDone = 0;
+    return 1;
+}
+
+/* Helper migrate function */
+void SymTable_migrate(SymTable_T oSymTable, size_t uBucketCount) {
+    struct Node* psCurrentNode;
+    struct Node* psNextNode;
+    size_t uOldBucketCount;
+    size_t uNewBucketCount;
+    size_t uEnd;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(oSymTable->ppsOldSymNode != NULL);
+
+    uOldBucketCount = oSymTable->uBucketCount / 2;
+    uNewBucketCount = oSymTable->uBucketCount;
+    uEnd = oSymTable->uMigrated + uBucketCount;
+    if (uEnd > uOldBucketCount) {
+        uEnd = uOldBucketCount;
+    }
+
+    /* Relink every node of these old buckets into the new array, using its cached hash. The
+    nodes themselves stay where they are. */
+    for (i = oSymTable->uMigrated; i < uEnd; i++) {
+        for (psCurrentNode = oSymTable->ppsOldSymNode[i];
+                psCurrentNode != NULL;
+                psCurrentNode = psNextNode) {
+            psNextNode = psCurrentNode->psNextNode;
+            SymTable_insert(oSymTable->ppsSymNode, psCurrentNode,
+                psCurrentNode->uHash & (uNewBucketCount - 1));
+        }
+    }
+    oSymTable->uMigrated = uEnd;
+
+    if (uEnd == uOldBucketCount) {
+        free(oSymTable->ppsOldSymNode);
+        oSymTable->ppsOldSymNode = NULL;
+        oSymTable->uMigrated = 0;
+    }
+}
+
+/* Helper function that rounds uSize up to a multiple of ARENA_ALIGNMENT */
+static size_t SymTable_arenaRound(size_t uSize) {
+    return (uSize + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+/* Helper function that allocates a slab with uSize usable bytes and links it at the front of
+the slab list of psArena. Returns the address of its usable bytes or NULL if there is
+insufficient memory. */
+static char* SymTable_arenaAddSlab(struct Arena *psArena, size_t uSize) {
+    struct Slab* psSlab;
+
+    assert(psArena != NULL);
+
+    /* The header is rounded up so that the usable bytes stay aligned */
+    psSlab = (struct Slab*)malloc(SymTable_arenaRound(sizeof(struct Slab)) + uSize);
+    if (psSlab == NULL) {
+        return NULL;
+    }
+
+    psSlab->psPrevSlab = NULL;
+    psSlab->psNextSlab = psArena->psSlabs;
+    if (psArena->psSlabs != NULL) {
+        psArena->psSlabs->psPrevSlab = psSlab;
+    }
+    psArena->psSlabs = psSlab;
+    return (char*)psSlab + SymTable_arenaRound(sizeof(struct Slab));
+}
+
+/* Helper arena carve function */
+void* SymTable_arenaCarve(struct Arena *psArena, struct Region *psRegion, size_t uSize) {
+    void* pvChunk;
+
+    assert(psArena != NULL);
+    assert(psRegion != NULL);
+    assert(uSize % ARENA_ALIGNMENT == 0 && uSize <= ARENA_MIN_SLAB_SIZE);
+
+    /* Start a new slab when the region's is used up; its leftover bytes go unused */
+    if (uSize > psRegion->uRemaining) {
+        size_t uSlabSize = psArena->uSlabSize != 0 ? psArena->uSlabSize : ARENA_MIN_SLAB_SIZE;
+        char* pcSlab = SymTable_arenaAddSlab(psArena, uSlabSize);
+        if (pcSlab == NULL) {
+            return NULL;
+        }
+        psRegion->pcNext = pcSlab;
+        psRegion->uRemaining = uSlabSize;
+        psArena->uSlabSize = uSlabSize < ARENA_MAX_SLAB_SIZE ? 2 * uSlabSize : uSlabSize;
+    }
+
+    pvChunk = psRegion->pcNext;
+    psRegion->pcNext += uSize;
+    psRegion->uRemaining -= uSize;
+    return pvChunk;
+}
+
+/* Helper binding free function */
+void SymTable_freeBinding(struct Arena *psArena, struct Node *psNode) {
+    assert(psArena != NULL);
+    assert(psNode != NULL);
+
+    if (psNode->pcKey != psNode->acInline) {
+        SymTable_freeKey(psArena, (char*)psNode->pcKey, psNode->uLength);
+    }
+    SymTable_freeNode(psArena, psNode);
+}
+
+/* Helper node copy function */
+struct Node* SymTable_copyNode(struct Arena *psArena, const struct Node *psNode) {
+    struct Node* psNewNode;
+
+    assert(psArena != NULL);
+    assert(psNode != NULL);
+
+    psNewNode = SymTable_allocNode(psArena);
+    if (psNewNode == NULL) {
+        return NULL;
+    }
+    *psNewNode = *psNode;
+    if (psNode->pcKey == psNode->acInline) {
+        psNewNode->pcKey = psNewNode->acInline;
+    } else {
+        psNewNode->pcKey = SymTable_copyKey(psArena, psNode->pcKey, psNode->uLength);
+        if (psNewNode->pcKey == NULL) {
+            SymTable_freeNode(psArena, psNewNode);
+            return NULL;
+        }
+    }
+    return psNewNode;
+}
+
+/* Helper node allocation function */
+struct Node* SymTable_allocNode(struct Arena *psArena) {
+    struct FreeChunk* psChunk;
+
+    assert(psArena != NULL);
+
+    psChunk = psArena->psFreeNodes;
+    if (psChunk != NULL) {
+        psArena->psFreeNodes = psChunk->psNextChunk;
+        return (struct Node*)psChunk;
+    }
+    return (struct Node*)SymTable_arenaCarve(psArena, &psArena->sNodes,
+        SymTable_arenaRound(sizeof(struct Node)));
+}
+
+/* Helper node free function */
+void SymTable_freeNode(struct Arena *psArena, struct Node *psNode) {
+    struct FreeChunk* psChunk = (struct FreeChunk*)psNode;
+
+    assert(psArena != NULL);
+    assert(psNode != NULL);
+
+    psChunk->psNextChunk = psArena->psFreeNodes;
+    psArena->psFreeNodes = psChunk;
+}
+
+/* Helper key copy function */
+char* SymTable_copyKey(struct Arena *psArena, const char *pcKey, size_t uLength) {
+    char* pcKeyCopy;
+    size_t uSize;
+
+    assert(psArena != NULL);
+    assert(pcKey != NULL);
+
+    uSize = SymTable_arenaRound(uLength + 1);
+    if (uSize > ARENA_MAX_KEY_CHUNK) {
+        pcKeyCopy = SymTable_arenaAddSlab(psArena, uLength + 1);
+    } else if (psArena->apsFreeKeys[uSize / ARENA_ALIGNMENT - 1] != NULL) {
+        struct FreeChunk* psChunk = psArena->apsFreeKeys[uSize / ARENA_ALIGNMENT - 1];
+        psArena->apsFreeKeys[uSize / ARENA_ALIGNMENT - 1] = psChunk->psNextChunk;
+        pcKeyCopy = (char*)psChunk;
+    } else {
+        pcKeyCopy = (char*)SymTable_arenaCarve(psArena, &psArena->sKeys, uSize);
+    }
+
+    if (pcKeyCopy == NULL) {
+        return NULL;
+    }
+    memcpy(pcKeyCopy, pcKey, uLength);
+    pcKeyCopy[uLength] = '\0';
+    return pcKeyCopy;
+}
+
+/* Helper key free function */
+void SymTable_freeKey(struct Arena *psArena, char *pcKey, size_t uLength) {
+    struct FreeChunk* psChunk;
+    size_t uSize;
+
+    assert(psArena != NULL);
+    assert(pcKey != NULL);
+
+    uSize = SymTable_arenaRound(uLength + 1);
+    if (uSize > ARENA_MAX_KEY_CHUNK) {
+        /* The key has a slab of its own, just before it; unlink and release that slab */
+        struct Slab* psSlab =
+            (struct Slab*)(pcKey - SymTable_arenaRound(sizeof(struct Slab)));
+        if (psSlab->psPrevSlab != NULL) {
+            psSlab->psPrevSlab->psNextSlab = psSlab->psNextSlab;
+        } else {
+            psArena->psSlabs = psSlab->psNextSlab;
+        }
+        if (psSlab->psNextSlab != NULL) {
+            psSlab->psNextSlab->psPrevSlab = psSlab->psPrevSlab;
+        }
+        free(psSlab);
+        return;
+    }
+
+    psChunk = (struct FreeChunk*)(void*)pcKey;
+    psChunk->psNextChunk = psArena->apsFreeKeys[uSize / ARENA_ALIGNMENT - 1];
+    psArena->apsFreeKeys[uSize / ARENA_ALIGNMENT - 1] = psChunk;
+}
+
+/* Helper arena free function */
+void SymTable_arenaFree(struct Arena *psArena) {
+    struct Slab* psSlab;
+    struct Slab* psNextSlab;
+
+    assert(psArena != NULL);
+
+    for (psSlab = psArena->psSlabs; psSlab != NULL; psSlab = psNextSlab) {
+        psNextSlab = psSlab->psNextSlab;
+        free(psSlab);
+    }
+    psArena->psSlabs = NULL;
+}
+
+/* Helper chain statistics function */
+void SymTable_addChainStats(struct Node *psNode, SymTable_Stats *psStats) {
+    size_t uChainLength = 0;
+
+    assert(psStats != NULL);
+
+    for (; psNode != NULL && psNode != FORWARD_NODE; psNode = psNode->psNextNode) {
+        psStats->uNodeBytes += SymTable_arenaRound(sizeof(struct Node));
+        if (psNode->pcKey != psNode->acInline) {
+            psStats->uKeyBytes += SymTable_arenaRound(psNode->uLength + 1);
+        }
+        uChainLength++;
+    }
+
+    psStats->auHistogram[uChainLength < SYMTABLE_HISTOGRAM_SIZE ?
+        uChainLength : SYMTABLE_HISTOGRAM_SIZE - 1]++;
+    if (uChainLength > psStats->uLongest) {
+        psStats->uLongest = uChainLength;
+    }
 }
-  
\ No newline at end of file
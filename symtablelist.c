@@ -10,9 +10,12 @@ Author: Tinney Mak */
 /* Each Node contains a binding, consisting of a key and value. Nodes are linked
 to form a list. */
 struct Node {
-    /* The key */
+    /* The key, followed by a '\0' */
     const char* pcKey;
 
+    /* The length of the key */
+    size_t uLength;
+
     /* The value */
     void* pvValue;
 
@@ -26,8 +29,34 @@ struct SymTable {
     struct Node* psFirstNode;
     /* The number of the bindings in the symbol table */
     size_t length;
+#ifdef SYMTABLE_STATS
+    /* The operation counters of SymTable_getStats */
+    size_t uHits;
+    size_t uMisses;
+    size_t uCompares;
+#endif
 };
 
+/* Adds uAmount to the operation counter uCounter of oSymTable in a build with SYMTABLE_STATS
+defined, and does nothing otherwise */
+#ifdef SYMTABLE_STATS
+#define SymTable_count(oSymTable, uCounter, uAmount) ((oSymTable)->uCounter += (uAmount))
+#else
+#define SymTable_count(oSymTable, uCounter, uAmount) ((void)0)
+#endif
+
+/* Helper function that returns the address of the link (the first-node pointer or a psNextNode
+field) that points to the node of oSymTable whose key is the uLength bytes at pcKey, or to the
+NULL ending the list if there is none.*/
+static struct Node** SymTable_find(SymTable_T oSymTable, const char *pcKey, size_t uLength);
+
+/* Helper function that returns the node of oSymTable whose key is the uLength bytes at pcKey,
+first adding a new binding of that key to pvValue if there is none. Sets *piAdded to 1 if the
+binding was added and 0 otherwise. Returns NULL if there is insufficient memory, leaving
+oSymTable unchanged.*/
+static struct Node* SymTable_findOrAdd(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, const void *pvValue, int *piAdded);
+
 SymTable_T SymTable_new(void) {
     SymTable_T oSymTable;
 
@@ -41,6 +70,36 @@ SymTable_T SymTable_new(void) {
     return oSymTable;
 }
 
+SymTable_T SymTable_newWithHash(SymTable_HashFunction pfHash, size_t uSeed) {
+    /* A list does not hash its keys */
+    (void)pfHash;
+    (void)uSeed;
+    return SymTable_new();
+}
+
+SymTable_T SymTable_newWithCapacity(size_t uCapacity) {
+    /* A list has nothing to size */
+    (void)uCapacity;
+    return SymTable_new();
+}
+
+SymTable_T SymTable_newConcurrent(void) {
+    /* A list has no buckets to guard separately */
+    return NULL;
+}
+
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity) {
+    assert(oSymTable != NULL);
+    (void)uCapacity;
+    return 1;
+}
+
+int SymTable_shrinkToFit(SymTable_T oSymTable) {
+    /* Each node is freed as soon as its binding is removed */
+    assert(oSymTable != NULL);
+    return 1;
+}
+
 void SymTable_free(SymTable_T oSymTable) {
     struct Node* psCurrentNode;
     struct Node* psNextNode;
@@ -64,144 +123,252 @@ size_t SymTable_getLength(SymTable_T oSymTable) {
     return oSymTable->length;
 }
 
+size_t SymTable_getBucketCount(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+    return 1;
+}
+
+void SymTable_getStats(SymTable_T oSymTable, SymTable_Stats *psStats) {
+    struct Node* psCurrentNode;
+
+    assert(oSymTable != NULL);
+    assert(psStats != NULL);
+
+    memset(psStats, 0, sizeof(SymTable_Stats));
+
+    /* The whole list is one chain that never moves, and has no bucket array */
+    psStats->uLength = oSymTable->length;
+    psStats->uBucketCount = 1;
+    psStats->dLoadFactor = (double)oSymTable->length;
+    if (oSymTable->length < SYMTABLE_HISTOGRAM_SIZE) {
+        psStats->auHistogram[oSymTable->length] = 1;
+    } else {
+        psStats->auHistogram[SYMTABLE_HISTOGRAM_SIZE - 1] = 1;
+    }
+    psStats->uLongest = oSymTable->length;
+
+    for (psCurrentNode = oSymTable->psFirstNode;
+            psCurrentNode != NULL;
+            psCurrentNode = psCurrentNode->psNextNode) {
+        psStats->uNodeBytes += sizeof(struct Node);
+        psStats->uKeyBytes += psCurrentNode->uLength + 1;
+    }
+
+#ifdef SYMTABLE_STATS
+    psStats->uHits = oSymTable->uHits;
+    psStats->uMisses = oSymTable->uMisses;
+    psStats->uCompares = oSymTable->uCompares;
+#endif
+}
+
 int SymTable_put(SymTable_T oSymTable, 
     const char *pcKey, const void *pvValue) {
-        struct Node* psNewNode;
+        assert(pcKey != NULL);
+        return SymTable_putN(oSymTable, pcKey, strlen(pcKey), pvValue);
+}
+
+int SymTable_putN(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength, const void *pvValue) {
+        struct Node* psNode;
+        int iAdded;
 
         assert(oSymTable != NULL);
         assert(pcKey != NULL);
 
-        if (SymTable_contains(oSymTable, pcKey) == 1) {
-            return 0;
-        }
+        psNode = SymTable_findOrAdd(oSymTable, pcKey, uLength, pvValue, &iAdded);
+        return (psNode != NULL) && iAdded;
+}
 
-        psNewNode = (struct Node*)calloc(1, sizeof(struct Node));
-        if (psNewNode == NULL) {
-            return 0;
-        }
+void **SymTable_getOrPut(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue) {
+        struct Node* psNode;
+        int iAdded;
 
-        /* makes defensive copy of key */
-        psNewNode->pcKey = (char*)malloc(strlen(pcKey) + 1);
-        if (psNewNode->pcKey == NULL) {
-            free(psNewNode);
-            return 0;
+        assert(oSymTable != NULL);
+        assert(pcKey != NULL);
+
+        psNode = SymTable_findOrAdd(oSymTable, pcKey, strlen(pcKey), pvValue, &iAdded);
+        if (psNode == NULL) {
+            return NULL;
         }
+        return &psNode->pvValue;
+}
+
+int SymTable_upsert(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue) {
+        return SymTable_putOrReplace(oSymTable, pcKey, pvValue, NULL) >= 0;
+}
 
-        strcpy((void*)(psNewNode->pcKey), pcKey);
+int SymTable_putOrReplace(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue, void **ppvOldValue) {
+        struct Node* psNode;
+        int iAdded;
 
-        psNewNode->pvValue = (void*)pvValue;
-        psNewNode->psNextNode = oSymTable->psFirstNode;
-        oSymTable->psFirstNode = psNewNode;
+        assert(oSymTable != NULL);
+        assert(pcKey != NULL);
 
-        (oSymTable->length)++;
-        return 1;
+        psNode = SymTable_findOrAdd(oSymTable, pcKey, strlen(pcKey), pvValue, &iAdded);
+        if (psNode == NULL) {
+            return -1;
+        }
+        if (iAdded) {
+            return 1;
+        }
+
+        if (ppvOldValue != NULL) {
+            *ppvOldValue = psNode->pvValue;
+        }
+        psNode->pvValue = (void*)pvValue;
+        return 0;
 }
 
 void *SymTable_replace(SymTable_T oSymTable, 
     const char *pcKey, const void *pvValue) {
+        assert(pcKey != NULL);
+        return SymTable_replaceN(oSymTable, pcKey, strlen(pcKey), pvValue);
+}
+
+void *SymTable_replaceN(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength, const void *pvValue) {
         void* pvOldValue;
         struct Node* psCurrentNode;
 
         assert(oSymTable != NULL);
         assert(pcKey != NULL);
 
-        if (SymTable_contains(oSymTable, pcKey) == 0) {
+        psCurrentNode = *SymTable_find(oSymTable, pcKey, uLength);
+        if (psCurrentNode == NULL) {
             return NULL;
         }
 
-        for (psCurrentNode = oSymTable->psFirstNode;
-                psCurrentNode != NULL;
-                psCurrentNode = psCurrentNode->psNextNode) 
-        {
-            if (strcmp(psCurrentNode->pcKey, pcKey) == 0) {
-                pvOldValue = psCurrentNode->pvValue;
-                psCurrentNode->pvValue = (void*)pvValue;
-                return (void*)pvOldValue;
-            }
-        }
-        return NULL;
+        pvOldValue = psCurrentNode->pvValue;
+        psCurrentNode->pvValue = (void*)pvValue;
+        return pvOldValue;
 }
 
 int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
-    struct Node* psCurrentNode;
+    assert(pcKey != NULL);
+    return SymTable_containsN(oSymTable, pcKey, strlen(pcKey));
+}
 
+int SymTable_containsN(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    for (psCurrentNode = oSymTable->psFirstNode;
-            psCurrentNode != NULL;
-            psCurrentNode = psCurrentNode->psNextNode) 
-        {
-            if (strcmp(psCurrentNode->pcKey, pcKey) == 0) {
-                return 1;
-            }
-        }
-    return 0;
-
+    return *SymTable_find(oSymTable, pcKey, uLength) != NULL;
 }
 
 void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+    assert(pcKey != NULL);
+    return SymTable_getN(oSymTable, pcKey, strlen(pcKey));
+}
+
+void *SymTable_getN(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
     struct Node* psCurrentNode;
 
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    if (SymTable_contains(oSymTable, pcKey) == 0) {
-            return NULL;
-        }
-    
-    for (psCurrentNode = oSymTable->psFirstNode;
-            psCurrentNode != NULL;
-            psCurrentNode = psCurrentNode->psNextNode) 
-        {
-            if (strcmp(psCurrentNode->pcKey, pcKey) == 0) {
-                return (void*)psCurrentNode->pvValue;
-            }
-        }
-    return NULL;
+    psCurrentNode = *SymTable_find(oSymTable, pcKey, uLength);
+    if (psCurrentNode == NULL) {
+        return NULL;
+    }
+    return psCurrentNode->pvValue;
 }
 
 void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+    assert(pcKey != NULL);
+    return SymTable_removeN(oSymTable, pcKey, strlen(pcKey));
+}
+
+void *SymTable_removeN(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
     void* pvOldValue;
+    struct Node** ppsLink;
     struct Node* psCurrentNode;
-    struct Node* psNextNode;
-    struct Node* psPreviousNode;
     
     assert(oSymTable != NULL);
     assert(pcKey != NULL);
 
-    if (SymTable_contains(oSymTable, pcKey) == 0) {
-            return NULL;
+    ppsLink = SymTable_find(oSymTable, pcKey, uLength);
+    psCurrentNode = *ppsLink;
+    if (psCurrentNode == NULL) {
+        return NULL;
+    }
+
+    /* Unlink the node, whether it is the first one or not */
+    *ppsLink = psCurrentNode->psNextNode;
+    pvOldValue = psCurrentNode->pvValue;
+    free((char*)(psCurrentNode->pcKey));
+    free(psCurrentNode);
+    (oSymTable->length)--;
+    return pvOldValue;
+}
+
+void SymTable_getBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    void **ppvValues) {
+        size_t i = 0;  /* loop counter */
+
+        assert(oSymTable != NULL);
+        assert(ppcKeys != NULL || uCount == 0);
+        assert(ppvValues != NULL || uCount == 0);
+
+        /* A list search has no cache misses to overlap */
+        for (i = 0; i < uCount; i++) {
+            ppvValues[i] = SymTable_get(oSymTable, ppcKeys[i]);
         }
+}
 
-    psPreviousNode = oSymTable->psFirstNode;
-    
-    for (psCurrentNode = oSymTable->psFirstNode;
-            psCurrentNode != NULL;
-            psCurrentNode = psNextNode) 
-        {
-            if (strcmp(psCurrentNode->pcKey, pcKey) == 0) {
-                pvOldValue = psCurrentNode->pvValue;
-                psNextNode = psCurrentNode->psNextNode;
-                /* If key to be freed is the first one */
-                if (psCurrentNode->pcKey == oSymTable->psFirstNode->pcKey) {
-                    oSymTable->psFirstNode = psNextNode;
-                    free((char*)(psCurrentNode->pcKey));
-                    free(psCurrentNode);
-                    (oSymTable->length)--;
-                    return (void*)pvOldValue;
-                } else {
-                    psPreviousNode->psNextNode = psNextNode;
-                    free((char*)(psCurrentNode->pcKey));
-                    free(psCurrentNode);
-                    (oSymTable->length)--;
-                    return (void*)pvOldValue;
-                }
+void SymTable_containsBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    int *piFound) {
+        size_t i = 0;  /* loop counter */
+
+        assert(oSymTable != NULL);
+        assert(ppcKeys != NULL || uCount == 0);
+        assert(piFound != NULL || uCount == 0);
+
+        for (i = 0; i < uCount; i++) {
+            piFound[i] = SymTable_contains(oSymTable, ppcKeys[i]);
+        }
+}
+
+int SymTable_putBatch(SymTable_T oSymTable, const char **ppcKeys, void **ppvValues,
+    size_t uCount, int *piRejected) {
+        struct Node* psNode;
+        int iAdded;
+        size_t i = 0;  /* loop counter */
+
+        assert(oSymTable != NULL);
+        assert(ppcKeys != NULL || uCount == 0);
+        assert(ppvValues != NULL || uCount == 0);
+
+        /* A list never grows, so there is nothing to size up front */
+        for (i = 0; i < uCount; i++) {
+            assert(ppcKeys[i] != NULL);
+            psNode = SymTable_findOrAdd(oSymTable, ppcKeys[i], strlen(ppcKeys[i]),
+                ppvValues[i], &iAdded);
+            if (psNode == NULL) {
+                return 0;
+            }
+            if (piRejected != NULL) {
+                piRejected[i] = !iAdded;
             }
-            psNextNode = psCurrentNode->psNextNode;
-            psPreviousNode = psCurrentNode;
         }
-        return NULL;
+        return 1;
+}
+
+SymTable_T SymTable_bulkLoad(const char **ppcKeys, void **ppvValues, size_t uCount,
+    int *piRejected) {
+        SymTable_T oSymTable;
+
+        oSymTable = SymTable_new();
+        if (oSymTable == NULL) {
+            return NULL;
+        }
+        if (!SymTable_putBatch(oSymTable, ppcKeys, ppvValues, uCount, piRejected)) {
+            SymTable_free(oSymTable);
+            return NULL;
+        }
+        return oSymTable;
 }
 
 void SymTable_map(SymTable_T oSymTable,
@@ -218,4 +385,127 @@ void SymTable_map(SymTable_T oSymTable,
                     (*pfApply)((void*)psCurrentNode->pcKey, (void*)psCurrentNode->pvValue, (void*)pvExtra);
                 }
     }
-  
\ No newline at end of file
+
+void SymTable_mapParallel(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    void **ppvExtras, size_t uThreadCount) {
+        /* Splitting a list would take a walk of its own, so one worker does it all */
+        (void)uThreadCount;
+        SymTable_map(oSymTable, pfApply, ppvExtras != NULL ? ppvExtras[0] : NULL);
+    }
+
+void SymTable_iterBegin(SymTable_T oSymTable, SymTable_Iter *psIter) {
+    assert(oSymTable != NULL);
+    assert(psIter != NULL);
+
+    psIter->oSymTable = oSymTable;
+    psIter->uIndex = 0;
+    psIter->pvNext = oSymTable->psFirstNode;
+}
+
+int SymTable_iterNext(SymTable_Iter *psIter, const char **ppcKey, size_t *puLength,
+    void **ppvValue) {
+    struct Node* psNode;
+
+    assert(psIter != NULL);
+
+    psNode = (struct Node*)psIter->pvNext;
+    if (psNode == NULL) {
+        return 0;
+    }
+    psIter->pvNext = psNode->psNextNode;
+
+    if (ppcKey != NULL) {
+        *ppcKey = psNode->pcKey;
+    }
+    if (puLength != NULL) {
+        *puLength = psNode->uLength;
+    }
+    if (ppvValue != NULL) {
+        *ppvValue = psNode->pvValue;
+    }
+    return 1;
+}
+
+void SymTable_iterEnd(SymTable_Iter *psIter) {
+    assert(psIter != NULL);
+    psIter->oSymTable = NULL;
+}
+
+size_t SymTable_scan(SymTable_T oSymTable, size_t uCursor, size_t uCount,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+        /* No position in a list survives the removal of the nodes before it, so one call
+        visits them all */
+        (void)uCursor;
+        (void)uCount;
+        SymTable_map(oSymTable, pfApply, pvExtra);
+        return 0;
+    }
+
+/* Helper find function */
+struct Node** SymTable_find(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
+    struct Node** ppsLink;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    /* Only compare the bytes of keys of the right length */
+    for (ppsLink = &oSymTable->psFirstNode;
+            *ppsLink != NULL;
+            ppsLink = &(*ppsLink)->psNextNode) {
+        SymTable_count(oSymTable, uCompares, 1);
+        if ((*ppsLink)->uLength == uLength &&
+                memcmp((*ppsLink)->pcKey, pcKey, uLength) == 0) {
+            break;
+        }
+    }
+
+    if (*ppsLink != NULL) {
+        SymTable_count(oSymTable, uHits, 1);
+    } else {
+        SymTable_count(oSymTable, uMisses, 1);
+    }
+    return ppsLink;
+}
+
+/* Helper find-or-add function */
+struct Node* SymTable_findOrAdd(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, const void *pvValue, int *piAdded) {
+        struct Node* psNewNode;
+
+        assert(oSymTable != NULL);
+        assert(pcKey != NULL);
+        assert(piAdded != NULL);
+
+        *piAdded = 0;
+
+        psNewNode = *SymTable_find(oSymTable, pcKey, uLength);
+        if (psNewNode != NULL) {
+            return psNewNode;
+        }
+
+        psNewNode = (struct Node*)calloc(1, sizeof(struct Node));
+        if (psNewNode == NULL) {
+            return NULL;
+        }
+
+        /* makes defensive copy of key */
+        psNewNode->pcKey = (char*)malloc(uLength + 1);
+        if (psNewNode->pcKey == NULL) {
+            free(psNewNode);
+            return NULL;
+        }
+
+        memcpy((void*)(psNewNode->pcKey), pcKey, uLength);
+        ((char*)psNewNode->pcKey)[uLength] = '\0';
+        psNewNode->uLength = uLength;
+
+        psNewNode->pvValue = (void*)pvValue;
+        psNewNode->psNextNode = oSymTable->psFirstNode;
+        oSymTable->psFirstNode = psNewNode;
+
+        (oSymTable->length)++;
+        *piAdded = 1;
+        return psNewNode;
+}
@@ -0,0 +1,1754 @@
+/* symtableshm.c
+Author: Tinney Mak */
+
+/* For shm_open, and for MAP_ANONYMOUS and MAP_NORESERVE, which POSIX leaves out */
+#define _DEFAULT_SOURCE
+
+#include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "symtable.h"
+#include "symhash.h"
+#include "symshm.h"
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+/* Bucket counts are powers of two, so the bucket of a key is the low bits of its hash. A table
+starts with INITIAL_BUCKET_COUNT buckets and doubles each time it holds more bindings than
+buckets, until it has MAX_BUCKET_COUNT. */
+enum {INITIAL_BUCKET_COUNT = 8};
+enum {MAX_BUCKET_COUNT = 1 << 30};
+
+/* The seed of the default hash for tables made by SymTable_new */
+enum {DEFAULT_SEED = 0};
+
+/* Once a removal leaves fewer than one binding per SHRINK_DIVISOR buckets, the table shrinks to
+about two buckets per binding, but no fewer than INITIAL_BUCKET_COUNT or the capacity reserved
+with SymTable_reserve. Defining SYMTABLE_NO_AUTO_SHRINK turns this off. */
+enum {SHRINK_DIVISOR = 8};
+
+/* The batch functions look up BATCH_SIZE keys at a time: they hash them all and prefetch their
+buckets, and only then search the chains, so that the cache misses of the keys overlap. */
+enum {BATCH_SIZE = 16};
+
+/* The workers of SymTable_mapParallel claim MAP_STEP buckets at a time, so that workers that
+finish early take on more of the rest. */
+enum {MAP_STEP = 1024};
+
+/* A call of SymTable_scan stops early once it has passed over SCAN_BUCKET_FACTOR buckets for each
+binding it was asked to visit, so that a scan of a sparse table still returns now and then. */
+enum {SCAN_BUCKET_FACTOR = 10};
+
+/* Hints that the memory at pv will be read soon */
+#if defined(__GNUC__)
+#define SymTable_prefetch(pv) __builtin_prefetch(pv)
+#else
+#define SymTable_prefetch(pv) ((void)(pv))
+#endif
+
+/* Tables live in pools: regions of shared memory in which every link is the offset of a block
+from the start of the region rather than its address, so that processes that map a region at
+different addresses follow the same links. Blocks are multiples of BLOCK_ALIGNMENT bytes. Freed
+blocks of up to SMALL_BLOCK_LIMIT bytes are kept on one free list per size; larger blocks are
+rounded up to powers of two, with one list per power. */
+enum {BLOCK_ALIGNMENT = 8};
+enum {SMALL_BLOCK_LIMIT = 512};
+enum {SMALL_CLASS_COUNT = SMALL_BLOCK_LIMIT / BLOCK_ALIGNMENT + 1};
+enum {CLASS_COUNT = SMALL_CLASS_COUNT + 64};
+
+/* The tables that SymTable_new makes in a process share one anonymous pool, mapped when the
+first is made. Its size is reserved, not allocated: pages are used only once blocks reach them.
+If 2^DEFAULT_POOL_BITS bytes cannot be mapped, smaller sizes are tried down to
+2^MIN_POOL_BITS. */
+#if SIZE_MAX > 0xFFFFFFFFu
+enum {DEFAULT_POOL_BITS = 36};
+#else
+enum {DEFAULT_POOL_BITS = 30};
+#endif
+enum {MIN_POOL_BITS = 24};
+
+/* The first bytes of a pool, "SMSHARE1" in little-endian order, and the version of its layout */
+#define POOL_MAGIC 0x3145524148534D53ULL
+enum {POOL_VERSION = 2};
+
+/* A PoolHeader starts each pool, at offset 0, so that no block has offset 0. */
+struct PoolHeader {
+    /* POOL_MAGIC, stored last when a named pool is made */
+    uint64_t uMagic;
+
+    /* POOL_VERSION, and the number of bits of a size_t */
+    uint32_t uVersion;
+    uint32_t uSizeBits;
+
+    /* The size of the pool in bytes */
+    size_t uSize;
+
+    /* The offset of the first byte that no block has used yet */
+    size_t uTop;
+
+    /* The offset of the table of a named pool, and 0 in the anonymous one */
+    size_t uTable;
+
+    /* The offsets of the first freed blocks of each size class, each holding the offset of the
+    next one in its first bytes */
+    size_t auFree[CLASS_COUNT];
+};
+
+/* A Pool is a process's view of a pool. */
+struct Pool {
+    /* The address where the pool is mapped in this process */
+    struct PoolHeader* psHeader;
+
+    /* The size of the mapping */
+    size_t uSize;
+
+    /* 1 if this process may not change the pool: it attached to it, or inherited it from the
+    process that made it */
+    int iReadOnly;
+
+    /* 1 if the pool is a named one, holding a single table, and 0 if it is the anonymous one */
+    int iNamed;
+
+    /* The lock that keeps the tables of the pool from allocating blocks at once */
+    pthread_mutex_t sLock;
+
+    /* The address of the next Pool that this process may change */
+    struct Pool* psNextPool;
+};
+
+/* A Table is the part of a SymTable that lives in its pool, where every process that uses the
+table reads it. */
+struct Table {
+    /* The sequence number of the table: odd while the writer is changing it, and advanced by
+    two with each change */
+    size_t uSequence;
+
+    /* The offset of the array of buckets, each holding the offset of the first Node of its
+    chain or 0 */
+    size_t uBuckets;
+
+    /* The number of buckets, a power of two */
+    size_t uBucketCount;
+
+    /* The number of the bindings in the symbol table */
+    size_t length;
+
+    /* The number of buckets below which the table does not shrink by itself */
+    size_t uMinBucketCount;
+
+    /* The seed of the hash function */
+    size_t uSeed;
+
+    /* The number of times the bindings have been moved into a new bucket array */
+    size_t uResizeCount;
+};
+
+/* Each Node contains a binding, consisting of a key and value. Nodes are linked by offset to
+form the chain of a bucket. The key and a '\0' follow the node in its block, so that the key
+needs no link of its own. */
+struct Node {
+    /* The offset of the next Node, or 0 at the end of the chain */
+    size_t uNextNode;
+
+    /* The full hash of the key, kept so that chains can be searched and rehashed without
+    rereading the key */
+    size_t uHash;
+
+    /* The length of the key */
+    size_t uLength;
+
+    /* The value */
+    void* pvValue;
+};
+
+/* A SymTable is a process's handle on a Table. */
+struct SymTable {
+    /* The pool of the table */
+    struct Pool* psPool;
+
+    /* The address of the table in this process */
+    struct Table* psTable;
+
+    /* The hash function */
+    SymTable_HashFunction pfHash;
+#ifdef SYMTABLE_STATS
+    /* The operation counters of SymTable_getStats. They count this process's searches only,
+    and live outside the pool so that its layout does not depend on the build */
+    size_t uHits;
+    size_t uMisses;
+    size_t uCompares;
+#endif
+};
+
+/* Adds uAmount to the operation counter uCounter of oSymTable in a build with SYMTABLE_STATS
+defined, and does nothing otherwise */
+#ifdef SYMTABLE_STATS
+#define SymTable_count(oSymTable, uCounter, uAmount) ((oSymTable)->uCounter += (uAmount))
+#else
+#define SymTable_count(oSymTable, uCounter, uAmount) ((void)0)
+#endif
+
+/* A MapJob is the work that the workers of SymTable_mapParallel share. */
+struct MapJob {
+    /* The table */
+    SymTable_T oSymTable;
+
+    /* The function to apply */
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra);
+
+    /* The number of buckets claimed so far */
+    size_t uNext;
+};
+
+/* A MapWorker is one worker of SymTable_mapParallel. */
+struct MapWorker {
+    /* The shared work */
+    struct MapJob* psJob;
+
+    /* The extra parameter of the worker */
+    void* pvExtra;
+
+    /* The thread of the worker, and whether it was started */
+    pthread_t sThread;
+    int iStarted;
+};
+
+/* The pools that this process may change, the anonymous one among them once it is made, and
+the lock that guards both */
+static struct Pool* psWritablePools = NULL;
+static struct Pool* psAnonymousPool = NULL;
+static pthread_mutex_t sPoolsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t sPoolsOnce = PTHREAD_ONCE_INIT;
+
+/* Helper function that registers the fork handlers of the pools.*/
+static void SymTable_initPools(void);
+
+/* Helper function, run before a fork, that keeps the list of pools from changing across it.*/
+static void SymTable_prepareFork(void);
+
+/* Helper function, run in the parent after a fork, that releases the list of pools.*/
+static void SymTable_parentFork(void);
+
+/* Helper function, run in the child after a fork, that makes every pool the parent could change
+read-only in the child, so that the child's own tables go in a new anonymous pool.*/
+static void SymTable_childFork(void);
+
+/* Helper function that returns a new Pool for the uSize bytes mapped at pvBase, laying out an
+empty pool there unless iReadOnly is nonzero, or NULL if there is insufficient memory.*/
+static struct Pool* SymTable_newPool(void *pvBase, size_t uSize, int iReadOnly, int iNamed);
+
+/* Helper function that returns the anonymous pool of this process, mapping it first if there is
+none, or NULL if it cannot be mapped or there is insufficient memory.*/
+static struct Pool* SymTable_anonymousPool(void);
+
+/* Helper function that adds psPool to the pools this process may change. The caller holds the
+lock of the list.*/
+static void SymTable_addPool(struct Pool *psPool);
+
+/* Helper function that unmaps named pool psPool and frees it.*/
+static void SymTable_freePool(struct Pool *psPool);
+
+/* Helper function that returns the size of the block that holds uSize bytes, or 0 if there is
+no such size.*/
+static size_t SymTable_blockSize(size_t uSize);
+
+/* Helper function that returns the size class of blocks of uBlockSize bytes, a size that
+SymTable_blockSize returns.*/
+static size_t SymTable_blockClass(size_t uBlockSize);
+
+/* Helper function that returns the offset of a new block of psPool of at least uSize bytes, or
+0 if the pool is full.*/
+static size_t SymTable_alloc(struct Pool *psPool, size_t uSize);
+
+/* Helper function that returns the block of psPool at offset uOffset, allocated with uSize
+bytes, to the pool for reuse.*/
+static void SymTable_release(struct Pool *psPool, size_t uOffset, size_t uSize);
+
+/* Helper function that returns a new SymTable object for a new, empty table in psPool that
+hashes keys with *pfHash, or the default hash if pfHash is NULL, and seed uSeed, or NULL if the
+pool is full or there is insufficient memory.*/
+static SymTable_T SymTable_make(struct Pool *psPool, SymTable_HashFunction pfHash,
+    size_t uSeed);
+
+/* Helper function that returns the address in this process of the memory at offset uOffset of
+the pool of oSymTable.*/
+static void* SymTable_at(SymTable_T oSymTable, size_t uOffset);
+
+/* Helper function that returns the address of the array of buckets of oSymTable.*/
+static size_t* SymTable_buckets(SymTable_T oSymTable);
+
+/* Helper function that returns the key of node psNode.*/
+static const char* SymTable_nodeKey(const struct Node *psNode);
+
+/* Helper function that returns the number of bytes of the block of a node whose key has uLength
+bytes, or 0 if there is no such size.*/
+static size_t SymTable_nodeSize(size_t uLength);
+
+/* Helper function that returns the full hash of the key of uLength bytes at pcKey in
+oSymTable.*/
+static size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey, size_t uLength);
+
+/* Helper function that returns 1 if this process may change oSymTable and 0 otherwise.*/
+static int SymTable_isWritable(SymTable_T oSymTable);
+
+/* Helper function that marks oSymTable as being changed, so that lookups that overlap the
+change try again. End the change with SymTable_endWrite.*/
+static void SymTable_beginWrite(SymTable_T oSymTable);
+
+/* Helper function that ends the change begun with SymTable_beginWrite.*/
+static void SymTable_endWrite(SymTable_T oSymTable);
+
+/* Helper function that waits until oSymTable is not being changed and returns its sequence
+number, to be passed to SymTable_endRead at the end of the lookup.*/
+static size_t SymTable_beginRead(SymTable_T oSymTable);
+
+/* Helper function that returns 1 if oSymTable has not begun to change since SymTable_beginRead
+returned uSequence, so that what was read since then is consistent, and 0 otherwise.*/
+static int SymTable_endRead(SymTable_T oSymTable, size_t uSequence);
+
+/* Helper function that searches oSymTable for the binding whose key is the uLength bytes at
+pcKey, whose full hash is uHash, as a lookup that began at sequence number uSequence. If it is
+found, stores its value in *ppvValue and returns 1. Returns 0 if there is no such binding, or -1
+if an offset read is out of place or the table has begun to change, in which case the lookup
+must start again. Nothing it reads while the writer changes the table can make it read outside
+the pool or loop forever.*/
+static int SymTable_search(SymTable_T oSymTable, const char *pcKey, size_t uLength,
+    size_t uHash, size_t uSequence, void **ppvValue);
+
+/* Helper function that stores in *ppvValue the value of the binding of oSymTable whose key is
+the uLength bytes at pcKey, whose full hash is uHash, searching again until no change overlaps
+the search. Returns 1 if there is such a binding and 0 otherwise, in which case *ppvValue is
+unchanged.*/
+static int SymTable_read(SymTable_T oSymTable, const char *pcKey, size_t uLength,
+    size_t uHash, void **ppvValue);
+
+/* Helper function that stores in ppvValues[i] the value of the binding of oSymTable whose key is
+ppcKeys[i], or NULL if there is none, and in piFound[i] whether there is one, for 0 <= i <
+uCount, where uCount is at most BATCH_SIZE. Either array may be NULL.*/
+static void SymTable_readBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    void **ppvValues, int *piFound);
+
+/* Helper function that searches the bucket of oSymTable that the key of uLength bytes at pcKey,
+whose full hash is uHash, hashes to, as only the writer may. Returns the address of the link
+(the bucket or a uNextNode field) that holds the offset of the node with that key, or the 0
+ending the chain if there is none.*/
+static size_t* SymTable_find(SymTable_T oSymTable, const char *pcKey, size_t uLength,
+    size_t uHash);
+
+/* Helper function that returns the node of oSymTable whose key is the uLength bytes at pcKey,
+first adding a new binding of that key to pvValue if there is none. Sets *piAdded to 1 if the
+binding was added and 0 otherwise. Returns NULL if this process may not change oSymTable or its
+pool is full, leaving oSymTable unchanged.*/
+static struct Node* SymTable_findOrAdd(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, const void *pvValue, int *piAdded);
+
+/* Helper function that moves every binding of oSymTable into a new bucket array of
+uNewBucketCount buckets, a power of two, as part of a change. Returns 1 if successful and 0 if
+the pool is full, in which case oSymTable is unchanged.*/
+static int SymTable_rehash(SymTable_T oSymTable, size_t uNewBucketCount);
+
+/* Helper function that returns the number of buckets a table needs to hold uBindingCount
+bindings without growing: the least power of two that is at least uBindingCount and
+INITIAL_BUCKET_COUNT, or MAX_BUCKET_COUNT if that is less.*/
+static size_t SymTable_bucketCountFor(size_t uBindingCount);
+
+/* Helper function that applies the function of the job of the MapWorker at pvWorker to the
+bindings of the buckets it claims, until there are none left. Returns NULL.*/
+static void* SymTable_mapWork(void *pvWorker);
+
+/* Helper function that applies *pfApply to each binding of the chain of oSymTable starting at
+offset uOffset, passing pvExtra. Returns the number of bindings visited.*/
+static size_t SymTable_applyChain(SymTable_T oSymTable, size_t uOffset,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra), void *pvExtra);
+
+/* Helper function that adds the chain of oSymTable starting at offset uOffset to the histogram
+and the node and key bytes of *psStats, as part of a lookup that began at sequence number
+uSequence. Returns 1 if successful, or 0 if an offset read is out of place or the table has begun
+to change, in which case the statistics must be gathered again.*/
+static int SymTable_addChainStats(SymTable_T oSymTable, size_t uOffset, size_t uSequence,
+    SymTable_Stats *psStats);
+
+/* Helper function that returns the cursor of SymTable_scan that follows uCursor for buckets
+chosen by the bits of uMask. Cursors advance by adding one to their reversed bits, so each
+bucket of a larger or smaller array covers a run of cursors, and growing or shrinking between
+calls skips no binding. Returns 0 after the last cursor.*/
+static size_t SymTable_nextCursor(size_t uCursor, size_t uMask);
+
+SymTable_T SymTable_new(void) {
+    return SymTable_newWithHash(NULL, DEFAULT_SEED);
+}
+
+SymTable_T SymTable_newWithHash(SymTable_HashFunction pfHash, size_t uSeed) {
+    struct Pool* psPool;
+
+    psPool = SymTable_anonymousPool();
+    if (psPool == NULL) {
+        return NULL;
+    }
+    return SymTable_make(psPool, pfHash, uSeed);
+}
+
+SymTable_T SymTable_newWithCapacity(size_t uCapacity) {
+    SymTable_T oSymTable;
+
+    oSymTable = SymTable_new();
+    if (oSymTable == NULL) {
+        return NULL;
+    }
+    if (!SymTable_reserve(oSymTable, uCapacity)) {
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+    return oSymTable;
+}
+
+SymTable_T SymTable_newConcurrent(void) {
+    /* A table has one writer; only lookups may run alongside it */
+    return NULL;
+}
+
+SymTable_T SymTable_newShared(const char *pcName, size_t uSize) {
+    struct Pool* psPool;
+    SymTable_T oSymTable;
+    void* pvBase;
+    int iFd;
+
+    assert(pcName != NULL);
+
+    if (uSize < sizeof(struct PoolHeader) || (off_t)uSize < 0) {
+        return NULL;
+    }
+
+    /* A new object, rather than the old one truncated, leaves readers of the old one their
+    pages */
+    (void)shm_unlink(pcName);
+    iFd = shm_open(pcName, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (iFd < 0) {
+        return NULL;
+    }
+    if (ftruncate(iFd, (off_t)uSize) != 0) {
+        close(iFd);
+        (void)shm_unlink(pcName);
+        return NULL;
+    }
+    pvBase = mmap(NULL, uSize, PROT_READ | PROT_WRITE, MAP_SHARED, iFd, 0);
+    close(iFd);
+    if (pvBase == MAP_FAILED) {
+        (void)shm_unlink(pcName);
+        return NULL;
+    }
+
+    psPool = SymTable_newPool(pvBase, uSize, 0, 1);
+    if (psPool == NULL) {
+        munmap(pvBase, uSize);
+        (void)shm_unlink(pcName);
+        return NULL;
+    }
+    pthread_once(&sPoolsOnce, SymTable_initPools);
+    pthread_mutex_lock(&sPoolsLock);
+    SymTable_addPool(psPool);
+    pthread_mutex_unlock(&sPoolsLock);
+    oSymTable = SymTable_make(psPool, NULL, DEFAULT_SEED);
+    if (oSymTable == NULL) {
+        SymTable_freePool(psPool);
+        (void)shm_unlink(pcName);
+        return NULL;
+    }
+
+    /* Readers accept the pool once its magic number is there */
+    psPool->psHeader->uTable = (size_t)((char*)oSymTable->psTable - (char*)psPool->psHeader);
+    __atomic_store_n(&psPool->psHeader->uMagic, POOL_MAGIC, __ATOMIC_RELEASE);
+    return oSymTable;
+}
+
+SymTable_T SymTable_attachShared(const char *pcName) {
+    struct PoolHeader* psHeader;
+    struct Pool* psPool;
+    SymTable_T oSymTable;
+    struct stat sStat;
+    void* pvBase;
+    size_t uSize;
+    size_t uTable;
+    int iFd;
+
+    assert(pcName != NULL);
+
+    iFd = shm_open(pcName, O_RDONLY, 0);
+    if (iFd < 0) {
+        return NULL;
+    }
+    if (fstat(iFd, &sStat) != 0 || sStat.st_size < (off_t)sizeof(struct PoolHeader) ||
+            (uintmax_t)sStat.st_size > SIZE_MAX) {
+        close(iFd);
+        return NULL;
+    }
+    uSize = (size_t)sStat.st_size;
+    pvBase = mmap(NULL, uSize, PROT_READ, MAP_SHARED, iFd, 0);
+    close(iFd);
+    if (pvBase == MAP_FAILED) {
+        return NULL;
+    }
+
+    psHeader = (struct PoolHeader*)pvBase;
+    if (__atomic_load_n(&psHeader->uMagic, __ATOMIC_ACQUIRE) != POOL_MAGIC) {
+        munmap(pvBase, uSize);
+        return NULL;
+    }
+    uTable = psHeader->uTable;
+    if (psHeader->uVersion != POOL_VERSION ||
+            psHeader->uSizeBits != sizeof(size_t) * 8 ||
+            psHeader->uSize != uSize ||
+            uTable % BLOCK_ALIGNMENT != 0 || uTable < sizeof(struct PoolHeader) ||
+            uTable > uSize - sizeof(struct Table)) {
+        munmap(pvBase, uSize);
+        return NULL;
+    }
+
+    psPool = SymTable_newPool(pvBase, uSize, 1, 1);
+    oSymTable = (SymTable_T)calloc(1, sizeof(struct SymTable));
+    if (psPool == NULL || oSymTable == NULL) {
+        free(psPool);
+        free(oSymTable);
+        munmap(pvBase, uSize);
+        return NULL;
+    }
+    oSymTable->psPool = psPool;
+    oSymTable->psTable = (struct Table*)((char*)pvBase + uTable);
+    oSymTable->pfHash = SymHash_hash;
+    return oSymTable;
+}
+
+int SymTable_unlinkShared(const char *pcName) {
+    assert(pcName != NULL);
+    return shm_unlink(pcName) == 0;
+}
+
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity) {
+    size_t uBucketCount;
+    int iSuccessful = 1;
+
+    assert(oSymTable != NULL);
+
+    if (!SymTable_isWritable(oSymTable)) {
+        return 0;
+    }
+
+    uBucketCount = SymTable_bucketCountFor(uCapacity);
+    if (uBucketCount > oSymTable->psTable->uBucketCount) {
+        SymTable_beginWrite(oSymTable);
+        iSuccessful = SymTable_rehash(oSymTable, uBucketCount);
+        SymTable_endWrite(oSymTable);
+    }
+    if (iSuccessful && uBucketCount > oSymTable->psTable->uMinBucketCount) {
+        oSymTable->psTable->uMinBucketCount = uBucketCount;
+    }
+    return iSuccessful;
+}
+
+int SymTable_shrinkToFit(SymTable_T oSymTable) {
+    size_t uBucketCount;
+    int iSuccessful = 1;
+
+    assert(oSymTable != NULL);
+
+    if (!SymTable_isWritable(oSymTable)) {
+        return 0;
+    }
+
+    /* Removed nodes are already back in the pool, where any table of it may reuse them */
+    uBucketCount = SymTable_bucketCountFor(oSymTable->psTable->length);
+    if (uBucketCount != oSymTable->psTable->uBucketCount) {
+        SymTable_beginWrite(oSymTable);
+        iSuccessful = SymTable_rehash(oSymTable, uBucketCount);
+        SymTable_endWrite(oSymTable);
+    }
+    if (iSuccessful) {
+        oSymTable->psTable->uMinBucketCount = INITIAL_BUCKET_COUNT;
+    }
+    return iSuccessful;
+}
+
+void SymTable_free(SymTable_T oSymTable) {
+    struct Table* psTable;
+    struct Node* psNode;
+    size_t* puBuckets;
+    size_t uOffset;
+    size_t uNextOffset;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+
+    /* A process that may not change the table only lets go of its handle */
+    psTable = oSymTable->psTable;
+    if (SymTable_isWritable(oSymTable)) {
+        puBuckets = SymTable_buckets(oSymTable);
+        for (i = 0; i < psTable->uBucketCount; i++) {
+            for (uOffset = puBuckets[i]; uOffset != 0; uOffset = uNextOffset) {
+                psNode = (struct Node*)SymTable_at(oSymTable, uOffset);
+                uNextOffset = psNode->uNextNode;
+                SymTable_release(oSymTable->psPool, uOffset,
+                    SymTable_nodeSize(psNode->uLength));
+            }
+        }
+        SymTable_release(oSymTable->psPool, psTable->uBuckets,
+            psTable->uBucketCount * sizeof(size_t));
+        SymTable_release(oSymTable->psPool,
+            (size_t)((char*)psTable - (char*)oSymTable->psPool->psHeader), sizeof(struct Table));
+    }
+
+    if (oSymTable->psPool->iNamed) {
+        SymTable_freePool(oSymTable->psPool);
+    }
+    free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+    return __atomic_load_n(&oSymTable->psTable->length, __ATOMIC_RELAXED);
+}
+
+size_t SymTable_getBucketCount(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+    return __atomic_load_n(&oSymTable->psTable->uBucketCount, __ATOMIC_RELAXED);
+}
+
+void SymTable_getStats(SymTable_T oSymTable, SymTable_Stats *psStats) {
+    struct Table* psTable;
+    size_t* puBuckets;
+    size_t uSequence;
+    size_t uSize;
+    size_t uBuckets;
+    size_t uBucketCount;
+    int iConsistent;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(psStats != NULL);
+
+    psTable = oSymTable->psTable;
+    uSize = oSymTable->psPool->uSize;
+
+    /* The writer may be in another process, so the walk is one lookup, made again if any
+    change overlaps it */
+    do {
+        memset(psStats, 0, sizeof(SymTable_Stats));
+        uSequence = SymTable_beginRead(oSymTable);
+        psStats->uLength = __atomic_load_n(&psTable->length, __ATOMIC_RELAXED);
+        psStats->uResizeCount = __atomic_load_n(&psTable->uResizeCount, __ATOMIC_RELAXED);
+        uBuckets = __atomic_load_n(&psTable->uBuckets, __ATOMIC_RELAXED);
+        uBucketCount = __atomic_load_n(&psTable->uBucketCount, __ATOMIC_RELAXED);
+        iConsistent = uBucketCount != 0 && (uBucketCount & (uBucketCount - 1)) == 0 &&
+            uBuckets % BLOCK_ALIGNMENT == 0 && uBuckets <= uSize &&
+            uBucketCount <= (uSize - uBuckets) / sizeof(size_t);
+
+        puBuckets = (size_t*)SymTable_at(oSymTable, uBuckets);
+        for (i = 0; i < uBucketCount && iConsistent; i++) {
+            iConsistent = SymTable_addChainStats(oSymTable,
+                __atomic_load_n(&puBuckets[i], __ATOMIC_RELAXED), uSequence, psStats);
+        }
+    } while (!SymTable_endRead(oSymTable, uSequence) || !iConsistent);
+
+    psStats->uBucketCount = uBucketCount;
+    psStats->dLoadFactor = (double)psStats->uLength / (double)uBucketCount;
+    psStats->uBucketBytes = SymTable_blockSize(uBucketCount * sizeof(size_t));
+
+#ifdef SYMTABLE_STATS
+    psStats->uHits = oSymTable->uHits;
+    psStats->uMisses = oSymTable->uMisses;
+    psStats->uCompares = oSymTable->uCompares;
+#endif
+}
+
+int SymTable_put(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue) {
+    assert(pcKey != NULL);
+    return SymTable_putN(oSymTable, pcKey, strlen(pcKey), pvValue);
+}
+
+int SymTable_putN(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength, const void *pvValue) {
+    struct Node* psNode;
+    int iAdded;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psNode = SymTable_findOrAdd(oSymTable, pcKey, uLength, pvValue, &iAdded);
+    return (psNode != NULL) && iAdded;
+}
+
+void **SymTable_getOrPut(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue) {
+    struct Node* psNode;
+    int iAdded;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psNode = SymTable_findOrAdd(oSymTable, pcKey, strlen(pcKey), pvValue, &iAdded);
+    if (psNode == NULL) {
+        return NULL;
+    }
+    return &psNode->pvValue;
+}
+
+int SymTable_upsert(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue) {
+    return SymTable_putOrReplace(oSymTable, pcKey, pvValue, NULL) >= 0;
+}
+
+int SymTable_putOrReplace(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue, void **ppvOldValue) {
+    struct Node* psNode;
+    int iAdded;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psNode = SymTable_findOrAdd(oSymTable, pcKey, strlen(pcKey), pvValue, &iAdded);
+    if (psNode == NULL) {
+        return -1;
+    }
+    if (iAdded) {
+        return 1;
+    }
+
+    if (ppvOldValue != NULL) {
+        *ppvOldValue = psNode->pvValue;
+    }
+    __atomic_store_n(&psNode->pvValue, (void*)pvValue, __ATOMIC_RELAXED);
+    return 0;
+}
+
+void *SymTable_replace(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue) {
+    assert(pcKey != NULL);
+    return SymTable_replaceN(oSymTable, pcKey, strlen(pcKey), pvValue);
+}
+
+void *SymTable_replaceN(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength, const void *pvValue) {
+    struct Node* psNode;
+    size_t uOffset;
+    void* pvOldValue;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    if (!SymTable_isWritable(oSymTable)) {
+        return NULL;
+    }
+
+    uOffset = *SymTable_find(oSymTable, pcKey, uLength,
+        SymTable_hash(oSymTable, pcKey, uLength));
+    if (uOffset == 0) {
+        return NULL;
+    }
+
+    /* A value is a single word, which readers load whole, so it needs no change of sequence */
+    psNode = (struct Node*)SymTable_at(oSymTable, uOffset);
+    pvOldValue = psNode->pvValue;
+    __atomic_store_n(&psNode->pvValue, (void*)pvValue, __ATOMIC_RELAXED);
+    return pvOldValue;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+    assert(pcKey != NULL);
+    return SymTable_containsN(oSymTable, pcKey, strlen(pcKey));
+}
+
+int SymTable_containsN(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
+    void* pvValue;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return SymTable_read(oSymTable, pcKey, uLength, SymTable_hash(oSymTable, pcKey, uLength),
+        &pvValue);
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+    assert(pcKey != NULL);
+    return SymTable_getN(oSymTable, pcKey, strlen(pcKey));
+}
+
+void *SymTable_getN(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
+    void* pvValue = NULL;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    (void)SymTable_read(oSymTable, pcKey, uLength, SymTable_hash(oSymTable, pcKey, uLength),
+        &pvValue);
+    return pvValue;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+    assert(pcKey != NULL);
+    return SymTable_removeN(oSymTable, pcKey, strlen(pcKey));
+}
+
+void *SymTable_removeN(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
+    struct Table* psTable;
+    struct Node* psNode;
+    size_t* puLink;
+    size_t uOffset;
+    void* pvOldValue;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    if (!SymTable_isWritable(oSymTable)) {
+        return NULL;
+    }
+
+    psTable = oSymTable->psTable;
+    puLink = SymTable_find(oSymTable, pcKey, uLength, SymTable_hash(oSymTable, pcKey, uLength));
+    uOffset = *puLink;
+    if (uOffset == 0) {
+        return NULL;
+    }
+    psNode = (struct Node*)SymTable_at(oSymTable, uOffset);
+    pvOldValue = psNode->pvValue;
+
+    /* The node goes back to the pool at once: a lookup still reading it sees the sequence
+    change and starts again */
+    SymTable_beginWrite(oSymTable);
+    *puLink = psNode->uNextNode;
+    SymTable_release(oSymTable->psPool, uOffset, SymTable_nodeSize(psNode->uLength));
+    (psTable->length)--;
+
+#ifndef SYMTABLE_NO_AUTO_SHRINK
+    /* If shrinking fails, the table keeps working at its current size */
+    if (psTable->length * SHRINK_DIVISOR < psTable->uBucketCount &&
+            psTable->uBucketCount > psTable->uMinBucketCount) {
+        size_t uNewBucketCount = SymTable_bucketCountFor(psTable->length * 2);
+        if (uNewBucketCount < psTable->uMinBucketCount) {
+            uNewBucketCount = psTable->uMinBucketCount;
+        }
+        (void)SymTable_rehash(oSymTable, uNewBucketCount);
+    }
+#endif
+    SymTable_endWrite(oSymTable);
+    return pvOldValue;
+}
+
+void SymTable_getBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    void **ppvValues) {
+    size_t uBatch;
+
+    assert(oSymTable != NULL);
+    assert(ppcKeys != NULL || uCount == 0);
+    assert(ppvValues != NULL || uCount == 0);
+
+    for (; uCount > 0; uCount -= uBatch, ppcKeys += uBatch, ppvValues += uBatch) {
+        uBatch = uCount < BATCH_SIZE ? uCount : BATCH_SIZE;
+        SymTable_readBatch(oSymTable, ppcKeys, uBatch, ppvValues, NULL);
+    }
+}
+
+void SymTable_containsBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    int *piFound) {
+    size_t uBatch;
+
+    assert(oSymTable != NULL);
+    assert(ppcKeys != NULL || uCount == 0);
+    assert(piFound != NULL || uCount == 0);
+
+    for (; uCount > 0; uCount -= uBatch, ppcKeys += uBatch, piFound += uBatch) {
+        uBatch = uCount < BATCH_SIZE ? uCount : BATCH_SIZE;
+        SymTable_readBatch(oSymTable, ppcKeys, uBatch, NULL, piFound);
+    }
+}
+
+int SymTable_putBatch(SymTable_T oSymTable, const char **ppcKeys, void **ppvValues,
+    size_t uCount, int *piRejected) {
+    struct Node* psNode;
+    int iAdded;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(ppcKeys != NULL || uCount == 0);
+    assert(ppvValues != NULL || uCount == 0);
+
+    /* If the bucket array cannot be grown, the puts below still grow it step by step */
+    if (SymTable_isWritable(oSymTable) &&
+            SymTable_bucketCountFor(oSymTable->psTable->length + uCount) >
+            oSymTable->psTable->uBucketCount) {
+        SymTable_beginWrite(oSymTable);
+        (void)SymTable_rehash(oSymTable,
+            SymTable_bucketCountFor(oSymTable->psTable->length + uCount));
+        SymTable_endWrite(oSymTable);
+    }
+
+    for (i = 0; i < uCount; i++) {
+        assert(ppcKeys[i] != NULL);
+        psNode = SymTable_findOrAdd(oSymTable, ppcKeys[i], strlen(ppcKeys[i]), ppvValues[i],
+            &iAdded);
+        if (psNode == NULL) {
+            return 0;
+        }
+        if (piRejected != NULL) {
+            piRejected[i] = !iAdded;
+        }
+    }
+    return 1;
+}
+
+SymTable_T SymTable_bulkLoad(const char **ppcKeys, void **ppvValues, size_t uCount,
+    int *piRejected) {
+    SymTable_T oSymTable;
+
+    oSymTable = SymTable_new();
+    if (oSymTable == NULL) {
+        return NULL;
+    }
+    if (!SymTable_putBatch(oSymTable, ppcKeys, ppvValues, uCount, piRejected)) {
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+    return oSymTable;
+}
+
+void SymTable_map(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    size_t* puBuckets;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    puBuckets = SymTable_buckets(oSymTable);
+    for (i = 0; i < oSymTable->psTable->uBucketCount; i++) {
+        (void)SymTable_applyChain(oSymTable, puBuckets[i], pfApply, (void*)pvExtra);
+    }
+}
+
+void SymTable_mapParallel(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    void **ppvExtras, size_t uThreadCount) {
+    struct MapJob sJob;
+    struct MapWorker* psWorkers;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    sJob.oSymTable = oSymTable;
+    sJob.pfApply = pfApply;
+    sJob.uNext = 0;
+
+    /* Without memory for the workers, the calling thread does it all */
+    if (uThreadCount == 0) {
+        uThreadCount = 1;
+    }
+    psWorkers = (struct MapWorker*)calloc(uThreadCount, sizeof(struct MapWorker));
+    if (psWorkers == NULL) {
+        struct MapWorker sWorker;
+        sWorker.psJob = &sJob;
+        sWorker.pvExtra = (ppvExtras != NULL) ? ppvExtras[0] : NULL;
+        (void)SymTable_mapWork(&sWorker);
+        return;
+    }
+
+    for (i = 0; i < uThreadCount; i++) {
+        psWorkers[i].psJob = &sJob;
+        psWorkers[i].pvExtra = (ppvExtras != NULL) ? ppvExtras[i] : NULL;
+    }
+    for (i = 1; i < uThreadCount; i++) {
+        psWorkers[i].iStarted = pthread_create(&psWorkers[i].sThread, NULL,
+            SymTable_mapWork, &psWorkers[i]) == 0;
+    }
+    (void)SymTable_mapWork(&psWorkers[0]);
+    for (i = 1; i < uThreadCount; i++) {
+        if (psWorkers[i].iStarted) {
+            pthread_join(psWorkers[i].sThread, NULL);
+        }
+    }
+    free(psWorkers);
+}
+
+void SymTable_iterBegin(SymTable_T oSymTable, SymTable_Iter *psIter) {
+    assert(oSymTable != NULL);
+    assert(psIter != NULL);
+
+    psIter->oSymTable = oSymTable;
+    psIter->uIndex = 0;
+    psIter->pvNext = NULL;
+}
+
+int SymTable_iterNext(SymTable_Iter *psIter, const char **ppcKey, size_t *puLength,
+    void **ppvValue) {
+    SymTable_T oSymTable;
+    struct Node* psNode;
+    size_t* puBuckets;
+
+    assert(psIter != NULL);
+    assert(psIter->oSymTable != NULL);
+
+    /* pvNext is the next node of the current chain, and uIndex the bucket after it */
+    oSymTable = psIter->oSymTable;
+    puBuckets = SymTable_buckets(oSymTable);
+    while (psIter->pvNext == NULL) {
+        if (psIter->uIndex == oSymTable->psTable->uBucketCount) {
+            return 0;
+        }
+        if (puBuckets[psIter->uIndex] != 0) {
+            psIter->pvNext = SymTable_at(oSymTable, puBuckets[psIter->uIndex]);
+        }
+        psIter->uIndex++;
+    }
+    psNode = (struct Node*)psIter->pvNext;
+    psIter->pvNext = psNode->uNextNode != 0 ? SymTable_at(oSymTable, psNode->uNextNode) : NULL;
+
+    if (ppcKey != NULL) {
+        *ppcKey = SymTable_nodeKey(psNode);
+    }
+    if (puLength != NULL) {
+        *puLength = psNode->uLength;
+    }
+    if (ppvValue != NULL) {
+        *ppvValue = psNode->pvValue;
+    }
+    return 1;
+}
+
+void SymTable_iterEnd(SymTable_Iter *psIter) {
+    assert(psIter != NULL);
+    psIter->oSymTable = NULL;
+}
+
+size_t SymTable_scan(SymTable_T oSymTable, size_t uCursor, size_t uCount,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    size_t* puBuckets;
+    size_t uMask;
+    size_t uApplied = 0;
+    size_t uBucketsPassed = 0;
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    puBuckets = SymTable_buckets(oSymTable);
+    uMask = oSymTable->psTable->uBucketCount - 1;
+    do {
+        uApplied += SymTable_applyChain(oSymTable, puBuckets[uCursor & uMask], pfApply,
+            (void*)pvExtra);
+        uCursor = SymTable_nextCursor(uCursor, uMask);
+        uBucketsPassed++;
+    } while (uCursor != 0 && uApplied < uCount &&
+        uBucketsPassed / SCAN_BUCKET_FACTOR < uCount);
+    return uCursor;
+}
+
+/* Helper init pools function */
+void SymTable_initPools(void) {
+    (void)pthread_atfork(SymTable_prepareFork, SymTable_parentFork, SymTable_childFork);
+}
+
+/* Helper prepare fork function */
+void SymTable_prepareFork(void) {
+    pthread_mutex_lock(&sPoolsLock);
+}
+
+/* Helper parent fork function */
+void SymTable_parentFork(void) {
+    pthread_mutex_unlock(&sPoolsLock);
+}
+
+/* Helper child fork function */
+void SymTable_childFork(void) {
+    struct Pool* psPool;
+
+    /* The child's copies of the Pool objects are its own, so marking them changes nothing in
+    the parent */
+    for (psPool = psWritablePools; psPool != NULL; psPool = psPool->psNextPool) {
+        psPool->iReadOnly = 1;
+    }
+    psWritablePools = NULL;
+    psAnonymousPool = NULL;
+    pthread_mutex_unlock(&sPoolsLock);
+}
+
+/* Helper new pool function */
+struct Pool* SymTable_newPool(void *pvBase, size_t uSize, int iReadOnly, int iNamed) {
+    struct PoolHeader* psHeader = (struct PoolHeader*)pvBase;
+    struct Pool* psPool;
+
+    assert(pvBase != NULL);
+
+    psPool = (struct Pool*)calloc(1, sizeof(struct Pool));
+    if (psPool == NULL) {
+        return NULL;
+    }
+    if (pthread_mutex_init(&psPool->sLock, NULL) != 0) {
+        free(psPool);
+        return NULL;
+    }
+    psPool->psHeader = psHeader;
+    psPool->uSize = uSize;
+    psPool->iReadOnly = iReadOnly;
+    psPool->iNamed = iNamed;
+    if (iReadOnly) {
+        return psPool;
+    }
+
+    /* A fresh mapping is all zeros, so the free lists start out empty */
+    psHeader->uVersion = POOL_VERSION;
+    psHeader->uSizeBits = (uint32_t)(sizeof(size_t) * 8);
+    psHeader->uSize = uSize;
+    psHeader->uTop = (sizeof(struct PoolHeader) + BLOCK_ALIGNMENT - 1) /
+        BLOCK_ALIGNMENT * BLOCK_ALIGNMENT;
+    return psPool;
+}
+
+/* Helper anonymous pool function */
+struct Pool* SymTable_anonymousPool(void) {
+    void* pvBase = MAP_FAILED;
+    size_t uSize = 0;
+    int iBits;
+
+    pthread_once(&sPoolsOnce, SymTable_initPools);
+    pthread_mutex_lock(&sPoolsLock);
+    if (psAnonymousPool == NULL) {
+        for (iBits = DEFAULT_POOL_BITS; iBits >= MIN_POOL_BITS && pvBase == MAP_FAILED;
+                iBits--) {
+            uSize = (size_t)1 << iBits;
+            pvBase = mmap(NULL, uSize, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        }
+        if (pvBase != MAP_FAILED) {
+            psAnonymousPool = SymTable_newPool(pvBase, uSize, 0, 0);
+            if (psAnonymousPool == NULL) {
+                munmap(pvBase, uSize);
+            } else {
+                SymTable_addPool(psAnonymousPool);
+            }
+        }
+    }
+    pthread_mutex_unlock(&sPoolsLock);
+    return psAnonymousPool;
+}
+
+/* Helper add pool function */
+void SymTable_addPool(struct Pool *psPool) {
+    assert(psPool != NULL);
+
+    psPool->psNextPool = psWritablePools;
+    psWritablePools = psPool;
+}
+
+/* Helper free pool function */
+void SymTable_freePool(struct Pool *psPool) {
+    struct Pool** ppsLink;
+
+    assert(psPool != NULL);
+    assert(psPool->iNamed);
+
+    pthread_mutex_lock(&sPoolsLock);
+    for (ppsLink = &psWritablePools; *ppsLink != NULL; ppsLink = &(*ppsLink)->psNextPool) {
+        if (*ppsLink == psPool) {
+            *ppsLink = psPool->psNextPool;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sPoolsLock);
+
+    munmap(psPool->psHeader, psPool->uSize);
+    pthread_mutex_destroy(&psPool->sLock);
+    free(psPool);
+}
+
+/* Helper block size function */
+size_t SymTable_blockSize(size_t uSize) {
+    size_t uBlockSize;
+
+    if (uSize <= SMALL_BLOCK_LIMIT) {
+        return (uSize + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT;
+    }
+    if (uSize > SIZE_MAX / 2 + 1) {
+        return 0;
+    }
+    uBlockSize = 2 * SMALL_BLOCK_LIMIT;
+    while (uBlockSize < uSize) {
+        uBlockSize *= 2;
+    }
+    return uBlockSize;
+}
+
+/* Helper block class function */
+size_t SymTable_blockClass(size_t uBlockSize) {
+    size_t uClass = SMALL_CLASS_COUNT;
+
+    if (uBlockSize <= SMALL_BLOCK_LIMIT) {
+        return uBlockSize / BLOCK_ALIGNMENT;
+    }
+    for (uBlockSize /= 2 * SMALL_BLOCK_LIMIT; uBlockSize > 1; uBlockSize /= 2) {
+        uClass++;
+    }
+    return uClass;
+}
+
+/* Helper alloc function */
+size_t SymTable_alloc(struct Pool *psPool, size_t uSize) {
+    struct PoolHeader* psHeader;
+    size_t uClass;
+    size_t uOffset = 0;
+
+    assert(psPool != NULL);
+    assert(!psPool->iReadOnly);
+
+    uSize = SymTable_blockSize(uSize);
+    if (uSize == 0) {
+        return 0;
+    }
+    uClass = SymTable_blockClass(uSize);
+
+    pthread_mutex_lock(&psPool->sLock);
+    psHeader = psPool->psHeader;
+    if (psHeader->auFree[uClass] != 0) {
+        uOffset = psHeader->auFree[uClass];
+        psHeader->auFree[uClass] = *(size_t*)((char*)psHeader + uOffset);
+    } else if (uSize <= psHeader->uSize - psHeader->uTop) {
+        uOffset = psHeader->uTop;
+        psHeader->uTop += uSize;
+    }
+    pthread_mutex_unlock(&psPool->sLock);
+    return uOffset;
+}
+
+/* Helper release function */
+void SymTable_release(struct Pool *psPool, size_t uOffset, size_t uSize) {
+    struct PoolHeader* psHeader;
+    size_t uClass;
+
+    assert(psPool != NULL);
+    assert(!psPool->iReadOnly);
+    assert(uOffset != 0);
+
+    uSize = SymTable_blockSize(uSize);
+    uClass = SymTable_blockClass(uSize);
+
+    /* The last block goes back to the unused space at the top, for any size to reuse */
+    pthread_mutex_lock(&psPool->sLock);
+    psHeader = psPool->psHeader;
+    if (uOffset + uSize == psHeader->uTop) {
+        psHeader->uTop = uOffset;
+    } else {
+        *(size_t*)((char*)psHeader + uOffset) = psHeader->auFree[uClass];
+        psHeader->auFree[uClass] = uOffset;
+    }
+    pthread_mutex_unlock(&psPool->sLock);
+}
+
+/* Helper make function */
+SymTable_T SymTable_make(struct Pool *psPool, SymTable_HashFunction pfHash, size_t uSeed) {
+    SymTable_T oSymTable;
+    struct Table* psTable;
+    size_t uTable;
+    size_t uBuckets;
+
+    assert(psPool != NULL);
+
+    oSymTable = (SymTable_T)calloc(1, sizeof(struct SymTable));
+    if (oSymTable == NULL) {
+        return NULL;
+    }
+    uTable = SymTable_alloc(psPool, sizeof(struct Table));
+    if (uTable == 0) {
+        free(oSymTable);
+        return NULL;
+    }
+    uBuckets = SymTable_alloc(psPool, INITIAL_BUCKET_COUNT * sizeof(size_t));
+    if (uBuckets == 0) {
+        SymTable_release(psPool, uTable, sizeof(struct Table));
+        free(oSymTable);
+        return NULL;
+    }
+
+    oSymTable->psPool = psPool;
+    oSymTable->psTable = psTable = (struct Table*)((char*)psPool->psHeader + uTable);
+    oSymTable->pfHash = (pfHash != NULL) ? pfHash : SymHash_hash;
+
+    /* A reused block holds whatever its last owner left there */
+    memset(SymTable_at(oSymTable, uBuckets), 0, INITIAL_BUCKET_COUNT * sizeof(size_t));
+    psTable->uSequence = 0;
+    psTable->uBuckets = uBuckets;
+    psTable->uBucketCount = INITIAL_BUCKET_COUNT;
+    psTable->length = 0;
+    psTable->uMinBucketCount = INITIAL_BUCKET_COUNT;
+    psTable->uSeed = uSeed;
+    psTable->uResizeCount = 0;
+    return oSymTable;
+}
+
+/* Helper at function */
+void* SymTable_at(SymTable_T oSymTable, size_t uOffset) {
+    assert(oSymTable != NULL);
+    return (char*)oSymTable->psPool->psHeader + uOffset;
+}
+
+/* Helper buckets function */
+size_t* SymTable_buckets(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+    return (size_t*)SymTable_at(oSymTable, oSymTable->psTable->uBuckets);
+}
+
+/* Helper node key function */
+const char* SymTable_nodeKey(const struct Node *psNode) {
+    assert(psNode != NULL);
+    return (const char*)(psNode + 1);
+}
+
+/* Helper node size function */
+size_t SymTable_nodeSize(size_t uLength) {
+    if (uLength > SIZE_MAX - sizeof(struct Node) - 1) {
+        return 0;
+    }
+    return sizeof(struct Node) + uLength + 1;
+}
+
+/* Helper hash function */
+size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return (*oSymTable->pfHash)(pcKey, uLength, oSymTable->psTable->uSeed);
+}
+
+/* Helper is writable function */
+int SymTable_isWritable(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+    return !oSymTable->psPool->iReadOnly;
+}
+
+/* Helper begin write function */
+void SymTable_beginWrite(SymTable_T oSymTable) {
+    struct Table* psTable;
+
+    assert(oSymTable != NULL);
+
+    psTable = oSymTable->psTable;
+    __atomic_store_n(&psTable->uSequence, psTable->uSequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/* Helper end write function */
+void SymTable_endWrite(SymTable_T oSymTable) {
+    struct Table* psTable;
+
+    assert(oSymTable != NULL);
+
+    psTable = oSymTable->psTable;
+    __atomic_store_n(&psTable->uSequence, psTable->uSequence + 1, __ATOMIC_RELEASE);
+}
+
+/* Helper begin read function */
+size_t SymTable_beginRead(SymTable_T oSymTable) {
+    size_t uSequence;
+
+    assert(oSymTable != NULL);
+
+    /* The writer may be in another process, so waiting means giving up the processor */
+    for (;;) {
+        uSequence = __atomic_load_n(&oSymTable->psTable->uSequence, __ATOMIC_ACQUIRE);
+        if (uSequence % 2 == 0) {
+            return uSequence;
+        }
+        sched_yield();
+    }
+}
+
+/* Helper end read function */
+int SymTable_endRead(SymTable_T oSymTable, size_t uSequence) {
+    assert(oSymTable != NULL);
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&oSymTable->psTable->uSequence, __ATOMIC_RELAXED) == uSequence;
+}
+
+/* Helper search function */
+int SymTable_search(SymTable_T oSymTable, const char *pcKey, size_t uLength,
+    size_t uHash, size_t uSequence, void **ppvValue) {
+    struct Table* psTable;
+    const struct Node* psNode;
+    size_t uSize;
+    size_t uBuckets;
+    size_t uBucketCount;
+    size_t uOffset;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(ppvValue != NULL);
+
+    psTable = oSymTable->psTable;
+    uSize = oSymTable->psPool->uSize;
+    uBuckets = __atomic_load_n(&psTable->uBuckets, __ATOMIC_RELAXED);
+    uBucketCount = __atomic_load_n(&psTable->uBucketCount, __ATOMIC_RELAXED);
+    if (uBucketCount == 0 || (uBucketCount & (uBucketCount - 1)) != 0 ||
+            uBuckets % BLOCK_ALIGNMENT != 0 || uBuckets > uSize ||
+            uBucketCount > (uSize - uBuckets) / sizeof(size_t)) {
+        return -1;
+    }
+
+    uOffset = __atomic_load_n((size_t*)SymTable_at(oSymTable, uBuckets) +
+        (uHash & (uBucketCount - 1)), __ATOMIC_RELAXED);
+    while (uOffset != 0) {
+        if (uOffset % BLOCK_ALIGNMENT != 0 || uOffset > uSize - sizeof(struct Node)) {
+            return -1;
+        }
+        psNode = (const struct Node*)SymTable_at(oSymTable, uOffset);
+        SymTable_count(oSymTable, uCompares, 1);
+        if (__atomic_load_n(&psNode->uHash, __ATOMIC_RELAXED) == uHash &&
+                __atomic_load_n(&psNode->uLength, __ATOMIC_RELAXED) == uLength) {
+            if (uLength >= uSize - uOffset - sizeof(struct Node)) {
+                return -1;
+            }
+            if (memcmp(SymTable_nodeKey(psNode), pcKey, uLength) == 0) {
+                *ppvValue = __atomic_load_n(&psNode->pvValue, __ATOMIC_RELAXED);
+                return 1;
+            }
+        }
+
+        /* A node freed and reused under the search may link anywhere, even back into the
+        chain, so every step checks that the table has not changed */
+        if (__atomic_load_n(&psTable->uSequence, __ATOMIC_RELAXED) != uSequence) {
+            return -1;
+        }
+        uOffset = __atomic_load_n(&psNode->uNextNode, __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+/* Helper read function */
+int SymTable_read(SymTable_T oSymTable, const char *pcKey, size_t uLength,
+    size_t uHash, void **ppvValue) {
+    size_t uSequence;
+    void* pvValue = NULL;
+    int iFound;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(ppvValue != NULL);
+
+    do {
+        uSequence = SymTable_beginRead(oSymTable);
+        iFound = SymTable_search(oSymTable, pcKey, uLength, uHash, uSequence, &pvValue);
+    } while (!SymTable_endRead(oSymTable, uSequence) || iFound < 0);
+
+    if (iFound) {
+        SymTable_count(oSymTable, uHits, 1);
+        *ppvValue = pvValue;
+    } else {
+        SymTable_count(oSymTable, uMisses, 1);
+    }
+    return iFound;
+}
+
+/* Helper read batch function */
+void SymTable_readBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    void **ppvValues, int *piFound) {
+    size_t auLengths[BATCH_SIZE];
+    size_t auHashes[BATCH_SIZE];
+    int aiFound[BATCH_SIZE];
+    void* apvValues[BATCH_SIZE];
+    struct Table* psTable;
+    size_t uSequence;
+    size_t uBucketCount;
+    size_t* puBuckets;
+    int iConsistent;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(uCount <= BATCH_SIZE);
+
+    psTable = oSymTable->psTable;
+    for (i = 0; i < uCount; i++) {
+        assert(ppcKeys[i] != NULL);
+        auLengths[i] = strlen(ppcKeys[i]);
+        auHashes[i] = SymTable_hash(oSymTable, ppcKeys[i], auLengths[i]);
+    }
+
+    /* The whole batch is one lookup, searched again if any change overlaps it */
+    do {
+        uSequence = SymTable_beginRead(oSymTable);
+        uBucketCount = __atomic_load_n(&psTable->uBucketCount, __ATOMIC_RELAXED);
+        puBuckets = (size_t*)SymTable_at(oSymTable,
+            __atomic_load_n(&psTable->uBuckets, __ATOMIC_RELAXED));
+        if (uBucketCount != 0) {
+            for (i = 0; i < uCount; i++) {
+                SymTable_prefetch(&puBuckets[auHashes[i] & (uBucketCount - 1)]);
+            }
+        }
+
+        iConsistent = 1;
+        for (i = 0; i < uCount && iConsistent; i++) {
+            apvValues[i] = NULL;
+            aiFound[i] = SymTable_search(oSymTable, ppcKeys[i], auLengths[i], auHashes[i],
+                uSequence, &apvValues[i]);
+            iConsistent = aiFound[i] >= 0;
+        }
+    } while (!SymTable_endRead(oSymTable, uSequence) || !iConsistent);
+
+    for (i = 0; i < uCount; i++) {
+        if (ppvValues != NULL) {
+            ppvValues[i] = apvValues[i];
+        }
+        if (piFound != NULL) {
+            piFound[i] = aiFound[i];
+        }
+        if (aiFound[i]) {
+            SymTable_count(oSymTable, uHits, 1);
+        } else {
+            SymTable_count(oSymTable, uMisses, 1);
+        }
+    }
+}
+
+/* Helper find function */
+size_t* SymTable_find(SymTable_T oSymTable, const char *pcKey, size_t uLength,
+    size_t uHash) {
+    struct Node* psNode;
+    size_t* puLink;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    puLink = &SymTable_buckets(oSymTable)[uHash & (oSymTable->psTable->uBucketCount - 1)];
+    while (*puLink != 0) {
+        psNode = (struct Node*)SymTable_at(oSymTable, *puLink);
+        SymTable_count(oSymTable, uCompares, 1);
+        if (psNode->uHash == uHash && psNode->uLength == uLength &&
+                memcmp(SymTable_nodeKey(psNode), pcKey, uLength) == 0) {
+            break;
+        }
+        puLink = &psNode->uNextNode;
+    }
+
+    if (*puLink != 0) {
+        SymTable_count(oSymTable, uHits, 1);
+    } else {
+        SymTable_count(oSymTable, uMisses, 1);
+    }
+    return puLink;
+}
+
+/* Helper find-or-add function */
+struct Node* SymTable_findOrAdd(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, const void *pvValue, int *piAdded) {
+    struct Table* psTable;
+    struct Node* psNewNode;
+    size_t* puBucket;
+    size_t uHash;
+    size_t uSize;
+    size_t uOffset;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(piAdded != NULL);
+
+    *piAdded = 0;
+    if (!SymTable_isWritable(oSymTable)) {
+        return NULL;
+    }
+
+    psTable = oSymTable->psTable;
+    uHash = SymTable_hash(oSymTable, pcKey, uLength);
+    uOffset = *SymTable_find(oSymTable, pcKey, uLength, uHash);
+    if (uOffset != 0) {
+        return (struct Node*)SymTable_at(oSymTable, uOffset);
+    }
+
+    uSize = SymTable_nodeSize(uLength);
+    uOffset = uSize != 0 ? SymTable_alloc(oSymTable->psPool, uSize) : 0;
+    if (uOffset == 0) {
+        return NULL;
+    }
+
+    /* The node is filled in before the change begins, since no reader can reach it yet */
+    psNewNode = (struct Node*)SymTable_at(oSymTable, uOffset);
+    psNewNode->uHash = uHash;
+    psNewNode->uLength = uLength;
+    psNewNode->pvValue = (void*)pvValue;
+    memcpy((char*)(psNewNode + 1), pcKey, uLength);
+    ((char*)(psNewNode + 1))[uLength] = '\0';
+
+    SymTable_beginWrite(oSymTable);
+
+    /* If growing fails, the table keeps working at its current size */
+    if (psTable->length >= psTable->uBucketCount &&
+            psTable->uBucketCount < MAX_BUCKET_COUNT) {
+        (void)SymTable_rehash(oSymTable, 2 * psTable->uBucketCount);
+    }
+    puBucket = &SymTable_buckets(oSymTable)[uHash & (psTable->uBucketCount - 1)];
+    psNewNode->uNextNode = *puBucket;
+    *puBucket = uOffset;
+    (psTable->length)++;
+
+    SymTable_endWrite(oSymTable);
+    *piAdded = 1;
+    return psNewNode;
+}
+
+/* Helper rehash function */
+int SymTable_rehash(SymTable_T oSymTable, size_t uNewBucketCount) {
+    struct Table* psTable;
+    struct Node* psNode;
+    size_t* puOldBuckets;
+    size_t* puNewBuckets;
+    size_t uNewBuckets;
+    size_t uOffset;
+    size_t uNextOffset;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(uNewBucketCount != 0 && (uNewBucketCount & (uNewBucketCount - 1)) == 0);
+
+    psTable = oSymTable->psTable;
+    uNewBuckets = SymTable_alloc(oSymTable->psPool, uNewBucketCount * sizeof(size_t));
+    if (uNewBuckets == 0) {
+        return 0;
+    }
+    puNewBuckets = (size_t*)SymTable_at(oSymTable, uNewBuckets);
+    memset(puNewBuckets, 0, uNewBucketCount * sizeof(size_t));
+
+    puOldBuckets = SymTable_buckets(oSymTable);
+    for (i = 0; i < psTable->uBucketCount; i++) {
+        for (uOffset = puOldBuckets[i]; uOffset != 0; uOffset = uNextOffset) {
+            psNode = (struct Node*)SymTable_at(oSymTable, uOffset);
+            uNextOffset = psNode->uNextNode;
+            psNode->uNextNode = puNewBuckets[psNode->uHash & (uNewBucketCount - 1)];
+            puNewBuckets[psNode->uHash & (uNewBucketCount - 1)] = uOffset;
+        }
+    }
+
+    SymTable_release(oSymTable->psPool, psTable->uBuckets,
+        psTable->uBucketCount * sizeof(size_t));
+    psTable->uBuckets = uNewBuckets;
+    psTable->uBucketCount = uNewBucketCount;
+    psTable->uResizeCount++;
+    return 1;
+}
+
+/* Helper bucket count function */
+size_t SymTable_bucketCountFor(size_t uBindingCount) {
+    size_t uBucketCount = INITIAL_BUCKET_COUNT;
+
+    while (uBucketCount < uBindingCount && uBucketCount < MAX_BUCKET_COUNT) {
+        uBucketCount *= 2;
+    }
+    return uBucketCount;
+}
+
+/* Helper map worker function */
+void* SymTable_mapWork(void *pvWorker) {
+    struct MapWorker* psWorker = (struct MapWorker*)pvWorker;
+    struct MapJob* psJob;
+    SymTable_T oSymTable;
+    size_t* puBuckets;
+    size_t uBucketCount;
+    size_t uStart;
+    size_t uEnd;
+    size_t i = 0;  /* loop counter */
+
+    assert(psWorker != NULL);
+
+    psJob = psWorker->psJob;
+    oSymTable = psJob->oSymTable;
+    puBuckets = SymTable_buckets(oSymTable);
+    uBucketCount = oSymTable->psTable->uBucketCount;
+    for (;;) {
+        uStart = __atomic_fetch_add(&psJob->uNext, MAP_STEP, __ATOMIC_RELAXED);
+        if (uStart >= uBucketCount) {
+            return NULL;
+        }
+        uEnd = uStart + MAP_STEP;
+        if (uEnd > uBucketCount) {
+            uEnd = uBucketCount;
+        }
+
+        for (i = uStart; i < uEnd; i++) {
+            (void)SymTable_applyChain(oSymTable, puBuckets[i], psJob->pfApply,
+                psWorker->pvExtra);
+        }
+    }
+}
+
+/* Helper apply chain function */
+size_t SymTable_applyChain(SymTable_T oSymTable, size_t uOffset,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra), void *pvExtra) {
+    struct Node* psNode;
+    size_t uVisited = 0;
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    for (; uOffset != 0; uOffset = psNode->uNextNode) {
+        psNode = (struct Node*)SymTable_at(oSymTable, uOffset);
+        (*pfApply)(SymTable_nodeKey(psNode), psNode->pvValue, pvExtra);
+        uVisited++;
+    }
+    return uVisited;
+}
+
+/* Helper chain statistics function */
+int SymTable_addChainStats(SymTable_T oSymTable, size_t uOffset, size_t uSequence,
+    SymTable_Stats *psStats) {
+    const struct Node* psNode;
+    size_t uSize;
+    size_t uLength;
+    size_t uChainLength = 0;
+
+    assert(oSymTable != NULL);
+    assert(psStats != NULL);
+
+    /* The checks are those of SymTable_search, and the key shares the node's block */
+    uSize = oSymTable->psPool->uSize;
+    while (uOffset != 0) {
+        if (uOffset % BLOCK_ALIGNMENT != 0 || uOffset > uSize - sizeof(struct Node) ||
+                __atomic_load_n(&oSymTable->psTable->uSequence, __ATOMIC_RELAXED) !=
+                uSequence) {
+            return 0;
+        }
+        psNode = (const struct Node*)SymTable_at(oSymTable, uOffset);
+        uLength = __atomic_load_n(&psNode->uLength, __ATOMIC_RELAXED);
+        psStats->uNodeBytes += sizeof(struct Node);
+        psStats->uKeyBytes += SymTable_blockSize(SymTable_nodeSize(uLength)) -
+            sizeof(struct Node);
+        uChainLength++;
+        uOffset = __atomic_load_n(&psNode->uNextNode, __ATOMIC_RELAXED);
+    }
+
+    psStats->auHistogram[uChainLength < SYMTABLE_HISTOGRAM_SIZE ?
+        uChainLength : SYMTABLE_HISTOGRAM_SIZE - 1]++;
+    if (uChainLength > psStats->uLongest) {
+        psStats->uLongest = uChainLength;
+    }
+    return 1;
+}
+
+/* Helper next cursor function */
+size_t SymTable_nextCursor(size_t uCursor, size_t uMask) {
+    size_t uBit;
+
+    /* Clear the highest bits of the cursor that are set, and set the highest one that is not */
+    uCursor &= uMask;
+    for (uBit = (uMask + 1) / 2; uBit != 0 && (uCursor & uBit) != 0; uBit /= 2) {
+        uCursor &= ~uBit;
+    }
+    return uCursor | uBit;
+}
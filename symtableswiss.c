@@ -0,0 +1,1260 @@
+/* symtableswiss.c
+Author: Tinney Mak */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "symtable.h"
+#include "symhash.h"
+
+/* Group matching compares a whole group of control bytes against a byte at once. Building
+with AVX2 enabled (e.g. -mavx2) uses 32-byte groups and one 256-bit compare; otherwise SSE2,
+which every x86-64 target has, uses 16-byte groups and one 128-bit compare. Defining
+SYMTABLE_SCALAR, or building for a target with neither, selects a portable matcher that works
+on 8 bytes at a time. It uses the same group width as the vector path it replaces, so a table
+built either way holds its bindings in the same slots. */
+#if defined(__AVX2__)
+enum {GROUP_WIDTH = 32};
+#else
+enum {GROUP_WIDTH = 16};
+#endif
+
+#if !defined(SYMTABLE_SCALAR) && defined(__AVX2__)
+#define SYMTABLE_AVX2
+#include <immintrin.h>
+#elif !defined(SYMTABLE_SCALAR) && defined(__SSE2__)
+#define SYMTABLE_SSE2
+#include <emmintrin.h>
+#endif
+
+/* The portable matcher is compiled when no vector path is, and also, beside the vector path,
+when SYMTABLE_MATCH_TEST is defined, so that testswissmatch.c can compare the two */
+#if (!defined(SYMTABLE_AVX2) && !defined(SYMTABLE_SSE2)) || defined(SYMTABLE_MATCH_TEST)
+#define SYMTABLE_PORTABLE_MATCH
+#endif
+
+/* Slots are probed in aligned groups of GROUP_WIDTH. The table grows once more than
+MAX_LOAD_NUMERATOR / MAX_LOAD_DENOMINATOR of its slots are full or deleted. */
+enum {MAX_LOAD_NUMERATOR = 7, MAX_LOAD_DENOMINATOR = 8};
+
+/* Group counts are powers of two, so the group where a key's probe starts is the low bits of
+its hash. The table starts with one group and doubles until it has MAX_GROUP_COUNT. */
+enum {MAX_GROUP_COUNT = 1 << 26};
+
+/* Once a removal leaves fewer than one binding per SHRINK_DIVISOR slots, the table is rehashed
+into about half as many groups as its bindings would fill, but no fewer than the capacity
+reserved with SymTable_reserve needs. Defining SYMTABLE_NO_AUTO_SHRINK turns this off. */
+enum {SHRINK_DIVISOR = 8};
+
+/* The batch functions look up BATCH_SIZE keys at a time: they hash them all and prefetch the
+control bytes of their first groups, then prefetch the first slot in each group whose tag
+matches, and only then search, so that the cache misses of the keys overlap. */
+enum {BATCH_SIZE = 16};
+
+/* The workers of SymTable_mapParallel claim MAP_STEP slots at a time, so that workers that
+finish early take on more of the rest. */
+enum {MAP_STEP = 16384};
+
+/* Hints that the memory at pv will be read soon */
+#if defined(__GNUC__)
+#define SymTable_prefetch(pv) __builtin_prefetch(pv)
+#else
+#define SymTable_prefetch(pv) ((void)(pv))
+#endif
+
+/* The seed of the default hash for tables made by SymTable_new */
+enum {DEFAULT_SEED = 0};
+
+/* Control byte values. A full slot holds the 7-bit tag of its key's hash, so its
+control byte has the high bit clear; empty and deleted slots have it set. */
+enum {CTRL_EMPTY = 0x80, CTRL_DELETED = 0xFE};
+
+/* Keys shorter than INLINE_KEY_SIZE - 1 bytes are stored inside their slot, which makes
+a slot 32 bytes on a 64-bit machine. The last byte of the slot's key holds the length of an
+inline key, or HEAP_KEY for a key stored on the heap. */
+enum {INLINE_KEY_SIZE = 24, HEAP_KEY = 0xFF};
+
+/* Each Slot contains a binding, consisting of a key and value. Slots are stored
+contiguously; which of them hold bindings is recorded in the control bytes. */
+struct Slot {
+    /* The key, followed by a '\0'. A short key is copied into acInline, whose last byte is
+    its length; a longer key is copied to the heap, sHeap holds the address of the copy and its
+    length, and the last byte of acInline is HEAP_KEY. */
+    union {
+        char acInline[INLINE_KEY_SIZE];
+        struct {
+            char* pcHeap;
+            size_t uLength;
+        } sHeap;
+    } uKey;
+
+    /* The value */
+    void* pvValue;
+};
+
+/* A SymTable is an open-addressing hash table: an array of control bytes, one per slot,
+and a parallel array of slots. */
+struct SymTable {
+    /* The address of the array of control bytes */
+    unsigned char* pucCtrl;
+
+    /* The address of the array of slots */
+    struct Slot* psSlots;
+
+    /* The number of slots, GROUP_WIDTH times the current group count */
+    size_t uCapacity;
+
+    /* The number of groups, a power of two */
+    size_t uGroupCount;
+
+    /* The number of the bindings in the symbol table */
+    size_t length;
+
+    /* The number of deleted slots */
+    size_t uDeleted;
+
+    /* The number of groups below which the table does not shrink by itself */
+    size_t uMinGroupCount;
+
+    /* The hash function and its seed */
+    SymTable_HashFunction pfHash;
+    size_t uSeed;
+
+    /* The number of times the bindings have been rehashed into new arrays */
+    size_t uResizeCount;
+#ifdef SYMTABLE_STATS
+    /* The operation counters of SymTable_getStats */
+    size_t uHits;
+    size_t uMisses;
+    size_t uCompares;
+#endif
+};
+
+/* Adds uAmount to the operation counter uCounter of oSymTable in a build with SYMTABLE_STATS
+defined, and does nothing otherwise */
+#ifdef SYMTABLE_STATS
+#define SymTable_count(oSymTable, uCounter, uAmount) ((oSymTable)->uCounter += (uAmount))
+#else
+#define SymTable_count(oSymTable, uCounter, uAmount) ((void)0)
+#endif
+
+/* A MapJob is the work that the workers of SymTable_mapParallel share. */
+struct MapJob {
+    /* The table */
+    SymTable_T oSymTable;
+
+    /* The function to apply */
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra);
+
+    /* The number of slots claimed so far */
+    size_t uNext;
+};
+
+/* A MapWorker is one worker of SymTable_mapParallel. */
+struct MapWorker {
+    /* The shared work */
+    struct MapJob* psJob;
+
+    /* The extra parameter of the worker */
+    void* pvExtra;
+
+    /* The thread of the worker, and whether it was started */
+    pthread_t sThread;
+    int iStarted;
+};
+
+/* Helper function that returns the key of the binding in psSlot.*/
+static const char* SymTable_slotKey(const struct Slot *psSlot);
+
+/* Helper function that returns the length of the key of the binding in psSlot.*/
+static size_t SymTable_slotKeyLength(const struct Slot *psSlot);
+
+/* Helper function that stores in psSlot a defensive copy of the uLength bytes at pcKey. Returns
+1 if successful and 0 if there is insufficient memory.*/
+static int SymTable_setSlotKey(struct Slot *psSlot, const char *pcKey, size_t uLength);
+
+/* Helper function that frees the heap copy of the key in psSlot, if there is one.*/
+static void SymTable_freeSlotKey(struct Slot *psSlot);
+
+/* Helper function that returns the hash of the uLength bytes at pcKey under the hash function
+and seed of oSymTable.*/
+static size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey, size_t uLength);
+
+/* Helper function that returns the 7-bit tag of hash uHash that is stored in the control byte
+of a full slot. It is drawn from the high bits of a scrambled copy of uHash, so that keys that
+start in the same group still get different tags.*/
+static unsigned char SymTable_tag(size_t uHash);
+
+/* Helper function that returns a bit mask with bit i set if slot i of the group whose control
+bytes start at pucGroup is empty or deleted, for 0 <= i < GROUP_WIDTH.*/
+static uint32_t SymTable_matchFree(const unsigned char *pucGroup);
+
+/* Helper function that returns a bit mask with bit i set if control byte pucGroup[i] equals
+ucValue, for 0 <= i < GROUP_WIDTH.*/
+static uint32_t SymTable_matchByte(const unsigned char *pucGroup, unsigned char ucValue);
+
+#if defined(SYMTABLE_PORTABLE_MATCH)
+/* Helper function that returns what SymTable_matchFree returns, using the portable matcher.*/
+static uint32_t SymTable_matchFreePortable(const unsigned char *pucGroup);
+
+/* Helper function that returns what SymTable_matchByte returns, using the portable matcher.*/
+static uint32_t SymTable_matchBytePortable(const unsigned char *pucGroup,
+    unsigned char ucValue);
+#endif
+
+/* Helper function that searches oSymTable for the slot whose key is the uLength bytes at pcKey,
+whose hash is uHash, and returns its index. If there is none, returns oSymTable->uCapacity and,
+unless puFreeIndex is NULL, stores in *puFreeIndex the index of the first empty or deleted slot
+on the key's probe sequence.*/
+static size_t SymTable_find(SymTable_T oSymTable, const char *pcKey, size_t uLength,
+    size_t uHash, size_t *puFreeIndex);
+
+/* Helper function that stores in puIndices[i] the index of the slot of oSymTable whose key is
+ppcKeys[i], or oSymTable->uCapacity if there is none, for 0 <= i < uCount, where uCount is at
+most BATCH_SIZE.*/
+static void SymTable_findBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    size_t *puIndices);
+
+/* Helper function that returns the slot of oSymTable whose key is the uLength bytes at pcKey,
+first adding a new binding of that key to pvValue if there is none. Sets *piAdded to 1 if the
+binding was added and 0 otherwise. Returns NULL if there is insufficient memory, leaving
+oSymTable unchanged.*/
+static struct Slot* SymTable_findOrAdd(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, const void *pvValue, int *piAdded);
+
+/* Helper function that moves every binding of oSymTable into new arrays with uNewGroupCount
+groups, dropping deleted slots. Returns 1 if successful and 0 if there is insufficient memory,
+in which case oSymTable is unchanged.*/
+static int SymTable_rehash(SymTable_T oSymTable, size_t uNewGroupCount);
+
+/* Helper function that returns the number of groups a table needs to hold uBindingCount
+bindings without growing: the least power of two whose slots stay under the load limit, or
+MAX_GROUP_COUNT if that is less.*/
+static size_t SymTable_groupCountFor(size_t uBindingCount);
+
+/* Helper function that rehashes oSymTable into enough groups to hold uBindingCount bindings
+without growing again, unless it already has them. Returns 1 if successful and 0 if there is
+insufficient memory, in which case oSymTable is unchanged.*/
+static int SymTable_growTo(SymTable_T oSymTable, size_t uBindingCount);
+
+/* Helper function that applies the function of the job of the MapWorker at pvWorker to the
+bindings in the slots it claims, until there are none left. Returns NULL.*/
+static void* SymTable_mapWork(void *pvWorker);
+
+/* Helper function that applies *pfApply to each binding of oSymTable whose probe starts in group
+uHome, passing pvExtra. Those are all in the groups from uHome up to the first one with an empty
+slot. Returns the number of bindings visited.*/
+static size_t SymTable_scanGroup(SymTable_T oSymTable, size_t uHome,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra), void *pvExtra);
+
+/* Helper function that returns the cursor of SymTable_scan that follows uCursor for groups
+chosen by the bits of uMask. Cursors advance by adding one to their reversed bits, so each group
+of a larger or smaller table covers a run of cursors, and rehashing between calls skips no
+binding. Returns 0 after the last cursor.*/
+static size_t SymTable_nextCursor(size_t uCursor, size_t uMask);
+
+SymTable_T SymTable_new(void) {
+    return SymTable_newWithHash(NULL, DEFAULT_SEED);
+}
+
+SymTable_T SymTable_newWithHash(SymTable_HashFunction pfHash, size_t uSeed) {
+    SymTable_T oSymTable;
+
+    oSymTable = (SymTable_T)calloc(1, sizeof(struct SymTable));
+    if (oSymTable == NULL) {
+        return NULL;
+    }
+
+    oSymTable->pucCtrl = (unsigned char*)malloc(GROUP_WIDTH);
+    oSymTable->psSlots = (struct Slot*)malloc(GROUP_WIDTH * sizeof(struct Slot));
+    if (oSymTable->pucCtrl == NULL || oSymTable->psSlots == NULL) {
+        free(oSymTable->pucCtrl);
+        free(oSymTable->psSlots);
+        free(oSymTable);
+        return NULL;
+    }
+    memset(oSymTable->pucCtrl, CTRL_EMPTY, GROUP_WIDTH);
+
+    oSymTable->uCapacity = GROUP_WIDTH;
+    oSymTable->uGroupCount = 1;
+    oSymTable->length = 0;
+    oSymTable->uDeleted = 0;
+    oSymTable->uMinGroupCount = 1;
+    oSymTable->pfHash = (pfHash != NULL) ? pfHash : SymHash_hash;
+    oSymTable->uSeed = uSeed;
+    oSymTable->uResizeCount = 0;
+    return oSymTable;
+}
+
+SymTable_T SymTable_newWithCapacity(size_t uCapacity) {
+    SymTable_T oSymTable;
+
+    oSymTable = SymTable_new();
+    if (oSymTable == NULL) {
+        return NULL;
+    }
+    if (!SymTable_reserve(oSymTable, uCapacity)) {
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+    return oSymTable;
+}
+
+SymTable_T SymTable_newConcurrent(void) {
+    /* A probe sequence crosses groups, so no group can be guarded on its own */
+    return NULL;
+}
+
+int SymTable_reserve(SymTable_T oSymTable, size_t uCapacity) {
+    size_t uGroupCount;
+
+    assert(oSymTable != NULL);
+
+    if (!SymTable_growTo(oSymTable, uCapacity)) {
+        return 0;
+    }
+    uGroupCount = SymTable_groupCountFor(uCapacity);
+    if (uGroupCount > oSymTable->uMinGroupCount) {
+        oSymTable->uMinGroupCount = uGroupCount;
+    }
+    return 1;
+}
+
+int SymTable_shrinkToFit(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+
+    /* Rehashing also clears out the deleted slots */
+    if (!SymTable_rehash(oSymTable, SymTable_groupCountFor(oSymTable->length))) {
+        return 0;
+    }
+    oSymTable->uMinGroupCount = 1;
+    return 1;
+}
+
+void SymTable_free(SymTable_T oSymTable) {
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+
+    for (i = 0; i < oSymTable->uCapacity; i++) {
+        if (oSymTable->pucCtrl[i] < CTRL_EMPTY) {
+            SymTable_freeSlotKey(&oSymTable->psSlots[i]);
+        }
+    }
+
+    free(oSymTable->pucCtrl);
+    free(oSymTable->psSlots);
+    free(oSymTable);
+}
+
+size_t SymTable_getLength(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+    return oSymTable->length;
+}
+
+size_t SymTable_getBucketCount(SymTable_T oSymTable) {
+    assert(oSymTable != NULL);
+    return oSymTable->uCapacity;
+}
+
+void SymTable_getStats(SymTable_T oSymTable, SymTable_Stats *psStats) {
+    const struct Slot* psSlot;
+    size_t uHome;
+    size_t uDistance;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(psStats != NULL);
+
+    memset(psStats, 0, sizeof(SymTable_Stats));
+
+    psStats->uLength = oSymTable->length;
+    psStats->uBucketCount = oSymTable->uCapacity;
+    psStats->dLoadFactor = (double)oSymTable->length / (double)oSymTable->uCapacity;
+    psStats->uResizeCount = oSymTable->uResizeCount;
+
+    /* A binding's probe length is the number of groups between the one its probe starts in
+    and its own, which takes hashing its key again */
+    for (i = 0; i < oSymTable->uCapacity; i++) {
+        if (oSymTable->pucCtrl[i] >= CTRL_EMPTY) {
+            continue;
+        }
+        psSlot = &oSymTable->psSlots[i];
+        uHome = SymTable_hash(oSymTable, SymTable_slotKey(psSlot),
+            SymTable_slotKeyLength(psSlot)) & (oSymTable->uGroupCount - 1);
+        uDistance = (i / GROUP_WIDTH - uHome) & (oSymTable->uGroupCount - 1);
+
+        psStats->auHistogram[uDistance < SYMTABLE_HISTOGRAM_SIZE ?
+            uDistance : SYMTABLE_HISTOGRAM_SIZE - 1]++;
+        if (uDistance > psStats->uLongest) {
+            psStats->uLongest = uDistance;
+        }
+        if ((unsigned char)psSlot->uKey.acInline[INLINE_KEY_SIZE - 1] == HEAP_KEY) {
+            psStats->uKeyBytes += psSlot->uKey.sHeap.uLength + 1;
+        }
+    }
+
+    /* Every slot is allocated whether or not it holds a binding, and the control bytes play
+    the part of buckets */
+    psStats->uNodeBytes = oSymTable->uCapacity * sizeof(struct Slot);
+    psStats->uBucketBytes = oSymTable->uCapacity;
+
+#ifdef SYMTABLE_STATS
+    psStats->uHits = oSymTable->uHits;
+    psStats->uMisses = oSymTable->uMisses;
+    psStats->uCompares = oSymTable->uCompares;
+#endif
+}
+
+int SymTable_put(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue) {
+    assert(pcKey != NULL);
+    return SymTable_putN(oSymTable, pcKey, strlen(pcKey), pvValue);
+}
+
+int SymTable_putN(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength, const void *pvValue) {
+    struct Slot* psSlot;
+    int iAdded;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psSlot = SymTable_findOrAdd(oSymTable, pcKey, uLength, pvValue, &iAdded);
+    return (psSlot != NULL) && iAdded;
+}
+
+void **SymTable_getOrPut(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue) {
+    struct Slot* psSlot;
+    int iAdded;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psSlot = SymTable_findOrAdd(oSymTable, pcKey, strlen(pcKey), pvValue, &iAdded);
+    if (psSlot == NULL) {
+        return NULL;
+    }
+    return &psSlot->pvValue;
+}
+
+int SymTable_upsert(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue) {
+    return SymTable_putOrReplace(oSymTable, pcKey, pvValue, NULL) >= 0;
+}
+
+int SymTable_putOrReplace(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue, void **ppvOldValue) {
+    struct Slot* psSlot;
+    int iAdded;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    psSlot = SymTable_findOrAdd(oSymTable, pcKey, strlen(pcKey), pvValue, &iAdded);
+    if (psSlot == NULL) {
+        return -1;
+    }
+    if (iAdded) {
+        return 1;
+    }
+
+    if (ppvOldValue != NULL) {
+        *ppvOldValue = psSlot->pvValue;
+    }
+    psSlot->pvValue = (void*)pvValue;
+    return 0;
+}
+
+void *SymTable_replace(SymTable_T oSymTable,
+    const char *pcKey, const void *pvValue) {
+    assert(pcKey != NULL);
+    return SymTable_replaceN(oSymTable, pcKey, strlen(pcKey), pvValue);
+}
+
+void *SymTable_replaceN(SymTable_T oSymTable,
+    const char *pcKey, size_t uLength, const void *pvValue) {
+    void* pvOldValue;
+    size_t uIndex;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uIndex = SymTable_find(oSymTable, pcKey, uLength,
+        SymTable_hash(oSymTable, pcKey, uLength), NULL);
+    if (uIndex == oSymTable->uCapacity) {
+        return NULL;
+    }
+
+    pvOldValue = oSymTable->psSlots[uIndex].pvValue;
+    oSymTable->psSlots[uIndex].pvValue = (void*)pvValue;
+    return pvOldValue;
+}
+
+int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
+    assert(pcKey != NULL);
+    return SymTable_containsN(oSymTable, pcKey, strlen(pcKey));
+}
+
+int SymTable_containsN(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return SymTable_find(oSymTable, pcKey, uLength,
+        SymTable_hash(oSymTable, pcKey, uLength), NULL) !=
+        oSymTable->uCapacity;
+}
+
+void *SymTable_get(SymTable_T oSymTable, const char *pcKey) {
+    assert(pcKey != NULL);
+    return SymTable_getN(oSymTable, pcKey, strlen(pcKey));
+}
+
+void *SymTable_getN(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
+    size_t uIndex;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uIndex = SymTable_find(oSymTable, pcKey, uLength,
+        SymTable_hash(oSymTable, pcKey, uLength), NULL);
+    if (uIndex == oSymTable->uCapacity) {
+        return NULL;
+    }
+    return oSymTable->psSlots[uIndex].pvValue;
+}
+
+void *SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+    assert(pcKey != NULL);
+    return SymTable_removeN(oSymTable, pcKey, strlen(pcKey));
+}
+
+void *SymTable_removeN(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
+    void* pvOldValue;
+    size_t uIndex;
+    size_t uGroupStart;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    uIndex = SymTable_find(oSymTable, pcKey, uLength,
+        SymTable_hash(oSymTable, pcKey, uLength), NULL);
+    if (uIndex == oSymTable->uCapacity) {
+        return NULL;
+    }
+
+    pvOldValue = oSymTable->psSlots[uIndex].pvValue;
+    SymTable_freeSlotKey(&oSymTable->psSlots[uIndex]);
+
+    /* Probing stops at the first group with an empty slot, so if this slot's group already
+    has one, no probe sequence runs past it and the slot can become empty again. Otherwise
+    leave a deleted marker so that later probes keep going. */
+    uGroupStart = uIndex & ~(size_t)(GROUP_WIDTH - 1);
+    if (SymTable_matchByte(&oSymTable->pucCtrl[uGroupStart], CTRL_EMPTY) != 0) {
+        oSymTable->pucCtrl[uIndex] = CTRL_EMPTY;
+    } else {
+        oSymTable->pucCtrl[uIndex] = CTRL_DELETED;
+        (oSymTable->uDeleted)++;
+    }
+
+    (oSymTable->length)--;
+
+#ifndef SYMTABLE_NO_AUTO_SHRINK
+    /* If shrinking fails, the table keeps working at its current size */
+    if (oSymTable->length * SHRINK_DIVISOR < oSymTable->uCapacity &&
+            oSymTable->uGroupCount > oSymTable->uMinGroupCount) {
+        size_t uNewGroupCount = SymTable_groupCountFor(oSymTable->length * 2);
+        if (uNewGroupCount < oSymTable->uMinGroupCount) {
+            uNewGroupCount = oSymTable->uMinGroupCount;
+        }
+        (void)SymTable_rehash(oSymTable, uNewGroupCount);
+    }
+#endif
+    return pvOldValue;
+}
+
+void SymTable_getBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    void **ppvValues) {
+    size_t auIndices[BATCH_SIZE];
+    size_t uBatch;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(ppcKeys != NULL || uCount == 0);
+    assert(ppvValues != NULL || uCount == 0);
+
+    for (; uCount > 0; uCount -= uBatch, ppcKeys += uBatch, ppvValues += uBatch) {
+        uBatch = uCount < BATCH_SIZE ? uCount : BATCH_SIZE;
+        SymTable_findBatch(oSymTable, ppcKeys, uBatch, auIndices);
+        for (i = 0; i < uBatch; i++) {
+            ppvValues[i] = auIndices[i] != oSymTable->uCapacity ?
+                oSymTable->psSlots[auIndices[i]].pvValue : NULL;
+        }
+    }
+}
+
+void SymTable_containsBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    int *piFound) {
+    size_t auIndices[BATCH_SIZE];
+    size_t uBatch;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(ppcKeys != NULL || uCount == 0);
+    assert(piFound != NULL || uCount == 0);
+
+    for (; uCount > 0; uCount -= uBatch, ppcKeys += uBatch, piFound += uBatch) {
+        uBatch = uCount < BATCH_SIZE ? uCount : BATCH_SIZE;
+        SymTable_findBatch(oSymTable, ppcKeys, uBatch, auIndices);
+        for (i = 0; i < uBatch; i++) {
+            piFound[i] = auIndices[i] != oSymTable->uCapacity;
+        }
+    }
+}
+
+int SymTable_putBatch(SymTable_T oSymTable, const char **ppcKeys, void **ppvValues,
+    size_t uCount, int *piRejected) {
+    struct Slot* psSlot;
+    int iAdded;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(ppcKeys != NULL || uCount == 0);
+    assert(ppvValues != NULL || uCount == 0);
+
+    /* If the arrays cannot be allocated, the puts below still grow the table step by step */
+    (void)SymTable_growTo(oSymTable, oSymTable->length + uCount);
+
+    for (i = 0; i < uCount; i++) {
+        assert(ppcKeys[i] != NULL);
+        psSlot = SymTable_findOrAdd(oSymTable, ppcKeys[i], strlen(ppcKeys[i]), ppvValues[i],
+            &iAdded);
+        if (psSlot == NULL) {
+            return 0;
+        }
+        if (piRejected != NULL) {
+            piRejected[i] = !iAdded;
+        }
+    }
+    return 1;
+}
+
+SymTable_T SymTable_bulkLoad(const char **ppcKeys, void **ppvValues, size_t uCount,
+    int *piRejected) {
+    SymTable_T oSymTable;
+
+    oSymTable = SymTable_new();
+    if (oSymTable == NULL) {
+        return NULL;
+    }
+    if (!SymTable_putBatch(oSymTable, ppcKeys, ppvValues, uCount, piRejected)) {
+        SymTable_free(oSymTable);
+        return NULL;
+    }
+    return oSymTable;
+}
+
+void SymTable_map(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    for (i = 0; i < oSymTable->uCapacity; i++) {
+        if (oSymTable->pucCtrl[i] < CTRL_EMPTY) {
+            (*pfApply)(SymTable_slotKey(&oSymTable->psSlots[i]), oSymTable->psSlots[i].pvValue,
+                (void*)pvExtra);
+        }
+    }
+}
+
+void SymTable_mapParallel(SymTable_T oSymTable,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    void **ppvExtras, size_t uThreadCount) {
+    struct MapJob sJob;
+    struct MapWorker* psWorkers;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    sJob.oSymTable = oSymTable;
+    sJob.pfApply = pfApply;
+    sJob.uNext = 0;
+
+    /* Without memory for the workers, the calling thread does it all */
+    if (uThreadCount == 0) {
+        uThreadCount = 1;
+    }
+    psWorkers = (struct MapWorker*)calloc(uThreadCount, sizeof(struct MapWorker));
+    if (psWorkers == NULL) {
+        struct MapWorker sWorker;
+        sWorker.psJob = &sJob;
+        sWorker.pvExtra = (ppvExtras != NULL) ? ppvExtras[0] : NULL;
+        (void)SymTable_mapWork(&sWorker);
+        return;
+    }
+
+    for (i = 0; i < uThreadCount; i++) {
+        psWorkers[i].psJob = &sJob;
+        psWorkers[i].pvExtra = (ppvExtras != NULL) ? ppvExtras[i] : NULL;
+    }
+    for (i = 1; i < uThreadCount; i++) {
+        psWorkers[i].iStarted = pthread_create(&psWorkers[i].sThread, NULL,
+            SymTable_mapWork, &psWorkers[i]) == 0;
+    }
+    (void)SymTable_mapWork(&psWorkers[0]);
+    for (i = 1; i < uThreadCount; i++) {
+        if (psWorkers[i].iStarted) {
+            pthread_join(psWorkers[i].sThread, NULL);
+        }
+    }
+    free(psWorkers);
+}
+
+void SymTable_iterBegin(SymTable_T oSymTable, SymTable_Iter *psIter) {
+    assert(oSymTable != NULL);
+    assert(psIter != NULL);
+
+    psIter->oSymTable = oSymTable;
+    psIter->uIndex = 0;
+    psIter->pvNext = NULL;
+}
+
+int SymTable_iterNext(SymTable_Iter *psIter, const char **ppcKey, size_t *puLength,
+    void **ppvValue) {
+    SymTable_T oSymTable;
+    const struct Slot* psSlot;
+
+    assert(psIter != NULL);
+    assert(psIter->oSymTable != NULL);
+
+    /* uIndex is the slot after the last one returned */
+    oSymTable = psIter->oSymTable;
+    while (psIter->uIndex < oSymTable->uCapacity &&
+            oSymTable->pucCtrl[psIter->uIndex] >= CTRL_EMPTY) {
+        psIter->uIndex++;
+    }
+    if (psIter->uIndex == oSymTable->uCapacity) {
+        return 0;
+    }
+    psSlot = &oSymTable->psSlots[psIter->uIndex];
+    psIter->uIndex++;
+
+    if (ppcKey != NULL) {
+        *ppcKey = SymTable_slotKey(psSlot);
+    }
+    if (puLength != NULL) {
+        *puLength = SymTable_slotKeyLength(psSlot);
+    }
+    if (ppvValue != NULL) {
+        *ppvValue = psSlot->pvValue;
+    }
+    return 1;
+}
+
+void SymTable_iterEnd(SymTable_Iter *psIter) {
+    assert(psIter != NULL);
+    psIter->oSymTable = NULL;
+}
+
+size_t SymTable_scan(SymTable_T oSymTable, size_t uCursor, size_t uCount,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+    const void *pvExtra) {
+    size_t uApplied = 0;
+    size_t uGroupsPassed = 0;
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    /* Cursors pick the group where the probes of bindings start. A call stops early once it
+    has passed over as many groups as bindings it was asked to visit, so that a scan of a sparse
+    table still returns now and then. */
+    do {
+        uApplied += SymTable_scanGroup(oSymTable, uCursor & (oSymTable->uGroupCount - 1),
+            pfApply, (void*)pvExtra);
+        uCursor = SymTable_nextCursor(uCursor, oSymTable->uGroupCount - 1);
+        uGroupsPassed++;
+    } while (uCursor != 0 && uApplied < uCount && uGroupsPassed < uCount);
+    return uCursor;
+}
+
+/* Helper map worker function */
+void* SymTable_mapWork(void *pvWorker) {
+    struct MapWorker* psWorker = (struct MapWorker*)pvWorker;
+    struct MapJob* psJob;
+    SymTable_T oSymTable;
+    size_t uStart;
+    size_t uEnd;
+    size_t i = 0;  /* loop counter */
+
+    assert(psWorker != NULL);
+
+    psJob = psWorker->psJob;
+    oSymTable = psJob->oSymTable;
+    for (;;) {
+        uStart = __atomic_fetch_add(&psJob->uNext, MAP_STEP, __ATOMIC_RELAXED);
+        if (uStart >= oSymTable->uCapacity) {
+            return NULL;
+        }
+        uEnd = uStart + MAP_STEP;
+        if (uEnd > oSymTable->uCapacity) {
+            uEnd = oSymTable->uCapacity;
+        }
+
+        for (i = uStart; i < uEnd; i++) {
+            if (oSymTable->pucCtrl[i] < CTRL_EMPTY) {
+                (*psJob->pfApply)(SymTable_slotKey(&oSymTable->psSlots[i]),
+                    oSymTable->psSlots[i].pvValue, psWorker->pvExtra);
+            }
+        }
+    }
+}
+
+/* Helper scan group function */
+size_t SymTable_scanGroup(SymTable_T oSymTable, size_t uHome,
+    void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra), void *pvExtra) {
+    const struct Slot* psSlot;
+    size_t uGroupMask;
+    size_t uGroup;
+    size_t uIndex;
+    size_t uVisited = 0;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(pfApply != NULL);
+
+    /* The load limit guarantees that some group has an empty slot, ending the run */
+    uGroupMask = oSymTable->uGroupCount - 1;
+    for (uGroup = uHome; ; uGroup = (uGroup + 1) & uGroupMask) {
+        for (i = 0; i < GROUP_WIDTH; i++) {
+            uIndex = uGroup * GROUP_WIDTH + i;
+            if (oSymTable->pucCtrl[uIndex] >= CTRL_EMPTY) {
+                continue;
+            }
+            psSlot = &oSymTable->psSlots[uIndex];
+            if ((SymTable_hash(oSymTable, SymTable_slotKey(psSlot),
+                    SymTable_slotKeyLength(psSlot)) & uGroupMask) == uHome) {
+                (*pfApply)(SymTable_slotKey(psSlot), psSlot->pvValue, pvExtra);
+                uVisited++;
+            }
+        }
+        if (SymTable_matchByte(&oSymTable->pucCtrl[uGroup * GROUP_WIDTH], CTRL_EMPTY) != 0) {
+            return uVisited;
+        }
+    }
+}
+
+/* Helper next cursor function */
+size_t SymTable_nextCursor(size_t uCursor, size_t uMask) {
+    size_t uBit;
+
+    /* Clear the highest bits of the cursor that are set, and set the highest one that is not */
+    uCursor &= uMask;
+    for (uBit = (uMask + 1) / 2; uBit != 0 && (uCursor & uBit) != 0; uBit /= 2) {
+        uCursor &= ~uBit;
+    }
+    return uCursor | uBit;
+}
+
+/* Helper find function */
+size_t SymTable_find(SymTable_T oSymTable, const char *pcKey, size_t uLength,
+    size_t uHash, size_t *puFreeIndex) {
+    unsigned char ucTag;
+    size_t uGroupCount;
+    size_t uGroup;
+    size_t uIndex;
+    uint32_t uMatches;
+    int iFreeFound = 0;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    ucTag = SymTable_tag(uHash);
+    uGroupCount = oSymTable->uGroupCount;
+    uGroup = uHash & (uGroupCount - 1);
+
+    /* Visit groups in order, wrapping around. The load limit guarantees that some group has
+    an empty slot, ending the search. */
+    for (;;) {
+        const unsigned char* pucGroup = &oSymTable->pucCtrl[uGroup * GROUP_WIDTH];
+
+        for (uMatches = SymTable_matchByte(pucGroup, ucTag);
+                uMatches != 0;
+                uMatches &= uMatches - 1) {
+            const struct Slot* psSlot;
+
+            /* Only compare the bytes of keys of the right length */
+            uIndex = uGroup * GROUP_WIDTH + (size_t)__builtin_ctz(uMatches);
+            psSlot = &oSymTable->psSlots[uIndex];
+            SymTable_count(oSymTable, uCompares, 1);
+            if (SymTable_slotKeyLength(psSlot) == uLength &&
+                    memcmp(SymTable_slotKey(psSlot), pcKey, uLength) == 0) {
+                SymTable_count(oSymTable, uHits, 1);
+                return uIndex;
+            }
+        }
+
+        uMatches = SymTable_matchFree(pucGroup);
+        if (uMatches != 0) {
+            if (puFreeIndex != NULL && !iFreeFound) {
+                *puFreeIndex = uGroup * GROUP_WIDTH + (size_t)__builtin_ctz(uMatches);
+                iFreeFound = 1;
+            }
+            if (SymTable_matchByte(pucGroup, CTRL_EMPTY) != 0) {
+                SymTable_count(oSymTable, uMisses, 1);
+                return oSymTable->uCapacity;
+            }
+        }
+
+        uGroup = (uGroup + 1) & (uGroupCount - 1);
+    }
+}
+
+/* Helper batch find function */
+void SymTable_findBatch(SymTable_T oSymTable, const char **ppcKeys, size_t uCount,
+    size_t *puIndices) {
+    size_t auHashes[BATCH_SIZE];
+    size_t auLengths[BATCH_SIZE];
+    size_t uGroupStart;
+    uint32_t uMatches;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(ppcKeys != NULL);
+    assert(puIndices != NULL);
+    assert(uCount <= BATCH_SIZE);
+
+    for (i = 0; i < uCount; i++) {
+        assert(ppcKeys[i] != NULL);
+        auLengths[i] = strlen(ppcKeys[i]);
+        auHashes[i] = SymTable_hash(oSymTable, ppcKeys[i], auLengths[i]);
+        uGroupStart = (auHashes[i] & (oSymTable->uGroupCount - 1)) * GROUP_WIDTH;
+        SymTable_prefetch(&oSymTable->pucCtrl[uGroupStart]);
+    }
+
+    /* Most keys that are present are in the first group of their probe sequence */
+    for (i = 0; i < uCount; i++) {
+        uGroupStart = (auHashes[i] & (oSymTable->uGroupCount - 1)) * GROUP_WIDTH;
+        uMatches = SymTable_matchByte(&oSymTable->pucCtrl[uGroupStart],
+            SymTable_tag(auHashes[i]));
+        if (uMatches != 0) {
+            SymTable_prefetch(&oSymTable->psSlots[uGroupStart +
+                (size_t)__builtin_ctz(uMatches)]);
+        }
+    }
+
+    for (i = 0; i < uCount; i++) {
+        puIndices[i] = SymTable_find(oSymTable, ppcKeys[i], auLengths[i], auHashes[i], NULL);
+    }
+}
+
+/* Helper find-or-add function */
+struct Slot* SymTable_findOrAdd(SymTable_T oSymTable, const char *pcKey,
+    size_t uLength, const void *pvValue, int *piAdded) {
+    struct Slot* psSlot;
+    size_t uHash;
+    size_t uIndex;
+    size_t uFreeIndex = 0;
+
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+    assert(piAdded != NULL);
+
+    *piAdded = 0;
+    uHash = SymTable_hash(oSymTable, pcKey, uLength);
+
+    /* Grow (or, if deleted slots account for the load, just clean up) before the search,
+    so that the free slot it finds stays valid for the insertion. If that fails, keep going
+    as long as a free slot remains. */
+    if ((oSymTable->length + oSymTable->uDeleted + 1) * MAX_LOAD_DENOMINATOR >
+            oSymTable->uCapacity * MAX_LOAD_NUMERATOR) {
+        size_t uNewGroupCount = oSymTable->uGroupCount;
+        if (oSymTable->length * 2 * MAX_LOAD_DENOMINATOR >=
+                oSymTable->uCapacity * MAX_LOAD_NUMERATOR &&
+                uNewGroupCount < MAX_GROUP_COUNT) {
+            uNewGroupCount *= 2;
+        }
+        if (!SymTable_rehash(oSymTable, uNewGroupCount) &&
+                oSymTable->length + oSymTable->uDeleted + 1 >= oSymTable->uCapacity) {
+            /* Keep at least one empty slot so that every probe terminates */
+            uIndex = SymTable_find(oSymTable, pcKey, uLength, uHash, NULL);
+            return uIndex == oSymTable->uCapacity ? NULL : &oSymTable->psSlots[uIndex];
+        }
+    }
+
+    uIndex = SymTable_find(oSymTable, pcKey, uLength, uHash, &uFreeIndex);
+    if (uIndex != oSymTable->uCapacity) {
+        return &oSymTable->psSlots[uIndex];
+    }
+
+    psSlot = &oSymTable->psSlots[uFreeIndex];
+    if (!SymTable_setSlotKey(psSlot, pcKey, uLength)) {
+        return NULL;
+    }
+    psSlot->pvValue = (void*)pvValue;
+
+    if (oSymTable->pucCtrl[uFreeIndex] == CTRL_DELETED) {
+        (oSymTable->uDeleted)--;
+    }
+    oSymTable->pucCtrl[uFreeIndex] = SymTable_tag(uHash);
+
+    (oSymTable->length)++;
+    *piAdded = 1;
+    return psSlot;
+}
+
+/* Helper group count function */
+size_t SymTable_groupCountFor(size_t uBindingCount) {
+    size_t uGroupCount = 1;
+
+    while (uBindingCount * MAX_LOAD_DENOMINATOR >
+            uGroupCount * GROUP_WIDTH * MAX_LOAD_NUMERATOR &&
+            uGroupCount < MAX_GROUP_COUNT) {
+        uGroupCount *= 2;
+    }
+    return uGroupCount;
+}
+
+/* Helper grow-to function */
+int SymTable_growTo(SymTable_T oSymTable, size_t uBindingCount) {
+    size_t uNewGroupCount;
+
+    assert(oSymTable != NULL);
+
+    uNewGroupCount = SymTable_groupCountFor(uBindingCount);
+    if (uNewGroupCount <= oSymTable->uGroupCount) {
+        return 1;
+    }
+    return SymTable_rehash(oSymTable, uNewGroupCount);
+}
+
+/* Helper rehash function */
+int SymTable_rehash(SymTable_T oSymTable, size_t uNewGroupCount) {
+    unsigned char* pucNewCtrl;
+    struct Slot* psNewSlots;
+    size_t uNewCapacity;
+    size_t i = 0;  /* loop counter */
+
+    assert(oSymTable != NULL);
+    assert(uNewGroupCount > 0 && (uNewGroupCount & (uNewGroupCount - 1)) == 0);
+
+    uNewCapacity = uNewGroupCount * GROUP_WIDTH;
+
+    pucNewCtrl = (unsigned char*)malloc(uNewCapacity);
+    psNewSlots = (struct Slot*)malloc(uNewCapacity * sizeof(struct Slot));
+    if (pucNewCtrl == NULL || psNewSlots == NULL) {
+        free(pucNewCtrl);
+        free(psNewSlots);
+        return 0;
+    }
+    memset(pucNewCtrl, CTRL_EMPTY, uNewCapacity);
+
+    /* The new arrays hold no deleted slots, so each binding goes into the first empty slot
+    on its probe sequence */
+    for (i = 0; i < oSymTable->uCapacity; i++) {
+        size_t uGroup;
+        size_t uNewIndex;
+        uint32_t uEmpty;
+
+        if (oSymTable->pucCtrl[i] >= CTRL_EMPTY) {
+            continue;
+        }
+
+        uGroup = SymTable_hash(oSymTable, SymTable_slotKey(&oSymTable->psSlots[i]),
+            SymTable_slotKeyLength(&oSymTable->psSlots[i])) & (uNewGroupCount - 1);
+        for (;;) {
+            uEmpty = SymTable_matchByte(&pucNewCtrl[uGroup * GROUP_WIDTH], CTRL_EMPTY);
+            if (uEmpty != 0) {
+                break;
+            }
+            uGroup = (uGroup + 1) & (uNewGroupCount - 1);
+        }
+
+        uNewIndex = uGroup * GROUP_WIDTH + (size_t)__builtin_ctz(uEmpty);
+        pucNewCtrl[uNewIndex] = oSymTable->pucCtrl[i];
+        psNewSlots[uNewIndex] = oSymTable->psSlots[i];
+    }
+
+    free(oSymTable->pucCtrl);
+    free(oSymTable->psSlots);
+    oSymTable->pucCtrl = pucNewCtrl;
+    oSymTable->psSlots = psNewSlots;
+    oSymTable->uCapacity = uNewCapacity;
+    oSymTable->uGroupCount = uNewGroupCount;
+    oSymTable->uDeleted = 0;
+    oSymTable->uResizeCount++;
+    return 1;
+}
+
+#if defined(SYMTABLE_AVX2)
+
+/* Helper match function */
+uint32_t SymTable_matchByte(const unsigned char *pucGroup, unsigned char ucValue) {
+    __m256i iCtrl = _mm256_loadu_si256((const __m256i*)pucGroup);
+    return (uint32_t)_mm256_movemask_epi8(
+        _mm256_cmpeq_epi8(iCtrl, _mm256_set1_epi8((char)ucValue)));
+}
+
+/* Helper free-slot match function. The free control bytes are exactly those with the high bit
+set, which is what movemask collects. */
+uint32_t SymTable_matchFree(const unsigned char *pucGroup) {
+    return (uint32_t)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)pucGroup));
+}
+
+#elif defined(SYMTABLE_SSE2)
+
+/* Helper match function */
+uint32_t SymTable_matchByte(const unsigned char *pucGroup, unsigned char ucValue) {
+    __m128i iCtrl = _mm_loadu_si128((const __m128i*)pucGroup);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(iCtrl, _mm_set1_epi8((char)ucValue)));
+}
+
+/* Helper free-slot match function. The free control bytes are exactly those with the high bit
+set, which is what movemask collects. */
+uint32_t SymTable_matchFree(const unsigned char *pucGroup) {
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)pucGroup));
+}
+
+#else
+
+/* Helper match function */
+uint32_t SymTable_matchByte(const unsigned char *pucGroup, unsigned char ucValue) {
+    return SymTable_matchBytePortable(pucGroup, ucValue);
+}
+
+/* Helper free-slot match function */
+uint32_t SymTable_matchFree(const unsigned char *pucGroup) {
+    return SymTable_matchFreePortable(pucGroup);
+}
+
+#endif
+
+#if defined(SYMTABLE_PORTABLE_MATCH)
+
+/* Helper function that loads the 8 control bytes at pucCtrl into a word, byte i in bits 8i
+through 8i+7 */
+static uint64_t SymTable_loadWord(const unsigned char *pucCtrl) {
+    uint64_t uWord;
+
+    memcpy(&uWord, pucCtrl, sizeof(uWord));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    uWord = __builtin_bswap64(uWord);
+#endif
+    return uWord;
+}
+
+/* Helper function that packs the high bit of each byte of uHighBits into an 8-bit mask, the
+high bit of byte i becoming bit i. Every other bit of uHighBits must be clear. */
+static uint32_t SymTable_packHighBits(uint64_t uHighBits) {
+    return (uint32_t)(((uHighBits >> 7) * 0x0102040810204080ULL) >> 56);
+}
+
+/* Helper portable match function. Works on GROUP_WIDTH / 8 words at a time: XORing with
+ucValue turns matching bytes into zero bytes, which the carry-free zero-byte test then flags
+exactly. */
+uint32_t SymTable_matchBytePortable(const unsigned char *pucGroup, unsigned char ucValue) {
+    const uint64_t LOW_SEVEN = 0x7F7F7F7F7F7F7F7FULL;
+    const uint64_t uPattern = 0x0101010101010101ULL * ucValue;
+    uint32_t uMatches = 0;
+    int i;  /* loop counter */
+
+    for (i = 0; i < GROUP_WIDTH; i += 8) {
+        uint64_t uWord = SymTable_loadWord(&pucGroup[i]) ^ uPattern;
+        uint64_t uZero = ~(((uWord & LOW_SEVEN) + LOW_SEVEN) | uWord | LOW_SEVEN);
+        uMatches |= SymTable_packHighBits(uZero) << i;
+    }
+    return uMatches;
+}
+
+/* Helper portable free-slot match function */
+uint32_t SymTable_matchFreePortable(const unsigned char *pucGroup) {
+    const uint64_t HIGH_BITS = 0x8080808080808080ULL;
+    uint32_t uMatches = 0;
+    int i;  /* loop counter */
+
+    for (i = 0; i < GROUP_WIDTH; i += 8) {
+        uMatches |= SymTable_packHighBits(SymTable_loadWord(&pucGroup[i]) & HIGH_BITS) << i;
+    }
+    return uMatches;
+}
+
+#endif
+
+/* Helper slot key function */
+const char* SymTable_slotKey(const struct Slot *psSlot) {
+    assert(psSlot != NULL);
+
+    if ((unsigned char)psSlot->uKey.acInline[INLINE_KEY_SIZE - 1] == HEAP_KEY) {
+        return psSlot->uKey.sHeap.pcHeap;
+    }
+    return psSlot->uKey.acInline;
+}
+
+/* Helper slot key length function */
+size_t SymTable_slotKeyLength(const struct Slot *psSlot) {
+    unsigned char ucLast;
+
+    assert(psSlot != NULL);
+
+    ucLast = (unsigned char)psSlot->uKey.acInline[INLINE_KEY_SIZE - 1];
+    if (ucLast == HEAP_KEY) {
+        return psSlot->uKey.sHeap.uLength;
+    }
+    return ucLast;
+}
+
+/* Helper set slot key function */
+int SymTable_setSlotKey(struct Slot *psSlot, const char *pcKey, size_t uLength) {
+    char* pcKeyCopy;
+
+    assert(psSlot != NULL);
+    assert(pcKey != NULL);
+
+    if (uLength < INLINE_KEY_SIZE - 1) {
+        memset(psSlot->uKey.acInline, 0, INLINE_KEY_SIZE);
+        memcpy(psSlot->uKey.acInline, pcKey, uLength);
+        psSlot->uKey.acInline[INLINE_KEY_SIZE - 1] = (char)uLength;
+        return 1;
+    }
+
+    /* makes defensive copy of key */
+    pcKeyCopy = (char*)malloc(uLength + 1);
+    if (pcKeyCopy == NULL) {
+        return 0;
+    }
+    memcpy(pcKeyCopy, pcKey, uLength);
+    pcKeyCopy[uLength] = '\0';
+    psSlot->uKey.sHeap.pcHeap = pcKeyCopy;
+    psSlot->uKey.sHeap.uLength = uLength;
+    psSlot->uKey.acInline[INLINE_KEY_SIZE - 1] = (char)HEAP_KEY;
+    return 1;
+}
+
+/* Helper free slot key function */
+void SymTable_freeSlotKey(struct Slot *psSlot) {
+    assert(psSlot != NULL);
+
+    if ((unsigned char)psSlot->uKey.acInline[INLINE_KEY_SIZE - 1] == HEAP_KEY) {
+        free(psSlot->uKey.sHeap.pcHeap);
+    }
+}
+
+/* Helper tag function */
+unsigned char SymTable_tag(size_t uHash) {
+    return (unsigned char)(((uint64_t)uHash * 0x9E3779B97F4A7C15ULL) >> 57);
+}
+
+/* Helper hash function */
+size_t SymTable_hash(SymTable_T oSymTable, const char *pcKey, size_t uLength) {
+    assert(oSymTable != NULL);
+    assert(pcKey != NULL);
+
+    return (*oSymTable->pfHash)(pcKey, uLength, oSymTable->uSeed);
+}
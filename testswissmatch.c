@@ -0,0 +1,121 @@
+/*--------------------------------------------------------------------*/
+/* testswissmatch.c                                                   */
+/* Author: Tinney Mak                                                 */
+/*--------------------------------------------------------------------*/
+
+/* symtableswiss.c is included rather than linked, so that its static
+   matchers can be called.  Defining SYMTABLE_MATCH_TEST compiles the
+   portable matcher beside the vector one that the build selects. */
+
+#define SYMTABLE_MATCH_TEST
+#include "symtableswiss.c"
+#include <stdio.h>
+
+/*--------------------------------------------------------------------*/
+
+#define ASSURE(i) assure(i, __LINE__)
+
+/*--------------------------------------------------------------------*/
+
+/* If !iSuccessful, print a message to stdout indicating that the
+   test at line iLineNum failed. */
+
+static void assure(int iSuccessful, int iLineNum)
+{
+   if (! iSuccessful)
+   {
+      printf("Test at line %d failed.\n", iLineNum);
+      fflush(stdout);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* The number of control byte values a slot can hold: every tag, then
+   CTRL_EMPTY and CTRL_DELETED. */
+
+enum {CTRL_VALUE_COUNT = 130};
+
+/* Return control byte value number i, for 0 <= i < CTRL_VALUE_COUNT. */
+
+static unsigned char ctrlValue(int i)
+{
+   if (i < 128)
+      return (unsigned char)i;
+   if (i == 128)
+      return (unsigned char)CTRL_EMPTY;
+   return (unsigned char)CTRL_DELETED;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check that the matchers of the build and the portable matchers
+   return the same masks for the group whose control bytes start at
+   pucGroup, for every control byte value. */
+
+static void checkGroup(const unsigned char *pucGroup)
+{
+   int i;
+
+   for (i = 0; i < CTRL_VALUE_COUNT; i++)
+      ASSURE(SymTable_matchByte(pucGroup, ctrlValue(i)) ==
+         SymTable_matchBytePortable(pucGroup, ctrlValue(i)));
+   ASSURE(SymTable_matchFree(pucGroup) ==
+      SymTable_matchFreePortable(pucGroup));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Compare the matchers over groups where every control byte value
+   appears in every slot, and over pseudo-random groups that mix tags
+   with empty and deleted slots.  Return 0. */
+
+int main(void)
+{
+   enum {RANDOM_GROUP_COUNT = 20000};
+
+   unsigned char aucGroup[GROUP_WIDTH];
+   unsigned long ulState = 12345;
+   int iValue;
+   int iGroup;
+   int iSlot;
+
+   printf("------------------------------------------------------\n");
+#if defined(SYMTABLE_AVX2)
+   printf("Comparing the AVX2 and portable group matchers.\n");
+#elif defined(SYMTABLE_SSE2)
+   printf("Comparing the SSE2 and portable group matchers.\n");
+#else
+   printf("Only the portable group matcher is built; comparing it\n");
+   printf("with itself.\n");
+#endif
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Each value in each slot, with a different value beside it. */
+   for (iValue = 0; iValue < CTRL_VALUE_COUNT; iValue++)
+   {
+      for (iSlot = 0; iSlot < GROUP_WIDTH; iSlot++)
+         aucGroup[iSlot] = ctrlValue((iValue + iSlot) % CTRL_VALUE_COUNT);
+      checkGroup(aucGroup);
+
+      memset(aucGroup, ctrlValue(iValue), GROUP_WIDTH);
+      checkGroup(aucGroup);
+   }
+
+   /* Pseudo-random groups, from a linear congruential generator. */
+   for (iGroup = 0; iGroup < RANDOM_GROUP_COUNT; iGroup++)
+   {
+      for (iSlot = 0; iSlot < GROUP_WIDTH; iSlot++)
+      {
+         ulState = (ulState * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+         aucGroup[iSlot] =
+            ctrlValue((int)((ulState >> 8) % CTRL_VALUE_COUNT));
+      }
+      checkGroup(aucGroup);
+   }
+
+   printf("------------------------------------------------------\n");
+   printf("End of testswissmatch.\n");
+   return 0;
+}
@@ -4,6 +4,9 @@
 /*--------------------------------------------------------------------*/
 
 #include "symtable.h"
+#include "symfrozen.h"
+#include "symdurable.h"
+#include "symhash.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -12,6 +15,14 @@
 
 #ifndef S_SPLINT_S
 #include <sys/resource.h>
+#include <pthread.h>
+#include <signal.h>
+#endif
+
+#if defined(SYMTABLE_SHARED) && !defined(S_SPLINT_S)
+#include "symshm.h"
+#include <unistd.h>
+#include <sys/wait.h>
 #endif
 
 /*--------------------------------------------------------------------*/
@@ -83,6 +94,58 @@ static void printBindingSimple(const char *pcKey, void *pvValue,
 
 /*--------------------------------------------------------------------*/
 
+/* Add the integer that pvValue points to into the sum that pvExtra
+   points to.  pcKey is unused. */
+
+static void sumBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   assert(pcKey != NULL);
+   assert(pvValue != NULL);
+   assert(pvExtra != NULL);
+
+   *(long*)pvExtra += *(int*)pvValue;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the hash of the uLength bytes at pvKey given by the hash
+   function from the assignment specification, modulo 509.  uSeed is
+   unused. */
+
+static size_t assignmentHash(const void *pvKey, size_t uLength,
+   size_t uSeed)
+{
+   const size_t HASH_MULTIPLIER = 65599;
+   const char *pcKey = (const char*)pvKey;
+   size_t u;
+   size_t uHash = 0;
+
+   assert(pvKey != NULL);
+   (void)uSeed;
+
+   for (u = 0; u < uLength; u++)
+      uHash = uHash * HASH_MULTIPLIER + (size_t)pcKey[u];
+
+   return uHash % 509;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Return the same hash for every key.  pvKey, uLength and uSeed are
+   unused. */
+
+static size_t constantHash(const void *pvKey, size_t uLength,
+   size_t uSeed)
+{
+   (void)pvKey;
+   (void)uLength;
+   (void)uSeed;
+   return 42;
+}
+
+/*--------------------------------------------------------------------*/
+
 /* Test the most basic SymTable functions. */
 
 static void testBasics(void)
@@ -274,11 +337,14 @@ static void testKeyComparison(void)
 static void testKeyOwnership(void)
 {
    enum {MAX_KEY_LENGTH = 10};
+   enum {MAX_LONG_KEY_LENGTH = 40};
 
    SymTable_T oSymTable;
    char acKey[MAX_KEY_LENGTH];
+   char acLongKey[MAX_LONG_KEY_LENGTH + 1];
    char *pcValue;
    int iSuccessful;
+   int i;
    char acCenterField[] = "CenterField";
 
    printf("------------------------------------------------------\n");
@@ -295,6 +361,24 @@ static void testKeyOwnership(void)
    pcValue = (char*)SymTable_get(oSymTable, "Mantle");
    ASSURE(pcValue == acCenterField);
 
+   /* Keys short enough to be stored inside a node and keys long
+      enough to be stored apart must both be copied. */
+   for (i = 1; i <= MAX_LONG_KEY_LENGTH; i++)
+   {
+      memset(acLongKey, 'a', (size_t)i);
+      acLongKey[i] = '\0';
+      iSuccessful = SymTable_put(oSymTable, acLongKey, acCenterField);
+      ASSURE(iSuccessful);
+      memset(acLongKey, 'x', (size_t)i);
+   }
+   for (i = 1; i <= MAX_LONG_KEY_LENGTH; i++)
+   {
+      memset(acLongKey, 'a', (size_t)i);
+      acLongKey[i] = '\0';
+      pcValue = (char*)SymTable_get(oSymTable, acLongKey);
+      ASSURE(pcValue == acCenterField);
+   }
+
    SymTable_free(oSymTable);
 }
 
@@ -431,6 +515,50 @@ static void testMap(void)
 
 /*--------------------------------------------------------------------*/
 
+/* Test the SymTable_map() function on a SymTable object that is
+   growing, checking after every put that each binding is visited
+   exactly once. */
+
+static void testMapWhileGrowing(void)
+{
+   enum {BINDING_COUNT = 3000};
+   enum {MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   char acKey[MAX_KEY_LENGTH];
+   int aiValues[BINDING_COUNT];
+   long lSum;
+   int i;
+   int iSuccessful;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the SymTable_map() function while a table grows.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* Value i is 1 << (i % 20), so a binding visited twice or not at
+      all changes the sum. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      aiValues[i] = 1 << (i % 20);
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+
+      lSum = 0;
+      SymTable_map(oSymTable, sumBinding, &lSum);
+      ASSURE(lSum == (long)(((long)(i / 20) * ((1L << 20) - 1)) +
+         ((1L << (i % 20 + 1)) - 1)));
+   }
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
 /* Test a SymTable object that contains no bindings. */
 
 static void testEmptyTable(void)
@@ -636,184 +764,2705 @@ static void testLongKey(void)
 
 /*--------------------------------------------------------------------*/
 
-/* Test the ability of SymTable object to have values that are
-   other SymTable objects. */
+/* Test the functions that take the length of a key, with keys that
+   contain '\0' characters. */
 
-static void testTableOfTables(void)
+static void testKeyLength(void)
 {
+   enum {KEY_COUNT = 2000, KEY_SIZE = 40};
+
    SymTable_T oSymTable;
-   SymTable_T oSymTable1;
-   SymTable_T oSymTable2;
-   SymTable_T oSymTableRet;
+   char acKey[KEY_SIZE];
    char acShortstop[] = "Shortstop";
-   char acCenterField[] = "CenterField";
+   char acCatcher[] = "Catcher";
+   char acRightField[] = "Right Field";
    char *pcValue;
+   int iFound;
+   size_t uLength;
+   size_t uKeyLength;
    int iSuccessful;
+   int i;
 
    printf("------------------------------------------------------\n");
-   printf("Testing a SymTable object that contains other\n");
-   printf("SymTable objects.\n");
+   printf("Testing keys given with their lengths.\n");
    printf("No output should appear here:\n");
    fflush(stdout);
 
-   oSymTable1 = SymTable_new();
-   ASSURE(oSymTable1 != NULL);
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
 
-   iSuccessful = SymTable_put(oSymTable1, "Jeter", acShortstop);
+   /* Keys that differ only after a '\0', or only in length */
+   iSuccessful = SymTable_putN(oSymTable, "a\0b", 3, acShortstop);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putN(oSymTable, "a\0c", 3, acCatcher);
    ASSURE(iSuccessful);
+   iSuccessful = SymTable_putN(oSymTable, "a\0b", 2, acRightField);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putN(oSymTable, "a\0b", 3, acRightField);
+   ASSURE(! iSuccessful);
 
-   oSymTable2 = SymTable_new();
-   ASSURE(oSymTable2 != NULL);
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == 3);
 
-   iSuccessful = SymTable_put(oSymTable2, "Mantle", acCenterField);
+   iFound = SymTable_contains(oSymTable, "a");
+   ASSURE(! iFound);
+   iFound = SymTable_containsN(oSymTable, "a\0b", 1);
+   ASSURE(! iFound);
+   iFound = SymTable_containsN(oSymTable, "a\0d", 3);
+   ASSURE(! iFound);
+
+   pcValue = (char*)SymTable_getN(oSymTable, "a\0b", 3);
+   ASSURE(pcValue == acShortstop);
+   pcValue = (char*)SymTable_getN(oSymTable, "a\0c", 3);
+   ASSURE(pcValue == acCatcher);
+   pcValue = (char*)SymTable_getN(oSymTable, "a\0z", 2);
+   ASSURE(pcValue == acRightField);
+
+   /* A key without a '\0' is the same whichever way it is given */
+   iSuccessful = SymTable_putN(oSymTable, "Ruth!", 4, acShortstop);
    ASSURE(iSuccessful);
+   pcValue = (char*)SymTable_get(oSymTable, "Ruth");
+   ASSURE(pcValue == acShortstop);
+   pcValue = (char*)SymTable_replace(oSymTable, "Ruth", acCatcher);
+   ASSURE(pcValue == acShortstop);
+   pcValue = (char*)SymTable_replaceN(oSymTable, "Ruth", 4, acRightField);
+   ASSURE(pcValue == acCatcher);
+   pcValue = (char*)SymTable_replaceN(oSymTable, "Ruth", 3, acRightField);
+   ASSURE(pcValue == NULL);
+   pcValue = (char*)SymTable_removeN(oSymTable, "Ruth", 4);
+   ASSURE(pcValue == acRightField);
+   iFound = SymTable_contains(oSymTable, "Ruth");
+   ASSURE(! iFound);
+
+   pcValue = (char*)SymTable_removeN(oSymTable, "a\0b", 3);
+   ASSURE(pcValue == acShortstop);
+   pcValue = (char*)SymTable_removeN(oSymTable, "a\0b", 3);
+   ASSURE(pcValue == NULL);
+   pcValue = (char*)SymTable_getN(oSymTable, "a\0c", 3);
+   ASSURE(pcValue == acCatcher);
+
+   SymTable_free(oSymTable);
 
+   /* Many keys of all zero bytes, whose lengths alone tell them
+      apart, and keys with a '\0' in the middle, short and long
+      enough to be stored in every way */
    oSymTable = SymTable_new();
    ASSURE(oSymTable != NULL);
 
-   iSuccessful = SymTable_put(oSymTable, "first table", oSymTable1);
-   ASSURE(iSuccessful);
+   memset(acKey, 0, sizeof(acKey));
+   for (uKeyLength = 0; uKeyLength < KEY_SIZE; uKeyLength++)
+   {
+      iSuccessful = SymTable_putN(oSymTable, acKey, uKeyLength,
+         acShortstop + (uKeyLength % 8));
+      ASSURE(iSuccessful);
+   }
 
-   iSuccessful = SymTable_put(oSymTable, "second table", oSymTable2);
-   ASSURE(iSuccessful);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      uKeyLength = 6 + (size_t)i % (KEY_SIZE - 6);
+      memset(acKey, 'x', sizeof(acKey));
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_putN(oSymTable, acKey, uKeyLength, acCatcher);
+      ASSURE(iSuccessful);
+   }
 
-   oSymTableRet = (SymTable_T)SymTable_get(oSymTable, "first table");
-   ASSURE(oSymTableRet == oSymTable1);
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == KEY_SIZE + KEY_COUNT);
 
-   pcValue = (char*)SymTable_get(oSymTableRet, "Jeter");
-   ASSURE(pcValue == acShortstop);
+   memset(acKey, 0, sizeof(acKey));
+   for (uKeyLength = 0; uKeyLength < KEY_SIZE; uKeyLength++)
+   {
+      pcValue = (char*)SymTable_getN(oSymTable, acKey, uKeyLength);
+      ASSURE(pcValue == acShortstop + (uKeyLength % 8));
+   }
 
-   oSymTableRet = (SymTable_T)SymTable_get(oSymTable, "second table");
-   ASSURE(oSymTableRet == oSymTable2);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      uKeyLength = 6 + (size_t)i % (KEY_SIZE - 6);
+      memset(acKey, 'x', sizeof(acKey));
+      sprintf(acKey, "%d", i);
+      iFound = SymTable_containsN(oSymTable, acKey, uKeyLength);
+      ASSURE(iFound);
+      pcValue = (char*)SymTable_removeN(oSymTable, acKey, uKeyLength);
+      ASSURE(pcValue == acCatcher);
+   }
 
-   pcValue = (char*)SymTable_get(oSymTableRet, "Mantle");
-   ASSURE(pcValue == acCenterField);
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == KEY_SIZE);
 
-   SymTable_free(oSymTable2);
-   SymTable_free(oSymTable1);
    SymTable_free(oSymTable);
 }
 
 /*--------------------------------------------------------------------*/
 
-/* Test the ability of a SymTable object to handle collisions.  This
-   test assumes that a SymTable object is implemented as a hash table,
-   that there are 509 buckets in the hash table, and that the
-   implementation uses the hash function provided in the assignment
-   specification. */
+/* Test the batch lookup functions against SymTable_get and
+   SymTable_contains, including while the table is growing. */
 
-static void testCollisions(void)
+static void testBatch(void)
 {
+   enum {KEY_COUNT = 3000, KEY_SIZE = 8, CHECK_INTERVAL = 97};
+
    SymTable_T oSymTable;
+   char (*pacKeys)[KEY_SIZE];
+   const char **ppcKeys;
+   void **ppvValues;
+   int *piFound;
    int iSuccessful;
-   char acCenterField[] = "pitcher";
-   char acCatcher[] = "catcher";
-   char acFirstBase[] = "first base";
-   char acRightField[] = "second base";
-   char *pcValue;
+   int i;
+   int iKeyCount;
 
    printf("------------------------------------------------------\n");
-   printf("Testing the collision handling of a SymTable object\n");
-   printf("assuming a hash table implementation, and assuming that\n");
-   printf("the implementation uses the hash function from the\n");
-   printf("assignment specification.\n");
+   printf("Testing the batch lookup functions.\n");
    printf("No output should appear here:\n");
    fflush(stdout);
 
+   /* Even keys are put into the table and odd keys are not */
+   pacKeys = (char(*)[KEY_SIZE])malloc(2 * KEY_COUNT * KEY_SIZE);
+   ppcKeys = (const char**)malloc(2 * KEY_COUNT * sizeof(const char*));
+   ppvValues = (void**)malloc(2 * KEY_COUNT * sizeof(void*));
+   piFound = (int*)malloc(2 * KEY_COUNT * sizeof(int));
+   ASSURE(pacKeys != NULL && ppcKeys != NULL);
+   ASSURE(ppvValues != NULL && piFound != NULL);
+   for (i = 0; i < 2 * KEY_COUNT; i++)
+   {
+      sprintf(pacKeys[i], "%d", i);
+      ppcKeys[i] = pacKeys[i];
+   }
+
    oSymTable = SymTable_new();
    ASSURE(oSymTable != NULL);
 
-   /* Note that strings "250", "469", "947", "1303", and "2016" hash
-      to the same bucket -- bucket 123. */
+   SymTable_getBatch(oSymTable, ppcKeys, 0, ppvValues);
+   SymTable_containsBatch(oSymTable, ppcKeys, 0, piFound);
 
-   iSuccessful = SymTable_put(oSymTable, "250", acCenterField);
-   ASSURE(iSuccessful);
+   for (iKeyCount = 0; iKeyCount < KEY_COUNT; iKeyCount++)
+   {
+      iSuccessful = SymTable_put(oSymTable, pacKeys[2 * iKeyCount],
+         pacKeys[2 * iKeyCount]);
+      ASSURE(iSuccessful);
 
-   iSuccessful = SymTable_put(oSymTable, "469", acCatcher);
-   ASSURE(iSuccessful);
+      /* Look up batches whose sizes are not multiples of anything
+         in particular, sometimes just after the table grows */
+      if (iKeyCount % CHECK_INTERVAL != 0)
+         continue;
+
+      SymTable_getBatch(oSymTable, ppcKeys, (size_t)(2 * iKeyCount + 3),
+         ppvValues);
+      SymTable_containsBatch(oSymTable, ppcKeys,
+         (size_t)(2 * iKeyCount + 3), piFound);
+      for (i = 0; i < 2 * iKeyCount + 3; i++)
+      {
+         ASSURE(ppvValues[i] == SymTable_get(oSymTable, ppcKeys[i]));
+         ASSURE(piFound[i] == SymTable_contains(oSymTable, ppcKeys[i]));
+         ASSURE(piFound[i] == (i % 2 == 0 && i / 2 <= iKeyCount));
+      }
+   }
 
-   iSuccessful = SymTable_put(oSymTable, "947", acFirstBase);
-   ASSURE(iSuccessful);
+   SymTable_getBatch(oSymTable, ppcKeys, 2 * KEY_COUNT, ppvValues);
+   for (i = 0; i < 2 * KEY_COUNT; i++)
+      ASSURE(ppvValues[i] == (i % 2 == 0 ? pacKeys[i] : NULL));
 
-   iSuccessful = SymTable_put(oSymTable, "1303", acRightField);
-   ASSURE(iSuccessful);
+   SymTable_free(oSymTable);
+   free(piFound);
+   free(ppvValues);
+   free(ppcKeys);
+   free(pacKeys);
+}
 
-   iSuccessful = SymTable_put(oSymTable, "2016", acRightField);
-   ASSURE(iSuccessful);
+/*--------------------------------------------------------------------*/
 
-   pcValue = SymTable_get(oSymTable, "250");
-   ASSURE(pcValue == acCenterField);
+/* Test SymTable_bulkLoad and SymTable_putBatch, including keys that
+   are rejected because they are already present. */
 
-   pcValue = SymTable_get(oSymTable, "469");
-   ASSURE(pcValue == acCatcher);
+static void testBulkLoad(void)
+{
+   enum {KEY_COUNT = 5000, KEY_SIZE = 8};
 
-   pcValue = SymTable_get(oSymTable, "947");
-   ASSURE(pcValue == acFirstBase);
+   SymTable_T oSymTable;
+   char (*pacKeys)[KEY_SIZE];
+   const char **ppcKeys;
+   void **ppvValues;
+   int *piRejected;
+   char acShortstop[] = "Shortstop";
+   char *pcValue;
+   size_t uLength;
+   int iSuccessful;
+   int i;
 
-   pcValue = SymTable_get(oSymTable, "1303");
-   ASSURE(pcValue == acRightField);
+   printf("------------------------------------------------------\n");
+   printf("Testing loading many bindings at once.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
 
-   pcValue = SymTable_get(oSymTable, "2016");
-   ASSURE(pcValue == acRightField);
+   /* Key i is the numeral of i / 2 for even i and of i for odd i, so
+      each even key except the first repeats an earlier one */
+   pacKeys = (char(*)[KEY_SIZE])malloc(KEY_COUNT * KEY_SIZE);
+   ppcKeys = (const char**)malloc(KEY_COUNT * sizeof(const char*));
+   ppvValues = (void**)malloc(KEY_COUNT * sizeof(void*));
+   piRejected = (int*)malloc(KEY_COUNT * sizeof(int));
+   ASSURE(pacKeys != NULL && ppcKeys != NULL);
+   ASSURE(ppvValues != NULL && piRejected != NULL);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(pacKeys[i], "%d", i % 2 == 0 ? i / 2 : i);
+      ppcKeys[i] = pacKeys[i];
+      ppvValues[i] = pacKeys[i];
+   }
 
-   pcValue = SymTable_remove(oSymTable, "947");
-   ASSURE(pcValue == acFirstBase);
+   oSymTable = SymTable_bulkLoad(ppcKeys, ppvValues, KEY_COUNT,
+      piRejected);
+   ASSURE(oSymTable != NULL);
 
-   pcValue = SymTable_remove(oSymTable, "2016");
-   ASSURE(pcValue == acRightField);
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == KEY_COUNT / 2 + KEY_COUNT / 4);
 
-   pcValue = SymTable_remove(oSymTable, "250");
-   ASSURE(pcValue == acCenterField);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      ASSURE(piRejected[i] == (i % 2 == 0 && (i / 2) % 2 == 1));
+      pcValue = (char*)SymTable_get(oSymTable, ppcKeys[i]);
+      if (piRejected[i])
+         ASSURE(pcValue == pacKeys[i / 2]);
+      else
+         ASSURE(pcValue == pacKeys[i]);
+   }
 
-   pcValue = SymTable_get(oSymTable, "469");
-   ASSURE(pcValue == acCatcher);
+   /* A batch whose keys are all present already changes nothing */
+   iSuccessful = SymTable_putBatch(oSymTable, ppcKeys, ppvValues,
+      KEY_COUNT, piRejected);
+   ASSURE(iSuccessful);
+   for (i = 0; i < KEY_COUNT; i++)
+      ASSURE(piRejected[i]);
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == KEY_COUNT / 2 + KEY_COUNT / 4);
 
-   pcValue = SymTable_get(oSymTable, "1303");
-   ASSURE(pcValue == acRightField);
+   iSuccessful = SymTable_putBatch(oSymTable, ppcKeys, ppvValues, 0,
+      NULL);
+   ASSURE(iSuccessful);
+
+   SymTable_free(oSymTable);
 
+   /* A batch added to a table that already has bindings, without
+      reporting the rejected keys */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_put(oSymTable, "1", acShortstop);
+   ASSURE(iSuccessful);
+
+   iSuccessful = SymTable_putBatch(oSymTable, ppcKeys, ppvValues,
+      KEY_COUNT, NULL);
+   ASSURE(iSuccessful);
+
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == KEY_COUNT / 2 + KEY_COUNT / 4);
+   pcValue = (char*)SymTable_get(oSymTable, "1");
+   ASSURE(pcValue == acShortstop);
+   pcValue = (char*)SymTable_get(oSymTable, "3");
+   ASSURE(pcValue == pacKeys[3]);
+
+   SymTable_free(oSymTable);
+
+   oSymTable = SymTable_bulkLoad(ppcKeys, ppvValues, 0, NULL);
+   ASSURE(oSymTable != NULL);
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == 0);
    SymTable_free(oSymTable);
+
+   free(piRejected);
+   free(ppvValues);
+   free(ppcKeys);
+   free(pacKeys);
 }
 
 /*--------------------------------------------------------------------*/
 
-/* Test the ability of a SymTable object to be large, that is, to
-   contain iBindingCount bindings. Write the time consumed to stdout. */
+/* Test reserving capacity and shrinking, both explicitly and after
+   removals leave a table mostly empty. */
 
-static void testLargeTable(int iBindingCount)
+static void testCapacity(void)
 {
-   enum {MAX_KEY_LENGTH = 10};
+   enum {KEY_COUNT = 20000, KEEP_COUNT = 200, KEY_SIZE = 8};
 
    SymTable_T oSymTable;
-   SymTable_T oSymTableSmall;
-   char acKey[MAX_KEY_LENGTH];
-   char *pcValue;
-   int i;
-   int iSmall;
-   int iLarge;
+   char acKey[KEY_SIZE];
+   size_t uBucketCount;
+   size_t uFullBucketCount;
+   size_t uLength;
    int iSuccessful;
-   clock_t iInitialClock;
-   clock_t iFinalClock;
-   size_t uLength = 0;
-   size_t uLength2;
+   int iFound;
+   int i;
 
    printf("------------------------------------------------------\n");
-   printf("Testing a potentially large SymTable object.\n");
-   printf("No output except CPU time consumed should appear here:\n");
+   printf("Testing reserving capacity and shrinking.\n");
+   printf("No output should appear here:\n");
    fflush(stdout);
 
-   /* Note the current time. */
-   iInitialClock = clock();
-
-   /* Create oSymTableSmall, and put a couple of bindings into it. */
-   oSymTableSmall = SymTable_new();
-   ASSURE(oSymTableSmall != NULL);
-   iSuccessful = SymTable_put(oSymTableSmall, "xxx", "xxx");
-   ASSURE(iSuccessful);
-   iSuccessful = SymTable_put(oSymTableSmall, "yyy", "yyy");
-   ASSURE(iSuccessful);
-
-   /* Create oSymTable, the primary SymTable object. */
-   oSymTable = SymTable_new();
+   /* A table made with room for KEY_COUNT bindings does not grow
+      while they are put, nor shrink while they are removed */
+   oSymTable = SymTable_newWithCapacity(KEY_COUNT);
+   ASSURE(oSymTable != NULL);
+   uBucketCount = SymTable_getBucketCount(oSymTable);
+
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, NULL);
+      ASSURE(iSuccessful);
+   }
+   ASSURE(SymTable_getBucketCount(oSymTable) == uBucketCount);
+
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      (void)SymTable_remove(oSymTable, acKey);
+   }
+   ASSURE(SymTable_getBucketCount(oSymTable) == uBucketCount);
+
+   /* Shrinking to fit cancels the reservation */
+   iSuccessful = SymTable_shrinkToFit(oSymTable);
+   ASSURE(iSuccessful);
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == 0);
+   if (uBucketCount > 1)
+      ASSURE(SymTable_getBucketCount(oSymTable) < uBucketCount);
+
+   iSuccessful = SymTable_put(oSymTable, "Ruth", NULL);
+   ASSURE(iSuccessful);
+   iFound = SymTable_contains(oSymTable, "Ruth");
+   ASSURE(iFound);
+
+   SymTable_free(oSymTable);
+
+   /* A table that grows during a spike shrinks again as the spike
+      passes, keeping the bindings that remain */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &acKey[i % KEY_SIZE]);
+      ASSURE(iSuccessful);
+   }
+   uFullBucketCount = SymTable_getBucketCount(oSymTable);
+
+   for (i = KEEP_COUNT; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_remove(oSymTable, acKey) == &acKey[i % KEY_SIZE]);
+   }
+#ifndef SYMTABLE_NO_AUTO_SHRINK
+   if (uFullBucketCount > 1)
+      ASSURE(SymTable_getBucketCount(oSymTable) < uFullBucketCount);
+#else
+   ASSURE(SymTable_getBucketCount(oSymTable) == uFullBucketCount);
+#endif
+
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == KEEP_COUNT);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (i < KEEP_COUNT)
+         ASSURE(SymTable_get(oSymTable, acKey) == &acKey[i % KEY_SIZE]);
+      else
+         ASSURE(! SymTable_contains(oSymTable, acKey));
+   }
+
+   /* Reserving room in a table that has bindings keeps them */
+   iSuccessful = SymTable_reserve(oSymTable, KEY_COUNT);
+   ASSURE(iSuccessful);
+   ASSURE(SymTable_getBucketCount(oSymTable) >= uBucketCount);
+   for (i = 0; i < KEEP_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymTable_get(oSymTable, acKey) == &acKey[i % KEY_SIZE]);
+   }
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the bindings of tables as they grow one binding at a time
+   from empty, and of many small tables in use at once, so that a
+   table that changes how it stores its bindings once it is no longer
+   small keeps them intact. */
+
+static void testSmallTables(void)
+{
+   enum {KEY_COUNT = 20, TABLE_COUNT = 1000, KEY_SIZE = 40};
+
+   SymTable_T oSymTable;
+   SymTable_T aoSymTables[TABLE_COUNT];
+   char aacKeys[KEY_COUNT][KEY_SIZE];
+   size_t uLength;
+   int iSuccessful;
+   int iFound;
+   int i;
+   int j;
+   int k;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing small tables as they grow.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* Every third key is too long to be stored inside its node */
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      if (i % 3 == 0)
+         sprintf(aacKeys[i], "a rather long key, number %d", i);
+      else
+         sprintf(aacKeys[i], "%d", i);
+   }
+
+   /* After each put, all the keys put so far are there and no
+      others are */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      iSuccessful = SymTable_put(oSymTable, aacKeys[i], aacKeys[i]);
+      ASSURE(iSuccessful);
+      for (j = 0; j < KEY_COUNT; j++)
+      {
+         if (j <= i)
+            ASSURE(SymTable_get(oSymTable, aacKeys[j]) == aacKeys[j]);
+         else
+            ASSURE(! SymTable_contains(oSymTable, aacKeys[j]));
+      }
+   }
+
+   for (i = 0; i < KEY_COUNT; i += 2)
+      ASSURE(SymTable_remove(oSymTable, aacKeys[i]) == aacKeys[i]);
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == KEY_COUNT / 2);
+   for (i = 0; i < KEY_COUNT; i++)
+   {
+      iFound = SymTable_contains(oSymTable, aacKeys[i]);
+      ASSURE(iFound == (i % 2 == 1));
+   }
+   SymTable_free(oSymTable);
+
+   /* Many small tables of different sizes, with removals while
+      they are still small */
+   for (i = 0; i < TABLE_COUNT; i++)
+   {
+      aoSymTables[i] = SymTable_new();
+      ASSURE(aoSymTables[i] != NULL);
+      for (j = 0; j < i % KEY_COUNT; j++)
+      {
+         iSuccessful = SymTable_put(aoSymTables[i], aacKeys[j],
+            aoSymTables[i]);
+         ASSURE(iSuccessful);
+      }
+      if (i % KEY_COUNT > 0)
+      {
+         (void)SymTable_remove(aoSymTables[i], aacKeys[0]);
+         iSuccessful = SymTable_put(aoSymTables[i], aacKeys[0], NULL);
+         ASSURE(iSuccessful);
+      }
+   }
+   for (i = 0; i < TABLE_COUNT; i++)
+   {
+      k = i % KEY_COUNT;
+      uLength = SymTable_getLength(aoSymTables[i]);
+      ASSURE(uLength == (size_t)k);
+      for (j = 1; j < k; j++)
+         ASSURE(SymTable_get(aoSymTables[i], aacKeys[j]) == aoSymTables[i]);
+      SymTable_free(aoSymTables[i]);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+#ifndef S_SPLINT_S
+
+enum {CONCURRENT_THREAD_COUNT = 8};
+enum {CONCURRENT_KEY_COUNT = 4000};
+enum {CONCURRENT_SHARED_COUNT = 100};
+
+/* A ConcurrentWorker is the work of one thread of testConcurrent. */
+
+struct ConcurrentWorker
+{
+   /* The table that every thread uses */
+   SymTable_T oSymTable;
+
+   /* The number of the thread, which its own keys contain */
+   int iThread;
+};
+
+/* Put the keys of the ConcurrentWorker at pvWorker into its table,
+   check them, and remove all but one in 16 of them, so that the
+   table grows and then shrinks while other threads use it. Also bind
+   every shared key to the worker. Return NULL. */
+
+static void *concurrentWork(void *pvWorker)
+{
+   struct ConcurrentWorker *psWorker = (struct ConcurrentWorker*)pvWorker;
+   SymTable_T oSymTable = psWorker->oSymTable;
+   char acKey[32];
+   int iSuccessful;
+   int i;
+
+   for (i = 0; i < CONCURRENT_KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d:%d", psWorker->iThread, i);
+      iSuccessful = SymTable_put(oSymTable, acKey, psWorker);
+      ASSURE(iSuccessful);
+      if (i % (CONCURRENT_KEY_COUNT / CONCURRENT_SHARED_COUNT) == 0)
+      {
+         sprintf(acKey, "shared %d",
+            i / (CONCURRENT_KEY_COUNT / CONCURRENT_SHARED_COUNT));
+         iSuccessful = SymTable_upsert(oSymTable, acKey, psWorker);
+         ASSURE(iSuccessful);
+         ASSURE(SymTable_contains(oSymTable, acKey));
+      }
+   }
+
+   for (i = 0; i < CONCURRENT_KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d:%d", psWorker->iThread, i);
+      ASSURE(SymTable_get(oSymTable, acKey) == psWorker);
+      if (i % 16 != 0)
+         ASSURE(SymTable_remove(oSymTable, acKey) == psWorker);
+   }
+   return NULL;
+}
+
+/* Test a table made by SymTable_newConcurrent while
+   CONCURRENT_THREAD_COUNT threads put, get and remove bindings at
+   once, some of them bound to the same keys. Implementations that do
+   not support concurrent use are skipped. */
+
+static void testConcurrent(void)
+{
+   SymTable_T oSymTable;
+   struct ConcurrentWorker asWorkers[CONCURRENT_THREAD_COUNT];
+   pthread_t aiThreads[CONCURRENT_THREAD_COUNT];
+   char acKey[32];
+   void *pvValue;
+   size_t uLength;
+   int iFound;
+   int i;
+   int j;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a table used by several threads at once.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newConcurrent();
+   if (oSymTable == NULL)
+      return;
+
+   for (i = 0; i < CONCURRENT_THREAD_COUNT; i++)
+   {
+      asWorkers[i].oSymTable = oSymTable;
+      asWorkers[i].iThread = i;
+      ASSURE(pthread_create(&aiThreads[i], NULL, concurrentWork,
+         &asWorkers[i]) == 0);
+   }
+   for (i = 0; i < CONCURRENT_THREAD_COUNT; i++)
+      ASSURE(pthread_join(aiThreads[i], NULL) == 0);
+
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == CONCURRENT_THREAD_COUNT * CONCURRENT_KEY_COUNT / 16
+      + CONCURRENT_SHARED_COUNT);
+   for (i = 0; i < CONCURRENT_THREAD_COUNT; i++)
+   {
+      for (j = 0; j < CONCURRENT_KEY_COUNT; j++)
+      {
+         sprintf(acKey, "%d:%d", i, j);
+         iFound = SymTable_contains(oSymTable, acKey);
+         ASSURE(iFound == (j % 16 == 0));
+      }
+   }
+
+   /* Each shared key is bound to whichever thread bound it last */
+   for (j = 0; j < CONCURRENT_SHARED_COUNT; j++)
+   {
+      sprintf(acKey, "shared %d", j);
+      pvValue = SymTable_get(oSymTable, acKey);
+      iFound = 0;
+      for (i = 0; i < CONCURRENT_THREAD_COUNT; i++)
+         if (pvValue == &asWorkers[i])
+            iFound = 1;
+      ASSURE(iFound);
+   }
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+enum {STRESS_READER_COUNT = 4};
+enum {STRESS_WRITER_COUNT = 2};
+enum {STRESS_STABLE_COUNT = 1000};
+enum {STRESS_CHURN_COUNT = 6000};
+enum {STRESS_ROUND_COUNT = 3};
+
+/* A StressState is what the threads of testLockFreeReads share. */
+
+struct StressState
+{
+   /* The table that every thread uses */
+   SymTable_T oSymTable;
+
+   /* The two values that the stable keys are bound to */
+   int aiValues[2];
+
+   /* Whether the writers have finished, read and written atomically */
+   int iDone;
+};
+
+/* A StressWorker is the work of one thread of testLockFreeReads. */
+
+struct StressWorker
+{
+   /* The shared state */
+   struct StressState *psState;
+
+   /* The number of the thread among the readers or the writers */
+   int iThread;
+};
+
+/* Look up the stable keys of the StressWorker at pvWorker, and keys
+   that are never bound, until the writers have finished, checking
+   that each stable key is always found with one of its two values
+   and that no other key is found. Return NULL. */
+
+static void *stressRead(void *pvWorker)
+{
+   struct StressWorker *psWorker = (struct StressWorker*)pvWorker;
+   struct StressState *psState = psWorker->psState;
+   char acKey[32];
+   void *pvValue;
+   int iDone;
+   int i;
+
+   do
+   {
+      iDone = __atomic_load_n(&psState->iDone, __ATOMIC_ACQUIRE);
+      for (i = 0; i < STRESS_STABLE_COUNT; i++)
+      {
+         sprintf(acKey, "stable %d", i);
+         pvValue = SymTable_get(psState->oSymTable, acKey);
+         ASSURE(pvValue == &psState->aiValues[0]
+            || pvValue == &psState->aiValues[1]);
+         sprintf(acKey, "absent %d", i);
+         ASSURE(! SymTable_contains(psState->oSymTable, acKey));
+      }
+   } while (! iDone);
+   return NULL;
+}
+
+/* Repeatedly add and remove churn keys of the StressWorker at
+   pvWorker, growing and shrinking the table, and rebind its share of
+   the stable keys to the other value between. Return NULL. */
+
+static void *stressWrite(void *pvWorker)
+{
+   struct StressWorker *psWorker = (struct StressWorker*)pvWorker;
+   struct StressState *psState = psWorker->psState;
+   char acKey[32];
+   void *pvValue;
+   int iSuccessful;
+   int iRound;
+   int i;
+
+   for (iRound = 0; iRound < STRESS_ROUND_COUNT; iRound++)
+   {
+      for (i = 0; i < STRESS_CHURN_COUNT; i++)
+      {
+         sprintf(acKey, "churn %d:%d", psWorker->iThread, i);
+         iSuccessful = SymTable_put(psState->oSymTable, acKey, psState);
+         ASSURE(iSuccessful);
+      }
+      for (i = psWorker->iThread; i < STRESS_STABLE_COUNT;
+         i += STRESS_WRITER_COUNT)
+      {
+         sprintf(acKey, "stable %d", i);
+         pvValue = SymTable_replace(psState->oSymTable, acKey,
+            &psState->aiValues[(iRound + 1) % 2]);
+         ASSURE(pvValue == &psState->aiValues[iRound % 2]);
+      }
+      for (i = 0; i < STRESS_CHURN_COUNT; i++)
+      {
+         sprintf(acKey, "churn %d:%d", psWorker->iThread, i);
+         pvValue = SymTable_remove(psState->oSymTable, acKey);
+         ASSURE(pvValue == psState);
+      }
+   }
+   return NULL;
+}
+
+/* Test that lookups in a table made by SymTable_newConcurrent, which
+   take no lock, always see a consistent table while writers bind
+   other values, and add and remove enough bindings to make the table
+   grow and shrink and to reuse the memory of removed ones.  Build
+   with -fsanitize=thread to check for data races too.
+   Implementations that do not support concurrent use are skipped. */
+
+static void testLockFreeReads(void)
+{
+   struct StressState sState;
+   struct StressWorker asReaders[STRESS_READER_COUNT];
+   struct StressWorker asWriters[STRESS_WRITER_COUNT];
+   pthread_t aiReaders[STRESS_READER_COUNT];
+   pthread_t aiWriters[STRESS_WRITER_COUNT];
+   char acKey[32];
+   size_t uLength;
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing lookups racing with writers.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   sState.oSymTable = SymTable_newConcurrent();
+   if (sState.oSymTable == NULL)
+      return;
+   sState.iDone = 0;
+
+   for (i = 0; i < STRESS_STABLE_COUNT; i++)
+   {
+      sprintf(acKey, "stable %d", i);
+      iSuccessful = SymTable_put(sState.oSymTable, acKey,
+         &sState.aiValues[0]);
+      ASSURE(iSuccessful);
+   }
+
+   for (i = 0; i < STRESS_READER_COUNT; i++)
+   {
+      asReaders[i].psState = &sState;
+      asReaders[i].iThread = i;
+      ASSURE(pthread_create(&aiReaders[i], NULL, stressRead,
+         &asReaders[i]) == 0);
+   }
+   for (i = 0; i < STRESS_WRITER_COUNT; i++)
+   {
+      asWriters[i].psState = &sState;
+      asWriters[i].iThread = i;
+      ASSURE(pthread_create(&aiWriters[i], NULL, stressWrite,
+         &asWriters[i]) == 0);
+   }
+
+   for (i = 0; i < STRESS_WRITER_COUNT; i++)
+      ASSURE(pthread_join(aiWriters[i], NULL) == 0);
+   __atomic_store_n(&sState.iDone, 1, __ATOMIC_RELEASE);
+   for (i = 0; i < STRESS_READER_COUNT; i++)
+      ASSURE(pthread_join(aiReaders[i], NULL) == 0);
+
+   uLength = SymTable_getLength(sState.oSymTable);
+   ASSURE(uLength == STRESS_STABLE_COUNT);
+   for (i = 0; i < STRESS_STABLE_COUNT; i++)
+   {
+      sprintf(acKey, "stable %d", i);
+      ASSURE(SymTable_get(sState.oSymTable, acKey)
+         == &sState.aiValues[STRESS_ROUND_COUNT % 2]);
+   }
+
+   SymTable_free(sState.oSymTable);
+}
+
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* A MapTally is the accumulator of one worker of
+   SymTable_mapParallel in testMapParallel. */
+
+struct MapTally
+{
+   /* The number of bindings the worker visited */
+   size_t uCount;
+
+   /* The sum of the lengths of their keys */
+   size_t uKeyLengthSum;
+};
+
+/* Count the binding whose key is pcKey in the MapTally at pvExtra,
+   and increment the int at pvValue, so that each binding can be
+   checked to be visited exactly once. */
+
+static void tallyBinding(const char *pcKey, void *pvValue,
+   void *pvExtra)
+{
+   struct MapTally *psTally = (struct MapTally*)pvExtra;
+
+   assert(pcKey != NULL);
+   assert(pvValue != NULL);
+   assert(pvExtra != NULL);
+
+   psTally->uCount++;
+   psTally->uKeyLengthSum += strlen(pcKey);
+   (*(int*)pvValue)++;
+}
+
+/* Test SymTable_mapParallel on tables of several sizes with several
+   numbers of workers: each binding must be visited exactly once, by
+   some worker, which gets its own extra parameter. */
+
+static void testMapParallel(void)
+{
+   enum {KEY_COUNT = 20000, WORKER_COUNT = 4};
+   enum {KEY_SIZE = 16};
+
+   static const int aiSizes[] = {0, 5, 600, KEY_COUNT};
+   static const size_t auWorkerCounts[] = {1, 2, WORKER_COUNT};
+
+   SymTable_T oSymTable;
+   struct MapTally asTallies[WORKER_COUNT];
+   void *apvExtras[WORKER_COUNT];
+   int *piVisits;
+   char acKey[KEY_SIZE];
+   size_t uCount;
+   size_t uKeyLengthSum;
+   size_t uExpectedKeyLengthSum;
+   int iSuccessful;
+   int iSize;
+   size_t uWorker;
+   size_t w;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the ability to map over a table in parallel.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   piVisits = (int*)calloc(KEY_COUNT, sizeof(int));
+   ASSURE(piVisits != NULL);
+   if (piVisits == NULL)
+      return;
+
+   for (iSize = 0; iSize < (int)(sizeof(aiSizes) / sizeof(aiSizes[0]));
+      iSize++)
+   {
+      oSymTable = SymTable_new();
+      ASSURE(oSymTable != NULL);
+      uExpectedKeyLengthSum = 0;
+      for (i = 0; i < aiSizes[iSize]; i++)
+      {
+         sprintf(acKey, "%d", i);
+         uExpectedKeyLengthSum += strlen(acKey);
+         iSuccessful = SymTable_put(oSymTable, acKey, &piVisits[i]);
+         ASSURE(iSuccessful);
+      }
+
+      for (uWorker = 0;
+         uWorker < sizeof(auWorkerCounts) / sizeof(auWorkerCounts[0]);
+         uWorker++)
+      {
+         memset(piVisits, 0, KEY_COUNT * sizeof(int));
+         for (w = 0; w < WORKER_COUNT; w++)
+         {
+            asTallies[w].uCount = 0;
+            asTallies[w].uKeyLengthSum = 0;
+            apvExtras[w] = &asTallies[w];
+         }
+
+         SymTable_mapParallel(oSymTable, tallyBinding, apvExtras,
+            auWorkerCounts[uWorker]);
+
+         uCount = 0;
+         uKeyLengthSum = 0;
+         for (w = 0; w < WORKER_COUNT; w++)
+         {
+            uCount += asTallies[w].uCount;
+            uKeyLengthSum += asTallies[w].uKeyLengthSum;
+            if (w >= auWorkerCounts[uWorker])
+               ASSURE(asTallies[w].uCount == 0);
+         }
+         ASSURE(uCount == (size_t)aiSizes[iSize]);
+         ASSURE(uKeyLengthSum == uExpectedKeyLengthSum);
+         for (i = 0; i < KEY_COUNT; i++)
+            ASSURE(piVisits[i] == (i < aiSizes[iSize]));
+      }
+      SymTable_free(oSymTable);
+   }
+
+   free(piVisits);
+}
+
+/*--------------------------------------------------------------------*/
+
+enum {ITER_KEY_COUNT = 20000};
+
+/* Walk oSymTable, whose bindings bind the numerals of 0 through
+   iSize - 1 to the ints of piVisits with those indices, with an
+   iterator. Check that each binding is visited exactly once, with
+   the right key, and that lookups during the walk see the same
+   values. */
+
+static void checkWalk(SymTable_T oSymTable, int *piVisits, int iSize)
+{
+   SymTable_Iter sIter;
+   char acKey[16];
+   const char *pcKey;
+   size_t uLength;
+   void *pvValue;
+   int iIndex;
+   int iCount = 0;
+   int i;
+
+   memset(piVisits, 0, ITER_KEY_COUNT * sizeof(int));
+   SymTable_iterBegin(oSymTable, &sIter);
+   while (SymTable_iterNext(&sIter, &pcKey, &uLength, &pvValue))
+   {
+      iIndex = (int)((int*)pvValue - piVisits);
+      ASSURE(iIndex >= 0 && iIndex < iSize);
+      sprintf(acKey, "%d", iIndex);
+      ASSURE(uLength == strlen(acKey));
+      ASSURE(strcmp(pcKey, acKey) == 0);
+      ASSURE(SymTable_get(oSymTable, pcKey) == pvValue);
+      piVisits[iIndex]++;
+      iCount++;
+   }
+   ASSURE(!SymTable_iterNext(&sIter, NULL, NULL, NULL));
+   SymTable_iterEnd(&sIter);
+
+   ASSURE(iCount == iSize);
+   for (i = 0; i < iSize; i++)
+      ASSURE(piVisits[i] == 1);
+}
+
+/* Test SymTable_Iter: walks over tables of several sizes, including
+   a concurrent one and one that is growing, walks that stop early,
+   walks over two tables in lockstep, and keys that contain '\0'. */
+
+static void testIter(void)
+{
+   static const int aiSizes[] = {0, 5, 600, ITER_KEY_COUNT};
+
+   SymTable_T oSymTable;
+   SymTable_T oOther;
+   SymTable_Iter sIter;
+   SymTable_Iter sOther;
+   int *piVisits;
+   char acKey[16];
+   const char *pcKey;
+   size_t uLength;
+   void *pvValue;
+   int iSuccessful;
+   int iSize;
+   int iConcurrent;
+   int iCount;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the ability to walk a table with an iterator.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   piVisits = (int*)calloc(ITER_KEY_COUNT, sizeof(int));
+   ASSURE(piVisits != NULL);
+   if (piVisits == NULL)
+      return;
+
+   /* Walk tables of each size, as they are filled and after some
+      lookups, and then the same in a concurrent table. */
+   for (iConcurrent = 0; iConcurrent < 2; iConcurrent++)
+   {
+      for (iSize = 0; iSize < (int)(sizeof(aiSizes) / sizeof(aiSizes[0]));
+         iSize++)
+      {
+         oSymTable = iConcurrent ? SymTable_newConcurrent() : SymTable_new();
+         if (oSymTable == NULL)
+            continue;
+         for (i = 0; i < aiSizes[iSize]; i++)
+         {
+            sprintf(acKey, "%d", i);
+            iSuccessful = SymTable_put(oSymTable, acKey, &piVisits[i]);
+            ASSURE(iSuccessful);
+         }
+         checkWalk(oSymTable, piVisits, aiSizes[iSize]);
+         checkWalk(oSymTable, piVisits, aiSizes[iSize]);
+
+         /* The table can change once the walk has ended */
+         iSuccessful = SymTable_put(oSymTable, "x", NULL);
+         ASSURE(iSuccessful);
+         ASSURE(SymTable_remove(oSymTable, "x") == NULL);
+         SymTable_free(oSymTable);
+      }
+   }
+
+   /* Stop a walk early, and then change the table. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   for (i = 0; i < 600; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &piVisits[i]);
+      ASSURE(iSuccessful);
+   }
+   SymTable_iterBegin(oSymTable, &sIter);
+   for (i = 0; i < 3; i++)
+      ASSURE(SymTable_iterNext(&sIter, &pcKey, NULL, NULL));
+   SymTable_iterEnd(&sIter);
+   iSuccessful = SymTable_put(oSymTable, "600", &piVisits[600]);
+   ASSURE(iSuccessful);
+   checkWalk(oSymTable, piVisits, 601);
+
+   /* Walk two tables with the same keys, put in opposite orders, in
+      lockstep, checking each key of either against the other. */
+   oOther = SymTable_new();
+   ASSURE(oOther != NULL);
+   for (i = 600; i >= 0; i--)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oOther, acKey, &piVisits[i]);
+      ASSURE(iSuccessful);
+   }
+   iCount = 0;
+   SymTable_iterBegin(oSymTable, &sIter);
+   SymTable_iterBegin(oOther, &sOther);
+   while (SymTable_iterNext(&sIter, &pcKey, NULL, &pvValue))
+   {
+      ASSURE(SymTable_get(oOther, pcKey) == pvValue);
+      ASSURE(SymTable_iterNext(&sOther, &pcKey, NULL, &pvValue));
+      ASSURE(SymTable_get(oSymTable, pcKey) == pvValue);
+      iCount++;
+   }
+   ASSURE(!SymTable_iterNext(&sOther, &pcKey, NULL, &pvValue));
+   SymTable_iterEnd(&sOther);
+   SymTable_iterEnd(&sIter);
+   ASSURE(iCount == 601);
+   SymTable_free(oOther);
+   SymTable_free(oSymTable);
+
+   /* A key with '\0' characters comes with its full length. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   iSuccessful = SymTable_putN(oSymTable, "a\0b", 3, piVisits);
+   ASSURE(iSuccessful);
+   SymTable_iterBegin(oSymTable, &sIter);
+   ASSURE(SymTable_iterNext(&sIter, &pcKey, &uLength, &pvValue));
+   ASSURE(uLength == 3);
+   ASSURE(memcmp(pcKey, "a\0b", 3) == 0);
+   ASSURE(pvValue == piVisits);
+   ASSURE(!SymTable_iterNext(&sIter, &pcKey, &uLength, &pvValue));
+   SymTable_iterEnd(&sIter);
+   SymTable_free(oSymTable);
+
+   free(piVisits);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Scan oSymTable, whose bindings bind the numerals of 0 through
+   iSize - 1 to the ints of piVisits with those indices, with
+   SymTable_scan, asking for uCount bindings per call. Unless
+   iChurn is 0, add bindings between calls until the table has grown
+   several times, and then remove them until it has shrunk again.
+   Check that each of the first bindings is visited at least once, or
+   exactly once if the table does not change. */
+
+static void checkScan(SymTable_T oSymTable, int *piVisits, int iSize,
+   size_t uCount, int iChurn)
+{
+   enum {CHURN_STEP = 500, CHURN_COUNT = 20000};
+
+   struct MapTally sTally;
+   int iChurnValue;
+   char acKey[32];
+   size_t uCursor = 0;
+   int iAdded = 0;
+   int iRemoved = 0;
+   int iSuccessful;
+   int iCall;
+   int i;
+
+   memset(piVisits, 0, ITER_KEY_COUNT * sizeof(int));
+   sTally.uCount = 0;
+   sTally.uKeyLengthSum = 0;
+   for (iCall = 0; ; iCall++)
+   {
+      uCursor = SymTable_scan(oSymTable, uCursor, uCount, tallyBinding,
+         &sTally);
+      if (uCursor == 0)
+         break;
+      if (!iChurn)
+         continue;
+
+      for (i = 0; i < CHURN_STEP; i++)
+      {
+         if (iAdded < CHURN_COUNT)
+         {
+            sprintf(acKey, "churn %d", iAdded++);
+            iSuccessful = SymTable_put(oSymTable, acKey, &iChurnValue);
+            ASSURE(iSuccessful);
+         }
+         else if (iRemoved < iAdded)
+         {
+            sprintf(acKey, "churn %d", iRemoved++);
+            ASSURE(SymTable_remove(oSymTable, acKey) == &iChurnValue);
+         }
+      }
+   }
+
+   for (i = 0; i < iSize; i++)
+   {
+      if (iChurn)
+         ASSURE(piVisits[i] >= 1);
+      else
+         ASSURE(piVisits[i] == 1);
+   }
+   if (!iChurn)
+      ASSURE(sTally.uCount == (size_t)iSize);
+
+   /* Leave the table as it was */
+   while (iRemoved < iAdded)
+   {
+      sprintf(acKey, "churn %d", iRemoved++);
+      ASSURE(SymTable_remove(oSymTable, acKey) == &iChurnValue);
+   }
+}
+
+/* Test SymTable_scan on tables of several sizes, including a
+   concurrent one, with a few bindings asked for per call or many,
+   while the table is left alone and while it grows and shrinks
+   between calls. */
+
+static void testScan(void)
+{
+   static const int aiSizes[] = {0, 5, 600, ITER_KEY_COUNT};
+   static const size_t auCounts[] = {0, 1, 50, ITER_KEY_COUNT};
+
+   SymTable_T oSymTable;
+   int *piVisits;
+   char acKey[16];
+   int iSuccessful;
+   int iSize;
+   int iConcurrent;
+   size_t uCount;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the ability to scan a table in steps.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   piVisits = (int*)calloc(ITER_KEY_COUNT, sizeof(int));
+   ASSURE(piVisits != NULL);
+   if (piVisits == NULL)
+      return;
+
+   for (iConcurrent = 0; iConcurrent < 2; iConcurrent++)
+   {
+      for (iSize = 0; iSize < (int)(sizeof(aiSizes) / sizeof(aiSizes[0]));
+         iSize++)
+      {
+         oSymTable = iConcurrent ? SymTable_newConcurrent() : SymTable_new();
+         if (oSymTable == NULL)
+            continue;
+         for (i = 0; i < aiSizes[iSize]; i++)
+         {
+            sprintf(acKey, "%d", i);
+            iSuccessful = SymTable_put(oSymTable, acKey, &piVisits[i]);
+            ASSURE(iSuccessful);
+         }
+
+         for (uCount = 0; uCount < sizeof(auCounts) / sizeof(auCounts[0]);
+            uCount++)
+         {
+            checkScan(oSymTable, piVisits, aiSizes[iSize], auCounts[uCount],
+               0);
+            checkScan(oSymTable, piVisits, aiSizes[iSize], auCounts[uCount],
+               1);
+         }
+         SymTable_free(oSymTable);
+      }
+   }
+
+   free(piVisits);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_freeze on tables of several sizes, including a
+   concurrent one: the frozen table must hold each binding of the
+   table once, and no other, after the table itself is freed. Then
+   test keys that contain '\0' characters, an empty key and a long
+   key. */
+
+static void testFreeze(void)
+{
+   enum {LONG_KEY_SIZE = 1000};
+
+   static const int aiSizes[] = {0, 1, 5, 600, ITER_KEY_COUNT};
+
+   SymTable_T oSymTable;
+   SymFrozen_T oSymFrozen;
+   struct MapTally sTally;
+   int *piVisits;
+   char acKey[16];
+   char acLongKey[LONG_KEY_SIZE];
+   int aiValues[4];
+   int iSuccessful;
+   int iSize;
+   int iConcurrent;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the ability to freeze a table.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   piVisits = (int*)calloc(ITER_KEY_COUNT, sizeof(int));
+   ASSURE(piVisits != NULL);
+   if (piVisits == NULL)
+      return;
+
+   for (iConcurrent = 0; iConcurrent < 2; iConcurrent++)
+   {
+      for (iSize = 0; iSize < (int)(sizeof(aiSizes) / sizeof(aiSizes[0]));
+         iSize++)
+      {
+         oSymTable = iConcurrent ? SymTable_newConcurrent() : SymTable_new();
+         if (oSymTable == NULL)
+            continue;
+         for (i = 0; i < aiSizes[iSize]; i++)
+         {
+            sprintf(acKey, "%d", i);
+            iSuccessful = SymTable_put(oSymTable, acKey, &piVisits[i]);
+            ASSURE(iSuccessful);
+         }
+         oSymFrozen = SymTable_freeze(oSymTable);
+         ASSURE(oSymFrozen != NULL);
+         SymTable_free(oSymTable);
+         if (oSymFrozen == NULL)
+            continue;
+
+         ASSURE(SymFrozen_getLength(oSymFrozen) == (size_t)aiSizes[iSize]);
+         ASSURE(SymFrozen_verify(oSymFrozen));
+         for (i = 0; i < aiSizes[iSize]; i++)
+         {
+            sprintf(acKey, "%d", i);
+            ASSURE(SymFrozen_contains(oSymFrozen, acKey));
+            ASSURE(SymFrozen_get(oSymFrozen, acKey) == &piVisits[i]);
+            sprintf(acKey, "x%d", i);
+            ASSURE(! SymFrozen_contains(oSymFrozen, acKey));
+            ASSURE(SymFrozen_get(oSymFrozen, acKey) == NULL);
+         }
+         ASSURE(! SymFrozen_contains(oSymFrozen, ""));
+
+         memset(piVisits, 0, ITER_KEY_COUNT * sizeof(int));
+         sTally.uCount = 0;
+         sTally.uKeyLengthSum = 0;
+         SymFrozen_map(oSymFrozen, tallyBinding, &sTally);
+         ASSURE(sTally.uCount == (size_t)aiSizes[iSize]);
+         for (i = 0; i < aiSizes[iSize]; i++)
+            ASSURE(piVisits[i] == 1);
+
+         SymFrozen_free(oSymFrozen);
+      }
+   }
+   free(piVisits);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   if (oSymTable == NULL)
+      return;
+   memset(acLongKey, 'k', LONG_KEY_SIZE);
+   iSuccessful = SymTable_putN(oSymTable, "a\0b", 3, &aiValues[0]);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putN(oSymTable, "a", 1, &aiValues[1]);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putN(oSymTable, "", 0, &aiValues[2]);
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_putN(oSymTable, acLongKey, LONG_KEY_SIZE,
+      &aiValues[3]);
+   ASSURE(iSuccessful);
+   oSymFrozen = SymTable_freeze(oSymTable);
+   ASSURE(oSymFrozen != NULL);
+   SymTable_free(oSymTable);
+   if (oSymFrozen == NULL)
+      return;
+
+   ASSURE(SymFrozen_getLength(oSymFrozen) == 4);
+   ASSURE(SymFrozen_getN(oSymFrozen, "a\0b", 3) == &aiValues[0]);
+   ASSURE(SymFrozen_get(oSymFrozen, "a") == &aiValues[1]);
+   ASSURE(SymFrozen_get(oSymFrozen, "") == &aiValues[2]);
+   ASSURE(SymFrozen_getN(oSymFrozen, acLongKey, LONG_KEY_SIZE)
+      == &aiValues[3]);
+   ASSURE(! SymFrozen_containsN(oSymFrozen, "a\0c", 3));
+   ASSURE(! SymFrozen_containsN(oSymFrozen, "a\0", 2));
+   ASSURE(! SymFrozen_containsN(oSymFrozen, acLongKey,
+      LONG_KEY_SIZE - 1));
+   SymFrozen_free(oSymFrozen);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Write the uSize bytes at pcBytes to the file at pcPath, replacing
+   it. */
+
+static void writeFile(const char *pcPath, const char *pcBytes,
+   size_t uSize)
+{
+   FILE *psFile;
+
+   psFile = fopen(pcPath, "wb");
+   ASSURE(psFile != NULL);
+   if (psFile == NULL)
+      return;
+   ASSURE(fwrite(pcBytes, 1, uSize, psFile) == uSize);
+   fclose(psFile);
+}
+
+/* Count the binding whose key is pcKey in the MapTally that pvExtra
+   points to, like tallyBinding, but leave pvValue alone, as it may
+   be any number. */
+
+static void tallyKey(const char *pcKey, void *pvValue, void *pvExtra)
+{
+   struct MapTally *psTally = (struct MapTally*)pvExtra;
+
+   assert(pcKey != NULL);
+   assert(pvExtra != NULL);
+
+   (void)pvValue;
+   psTally->uCount++;
+   psTally->uKeyLengthSum += strlen(pcKey);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_save and SymTable_openMapped on tables of several
+   sizes: the mapped table must hold each binding of the saved one
+   after the saved one is freed, and must save again while mapped.
+   Then test that a file that is truncated, empty or missing is
+   refused, that a corrupt one is refused or fails SymFrozen_verify,
+   and that slots whose keys lie outside the file are passed over. */
+
+static void testSaveAndOpen(void)
+{
+   static const char *pcPath = "testsymtable.sym";
+   static const int aiSizes[] = {0, 1, 600, ITER_KEY_COUNT};
+   static const double adCorruptAt[] = {0.0, 0.3, 0.6, 0.99};
+
+   SymTable_T oSymTable;
+   SymFrozen_T oSymFrozen;
+   SymFrozen_T oSymFrozen2;
+   struct MapTally sTally;
+   FILE *psFile;
+   int *piVisits;
+   char *pcFile;
+   char acKey[16];
+   char acSaved[24];
+   long lFileSize;
+   size_t uFileSize;
+   size_t uAt;
+   int iSuccessful;
+   int iSize;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the ability to save a table and map it back.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   piVisits = (int*)calloc(ITER_KEY_COUNT, sizeof(int));
+   ASSURE(piVisits != NULL);
+   if (piVisits == NULL)
+      return;
+
+   for (iSize = 0; iSize < (int)(sizeof(aiSizes) / sizeof(aiSizes[0]));
+      iSize++)
+   {
+      oSymTable = SymTable_new();
+      ASSURE(oSymTable != NULL);
+      if (oSymTable == NULL)
+         continue;
+      for (i = 0; i < aiSizes[iSize]; i++)
+      {
+         sprintf(acKey, "%d", i);
+         iSuccessful = SymTable_put(oSymTable, acKey, &piVisits[i]);
+         ASSURE(iSuccessful);
+      }
+      iSuccessful = SymTable_save(oSymTable, pcPath);
+      ASSURE(iSuccessful);
+      SymTable_free(oSymTable);
+
+      oSymFrozen = SymTable_openMapped(pcPath);
+      ASSURE(oSymFrozen != NULL);
+      if (oSymFrozen == NULL)
+         continue;
+      ASSURE(SymFrozen_verify(oSymFrozen));
+      ASSURE(SymFrozen_getLength(oSymFrozen) == (size_t)aiSizes[iSize]);
+      for (i = 0; i < aiSizes[iSize]; i++)
+      {
+         sprintf(acKey, "%d", i);
+         ASSURE(SymFrozen_get(oSymFrozen, acKey) == &piVisits[i]);
+         sprintf(acKey, "x%d", i);
+         ASSURE(! SymFrozen_contains(oSymFrozen, acKey));
+      }
+
+      memset(piVisits, 0, ITER_KEY_COUNT * sizeof(int));
+      sTally.uCount = 0;
+      sTally.uKeyLengthSum = 0;
+      SymFrozen_map(oSymFrozen, tallyBinding, &sTally);
+      ASSURE(sTally.uCount == (size_t)aiSizes[iSize]);
+      for (i = 0; i < aiSizes[iSize]; i++)
+         ASSURE(piVisits[i] == 1);
+
+      /* Saving replaces the file, so the old mapping stays intact */
+      iSuccessful = SymFrozen_save(oSymFrozen, pcPath);
+      ASSURE(iSuccessful);
+      oSymFrozen2 = SymTable_openMapped(pcPath);
+      ASSURE(oSymFrozen2 != NULL);
+      if (oSymFrozen2 != NULL)
+      {
+         ASSURE(SymFrozen_getLength(oSymFrozen2)
+            == (size_t)aiSizes[iSize]);
+         if (aiSizes[iSize] > 0)
+            ASSURE(SymFrozen_get(oSymFrozen2, "0") == &piVisits[0]);
+         SymFrozen_free(oSymFrozen2);
+      }
+      if (aiSizes[iSize] > 0)
+         ASSURE(SymFrozen_get(oSymFrozen, "0") == &piVisits[0]);
+      SymFrozen_free(oSymFrozen);
+   }
+   free(piVisits);
+
+   /* The file now holds the largest table. Read it back, and change
+      it in a few places. A change to the header is found when the
+      file is opened, and one to the slots or keys perhaps only by
+      SymFrozen_verify. */
+   psFile = fopen(pcPath, "rb");
+   ASSURE(psFile != NULL);
+   if (psFile == NULL)
+      return;
+   fseek(psFile, 0, SEEK_END);
+   lFileSize = ftell(psFile);
+   ASSURE(lFileSize > 0);
+   uFileSize = (size_t)lFileSize;
+   fseek(psFile, 0, SEEK_SET);
+   pcFile = (char*)malloc(uFileSize);
+   ASSURE(pcFile != NULL);
+   if (pcFile == NULL)
+   {
+      fclose(psFile);
+      return;
+   }
+   ASSURE(fread(pcFile, 1, uFileSize, psFile) == uFileSize);
+   fclose(psFile);
+
+   for (i = 0; i < (int)(sizeof(adCorruptAt) / sizeof(adCorruptAt[0]));
+      i++)
+   {
+      uAt = (size_t)(adCorruptAt[i] * (double)uFileSize);
+      pcFile[uAt] ^= 0x10;
+      writeFile(pcPath, pcFile, uFileSize);
+      oSymFrozen = SymTable_openMapped(pcPath);
+      ASSURE(uAt > 0 || oSymFrozen == NULL);
+      if (oSymFrozen != NULL)
+      {
+         ASSURE(! SymFrozen_verify(oSymFrozen));
+         SymFrozen_free(oSymFrozen);
+      }
+      pcFile[uAt] ^= 0x10;
+   }
+
+   /* Slots make up most of the file, so these bytes cover at least
+      one key offset or length, which then points outside the file.
+      Lookups and SymFrozen_map must pass over that slot. */
+   uAt = (size_t)(0.3 * (double)uFileSize);
+   memcpy(acSaved, pcFile + uAt, sizeof(acSaved));
+   memset(pcFile + uAt, 0xFF, sizeof(acSaved));
+   writeFile(pcPath, pcFile, uFileSize);
+   oSymFrozen = SymTable_openMapped(pcPath);
+   ASSURE(oSymFrozen != NULL);
+   if (oSymFrozen != NULL)
+   {
+      ASSURE(! SymFrozen_verify(oSymFrozen));
+      for (i = 0; i < ITER_KEY_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         (void)SymFrozen_contains(oSymFrozen, acKey);
+      }
+      sTally.uCount = 0;
+      sTally.uKeyLengthSum = 0;
+      SymFrozen_map(oSymFrozen, tallyKey, &sTally);
+      ASSURE(sTally.uCount < ITER_KEY_COUNT);
+      ASSURE(sTally.uCount >= ITER_KEY_COUNT - 2);
+      SymFrozen_free(oSymFrozen);
+   }
+   memcpy(pcFile + uAt, acSaved, sizeof(acSaved));
+
+   writeFile(pcPath, pcFile, uFileSize - 1);
+   ASSURE(SymTable_openMapped(pcPath) == NULL);
+   writeFile(pcPath, pcFile, 0);
+   ASSURE(SymTable_openMapped(pcPath) == NULL);
+
+   writeFile(pcPath, pcFile, uFileSize);
+   oSymFrozen = SymTable_openMapped(pcPath);
+   ASSURE(oSymFrozen != NULL);
+   if (oSymFrozen != NULL)
+   {
+      ASSURE(SymFrozen_getLength(oSymFrozen) == ITER_KEY_COUNT);
+      SymFrozen_free(oSymFrozen);
+   }
+   free(pcFile);
+
+   remove(pcPath);
+   ASSURE(SymTable_openMapped(pcPath) == NULL);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   if (oSymTable == NULL)
+      return;
+   ASSURE(! SymTable_save(oSymTable, "no such directory/table.sym"));
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+#ifndef S_SPLINT_S
+
+enum {DURABLE_KEY_COUNT = 2000};
+enum {DURABLE_THREAD_COUNT = 4};
+
+/* A DurableWorker is the work of one thread of testDurable. */
+
+struct DurableWorker
+{
+   /* The table that every thread uses */
+   SymDurable_T oSymDurable;
+
+   /* The number of the thread, which its keys contain */
+   int iThread;
+};
+
+/* Put DURABLE_KEY_COUNT / DURABLE_THREAD_COUNT keys of the
+   DurableWorker at pvWorker into its table, and remove every other
+   one. Return NULL. */
+
+static void *durableWork(void *pvWorker)
+{
+   struct DurableWorker *psWorker = (struct DurableWorker*)pvWorker;
+   char acKey[32];
+   int i;
+
+   for (i = 0; i < DURABLE_KEY_COUNT / DURABLE_THREAD_COUNT; i++)
+   {
+      sprintf(acKey, "thread %d:%d", psWorker->iThread, i);
+      ASSURE(SymDurable_put(psWorker->oSymDurable, acKey, psWorker));
+      if (i % 2 == 1)
+         ASSURE(SymDurable_remove(psWorker->oSymDurable, acKey)
+            == psWorker);
+   }
+   return NULL;
+}
+
+/* Check that oSymDurable holds the bindings that testDurable leaves
+   after iPhase phases of changes, whose values are elements of
+   piValues. Return the number of those bindings. */
+
+static size_t checkDurable(SymDurable_T oSymDurable, int *piValues,
+   int iPhase)
+{
+   char acKey[32];
+   size_t uExpected = 0;
+   void *pvExpected;
+   int i;
+
+   for (i = 0; i < DURABLE_KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (i % 5 == 0 || (iPhase >= 2 && i % 7 == 1))
+         pvExpected = NULL;
+      else if (i % 3 == 0)
+         pvExpected = &piValues[0];
+      else
+         pvExpected = &piValues[i];
+      ASSURE(SymDurable_contains(oSymDurable, acKey)
+         == (pvExpected != NULL));
+      ASSURE(SymDurable_get(oSymDurable, acKey) == pvExpected);
+      if (pvExpected != NULL)
+         uExpected++;
+
+      if (iPhase >= 2)
+      {
+         sprintf(acKey, "new %d", i);
+         ASSURE(SymDurable_get(oSymDurable, acKey) == &piValues[i]);
+         uExpected++;
+      }
+   }
+   return uExpected;
+}
+
+/* Test that a SymDurable object keeps its bindings across closing and
+   opening again, before and after a compaction, after the log is cut
+   short, while several threads change it at once, and while it
+   compacts in the background.  Then test that a replacement or
+   removal whose record cannot be written is reported. */
+
+static void testDurable(void)
+{
+   enum {LONG_KEY_SIZE = 400, LONG_KEY_COUNT = 4000};
+
+   static const char *pcPath = "testsymtable.dur";
+   static const char *pcLogPath = "testsymtable.dur.log";
+
+   SymDurable_T oSymDurable;
+   struct DurableWorker asWorkers[DURABLE_THREAD_COUNT];
+   pthread_t aiThreads[DURABLE_THREAD_COUNT];
+   FILE *psFile;
+   int *piValues;
+   char acKey[LONG_KEY_SIZE + 16];
+   struct rlimit sOldLimit;
+   struct rlimit sNewLimit;
+   long lLogSize;
+   size_t uLength;
+   int iRound;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the ability to keep a table in a log.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   remove(pcPath);
+   remove(pcLogPath);
+   piValues = (int*)calloc(DURABLE_KEY_COUNT, sizeof(int));
+   ASSURE(piValues != NULL);
+   if (piValues == NULL)
+      return;
+
+   oSymDurable = SymDurable_open(pcPath);
+   ASSURE(oSymDurable != NULL);
+   if (oSymDurable == NULL)
+   {
+      free(piValues);
+      return;
+   }
+   ASSURE(SymDurable_getLength(oSymDurable) == 0);
+   for (i = 0; i < DURABLE_KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      ASSURE(SymDurable_put(oSymDurable, acKey, &piValues[i]));
+      ASSURE(! SymDurable_put(oSymDurable, acKey, &piValues[0]));
+      if (i % 3 == 0)
+         ASSURE(SymDurable_replace(oSymDurable, acKey, &piValues[0])
+            == &piValues[i]);
+      if (i % 5 == 0)
+         ASSURE(SymDurable_remove(oSymDurable, acKey) != NULL);
+   }
+   ASSURE(SymDurable_replace(oSymDurable, "absent", &piValues[0])
+      == NULL);
+   ASSURE(SymDurable_remove(oSymDurable, "absent") == NULL);
+   ASSURE(checkDurable(oSymDurable, piValues, 1)
+      == SymDurable_getLength(oSymDurable));
+   SymDurable_close(oSymDurable);
+
+   /* Replay the log alone, then a snapshot and the log after it */
+   oSymDurable = SymDurable_open(pcPath);
+   ASSURE(oSymDurable != NULL);
+   if (oSymDurable == NULL)
+   {
+      free(piValues);
+      return;
+   }
+   ASSURE(checkDurable(oSymDurable, piValues, 1)
+      == SymDurable_getLength(oSymDurable));
+   ASSURE(SymDurable_compact(oSymDurable));
+   for (i = 0; i < DURABLE_KEY_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      if (i % 7 == 1 && i % 5 != 0)
+         ASSURE(SymDurable_remove(oSymDurable, acKey) != NULL);
+      sprintf(acKey, "new %d", i);
+      ASSURE(SymDurable_put(oSymDurable, acKey, &piValues[i]));
+   }
+   ASSURE(checkDurable(oSymDurable, piValues, 2)
+      == SymDurable_getLength(oSymDurable));
+   ASSURE(! SymDurable_hasFailed(oSymDurable));
+   SymDurable_close(oSymDurable);
+
+   /* A record cut short by a crash is dropped */
+   psFile = fopen(pcLogPath, "ab");
+   ASSURE(psFile != NULL);
+   if (psFile != NULL)
+   {
+      ASSURE(fwrite("cut short", 1, 9, psFile) == 9);
+      fclose(psFile);
+   }
+   oSymDurable = SymDurable_open(pcPath);
+   ASSURE(oSymDurable != NULL);
+   if (oSymDurable == NULL)
+   {
+      free(piValues);
+      return;
+   }
+   ASSURE(checkDurable(oSymDurable, piValues, 2)
+      == SymDurable_getLength(oSymDurable));
+   ASSURE(SymDurable_put(oSymDurable, "after the cut", &piValues[1]));
+
+   /* Several writers share fsync calls */
+   for (i = 0; i < DURABLE_THREAD_COUNT; i++)
+   {
+      asWorkers[i].oSymDurable = oSymDurable;
+      asWorkers[i].iThread = i;
+      ASSURE(pthread_create(&aiThreads[i], NULL, durableWork,
+         &asWorkers[i]) == 0);
+   }
+   for (i = 0; i < DURABLE_THREAD_COUNT; i++)
+      ASSURE(pthread_join(aiThreads[i], NULL) == 0);
+   uLength = SymDurable_getLength(oSymDurable);
+   SymDurable_close(oSymDurable);
+
+   oSymDurable = SymDurable_open(pcPath);
+   ASSURE(oSymDurable != NULL);
+   if (oSymDurable == NULL)
+   {
+      free(piValues);
+      return;
+   }
+   ASSURE(SymDurable_getLength(oSymDurable) == uLength);
+   ASSURE(SymDurable_get(oSymDurable, "after the cut") == &piValues[1]);
+   for (i = 0; i < DURABLE_THREAD_COUNT; i++)
+   {
+      sprintf(acKey, "thread %d:%d", i, 0);
+      ASSURE(SymDurable_get(oSymDurable, acKey) == &asWorkers[i]);
+      sprintf(acKey, "thread %d:%d", i, 1);
+      ASSURE(! SymDurable_contains(oSymDurable, acKey));
+   }
+
+   /* Long keys fill the log enough for the background thread to
+      compact it, while the bindings change under it */
+   memset(acKey, 'k', LONG_KEY_SIZE);
+   for (iRound = 0; iRound < 2; iRound++)
+      for (i = 0; i < LONG_KEY_COUNT; i++)
+      {
+         sprintf(acKey + LONG_KEY_SIZE, "%d", i);
+         if (iRound == 0)
+            ASSURE(SymDurable_put(oSymDurable, acKey, &piValues[1]));
+         else if (i % 2 == 0)
+            ASSURE(SymDurable_remove(oSymDurable, acKey)
+               == &piValues[1]);
+      }
+   ASSURE(SymDurable_getLength(oSymDurable)
+      == uLength + LONG_KEY_COUNT / 2);
+   SymDurable_close(oSymDurable);
+
+   oSymDurable = SymDurable_open(pcPath);
+   ASSURE(oSymDurable != NULL);
+   if (oSymDurable != NULL)
+   {
+      ASSURE(SymDurable_getLength(oSymDurable)
+         == uLength + LONG_KEY_COUNT / 2);
+      checkDurable(oSymDurable, piValues, 2);
+      sprintf(acKey + LONG_KEY_SIZE, "%d", 1);
+      ASSURE(SymDurable_get(oSymDurable, acKey) == &piValues[1]);
+      SymDurable_close(oSymDurable);
+   }
+
+   /* Limiting the size of files to that of the log makes the next
+      record fail to be written, in round 0 for a replacement and in
+      round 1 for a removal */
+   signal(SIGXFSZ, SIG_IGN);
+   for (iRound = 0; iRound < 2; iRound++)
+   {
+      remove(pcPath);
+      remove(pcLogPath);
+      oSymDurable = SymDurable_open(pcPath);
+      ASSURE(oSymDurable != NULL);
+      if (oSymDurable == NULL)
+         continue;
+      ASSURE(SymDurable_put(oSymDurable, "key", &piValues[1]));
+
+      psFile = fopen(pcLogPath, "rb");
+      ASSURE(psFile != NULL);
+      if (psFile == NULL)
+      {
+         SymDurable_close(oSymDurable);
+         continue;
+      }
+      fseek(psFile, 0, SEEK_END);
+      lLogSize = ftell(psFile);
+      fclose(psFile);
+
+      ASSURE(getrlimit(RLIMIT_FSIZE, &sOldLimit) == 0);
+      sNewLimit = sOldLimit;
+      sNewLimit.rlim_cur = (rlim_t)lLogSize;
+      ASSURE(setrlimit(RLIMIT_FSIZE, &sNewLimit) == 0);
+      if (iRound == 0)
+         ASSURE(SymDurable_replace(oSymDurable, "key", &piValues[2])
+            == NULL);
+      else
+         ASSURE(SymDurable_remove(oSymDurable, "key") == NULL);
+      ASSURE(setrlimit(RLIMIT_FSIZE, &sOldLimit) == 0);
+
+      ASSURE(SymDurable_hasFailed(oSymDurable));
+      ASSURE(! SymDurable_put(oSymDurable, "other", &piValues[1]));
+      SymDurable_close(oSymDurable);
+   }
+   signal(SIGXFSZ, SIG_DFL);
+
+   free(piValues);
+   remove(pcPath);
+   remove(pcLogPath);
+}
+
+#endif
+
+/*--------------------------------------------------------------------*/
+
+#if defined(SYMTABLE_SHARED) && !defined(S_SPLINT_S)
+
+enum {SHARED_STABLE_COUNT = 1000, SHARED_CHURN_COUNT = 20000};
+enum {SHARED_ROUND_COUNT = 10};
+
+/* In a process forked from the one that made oSymTable, look up the
+   stable bindings of testShared over and over while the parent
+   changes the others, from writing a byte to file descriptor
+   iReadyFd until the parent adds the key "done".  Check
+   that the child cannot change oSymTable and that tables it makes
+   itself work.  Exit the process. */
+
+static void sharedChild(SymTable_T oSymTable, int *piValues,
+   int iReadyFd)
+{
+   SymTable_T oOwnSymTable;
+   char acKey[32];
+   int i;
+
+   ASSURE(! SymTable_put(oSymTable, "child", &piValues[0]));
+   ASSURE(SymTable_replace(oSymTable, "s0", &piValues[1]) == NULL);
+   ASSURE(SymTable_remove(oSymTable, "s0") == NULL);
+   ASSURE(SymTable_getOrPut(oSymTable, "child", &piValues[0]) == NULL);
+
+   oOwnSymTable = SymTable_new();
+   ASSURE(oOwnSymTable != NULL);
+   if (oOwnSymTable != NULL)
+   {
+      for (i = 0; i < SHARED_STABLE_COUNT; i++)
+      {
+         sprintf(acKey, "own %d", i);
+         ASSURE(SymTable_put(oOwnSymTable, acKey, &piValues[i]));
+      }
+      ASSURE(SymTable_getLength(oOwnSymTable) == SHARED_STABLE_COUNT);
+      SymTable_free(oOwnSymTable);
+   }
+
+   ASSURE(write(iReadyFd, "r", 1) == 1);
+   while (! SymTable_contains(oSymTable, "done"))
+      for (i = 0; i < SHARED_STABLE_COUNT; i++)
+      {
+         sprintf(acKey, "s%d", i);
+         ASSURE(SymTable_get(oSymTable, acKey) == &piValues[i]);
+      }
+   ASSURE(SymTable_get(oSymTable, "late") == &piValues[1]);
+   ASSURE(! SymTable_contains(oSymTable, "child"));
+
+   SymTable_free(oSymTable);
+   fflush(stdout);
+   _exit(0);
+}
+
+/* Test that the bindings of a table in shared memory are seen, as
+   they change, by a forked process and by a table attached by name,
+   neither of which can change them, and that a full pool refuses
+   more bindings. */
+
+static void testShared(void)
+{
+   static const char *pcName = "/testsymtable";
+
+   SymTable_T oSymTable;
+   SymTable_T oAttached;
+   int *piValues;
+   char acKey[32];
+   int aiReadyFds[2];
+   char cReady;
+   pid_t iPid;
+   int iStatus;
+   int iRound;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the ability to share a table between processes.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   piValues = (int*)calloc(SHARED_STABLE_COUNT, sizeof(int));
+   ASSURE(piValues != NULL);
+   if (piValues == NULL)
+      return;
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   if (oSymTable == NULL)
+   {
+      free(piValues);
+      return;
+   }
+   for (i = 0; i < SHARED_STABLE_COUNT; i++)
+   {
+      sprintf(acKey, "s%d", i);
+      ASSURE(SymTable_put(oSymTable, acKey, &piValues[i]));
+   }
+
+   /* The child reads while the table grows and shrinks under it */
+   ASSURE(pipe(aiReadyFds) == 0);
+   iPid = fork();
+   ASSURE(iPid >= 0);
+   if (iPid == 0)
+      sharedChild(oSymTable, piValues, aiReadyFds[1]);
+   if (iPid > 0)
+      ASSURE(read(aiReadyFds[0], &cReady, 1) == 1);
+   close(aiReadyFds[0]);
+   close(aiReadyFds[1]);
+   ASSURE(SymTable_put(oSymTable, "late", &piValues[1]));
+   for (iRound = 0; iRound < SHARED_ROUND_COUNT; iRound++)
+   {
+      for (i = 0; i < SHARED_CHURN_COUNT; i++)
+      {
+         sprintf(acKey, "c%d", i);
+         ASSURE(SymTable_put(oSymTable, acKey, &piValues[0]));
+      }
+      for (i = 0; i < SHARED_CHURN_COUNT; i++)
+      {
+         sprintf(acKey, "c%d", i);
+         ASSURE(SymTable_remove(oSymTable, acKey) == &piValues[0]);
+      }
+   }
+   ASSURE(SymTable_put(oSymTable, "done", NULL));
+   if (iPid > 0)
+   {
+      ASSURE(waitpid(iPid, &iStatus, 0) == iPid);
+      ASSURE(WIFEXITED(iStatus) && WEXITSTATUS(iStatus) == 0);
+   }
+   ASSURE(SymTable_getLength(oSymTable) == SHARED_STABLE_COUNT + 2);
+   SymTable_free(oSymTable);
+
+   /* A named table seen through a read-only mapping */
+   ASSURE(SymTable_newShared(pcName, 16) == NULL);
+   oSymTable = SymTable_newShared(pcName, 1 << 20);
+   ASSURE(oSymTable != NULL);
+   if (oSymTable == NULL)
+   {
+      free(piValues);
+      return;
+   }
+   ASSURE(SymTable_put(oSymTable, "before", &piValues[0]));
+   oAttached = SymTable_attachShared(pcName);
+   ASSURE(oAttached != NULL);
+   if (oAttached != NULL)
+   {
+      ASSURE(SymTable_get(oAttached, "before") == &piValues[0]);
+      ASSURE(SymTable_put(oSymTable, "after", &piValues[1]));
+      ASSURE(SymTable_get(oAttached, "after") == &piValues[1]);
+      ASSURE(! SymTable_put(oAttached, "attached", NULL));
+      ASSURE(! SymTable_reserve(oAttached, 100));
+
+      /* The pool fills up, and puts fail without harm */
+      for (i = 0; ; i++)
+      {
+         sprintf(acKey, "f%d", i);
+         if (! SymTable_put(oSymTable, acKey, &piValues[1]))
+            break;
+      }
+      ASSURE(i > 1000);
+      ASSURE(SymTable_getLength(oAttached) == (size_t)i + 2);
+      ASSURE(SymTable_contains(oAttached, "f0"));
+      ASSURE(SymTable_remove(oSymTable, "f0") == &piValues[1]);
+      ASSURE(! SymTable_contains(oAttached, "f0"));
+      ASSURE(SymTable_put(oSymTable, "f0", &piValues[1]));
+      SymTable_free(oAttached);
+   }
+   ASSURE(SymTable_unlinkShared(pcName));
+   ASSURE(SymTable_attachShared(pcName) == NULL);
+   ASSURE(SymTable_get(oSymTable, "after") == &piValues[1]);
+   SymTable_free(oSymTable);
+   ASSURE(! SymTable_unlinkShared(pcName));
+
+   free(piValues);
+}
+
+#endif
+
+/*--------------------------------------------------------------------*/
+
+/* Test the ability of a SymTable object to keep its bindings intact
+   while bindings of many key lengths are removed and added again,
+   so that memory freed by one binding is reused by another. */
+
+static void testRemoveAndPutAgain(void)
+{
+   enum {KEY_COUNT = 600};
+   enum {KEY_SIZE = 400};
+
+   SymTable_T oSymTable;
+   char acKey[KEY_SIZE];
+   int aiValues[KEY_COUNT];
+   int *piValue;
+   int i;
+   int iRound;
+   size_t uLength;
+   int iSuccessful;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing removing and putting bindings again.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* Key i is i % (KEY_SIZE - 10) 'k' characters followed by the
+      numeral i, so key lengths range from 1 to nearly KEY_SIZE. */
+   for (iRound = 0; iRound < 3; iRound++)
+   {
+      for (i = 0; i < KEY_COUNT; i++)
+      {
+         if (iRound > 0 && i % 3 != iRound)
+            continue;
+         memset(acKey, 'k', (size_t)(i % (KEY_SIZE - 10)));
+         sprintf(acKey + i % (KEY_SIZE - 10), "%d", i);
+         if (iRound > 0)
+         {
+            piValue = (int*)SymTable_remove(oSymTable, acKey);
+            ASSURE(piValue == &aiValues[i]);
+         }
+         iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+         ASSURE(iSuccessful);
+      }
+
+      uLength = SymTable_getLength(oSymTable);
+      ASSURE(uLength == KEY_COUNT);
+
+      for (i = 0; i < KEY_COUNT; i++)
+      {
+         memset(acKey, 'k', (size_t)(i % (KEY_SIZE - 10)));
+         sprintf(acKey + i % (KEY_SIZE - 10), "%d", i);
+         piValue = (int*)SymTable_get(oSymTable, acKey);
+         ASSURE(piValue == &aiValues[i]);
+      }
+   }
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the ability of SymTable object to have values that are
+   other SymTable objects. */
+
+static void testTableOfTables(void)
+{
+   SymTable_T oSymTable;
+   SymTable_T oSymTable1;
+   SymTable_T oSymTable2;
+   SymTable_T oSymTableRet;
+   char acShortstop[] = "Shortstop";
+   char acCenterField[] = "CenterField";
+   char *pcValue;
+   int iSuccessful;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a SymTable object that contains other\n");
+   printf("SymTable objects.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable1 = SymTable_new();
+   ASSURE(oSymTable1 != NULL);
+
+   iSuccessful = SymTable_put(oSymTable1, "Jeter", acShortstop);
+   ASSURE(iSuccessful);
+
+   oSymTable2 = SymTable_new();
+   ASSURE(oSymTable2 != NULL);
+
+   iSuccessful = SymTable_put(oSymTable2, "Mantle", acCenterField);
+   ASSURE(iSuccessful);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   iSuccessful = SymTable_put(oSymTable, "first table", oSymTable1);
+   ASSURE(iSuccessful);
+
+   iSuccessful = SymTable_put(oSymTable, "second table", oSymTable2);
+   ASSURE(iSuccessful);
+
+   oSymTableRet = (SymTable_T)SymTable_get(oSymTable, "first table");
+   ASSURE(oSymTableRet == oSymTable1);
+
+   pcValue = (char*)SymTable_get(oSymTableRet, "Jeter");
+   ASSURE(pcValue == acShortstop);
+
+   oSymTableRet = (SymTable_T)SymTable_get(oSymTable, "second table");
+   ASSURE(oSymTableRet == oSymTable2);
+
+   pcValue = (char*)SymTable_get(oSymTableRet, "Mantle");
+   ASSURE(pcValue == acCenterField);
+
+   SymTable_free(oSymTable2);
+   SymTable_free(oSymTable1);
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the SymTable_getOrPut(), SymTable_upsert(), and
+   SymTable_putOrReplace() functions. */
+
+static void testCombinedPut(void)
+{
+   SymTable_T oSymTable;
+   char acJeter[] = "Jeter";
+   char acMantle[] = "Mantle";
+   char acShortstop[] = "Shortstop";
+   char acCenterField[] = "Center Field";
+   char acFirstBase[] = "First Base";
+   void **ppvValue;
+   void *pvOldValue;
+   char *pcValue;
+   int iResult;
+   size_t uLength;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the combined lookup-and-insert functions.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+
+   /* Test SymTable_getOrPut(). */
+
+   ppvValue = SymTable_getOrPut(oSymTable, acJeter, acShortstop);
+   ASSURE((ppvValue != NULL) && (*ppvValue == acShortstop));
+
+   ppvValue = SymTable_getOrPut(oSymTable, acJeter, acCenterField);
+   ASSURE((ppvValue != NULL) && (*ppvValue == acShortstop));
+
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == 1);
+
+   *ppvValue = acFirstBase;
+   pcValue = (char*)SymTable_get(oSymTable, acJeter);
+   ASSURE(pcValue == acFirstBase);
+
+   /* Test SymTable_upsert(). */
+
+   iResult = SymTable_upsert(oSymTable, acMantle, acCenterField);
+   ASSURE(iResult);
+
+   iResult = SymTable_upsert(oSymTable, acMantle, acFirstBase);
+   ASSURE(iResult);
+
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == 2);
+
+   pcValue = (char*)SymTable_get(oSymTable, acMantle);
+   ASSURE(pcValue == acFirstBase);
+
+   /* Test SymTable_putOrReplace(). */
+
+   pvOldValue = NULL;
+   iResult = SymTable_putOrReplace(oSymTable, acJeter, acShortstop,
+      &pvOldValue);
+   ASSURE(iResult == 0);
+   ASSURE(pvOldValue == acFirstBase);
+
+   iResult = SymTable_putOrReplace(oSymTable, "Ruth", acCenterField,
+      &pvOldValue);
+   ASSURE(iResult == 1);
+
+   iResult = SymTable_putOrReplace(oSymTable, "Ruth", NULL, NULL);
+   ASSURE(iResult == 0);
+
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == 3);
+
+   pcValue = (char*)SymTable_get(oSymTable, acJeter);
+   ASSURE(pcValue == acShortstop);
+
+   ASSURE(SymTable_contains(oSymTable, "Ruth"));
+   pcValue = (char*)SymTable_get(oSymTable, "Ruth");
+   ASSURE(pcValue == NULL);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable objects made with SymTable_newWithHash(): one whose
+   hash function sends every key to the same bucket, and ones that
+   use the default hash function with different seeds. */
+
+static void testCustomHash(void)
+{
+   enum {BINDING_COUNT = 600};
+   enum {MAX_KEY_LENGTH = 10};
+
+   SymTable_T oSymTable;
+   SymTable_T oSymTableSeeded;
+   char acKey[MAX_KEY_LENGTH];
+   int aiValues[BINDING_COUNT];
+   int *piValue;
+   int i;
+   int iSuccessful;
+   size_t uLength;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing SymTable objects with chosen hash functions.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithHash(constantHash, 0);
+   ASSURE(oSymTable != NULL);
+   oSymTableSeeded = SymTable_newWithHash(NULL, 12345);
+   ASSURE(oSymTableSeeded != NULL);
+
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+      iSuccessful = SymTable_put(oSymTableSeeded, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+   }
+
+   /* Remove every other binding, then look all of them up. */
+   for (i = 0; i < BINDING_COUNT; i += 2)
+   {
+      sprintf(acKey, "%d", i);
+      piValue = (int*)SymTable_remove(oSymTable, acKey);
+      ASSURE(piValue == &aiValues[i]);
+      piValue = (int*)SymTable_remove(oSymTableSeeded, acKey);
+      ASSURE(piValue == &aiValues[i]);
+   }
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      piValue = (int*)SymTable_get(oSymTable, acKey);
+      ASSURE(piValue == ((i % 2 == 0) ? NULL : &aiValues[i]));
+      piValue = (int*)SymTable_get(oSymTableSeeded, acKey);
+      ASSURE(piValue == ((i % 2 == 0) ? NULL : &aiValues[i]));
+   }
+
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(uLength == BINDING_COUNT / 2);
+   uLength = SymTable_getLength(oSymTableSeeded);
+   ASSURE(uLength == BINDING_COUNT / 2);
+
+   SymTable_free(oSymTable);
+   SymTable_free(oSymTableSeeded);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Spread the keys that pfNextKey produces over uBucketCount buckets,
+   a power of two, by the low bits of their default hashes with seed
+   uSeed, one key per bucket on average.  Return the length of the
+   longest chain, and store the number of empty buckets in
+   *puEmptyCount. */
+
+static size_t spreadKeys(size_t uBucketCount, size_t uSeed,
+   void (*pfNextKey)(char *pcKey, size_t uKeyNum),
+   size_t *puEmptyCount)
+{
+   enum {MAX_KEY_LENGTH = 40};
+
+   size_t *puChainLengths;
+   char acKey[MAX_KEY_LENGTH];
+   size_t uLongest = 0;
+   size_t u;
+   size_t uBucket;
+
+   puChainLengths = (size_t*)calloc(uBucketCount, sizeof(size_t));
+   ASSURE(puChainLengths != NULL);
+
+   for (u = 0; u < uBucketCount; u++)
+   {
+      (*pfNextKey)(acKey, u);
+      uBucket = SymHash_hash(acKey, strlen(acKey), uSeed) &
+         (uBucketCount - 1);
+      puChainLengths[uBucket]++;
+   }
+
+   *puEmptyCount = 0;
+   for (u = 0; u < uBucketCount; u++)
+   {
+      if (puChainLengths[u] == 0)
+         (*puEmptyCount)++;
+      if (puChainLengths[u] > uLongest)
+         uLongest = puChainLengths[u];
+   }
+
+   free(puChainLengths);
+   return uLongest;
+}
+
+/* Write key uKeyNum of the numeral key set to pcKey. */
+
+static void numeralKey(char *pcKey, size_t uKeyNum)
+{
+   sprintf(pcKey, "%lu", (unsigned long)uKeyNum);
+}
+
+/* Write key uKeyNum of the long-shared-prefix key set to pcKey. */
+
+static void prefixedKey(char *pcKey, size_t uKeyNum)
+{
+   sprintf(pcKey, "identifier_in_scope_%010lu", (unsigned long)uKeyNum);
+}
+
+/* Write key uKeyNum of the two-character key set to pcKey. */
+
+static void shortKey(char *pcKey, size_t uKeyNum)
+{
+   pcKey[0] = (char)('!' + uKeyNum % 94);
+   pcKey[1] = (char)('!' + uKeyNum / 94 % 94);
+   pcKey[2] = (char)('!' + uKeyNum / (94 * 94));
+   pcKey[3] = '\0';
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the quality of the default hash function.  For key sets that
+   defeat weak hash functions -- consecutive numerals, numerals with a
+   long shared prefix, and short keys -- spread as many keys as there
+   are buckets and check the chain-length distribution against that
+   of a random function: about 1/e of the buckets empty, and no chain
+   much longer than ln n / ln ln n. */
+
+static void testHashQuality(void)
+{
+   enum {BUCKET_COUNT = 1 << 16};
+   enum {MAX_CHAIN_LENGTH = 11};
+
+   void (*apfKeySets[3])(char *pcKey, size_t uKeyNum);
+   size_t uEmptyCount;
+   size_t uLongest;
+   size_t uSeed;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the quality of the default hash function.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   apfKeySets[0] = numeralKey;
+   apfKeySets[1] = prefixedKey;
+   apfKeySets[2] = shortKey;
+
+   for (i = 0; i < 3; i++)
+      for (uSeed = 0; uSeed < 3; uSeed++)
+      {
+         uLongest = spreadKeys(BUCKET_COUNT, uSeed, apfKeySets[i],
+            &uEmptyCount);
+         ASSURE(uLongest <= MAX_CHAIN_LENGTH);
+         /* 1/e of 65536 is 24109, with a standard deviation of
+            about 123. */
+         ASSURE(uEmptyCount > 23500 && uEmptyCount < 24700);
+      }
+
+   /* Different seeds give different hashes. */
+   ASSURE(SymHash_hash("Ruth", 4, 0) != SymHash_hash("Ruth", 4, 1));
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the ability of a SymTable object to handle collisions.  The
+   SymTable object hashes with the hash function provided in the
+   assignment specification, reduced modulo 509, so the keys below
+   share a bucket of a hash table with at least 509 buckets. */
+
+static void testCollisions(void)
+{
+   SymTable_T oSymTable;
+   int iSuccessful;
+   char acCenterField[] = "pitcher";
+   char acCatcher[] = "catcher";
+   char acFirstBase[] = "first base";
+   char acRightField[] = "second base";
+   char *pcValue;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the collision handling of a SymTable object\n");
+   printf("that uses the hash function from the assignment\n");
+   printf("specification.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   oSymTable = SymTable_newWithHash(assignmentHash, 0);
+   ASSURE(oSymTable != NULL);
+
+   /* Note that strings "250", "469", "947", "1303", and "2016" hash
+      to the same bucket -- bucket 123. */
+
+   iSuccessful = SymTable_put(oSymTable, "250", acCenterField);
+   ASSURE(iSuccessful);
+
+   iSuccessful = SymTable_put(oSymTable, "469", acCatcher);
+   ASSURE(iSuccessful);
+
+   iSuccessful = SymTable_put(oSymTable, "947", acFirstBase);
+   ASSURE(iSuccessful);
+
+   iSuccessful = SymTable_put(oSymTable, "1303", acRightField);
+   ASSURE(iSuccessful);
+
+   iSuccessful = SymTable_put(oSymTable, "2016", acRightField);
+   ASSURE(iSuccessful);
+
+   pcValue = SymTable_get(oSymTable, "250");
+   ASSURE(pcValue == acCenterField);
+
+   pcValue = SymTable_get(oSymTable, "469");
+   ASSURE(pcValue == acCatcher);
+
+   pcValue = SymTable_get(oSymTable, "947");
+   ASSURE(pcValue == acFirstBase);
+
+   pcValue = SymTable_get(oSymTable, "1303");
+   ASSURE(pcValue == acRightField);
+
+   pcValue = SymTable_get(oSymTable, "2016");
+   ASSURE(pcValue == acRightField);
+
+   pcValue = SymTable_remove(oSymTable, "947");
+   ASSURE(pcValue == acFirstBase);
+
+   pcValue = SymTable_remove(oSymTable, "2016");
+   ASSURE(pcValue == acRightField);
+
+   pcValue = SymTable_remove(oSymTable, "250");
+   ASSURE(pcValue == acCenterField);
+
+   pcValue = SymTable_get(oSymTable, "469");
+   ASSURE(pcValue == acCatcher);
+
+   pcValue = SymTable_get(oSymTable, "1303");
+   ASSURE(pcValue == acRightField);
+
+   SymTable_free(oSymTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Check the parts of *psStats, just filled in for oSymTable, that
+   every implementation agrees on. */
+
+static void checkStats(SymTable_T oSymTable, SymTable_Stats *psStats)
+{
+   size_t uLength;
+   size_t uBucketCount;
+   size_t uHighest = 0;
+   int iAnyCounted = 0;
+   size_t i;
+
+   uLength = SymTable_getLength(oSymTable);
+   ASSURE(psStats->uLength == uLength);
+   uBucketCount = SymTable_getBucketCount(oSymTable);
+   ASSURE(psStats->uBucketCount == uBucketCount);
+   ASSURE(psStats->dLoadFactor * (double)uBucketCount > (double)uLength - 0.5);
+   ASSURE(psStats->dLoadFactor * (double)uBucketCount < (double)uLength + 0.5);
+
+   /* The last nonempty entry of the histogram is the one that
+      uLongest falls in. */
+   for (i = 0; i < SYMTABLE_HISTOGRAM_SIZE; i++)
+      if (psStats->auHistogram[i] != 0)
+      {
+         uHighest = i;
+         iAnyCounted = 1;
+      }
+   if (! iAnyCounted)
+      ASSURE(psStats->uLongest == 0);
+   else if (psStats->uLongest < SYMTABLE_HISTOGRAM_SIZE - 1)
+      ASSURE(uHighest == psStats->uLongest);
+   else
+      ASSURE(uHighest == SYMTABLE_HISTOGRAM_SIZE - 1);
+
+#ifndef SYMTABLE_STATS
+   ASSURE(psStats->uHits == 0);
+   ASSURE(psStats->uMisses == 0);
+   ASSURE(psStats->uCompares == 0);
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test SymTable_getStats(): its agreement with the other functions,
+   the histogram of a table whose keys all collide, the bytes of a long
+   key, the count of resizes, and, in a build with SYMTABLE_STATS
+   defined, the counters of hits, misses and compares. */
+
+static void testStats(void)
+{
+   enum {BINDING_COUNT = 1000};
+   enum {COLLIDING_COUNT = 100};
+   enum {MAX_KEY_LENGTH = 10};
+   enum {LONG_KEY_LENGTH = 100};
+
+   SymTable_T oSymTable;
+   SymTable_T oSymTableColliding;
+   SymTable_Stats sStats;
+   SymTable_Stats sStatsAfter;
+   char acKey[MAX_KEY_LENGTH];
+   char acLongKey[LONG_KEY_LENGTH + 1];
+   int aiValues[BINDING_COUNT];
+   int iSuccessful;
+   int i;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing the statistics of SymTable objects.\n");
+   printf("No output should appear here:\n");
+   fflush(stdout);
+
+   /* An empty table. */
+   oSymTable = SymTable_new();
+   ASSURE(oSymTable != NULL);
+   SymTable_getStats(oSymTable, &sStats);
+   checkStats(oSymTable, &sStats);
+   ASSURE(sStats.uLength == 0);
+   ASSURE(sStats.uLongest == 0);
+   ASSURE(sStats.uNodeBytes == 0 || sStats.uBucketCount > 1);
+   ASSURE(sStats.uKeyBytes == 0);
+
+   /* A table that grows, unless it has only one bucket. */
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+   }
+   SymTable_getStats(oSymTable, &sStats);
+   checkStats(oSymTable, &sStats);
+   ASSURE(sStats.uLength == BINDING_COUNT);
+   ASSURE(sStats.uResizeCount > 0 || sStats.uBucketCount == 1);
+   ASSURE(sStats.uNodeBytes > 0);
+
+   /* A long key is stored apart from its node. */
+   memset(acLongKey, 'k', LONG_KEY_LENGTH);
+   acLongKey[LONG_KEY_LENGTH] = '\0';
+   iSuccessful = SymTable_put(oSymTable, acLongKey, &aiValues[0]);
+   ASSURE(iSuccessful);
+   SymTable_getStats(oSymTable, &sStatsAfter);
+   checkStats(oSymTable, &sStatsAfter);
+   ASSURE(sStatsAfter.uKeyBytes >= sStats.uKeyBytes + LONG_KEY_LENGTH + 1);
+
+#ifdef SYMTABLE_STATS
+   /* One lookup that finds its key and one that does not. */
+   SymTable_getStats(oSymTable, &sStats);
+   ASSURE(SymTable_get(oSymTable, "0") == &aiValues[0]);
+   SymTable_getStats(oSymTable, &sStatsAfter);
+   ASSURE(sStatsAfter.uHits == sStats.uHits + 1);
+   ASSURE(sStatsAfter.uMisses == sStats.uMisses);
+   ASSURE(sStatsAfter.uCompares > sStats.uCompares);
+
+   ASSURE(SymTable_get(oSymTable, "missing") == NULL);
+   SymTable_getStats(oSymTable, &sStats);
+   ASSURE(sStats.uHits == sStatsAfter.uHits);
+   ASSURE(sStats.uMisses == sStatsAfter.uMisses + 1);
+#endif
+
+   SymTable_free(oSymTable);
+
+   /* A table made with room for its bindings does not resize as
+      they are added. */
+   oSymTable = SymTable_newWithCapacity(BINDING_COUNT);
+   ASSURE(oSymTable != NULL);
+   SymTable_getStats(oSymTable, &sStats);
+   for (i = 0; i < BINDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+      ASSURE(iSuccessful);
+   }
+   SymTable_getStats(oSymTable, &sStatsAfter);
+   checkStats(oSymTable, &sStatsAfter);
+   ASSURE(sStatsAfter.uResizeCount == sStats.uResizeCount);
+
+   /* Keys that all hash alike make longer chains or probes than the
+      default hash does. */
+   oSymTableColliding = SymTable_newWithHash(constantHash, 0);
+   ASSURE(oSymTableColliding != NULL);
+   for (i = 0; i < COLLIDING_COUNT; i++)
+   {
+      sprintf(acKey, "%d", i);
+      iSuccessful = SymTable_put(oSymTableColliding, acKey,
+         &aiValues[i]);
+      ASSURE(iSuccessful);
+   }
+   SymTable_getStats(oSymTableColliding, &sStats);
+   checkStats(oSymTableColliding, &sStats);
+   ASSURE(sStats.uLongest > 0);
+   ASSURE(sStats.uLongest > sStatsAfter.uLongest ||
+      sStats.uBucketCount == 1);
+
+   SymTable_free(oSymTable);
+   SymTable_free(oSymTableColliding);
+
+#ifndef S_SPLINT_S
+   /* A concurrent table, where there is one. */
+   oSymTable = SymTable_newConcurrent();
+   if (oSymTable != NULL)
+   {
+      for (i = 0; i < BINDING_COUNT; i++)
+      {
+         sprintf(acKey, "%d", i);
+         iSuccessful = SymTable_put(oSymTable, acKey, &aiValues[i]);
+         ASSURE(iSuccessful);
+      }
+      SymTable_getStats(oSymTable, &sStats);
+      checkStats(oSymTable, &sStats);
+      ASSURE(sStats.uLength == BINDING_COUNT);
+      SymTable_free(oSymTable);
+   }
+#endif
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Test the ability of a SymTable object to be large, that is, to
+   contain iBindingCount bindings. Write the time consumed to stdout. */
+
+static void testLargeTable(int iBindingCount)
+{
+   enum {MAX_KEY_LENGTH = 10};
+   enum {MAX_AVERAGE_CHAIN_LENGTH = 2};
+
+   SymTable_T oSymTable;
+   SymTable_T oSymTableSmall;
+   char acKey[MAX_KEY_LENGTH];
+   char *pcValue;
+   int i;
+   int iSmall;
+   int iLarge;
+   int iSuccessful;
+   clock_t iInitialClock;
+   clock_t iFinalClock;
+   size_t uLength = 0;
+   size_t uLength2;
+   size_t uBucketCount;
+
+   printf("------------------------------------------------------\n");
+   printf("Testing a potentially large SymTable object.\n");
+   printf("No output except CPU time consumed should appear here:\n");
+   fflush(stdout);
+
+   /* Note the current time. */
+   iInitialClock = clock();
+
+   /* Create oSymTableSmall, and put a couple of bindings into it. */
+   oSymTableSmall = SymTable_new();
+   ASSURE(oSymTableSmall != NULL);
+   iSuccessful = SymTable_put(oSymTableSmall, "xxx", "xxx");
+   ASSURE(iSuccessful);
+   iSuccessful = SymTable_put(oSymTableSmall, "yyy", "yyy");
+   ASSURE(iSuccessful);
+
+   /* Create oSymTable, the primary SymTable object. */
+   oSymTable = SymTable_new();
    ASSURE(oSymTable != NULL);
 
    /* Put iBindingCount new bindings into oSymTable.  Each binding's
@@ -830,6 +3479,14 @@ static void testLargeTable(int iBindingCount)
       ASSURE(uLength == (size_t)(i+1));
    }
 
+   /* Make sure oSymTable has expanded enough to keep its average
+      chain length bounded.  An implementation with a single chain
+      reports one bucket and is exempt. */
+   uBucketCount = SymTable_getBucketCount(oSymTable);
+   ASSURE(uBucketCount >= 1);
+   if (uBucketCount > 1)
+      ASSURE(uLength / uBucketCount <= MAX_AVERAGE_CHAIN_LENGTH);
+
    /* Get each binding's value, and make sure that it contains
       the same characters as its key. */
    iSmall = 0;
@@ -954,12 +3611,38 @@ int main(int argc, char *argv[])
    testKeyOwnership();
    testRemove();
    testMap();
+   testMapWhileGrowing();
    testEmptyTable();
    testEmptyKey();
    testNullValue();
    testLongKey();
+   testKeyLength();
+   testBatch();
+   testBulkLoad();
+   testCapacity();
+   testSmallTables();
+#ifndef S_SPLINT_S
+   testConcurrent();
+   testLockFreeReads();
+#endif
+   testMapParallel();
+   testIter();
+   testScan();
+   testFreeze();
+   testSaveAndOpen();
+#ifndef S_SPLINT_S
+   testDurable();
+#endif
+#if defined(SYMTABLE_SHARED) && !defined(S_SPLINT_S)
+   testShared();
+#endif
+   testRemoveAndPutAgain();
    testTableOfTables();
+   testCombinedPut();
+   testCustomHash();
+   testHashQuality();
    testCollisions();
+   testStats();
    testLargeTable(iBindingCount);
 
    printf("------------------------------------------------------\n");